@@ -193,6 +193,51 @@ namespace Cat {
 	 */
 	OID crc32(const Char* str);
 
+	/**
+	 * @brief Calculates the CRC32 hash of a number of bytes, the same hash as crc32(const Char*)
+	 * of a string of them.  Uses the CRC32 instructions when the CPU has them (ARMv8),
+	 * otherwise a slicing-by-8 table.
+	 * @param data The bytes to hash.
+	 * @param length The number of bytes.
+	 * @return A 32 bit unsigned integer representing the CRC32 hash of the bytes.
+	 */
+	OID crc32(const Char* data, Size length);
+
+	/**
+	 * @brief Calculates the CRC-32C (Castagnoli) hash of a number of bytes.
+	 * NOT the same values as crc32(), but the SSE4.2 crc32 instruction computes it, so it
+	 * is faster on x86 CPUs.  Only for hashes that are never compared with a crc32() OID.
+	 * @param data The bytes to hash.
+	 * @param length The number of bytes.
+	 * @return A 32 bit unsigned integer representing the CRC-32C hash of the bytes.
+	 */
+	OID crc32c(const Char* data, Size length);
+
+#if __cplusplus >= 201103L
+	namespace CRC32 {
+		constexpr U32 shiftByte(U32 crc, U32 bits) {
+			return bits == 0 ? crc : shiftByte((crc >> 1) ^ (0xedb88320U & (0U - (crc & 1U))), bits - 1);
+		}
+
+		constexpr U32 update(U32 crc, const Char* str) {
+			return *str ? update(shiftByte(crc ^ (U8)*str, 8), str + 1) : crc;
+		}
+	} // namespace CRC32
+
+	/**
+	 * @brief Calculates the same CRC32 hash as crc32(const Char*), but at compile time for a
+	 * constant string.
+	 *
+	 *     static constexpr OID kResizeSignal = crc32Const("onResize");
+	 *
+	 * @param str The string to hash.
+	 * @return A 32 bit unsigned integer representing the CRC32 hash of the string.
+	 */
+	constexpr OID crc32Const(const Char* str) {
+		return CRC32::update(~0U, str) ^ ~0U;
+	}
+#endif
+
 	/**
 	 * @brief Copies the value of a string and returns a pointer to the newly allocated copy.
 	 * @param str The string to make a copy of.
@@ -32,18 +32,14 @@ namespace Cat {
 		/**
 		 * @brief Increase the retain count by one.
 		 */
-		inline void retain() { m_retainCount.increment(); }
+		inline void retain() { m_retainCount.increment(kMORelaxed); }
 
 		/**
 		 * @brief Decrement the retainCount by one.
 		 * @return True if there are no more references to the Shader.
 		 */
 		inline Boolean release() {
-			m_retainCount.decrement();			
-			if (m_retainCount.val() <= 0) {
-				return true;
-			}
-			return false;
+			return m_retainCount.decrement(kMOAcqRel) <= 0;
 		}
 
 		/**
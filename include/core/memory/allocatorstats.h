@@ -0,0 +1,148 @@
+#ifndef CAT_CORE_MEMORY_ALLOCATORSTATS_H
+#define CAT_CORE_MEMORY_ALLOCATORSTATS_H
+/**
+ * Copyright Catlin Zilinksi, 2013.  All rights reserved.
+ *
+ * allocatorstats.h: Contains the AllocatorStats struct, the counters kept by a
+ * MemoryAllocator when statistics are enabled.
+ *
+ * Author: Catlin Zilinski
+ * Date: Oct 22, 2014
+ */
+
+#include <iostream>
+#include "core/corelib.h"
+
+namespace Cat {
+
+	/**
+	 * The AllocatorStats struct holds the counters of a MemoryAllocator.
+	 *
+	 * Blocks are counted by size class, the log2 of the next power of two of their size.
+	 * Allocation latency is kept as a histogram where bucket i counts the allocations that
+	 * took less than 2^(i+1) nanoseconds (the last bucket counts everything slower).  The
+	 * latency includes the cost of reading the clock, so it is mostly useful to spot the
+	 * slow paths (e.g., a refill or a new chunk) rather than as an exact timing.
+	 */
+	struct AllocatorStats {
+		static const U32 kNumSizeClasses = 32;
+		static const U32 kNumLatencyBuckets = 16;
+
+		U64	allocs;
+		U64	deallocs;
+		U64	failed_allocs;
+		U64	live_bytes;
+		U64	peak_bytes;			// High water mark of live_bytes.
+		U64	capacity_bytes;	// Total bytes the allocator can hand out (0 if unbounded).
+		U64	live_blocks[kNumSizeClasses];
+		U64	latency[kNumLatencyBuckets];
+
+		/**
+		 * Sets all the counters to zero.
+		 */
+		void clear();
+
+		/**
+		 * Adds the counters of other to these.  The peaks are added too, which gives an upper
+		 * bound of the combined peak (the allocators may not all peak at once).
+		 */
+		void merge(const AllocatorStats& other);
+
+		/**
+		 * Records a successful allocation.
+		 * @param size The size of the block allocated.
+		 * @param nanos The time taken to allocate the block.
+		 * @param track_block True to count the block in its size class.
+		 */
+		inline void recordAlloc(U32 size, U64 nanos, Boolean track_block = true);
+
+		/**
+		 * Records a block being deallocated.
+		 * @param size The size of the block deallocated.
+		 */
+		inline void recordDealloc(U32 size);
+
+		/**
+		 * Records a number of bytes being released at once (not counted by size class).
+		 * @param bytes The number of bytes released.
+		 */
+		inline void recordRelease(U64 bytes);
+
+		/**
+		 * Records an allocation that failed.
+		 */
+		inline void recordFailure();
+
+		/**
+		 * Records the allocator being reset, so nothing is live anymore.
+		 */
+		inline void recordReset();
+
+		static inline U32 getSizeClass(U32 size);
+		static inline U32 getLatencyBucket(U64 nanos);
+	};
+
+	/**
+	 * Prints the statistics in a human readable form.
+	 * @param out The stream to print to.
+	 * @param stats The AllocatorStats to print.
+	 */
+	void dumpAllocatorStats(std::ostream& out, const AllocatorStats& stats);
+
+	inline void AllocatorStats::recordAlloc(U32 size, U64 nanos, Boolean track_block) {
+		allocs++;
+		live_bytes += size;
+		if (live_bytes > peak_bytes) {
+			peak_bytes = live_bytes;
+		}
+		if (track_block) {
+			live_blocks[getSizeClass(size)]++;
+		}
+		latency[getLatencyBucket(nanos)]++;
+	}
+
+	inline void AllocatorStats::recordDealloc(U32 size) {
+		deallocs++;
+		live_bytes -= size;
+		live_blocks[getSizeClass(size)]--;
+	}
+
+	inline void AllocatorStats::recordRelease(U64 bytes) {
+		deallocs++;
+		live_bytes -= bytes;
+	}
+
+	inline void AllocatorStats::recordFailure() {
+		failed_allocs++;
+	}
+
+	inline void AllocatorStats::recordReset() {
+		live_bytes = 0;
+		for (U32 i = 0; i < kNumSizeClasses; i++) {
+			live_blocks[i] = 0;
+		}
+	}
+
+	inline U32 AllocatorStats::getSizeClass(U32 size) {
+		if (size <= 1) { return 0; }
+#if defined (__GNUC__)
+		U32 size_class = 32 - __builtin_clz(size - 1);
+#else
+		U32 size_class = 0;
+		size--;
+		while (size) { size >>= 1; size_class++; }
+#endif
+		return size_class < kNumSizeClasses ? size_class : kNumSizeClasses - 1;
+	}
+
+	inline U32 AllocatorStats::getLatencyBucket(U64 nanos) {
+		U32 bucket = 0;
+		while ((nanos >>= 1) && bucket < kNumLatencyBuckets - 1) {
+			bucket++;
+		}
+		return bucket;
+	}
+
+} // namespace Cat
+
+#endif // CAT_CORE_MEMORY_ALLOCATORSTATS_H
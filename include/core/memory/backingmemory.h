@@ -0,0 +1,60 @@
+#ifndef CAT_CORE_MEMORY_BACKINGMEMORY_H
+#define CAT_CORE_MEMORY_BACKINGMEMORY_H
+/**
+ * Copyright Catlin Zilinksi, 2013.  All rights reserved.
+ *
+ * backingmemory.h: Contains the functions used by the MemoryAllocators to get their
+ * backing memory, either from malloc or directly from the OS (huge pages / NUMA node).
+ *
+ * Author: Catlin Zilinski
+ * Date: Oct 20, 2014
+ */
+
+#include "core/memory/memoryallocator.h"
+
+namespace Cat {
+
+	/**
+	 * Where the memory of a BackingMemory actually came from.
+	 */
+	enum BackingSource { BS_NONE, BS_MALLOC, BS_MMAP, BS_HUGETLB };
+
+	/**
+	 * A region of memory used to back a MemoryAllocator.
+	 */
+	struct BackingMemory {
+		VPtr				ptr;
+		Size				size;		// The size actually mapped (may be rounded up).
+		BackingSource	source;
+	};
+
+	/**
+	 * The size of huge pages that mapped regions are aligned and rounded to.
+	 */
+	const Size kHugePageSize = 2*1024*1024;
+
+	/**
+	 * @brief Allocates the memory to back an allocator.
+	 *
+	 * With no flags and no NUMA node, the memory simply comes from malloc.  Otherwise it
+	 * is mapped from the OS.  With AllocatorFlags::kAFHugePages, explicit huge pages are
+	 * tried first, then a huge page aligned mapping advised to use transparent huge pages.
+	 * If a NUMA node is given, the pages are bound to that node.  Anything unsupported
+	 * on the platform falls back gracefully (with a warning).
+	 * @param memory The BackingMemory to fill in.
+	 * @param size The minimum number of bytes needed.
+	 * @param flags The AllocatorFlags.
+	 * @param numa_node The NUMA node to bind the memory to, or -1 for none.
+	 * @return True if the memory was allocated.
+	 */
+	Boolean allocBackingMemory(BackingMemory* memory, Size size, BitField32 flags = AllocatorFlags::kAFNone, I32 numa_node = -1);
+
+	/**
+	 * @brief Returns the memory of a BackingMemory to wherever it came from.
+	 * @param memory The BackingMemory to free.
+	 */
+	void freeBackingMemory(BackingMemory* memory);
+
+} // namespace Cat
+
+#endif // CAT_CORE_MEMORY_BACKINGMEMORY_H
@@ -11,7 +11,7 @@
  * Date: Sept 23, 2013
  */
 
-#include "core/memory/memoryallocator.h"
+#include "core/memory/backingmemory.h"
 
 namespace Cat {
 
@@ -27,8 +27,12 @@ namespace Cat {
 			 * Each block will be aligned to the size of the block.
 			 * @param block_size The size each block will be, in bytes (must be a power of two).
 			 * @param number_of_blocks The number of blocks to allocate.
+			 * @param region_alignment OPTIONAL alignment for the start of the whole region, if larger 
+			 * than the block size (must be a power of two).
+			 * @param flags OPTIONAL AllocatorFlags for the backing memory (e.g., kAFHugePages).
+			 * @param numa_node OPTIONAL NUMA node to bind the backing memory to, or -1 for none.
 			 */
-			ChunkMemoryAllocator(U32 chunk_size, U32 number_of_chunks, OID id = 0);
+			ChunkMemoryAllocator(U32 chunk_size, U32 number_of_chunks, OID id = 0, U32 region_alignment = 0, BitField32 flags = AllocatorFlags::kAFNone, I32 numa_node = -1);
 			~ChunkMemoryAllocator();
 
 			/**
@@ -64,6 +68,11 @@ namespace Cat {
 			 */
 			OID getOID();
 
+			/**
+			 * @see MemoryAllocator::getCapacity()
+			 */
+			U64 getCapacity();
+
 			/**
 			 * checks to see whether or not a specified piece of memory lies within this 
 			 * allocators control.
@@ -82,6 +91,7 @@ namespace Cat {
 			MemAddr	next_block_;	
 			MemAddr	aligned_memory_block_;
 			MemAddr	unaligned_memory_block_;
+			BackingMemory	backing_;
 			U32		block_size_;
 			U32		number_of_blocks_;
 			OID		id_;
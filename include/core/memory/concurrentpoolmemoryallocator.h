@@ -0,0 +1,194 @@
+#ifndef CAT_CORE_MEMORY_CONCURRENTPOOLMEMORYALLOCATOR_H
+#define CAT_CORE_MEMORY_CONCURRENTPOOLMEMORYALLOCATOR_H
+/**
+ * Copyright Catlin Zilinksi, 2013.  All rights reserved.
+ *
+ * concurrentpoolmemoryallocator.h: Contains the ConcurrentPoolMemoryAllocator class, a
+ * PoolMemoryAllocator that can be shared between threads without an external lock.
+ *
+ * Author: Catlin Zilinski
+ * Date: Oct 17, 2014
+ */
+
+#include "core/memory/backingmemory.h"
+#include "core/threading/atomic.h"
+
+#if !defined (OS_WINDOWS)
+#include <pthread.h>
+#endif
+
+namespace Cat {
+
+	/**
+	 * The ConcurrentPoolMemoryAllocator class hands out blocks of the same size, like the
+	 * PoolMemoryAllocator, but can be used by many threads at once.
+	 *
+	 * The free blocks are kept in a lock-free list whose head stores the index of the first
+	 * free block together with a tag that is bumped on every change (to avoid the ABA problem).
+	 * Each thread also keeps a small cache (magazine) of blocks, which is refilled from and
+	 * spilled back to the shared list in batches, so most alloc() / dealloc() calls never
+	 * touch shared memory at all.
+	 *
+	 * Because of the caches, up to magazine_size blocks per thread may be unavailable to
+	 * other threads.  reset(), free() and enableStats() must not be called while other
+	 * threads are using the allocator.
+	 *
+	 * The statistics are kept per thread and summed by getStats(), so the counts are only
+	 * a snapshot while other threads are allocating.  The peak is the high water mark of
+	 * blocks taken out of the shared list (including the blocks cached by threads), which
+	 * is the number of blocks the pool actually needed.
+	 * BLOCK SIZE MUST BE GREATER THAN OR EQUAL TO SIZE OF A U32
+	 */
+	class ConcurrentPoolMemoryAllocator : public MemoryAllocator {
+		public:
+			/**
+			 * Creates a new MemoryAllocator that has a certain number of fixed size blocks available.
+			 * Each block will be aligned.
+			 * @param block_size The size each block will be, in bytes.
+			 * @param number_of_blocks The number of blocks to allocate.
+			 * @param block_alignment The alignment we need to make sure each block is aligned in memory. (Must be Power of 2)
+			 * @param magazine_size The max number of blocks each thread caches (must be >= 2).
+			 * @param flags OPTIONAL AllocatorFlags for the backing memory (e.g., kAFHugePages).
+			 * @param numa_node OPTIONAL NUMA node to bind the backing memory to, or -1 for none.
+			 */
+			ConcurrentPoolMemoryAllocator(U32 block_size, U32 number_of_blocks, U32 block_alignment, U32 magazine_size = 32, OID id = 0, BitField32 flags = AllocatorFlags::kAFNone, I32 numa_node = -1);
+			~ConcurrentPoolMemoryAllocator();
+
+			/**
+			 * Allocates a block of memory, from the calling thread's cache if possible.
+			 * @return A pointer to the block of memory, or null on error
+			 */
+			VPtr alloc();
+			/**
+			 * block_size parameter is ignored.
+			 * @see allocate();
+			 */
+			VPtr alloc(U32 block_size, U32 alignment);
+
+			/**
+			 * Returns a block to the calling thread's cache.  The block may have been
+			 * allocated by any thread.
+			 */
+			void dealloc(VPtr memory_block);
+			void dealloc();
+			/**
+			 * Resets the MemoryAllocator to its initial state and empties all the thread caches.
+			 * NOT thread safe.
+			 */
+			void reset();
+			/**
+			 * Frees all the memory associated with this MemoryAllocator.
+			 * The MemoryAllocator can no longer be used after free() is called.
+			 * NOT thread safe.
+			 */
+			void free();
+
+			/**
+			 * Returns all the blocks cached by the calling thread to the shared list.
+			 */
+			void flushThreadCache();
+
+			/**
+			 * @see MemoryAllocator::getOID()
+			 */
+			OID getOID();
+
+			/**
+			 * Starts or stops the statistics of every thread.
+			 * @see MemoryAllocator::enableStats()
+			 */
+			void enableStats(Boolean enable);
+
+			/**
+			 * Sums the statistics of all the threads.
+			 * @see MemoryAllocator::getStats()
+			 */
+			Boolean getStats(AllocatorStats* stats);
+
+			/**
+			 * @see MemoryAllocator::getCapacity()
+			 */
+			U64 getCapacity();
+
+			inline U32 getBlockSize() const;
+			inline U32 getNumberOfBlocks() const;
+			inline U32 getMagazineSize() const;
+			inline MemAddr getAlignedMemoryBlock() const;
+			inline MemAddr getUnalignedMemoryBlock() const;
+		private:
+			static const U32 kNilBlock = 0xFFFFFFFF;
+
+			/* The per thread cache of block indices. */
+			struct Magazine {
+				ConcurrentPoolMemoryAllocator*	owner;
+				Magazine*								next_magazine;
+				AtomicU64								in_use;
+				AllocatorStats							stats;
+				U32										count;
+				U32										blocks[1];
+			};
+
+			inline VPtr blockAddress(U32 index) const;
+			inline U32 blockIndex(VPtr block) const;
+			inline U32& nextBlock(U32 index) const;
+
+			Magazine* getMagazine();
+			U32 popBlocks(U32* blocks, U32 max_blocks);
+			void pushBlocks(const U32* blocks, U32 count);
+			void addTakenBlocks(U32 count);
+			void removeTakenBlocks(U32 count);
+
+			static void releaseMagazine(VPtr magazine);
+
+			AtomicU64	free_head_;		// (tag << 32) | index of first free block
+			AtomicU64	magazines_;		// Every Magazine ever created, linked by next_magazine
+			AtomicU64	taken_blocks_;		// Blocks out of the shared list (only kept with stats)
+			AtomicU64	peak_taken_blocks_;
+			MemAddr		aligned_memory_block_;
+			MemAddr		unaligned_memory_block_;
+			BackingMemory	backing_;
+			U32			block_size_;
+			U32			number_of_blocks_;
+			U32			magazine_size_;
+			U32			batch_size_;
+			Boolean		has_key_;
+#if defined (OS_WINDOWS)
+			DWORD			cache_key_;
+#else
+			pthread_key_t	cache_key_;
+#endif
+			OID			id_;
+	};
+
+	inline U32 ConcurrentPoolMemoryAllocator::getBlockSize() const {
+		return block_size_;
+	}
+	inline U32 ConcurrentPoolMemoryAllocator::getNumberOfBlocks() const {
+		return number_of_blocks_;
+	}
+	inline U32 ConcurrentPoolMemoryAllocator::getMagazineSize() const {
+		return magazine_size_;
+	}
+	inline MemAddr ConcurrentPoolMemoryAllocator::getAlignedMemoryBlock() const {
+		return aligned_memory_block_;
+	}
+	inline MemAddr ConcurrentPoolMemoryAllocator::getUnalignedMemoryBlock() const {
+		return unaligned_memory_block_;
+	}
+
+	inline VPtr ConcurrentPoolMemoryAllocator::blockAddress(U32 index) const {
+		MemAddr block;
+		block.addr = aligned_memory_block_.addr + ((Addr)index * block_size_);
+		return block.ptr;
+	}
+	inline U32 ConcurrentPoolMemoryAllocator::blockIndex(VPtr block) const {
+		return (U32)(((Addr)block - aligned_memory_block_.addr) / block_size_);
+	}
+	inline U32& ConcurrentPoolMemoryAllocator::nextBlock(U32 index) const {
+		return *((U32*)blockAddress(index));
+	}
+
+} // namespace Cat
+
+#endif // CAT_CORE_MEMORY_CONCURRENTPOOLMEMORYALLOCATOR_H
+
@@ -3,8 +3,8 @@
 /**
  * Copyright Catlin Zilinksi, 2013.  All rights reserved.
  *
- * dynamicchunkmemoryallocator.h: Contains the DynamicChunkMemoryAllocator class, which basically 
- * contains a list of ChunkMemoryAllocators, and picks the best one based on the size, and if there's not 
+ * dynamicchunkmemoryallocator.h: Contains the DynamicChunkMemoryAllocator class, which basically
+ * contains a list of ChunkMemoryAllocators, and picks the best one based on the size, and if there's not
  * one big enough, it trys to create a new one.
  *
  * Author: Catlin Zilinski
@@ -19,14 +19,32 @@ namespace Cat {
 
 	struct DCAllocatorNode {
 		ChunkMemoryAllocator* 	allocator;
-		DCAllocatorNode*			next;
+		DCAllocatorNode*			next;			// Next chunk in the same size class
 		DCAllocatorNode*			prev;
+		DCAllocatorNode*			next_free;	// Next chunk in the same size class with free blocks
+		DCAllocatorNode*			prev_free;
+		U32							size_class;
+		Boolean						has_free;
 	};
 
 	/**
-	 * The DynamicChunkMemoryAllocator class is used when allocating and deallocating blocks of the same 
-	 * size (e.g., all the same type of object).  
+	 * An entry in the page map, maps the page number of an address to the chunk that owns it.
+	 */
+	struct DCPageEntry {
+		Addr							page;
+		DCAllocatorNode*			node;
+	};
+
+	/**
+	 * The DynamicChunkMemoryAllocator class is used when allocating and deallocating blocks of the same
+	 * size (e.g., all the same type of object).
 	 * BLOCK SIZE MUST BE GREATER THAN OR EQUAL TO SIZE OF A POINTER AND A POWER OF 2
+	 *
+	 * The chunks are kept in a table indexed by size class (the log2 of the block size), each
+	 * class holding a chain of chunks and a list of the chunks that still have free blocks, so
+	 * finding a chunk to allocate from is O(1).  The region of each chunk is aligned to a page,
+	 * and a hashed page map from page number to chunk makes finding the owner of a block in
+	 * dealloc() O(1) as well.
 	 */
 	class DynamicChunkMemoryAllocator : public MemoryAllocator {
 		public:
@@ -43,8 +61,8 @@ namespace Cat {
 			 */
 			VPtr alloc();
 			/**
-			 * Allocate a new object in a block of memory.  The block_size must be 
-			 * smaller than the size of each chunk.  Also, if the blocksize + calculated alignment offset 
+			 * Allocate a new object in a block of memory.  The block_size must be
+			 * smaller than the size of each chunk.  Also, if the blocksize + calculated alignment offset
 			 * must be <= the chunk size.
 			 * @param block_size The size of the object being allocated.
 			 * @param alignment The alignment required for the object.
@@ -60,8 +78,8 @@ namespace Cat {
 			 */
 			void reset();
 			/**
-			 * Frees all the memory associated with this MemoryAllocator.  
-			 * Unlike most MemoryAllocators, this one can be used after it is free'd by adding 
+			 * Frees all the memory associated with this MemoryAllocator.
+			 * Unlike most MemoryAllocators, this one can be used after it is free'd by adding
 			 * new allocators again.
 			 */
 			void free();
@@ -72,7 +90,13 @@ namespace Cat {
 			OID getOID();
 
 			/**
-			 * Add a new ChunkAllocator to the available allocators.
+			 * @see MemoryAllocator::getCapacity()
+			 */
+			U64 getCapacity();
+
+			/**
+			 * Add a new ChunkAllocator to the available allocators.  If there are already
+			 * chunks of the same size, the new one is added to the chain for that size.
 			 * @param chunk_size The size of each block of memory.
 			 * @param number_of_chunks The number of memory blocks.
 			 * @return True The created ChunkMemoryAllocator if successfull, else, NIL.
@@ -80,36 +104,71 @@ namespace Cat {
 			ChunkMemoryAllocator* addChunk(U32 chunk_size, U32 number_of_chunks);
 
 			/**
-			 * Remove a ChunkAllocator from the available allocators.
-			 * @param chunk_size: The block size of the allocator we are removing.
+			 * Remove all the ChunkAllocators with a block size from the available allocators.
+			 * @param chunk_size: The block size of the allocators we are removing.
 			 */
 			void freeChunk(U32 chunk_size);
 
 			/**
-			 * Gets the ChunkAllocator associated with the block size.
+			 * Gets the (most recently added) ChunkAllocator associated with the block size.
 			 */
 			ChunkMemoryAllocator* getChunk(U32 chunk_size);
 
+			/**
+			 * Sets whether or not a new chunk is added when all the chunks for a size are full.
+			 * By default, a chunk is only created automatically for sizes that have none.
+			 * @param growable True to add chunks when a size runs out of blocks.
+			 */
+			inline void setGrowable(Boolean growable);
+
+			inline Boolean isGrowable() const;
 			inline U32 getNumberOfAllocators() const;
 			inline U32 getDefaultNumberOfBlocks() const;
 			Boolean canFit(U32 block_size) const;
 		private:
+			static const U32 kNumSizeClasses = 32;
+			static const U32 kPageShift = 12;
+
 			static inline U32 getNextHighestPowerOfTwo(U32 val);
+			static inline U32 getSizeClass(U32 val);
+			static inline U32 hashPage(Addr page);
+
+			void addToFreeList(DCAllocatorNode* node);
+			void removeFromFreeList(DCAllocatorNode* node);
+
+			Boolean mapPages(DCAllocatorNode* node);
+			void unmapPages(DCAllocatorNode* node);
+			DCAllocatorNode* findPage(Addr page) const;
+			Boolean insertPage(Addr page, DCAllocatorNode* node);
+			void removePage(Addr page);
+			Boolean resizePageMap(U32 capacity);
 
 			U32							number_of_allocators_;
 			U32							default_number_of_blocks_;
-			ChunkMemoryAllocator*	last_accessed_;
-			DCAllocatorNode*			allocators_;
+			U32							class_mask_;		// Bit set for each size class with a chunk
+			U32							free_mask_;			// Bit set for each size class with a free block
+			DCAllocatorNode*			classes_[kNumSizeClasses];
+			DCAllocatorNode*			free_classes_[kNumSizeClasses];
+			DCPageEntry*				page_map_;
+			U32							page_map_capacity_;	// Always a power of two
+			U32							page_map_size_;
+			Boolean						growable_;
 			OID							id_;
 	};
 
-	inline U32 DynamicChunkMemoryAllocator::getNumberOfAllocators() const { 
+	inline void DynamicChunkMemoryAllocator::setGrowable(Boolean growable) {
+		growable_ = growable;
+	}
+	inline Boolean DynamicChunkMemoryAllocator::isGrowable() const {
+		return growable_;
+	}
+	inline U32 DynamicChunkMemoryAllocator::getNumberOfAllocators() const {
 		return number_of_allocators_;
 	}
 	inline U32 DynamicChunkMemoryAllocator::getDefaultNumberOfBlocks() const {
 		return default_number_of_blocks_;
 	}
-	
+
 	inline U32 DynamicChunkMemoryAllocator::getNextHighestPowerOfTwo(U32 val) {
 		val--;
 		val |= val >> 1;
@@ -120,10 +179,38 @@ namespace Cat {
 		return (val+1);
 	}
 
-	
+	/*
+	 * The size class is the log2 of the next highest power of two,
+	 * i.e., the index of the block size that fits val.
+	 */
+	inline U32 DynamicChunkMemoryAllocator::getSizeClass(U32 val) {
+		if (val <= 1) { return 0; }
+#if defined (__GNUC__)
+		return 32 - __builtin_clz(val - 1);
+#else
+		val = getNextHighestPowerOfTwo(val);
+		U32 size_class = 0;
+		while (val >>= 1) { size_class++; }
+		return size_class;
+#endif
+	}
+
+	/*
+	 * Mixes the bits of the page number (murmur3 finalizer), so the low bits
+	 * can be used to index the page map.
+	 */
+	inline U32 DynamicChunkMemoryAllocator::hashPage(Addr page) {
+		U32 hash = (U32)((U64)page ^ ((U64)page >> 32));
+		hash ^= hash >> 16;
+		hash *= 0x85ebca6b;
+		hash ^= hash >> 13;
+		hash *= 0xc2b2ae35;
+		hash ^= hash >> 16;
+		return hash;
+	}
+
 } // namespace Cat
 
 #endif // CAT_CORE_MEMORY_DYNAMICCHUNKMEMORYALLOCATOR_H
-	
 
 
@@ -14,17 +14,34 @@
 
 #include <new>
 #include "core/corelib.h"
+#include "core/memory/allocatorstats.h"
 
 namespace Cat {
+
+	/**
+	 * Flags to select optional behaviour of the MemoryAllocators.
+	 */
+	namespace AllocatorFlags {
+		enum Enum {
+			kAFNone = 0x0,
+			kAFConcurrent = 0x1,		// Allocator can be shared between threads without a lock.
+			kAFHugePages = 0x2,		// Back the allocator with huge pages if possible.
+			kAFStats = 0x4,			// Keep AllocatorStats for the allocator.
+			kAFGrowable = 0x8,		// Chain a new block instead of failing when the memory runs out.
+		};
+	} // namespace AllocatorFlags
 	
 	/**
 	 * The MemoryAllocator interface defines the basic methods required for a 
 	 * MemoryAllocator to implement, namly, allocate, deallocate.
+	 *
+	 * Every MemoryAllocator can optionally keep AllocatorStats.  They are off by default
+	 * and cost a single pointer test per call while off.
 	 */
 	class MemoryAllocator {
 		public:
-
-			virtual ~MemoryAllocator() {}
+			MemoryAllocator() : stats_(NIL) {}
+			virtual ~MemoryAllocator();
 			/**
 			 * Allocates a new block of memory from the MemoryAllocator.
 			 * Can be an error to simply call it if the MemoryAllocator does not suport 
@@ -60,6 +77,34 @@ namespace Cat {
 			 */
 			virtual OID getOID() = 0;
 
+			/**
+			 * Gets the total number of bytes the allocator can hand out.
+			 * @return The capacity in bytes, or 0 if the allocator can grow.
+			 */
+			virtual U64 getCapacity() { return 0; }
+
+			/**
+			 * Turns the statistics on or off.  Turning them on starts all the counters
+			 * at zero, so allocations made before are not counted.
+			 * @param enable True to keep statistics.
+			 */
+			virtual void enableStats(Boolean enable);
+
+			/**
+			 * Gets a copy of the current statistics.
+			 * @param stats The AllocatorStats to copy the statistics into.
+			 * @return False if statistics are not enabled.
+			 */
+			virtual Boolean getStats(AllocatorStats* stats);
+
+			/**
+			 * Prints the current statistics to a stream.
+			 * @param out The stream to print to.
+			 */
+			void dumpStats(std::ostream& out);
+
+			inline Boolean isStatsEnabled() const;
+
 			/**
 			 * Returns a aligned memory address
 			 * @param address The Address to align
@@ -67,9 +112,20 @@ namespace Cat {
 			 * @return The aligned memory address.
 			 */
 			static inline MemAddr getAlignedMemoryAddress(MemAddr addr, U32 alignment);
-			
+
+		protected:
+			/**
+			 * Gets the time in nanoseconds used to time allocations for the statistics.
+			 */
+			static U64 getStatsTime();
+
+			AllocatorStats* stats_;		// NIL unless statistics are enabled.
 	};
 
+	inline Boolean MemoryAllocator::isStatsEnabled() const {
+		return stats_ != NIL;
+	}
+
 	inline MemAddr MemoryAllocator::getAlignedMemoryAddress(MemAddr addr, U32 alignment)  {
 		// If is already aligned, return it
 		D(assert(alignment > 0));
@@ -82,14 +138,21 @@ namespace Cat {
 
 }
 
+/* A non-throwing new may return NULL, then the new expression skips the constructor. */
+#if __cplusplus >= 201103L
+#define CAT_NOTHROW noexcept
+#else
+#define CAT_NOTHROW throw()
+#endif
+
 /**
  * The overloaded positional new operator to allocate memory from a 
- * MemoryAllocator
+ * MemoryAllocator, gives NULL if the MemoryAllocator has no memory left.
  */
-inline void* operator new(size_t nbytes, cc::MemoryAllocator& allocator) {
+inline void* operator new(size_t nbytes, Cat::MemoryAllocator& allocator) CAT_NOTHROW {
 	return allocator.alloc(nbytes, 0);
 }
-inline void* operator new(size_t nbytes, cc::MemoryAllocator& allocator, cc::U32 alignment) {
+inline void* operator new(size_t nbytes, Cat::MemoryAllocator& allocator, Cat::U32 alignment) CAT_NOTHROW {
 	return allocator.alloc(nbytes, alignment);
 }
 
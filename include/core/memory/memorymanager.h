@@ -15,6 +15,7 @@
 #include "core/memory/memoryallocator.h"
 
 namespace Cat {
+
 	
 	/**
 	 * The MemoryManager class is a singleton that contains methods to create and store different 
@@ -53,31 +54,41 @@ namespace Cat {
 			 * @param block_size The size of each block for the allocator to return
 			 * @param number_of_blocks The number of blocks able to allocate
 			 * @param alignment The memory Alignment factor for the blocks
+			 * @param flags The AllocatorFlags, kAFConcurrent creates a ConcurrentPoolMemoryAllocator, 
+			 * kAFHugePages backs it with huge pages, kAFStats enables its statistics.
+			 * @param numa_node The NUMA node to bind the memory to, or -1 for none.
 			 * @return A nonzero ID for the allocator to use with the get() instance method.
 			 */
-			OID createPoolAllocator(U32 block_size, U32 number_of_blocks, U32 alignment);
+			OID createPoolAllocator(U32 block_size, U32 number_of_blocks, U32 alignment, BitField32 flags = AllocatorFlags::kAFNone, I32 numa_node = -1);
 
 			/**
 			 * Creates a new StackMemoryAllocator to use in allocating new objects.
 			 * @param stack_size The amount of memory in bytes to allocate for the stack.
+			 * @param flags The AllocatorFlags, kAFHugePages backs it with huge pages, kAFStats
+			 * enables its statistics.
+			 * @param numa_node The NUMA node to bind the memory to, or -1 for none.
 			 * @return A nonzero ID for the allocator to use with the get() instance method.
 			 */
-			OID createStackAllocator(U32 stack_size);
+			OID createStackAllocator(U32 stack_size, BitField32 flags = AllocatorFlags::kAFNone, I32 numa_node = -1);
 
 			/**
 			 * Creates a new ChunkMemoryAllocator to use in allocating new objects.
 			 * @param chunk_size The size of each block of memory
 			 * @param number_of_chunks The total number of blocks available.
+			 * @param flags The AllocatorFlags, kAFHugePages backs it with huge pages, kAFStats
+			 * enables its statistics.
+			 * @param numa_node The NUMA node to bind the memory to, or -1 for none.
 			 * @return A nonzero ID for the allocator to use with the get() instance method.
 			 */
-			OID createChunkAllocator(U32 chunk_size, U32 number_of_chunks);
+			OID createChunkAllocator(U32 chunk_size, U32 number_of_chunks, BitField32 flags = AllocatorFlags::kAFNone, I32 numa_node = -1);
 
 			/**
 			 * Creates a new DynamicChunkMemoryAllocator to use in allocating new objects.
 			 * @param default_number_of_chunks The default number of blocks to allocate.
+			 * @param flags The AllocatorFlags, kAFStats enables its statistics.
 			 * @return A nonzero ID for the allocator to use with the get() instance method.
 			 */
-			OID createDynamicChunkAllocator(U32 default_number_of_chunks = 32);
+			OID createDynamicChunkAllocator(U32 default_number_of_chunks = 32, BitField32 flags = AllocatorFlags::kAFNone);
 
 			/**
 			 * Frees the memory used by the allocator and removes it from the list.
@@ -104,6 +115,19 @@ namespace Cat {
 			 */
 			U32 getMaxAllocators() const;
 
+			/**
+			 * Sums the statistics of all the allocators that have statistics enabled.
+			 * @param stats The AllocatorStats to store the totals in.
+			 * @return The number of allocators with statistics.
+			 */
+			U32 getStats(AllocatorStats* stats);
+
+			/**
+			 * Prints the statistics of each allocator that has them, followed by the totals.
+			 * @param out The stream to print to.
+			 */
+			void dumpStats(std::ostream& out);
+
 
 			
 			friend inline U32 len(MemoryManager* manager);
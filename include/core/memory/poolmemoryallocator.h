@@ -10,7 +10,7 @@
  * Date: Sept 20, 2013
  */
 
-#include "core/memory/memoryallocator.h"
+#include "core/memory/backingmemory.h"
 
 namespace Cat {
 
@@ -27,8 +27,10 @@ namespace Cat {
 			 * @param block_size The size each block will be, in bytes.
 			 * @param number_of_blocks The number of blocks to allocate.
 			 * @param block_alignment The alignment we need to make sure each block is aligned in memory. (Must be Power of 2)
+			 * @param flags OPTIONAL AllocatorFlags for the backing memory (e.g., kAFHugePages).
+			 * @param numa_node OPTIONAL NUMA node to bind the backing memory to, or -1 for none.
 			 */
-			PoolMemoryAllocator(U32 block_size, U32 number_of_blocks, U32 block_alignment, OID id = 0);
+			PoolMemoryAllocator(U32 block_size, U32 number_of_blocks, U32 block_alignment, OID id = 0, BitField32 flags = AllocatorFlags::kAFNone, I32 numa_node = -1);
 			~PoolMemoryAllocator();
 
 			/**
@@ -61,6 +63,11 @@ namespace Cat {
 			 */
 			OID getOID();
 
+			/**
+			 * @see MemoryAllocator::getCapacity()
+			 */
+			U64 getCapacity();
+
 
 			inline U32 getBlockSize() const;
 			inline U32 getNumberOfBlocks() const;
@@ -71,6 +78,7 @@ namespace Cat {
 			MemAddr	next_block_;	
 			MemAddr	aligned_memory_block_;
 			MemAddr	unaligned_memory_block_;
+			BackingMemory	backing_;
 			U32		block_size_;
 			U32		number_of_blocks_;
 			OID		id_;
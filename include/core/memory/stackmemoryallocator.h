@@ -10,20 +10,38 @@
  * Date: Sept 20, 2013
  */
 
-#include "core/memory/memoryallocator.h"
+#include <cstring>
+#include "core/memory/backingmemory.h"
 
 namespace Cat {
 
+	/**
+	 * A position in a StackMemoryAllocator that it can be rolled back to.
+	 */
+	typedef MemAddr StackMarker;
+
 	/**
 	 * The StackMemoryAllocator class is used when allocating and deallocating blocks of different 
 	 * sizes.  When deallocating, can only deallocate to a set marker. 
+	 *
+	 * Besides the markers set with mark(), any number of positions can be saved with
+	 * getMarker() and rolled back to with rollback() (usually by a StackScope), as long as
+	 * they are rolled back in the reverse order they were taken.
+	 *
+	 * With AllocatorFlags::kAFGrowable, an allocation that does not fit chains a new block
+	 * of memory instead of failing.  The chained blocks are freed when the stack is rolled
+	 * back past them (the last one is kept to be reused).  In debug builds, the memory
+	 * released by a rollback, dealloc() or reset() is filled with kStackPoison.
 	 */
 	class StackMemoryAllocator : public MemoryAllocator {
 		public:
 			/**
 			 * Creates a new MemoryAllocator of a certain size to create a stack from.
+			 * With AllocatorFlags::kAFGrowable, each chained block is at least stack_size bytes.
+			 * @param flags OPTIONAL AllocatorFlags for the backing memory (e.g., kAFHugePages).
+			 * @param numa_node OPTIONAL NUMA node to bind the backing memory to, or -1 for none.
 			 */
-			StackMemoryAllocator(U32 stack_size, OID id = 0);
+			StackMemoryAllocator(U32 stack_size, OID id = 0, BitField32 flags = AllocatorFlags::kAFNone, I32 numa_node = -1);
 			~StackMemoryAllocator();
 
 			/**
@@ -39,7 +57,9 @@ namespace Cat {
 
 			void dealloc();
 			/**
-			 * Is an error to call dealloc with memory block for StackMemoryAllocator
+			 * Does nothing, a single block cannot be deallocated from the stack.  This lets
+			 * containers use the stack as an arena, their memory is released when the stack
+			 * is deallocated to a marker or reset.
 			 */
 			void dealloc(VPtr memory_block);
 
@@ -60,28 +80,133 @@ namespace Cat {
 			 */
 			void mark();
 
+			/**
+			 * Gets the current top of the stack, to roll back to later.
+			 * @return The StackMarker of the current top of the stack.
+			 */
+			inline StackMarker getMarker() const;
+
+			/**
+			 * Releases everything allocated since the marker was taken.  Any markers taken
+			 * after it are no longer valid.
+			 * @param marker A StackMarker from getMarker().
+			 */
+			void rollback(const StackMarker& marker);
+
 			/**
 			 * @see MemoryAllocator::getOID()
 			 */
 			OID getOID();
 
+			/**
+			 * @see MemoryAllocator::getCapacity()
+			 */
+			U64 getCapacity();
+
 			inline U32 getStackSize() const;
 			inline MemAddr getNextBlock() const;
+			/**
+			 * @return The number of blocks chained after the initial block.
+			 */
+			inline U32 getNumberOfChainedBlocks() const;
+
+			/**
+			 * The byte released memory is filled with in debug builds.
+			 */
+			static const U8 kStackPoison = 0xCD;
 		private:
+			/* The header at the start of a chained block. */
+			struct ChainedBlock {
+				ChainedBlock*	prev_block;
+				MemAddr			prev_next_block;	// The next_block_ of the previous block when chained.
+				MemAddr			end;
+				BackingMemory	backing;
+			};
+
+			Boolean chainBlock(U32 block_size, U32 alignment);
+			void popChainedBlock();
+			static inline void poison(Addr from, Addr to);
+
 			MemAddr	next_block_;	
 			MemAddr	marker_;
+			MemAddr	limit_;			// End of the memory usable in the current block.
 			MemAddr	unaligned_memory_block_;
+			BackingMemory	backing_;
+			ChainedBlock*	current_block_;	// NIL while in the initial block.
+			ChainedBlock*	spare_block_;
+			U64		chained_size_;
+			U32		number_of_chained_blocks_;
 			U32		stack_size_;
+			BitField32	flags_;
+			I32		numa_node_;
 			OID 		id_;
 
 	};
 
+	/**
+	 * The StackScope class saves the top of a StackMemoryAllocator when created and rolls
+	 * the stack back to it when destroyed, so everything allocated in the scope is released
+	 * at once.  Scopes can be nested as deep as needed.  The destructors of the objects
+	 * allocated in the scope are NOT called.
+	 */
+	class StackScope {
+		public:
+			explicit StackScope(StackMemoryAllocator* allocator)
+				: allocator_(allocator), marker_(allocator->getMarker()) {}
+			~StackScope() {
+				allocator_->rollback(marker_);
+			}
+
+			/**
+			 * Allocates a block of memory from the stack.
+			 * @see StackMemoryAllocator::alloc()
+			 */
+			inline VPtr alloc(U32 block_size, U32 alignment) {
+				return allocator_->alloc(block_size, alignment);
+			}
+
+			/**
+			 * Releases everything allocated in the scope so far, keeping the scope open.
+			 */
+			inline void release() {
+				allocator_->rollback(marker_);
+			}
+
+			inline StackMemoryAllocator* getAllocator() const {
+				return allocator_;
+			}
+
+		private:
+			StackScope(const StackScope& src);
+			StackScope& operator=(const StackScope& src);
+
+			StackMemoryAllocator*	allocator_;
+			StackMarker					marker_;
+	};
+
 	inline U32 StackMemoryAllocator::getStackSize() const { 
 		return stack_size_;
 	}
 	inline MemAddr StackMemoryAllocator::getNextBlock() const {
 		return next_block_;
 	}
+	inline U32 StackMemoryAllocator::getNumberOfChainedBlocks() const {
+		return number_of_chained_blocks_;
+	}
+	inline StackMarker StackMemoryAllocator::getMarker() const {
+		return next_block_;
+	}
+
+	inline void StackMemoryAllocator::poison(Addr from, Addr to) {
+#if defined (DEBUG)
+		if (to > from) {
+			memset((VPtr)from, kStackPoison, to - from);
+		}
+#else
+		CC_UNUSED(from);
+		CC_UNUSED(to);
+#endif
+	}
 
 } // namespace Cat
 
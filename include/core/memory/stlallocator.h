@@ -0,0 +1,178 @@
+#ifndef CAT_CORE_MEMORY_STLALLOCATOR_H
+#define CAT_CORE_MEMORY_STLALLOCATOR_H
+/**
+ * Copyright Catlin Zilinksi, 2013.  All rights reserved.
+ *
+ * stlallocator.h: Contains the StlAllocator class, which lets the standard containers
+ * get their memory from a MemoryAllocator, and the helper functions the util containers
+ * use to do the same.
+ *
+ * Author: Catlin Zilinski
+ * Date: Oct 24, 2014
+ */
+
+#include <cstddef>
+#include "core/memory/memoryallocator.h"
+
+namespace Cat {
+
+	/**
+	 * The alignment used for memory the containers get from a MemoryAllocator (the same
+	 * as malloc() gives on most platforms).
+	 */
+	const U32 kContainerAlignment = 2*sizeof(VPtr);
+
+	/**
+	 * Creates an array of default constructed objects.
+	 * @param allocator The MemoryAllocator to get the memory from, or NIL to use new[].
+	 * @param count The number of objects in the array.
+	 * @return The array, or NIL if the MemoryAllocator has no memory left.
+	 */
+	template <typename T>
+	T* createArray(MemoryAllocator* allocator, Size count) {
+		if (!allocator) {
+			return new T[count];
+		}
+		T* array = (T*)allocator->alloc((U32)(sizeof(T)*count), kContainerAlignment);
+		if (!array) {
+			DERR("MemoryAllocator " << allocator->getOID() << " could not allocate an array of " << count << " objects!");
+			return NIL;
+		}
+		for (Size i = 0; i < count; ++i) {
+			new (&(array[i])) T();
+		}
+		return array;
+	}
+
+	/**
+	 * Destroys an array created by createArray().
+	 * @param allocator The MemoryAllocator the array was created with.
+	 * @param array The array to destroy.
+	 * @param count The number of objects in the array.
+	 */
+	template <typename T>
+	void destroyArray(MemoryAllocator* allocator, T* array, Size count) {
+		if (!allocator) {
+			delete[] array;
+			return;
+		}
+		if (!array) {
+			return;
+		}
+		for (Size i = 0; i < count; ++i) {
+			array[i].~T();
+		}
+		allocator->dealloc(array);
+	}
+
+	/**
+	 * Destroys an object created with new (*allocator) T(...), or with new if allocator is NIL.
+	 * @param allocator The MemoryAllocator the object was created with.
+	 * @param object The object to destroy.
+	 */
+	template <typename T>
+	void destroyObject(MemoryAllocator* allocator, T* object) {
+		if (!allocator) {
+			delete object;
+			return;
+		}
+		if (!object) {
+			return;
+		}
+		object->~T();
+		allocator->dealloc(object);
+	}
+
+	/**
+	 * The StlAllocator class is an allocator for the standard containers that gets its
+	 * memory from a MemoryAllocator.  A StlAllocator with no MemoryAllocator uses the
+	 * global operator new.
+	 *
+	 * It holds a pointer to the MemoryAllocator, so copies (and rebound copies) share the
+	 * same memory, and two StlAllocators are equal if they use the same MemoryAllocator.
+	 * With a StackMemoryAllocator the memory of a container is only released when the stack
+	 * is deallocated to a marker or reset.
+	 */
+	template <typename T>
+	class StlAllocator {
+		public:
+			typedef T					value_type;
+			typedef T*					pointer;
+			typedef const T*			const_pointer;
+			typedef T&					reference;
+			typedef const T&			const_reference;
+			typedef std::size_t		size_type;
+			typedef std::ptrdiff_t	difference_type;
+
+			template <typename U>
+			struct rebind {
+				typedef StlAllocator<U> other;
+			};
+
+			StlAllocator() : allocator_(NIL) {}
+			StlAllocator(MemoryAllocator* allocator) : allocator_(allocator) {}
+			StlAllocator(const StlAllocator& src) : allocator_(src.allocator_) {}
+			template <typename U>
+			StlAllocator(const StlAllocator<U>& src) : allocator_(src.getMemoryAllocator()) {}
+
+			inline pointer address(reference value) const { return &value; }
+			inline const_pointer address(const_reference value) const { return &value; }
+
+			/**
+			 * Gets memory for count objects (does not construct them).
+			 * @throw std::bad_alloc if the MemoryAllocator has no memory left.
+			 */
+			pointer allocate(size_type count, const void* hint = 0) {
+				CC_UNUSED(hint);
+				if (!allocator_) {
+					return (pointer)::operator new(count*sizeof(T));
+				}
+				pointer memory = (pointer)allocator_->alloc((U32)(count*sizeof(T)), kContainerAlignment);
+				if (!memory) {
+					throw std::bad_alloc();
+				}
+				return memory;
+			}
+
+			void deallocate(pointer memory, size_type count) {
+				CC_UNUSED(count);
+				if (!allocator_) {
+					::operator delete(memory);
+				} else {
+					allocator_->dealloc(memory);
+				}
+			}
+
+			inline size_type max_size() const {
+				return (size_type)(0xFFFFFFFF / sizeof(T));
+			}
+
+			inline void construct(pointer memory, const T& value) {
+				new ((VPtr)memory) T(value);
+			}
+
+			inline void destroy(pointer memory) {
+				memory->~T();
+			}
+
+			inline MemoryAllocator* getMemoryAllocator() const {
+				return allocator_;
+			}
+
+		private:
+			MemoryAllocator* allocator_;
+	};
+
+	template <typename T, typename U>
+	inline bool operator==(const StlAllocator<T>& lhs, const StlAllocator<U>& rhs) {
+		return lhs.getMemoryAllocator() == rhs.getMemoryAllocator();
+	}
+
+	template <typename T, typename U>
+	inline bool operator!=(const StlAllocator<T>& lhs, const StlAllocator<U>& rhs) {
+		return lhs.getMemoryAllocator() != rhs.getMemoryAllocator();
+	}
+
+} // namespace Cat
+
+#endif // CAT_CORE_MEMORY_STLALLOCATOR_H
@@ -10,7 +10,8 @@
  * @date June 20, 2014
  */
 
-#include "core/util/map.h"
+#include "core/util/densemap.h"
+#include "core/util/hashedid.h"
 #include "core/util/vector.h"
 #include "core/signal/signalhandler.h"
 
@@ -71,6 +72,9 @@ namespace Cat {
 									  const SignalHandler& handler) {
 			return connect(crc32(name), handler);
 		}		
+		inline Boolean connect(const HashedID& name, const SignalHandler& handler) {
+			return connect(name.record(), handler);
+		}
 
 		/**
 		 * @brief Connect a signal of this object to the specified handler.
@@ -86,6 +90,11 @@ namespace Cat {
 									  void* obj) {
 			return connect(crc32(name), SignalHandler(func, obj));
 		}	
+		inline Boolean connect(const HashedID& name,
+									  void (*func)(void*, SignalData&),
+									  void* obj) {
+			return connect(name.record(), SignalHandler(func, obj));
+		}
 
 		/**
 		 * @brief disconnect a signal of this object from the specified handler.
@@ -119,6 +128,9 @@ namespace Cat {
 		inline Boolean disconnect(const Char* name, const SignalHandler& handler) {
 			return disconnect(crc32(name), handler);
 		}
+		inline Boolean disconnect(const HashedID& name, const SignalHandler& handler) {
+			return disconnect(name.id(), handler);
+		}
 
 		/**
 		 * @brief disconnect a signal of this object from the specified handler.
@@ -133,6 +145,11 @@ namespace Cat {
 										  void* obj) {
 			return disconnect(crc32(name), SignalHandler(func, obj));
 		}
+		inline Boolean disconnect(const HashedID& name,
+										  void (*func)(void*, SignalData&),
+										  void* obj) {
+			return disconnect(name.id(), SignalHandler(func, obj));
+		}
 
 		/**
 		 * @brief disconnect all signal handlers from the specified signal.
@@ -149,6 +166,9 @@ namespace Cat {
 		inline Boolean disconnect(const Char* signal) {
 			return disconnect(crc32(signal));
 		}		
+		inline Boolean disconnect(const HashedID& signal) {
+			return disconnect(signal.id());
+		}
 
 	
 	  protected:
@@ -178,9 +198,21 @@ namespace Cat {
 			SignalData data(dataPtr, sender);
 			emit(crc32(name), data);
 		}
+
+		inline void emit(const HashedID& name, SignalData& data) {
+			emit(name.id(), data);
+		}
+		inline void emit(const HashedID& name, void* sender) {
+			SignalData data(sender);
+			emit(name.id(), data);
+		}
+		inline void emit(const HashedID& name, void* sender, void* dataPtr) {
+			SignalData data(dataPtr, sender);
+			emit(name.id(), data);
+		}
 		
 
-		Map< Vector<SignalHandler>* > m_signalMap;
+		DenseMap< Vector<SignalHandler>* > m_signalMap;
 		
 		
 		
@@ -259,14 +259,14 @@ namespace Cat {
 		/**
 		 * @brief Increase the retain count by one.
 		 */
-		inline void retain() { m_retainCount.increment(); }
+		inline void retain() { m_retainCount.increment(kMORelaxed); }
 
 		/**
 		 * @brief Decrement the retainCount by one.
 		 * @return True if there are no more references to the String.
 		 */
 		inline Boolean release() {
-			return m_retainCount.decrement() <= 0;
+			return m_retainCount.decrement(kMOAcqRel) <= 0;
 		}
 
 		/**
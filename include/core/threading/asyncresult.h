@@ -14,11 +14,33 @@
  */
 
 #include "core/corelib.h"
+#include "core/threading/mutex.h"
 #include "core/threading/conditionvariable.h"
 
 namespace Cat {
 
 	class AsyncTask;
+	class AsyncResult;
+
+	/**
+	 * @interface AsyncResultListener asyncresult.h "core/threading/asyncresult.h"
+	 * @brief Told when an AsyncResult completes, instead of a thread waiting for it.
+	 *
+	 * @author Catlin Zilinski
+	 * @version 1
+	 * @since Apr 4, 2015
+	 */
+	class AsyncResultListener {
+	  public:
+		virtual ~AsyncResultListener() {}
+
+		/**
+		 * @brief Called once, on the thread that completes the result, or on the
+		 * thread that sets the listener if the result is already complete.
+		 * @param result The result, which has no result if its task was destroyed first.
+		 */
+		virtual void resultCompleted(AsyncResult* result) = 0;
+	};
 
 	/**
 	 * @interface AsyncResult asyncresult.h "core/threading/asyncresult.h"
@@ -31,9 +53,9 @@ namespace Cat {
 	class AsyncResult {
 	  public:
 		
-		AsyncResult() : m_errno(0), m_complete(false), m_pTask(NIL) {}
+		AsyncResult() : m_errno(0), m_complete(false), m_pTask(NIL), m_pListener(NIL) {}
 		AsyncResult(AsyncTask* task) 
-			: m_errno(0), m_complete(false), m_pTask(task) {}
+			: m_errno(0), m_complete(false), m_pTask(task), m_pListener(NIL) {}
 				
 		virtual ~AsyncResult() { m_pTask = NIL; }
 				
@@ -93,16 +115,30 @@ namespace Cat {
 		 */
 		virtual void detach();		
 
+		/**
+		 * @brief Sets the listener told when the result completes or its task is destroyed.
+		 * A result has a single listener, which is called right away if the result
+		 * is already complete.
+		 * @param listener The listener, which must outlive the result or its completion.
+		 */
+		void setListener(AsyncResultListener* listener);
+
 	  protected: 
-		inline ConditionVariable& resultSync() { return m_resultSync; }
-		inline void setComplete(Boolean complete) { m_complete = complete; }
+		/**
+		 * @brief Marks the result as complete, waking up the waiting threads and
+		 * telling the listener.  Set the values of the result before calling it.
+		 */
+		void complete();
+
 		inline void setTask(AsyncTask* task) { m_pTask = task; }
 				
 	  private:
-		I32					m_errno;
-		Boolean				m_complete;
-		AsyncTask*			m_pTask;
-		ConditionVariable m_resultSync;
+		I32						m_errno;
+		Boolean					m_complete;
+		AsyncTask*				m_pTask;
+		AsyncResultListener*	m_pListener;
+		Mutex						m_resultLock;
+		ConditionVariable		m_resultSignal;
 	};
 
 } // namespace Cat
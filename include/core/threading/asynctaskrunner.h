@@ -13,21 +13,106 @@
 #include "core/corelib.h"
 #include "core/threading/conditionvariable.h"
 #include "core/threading/runnable.h"
+#include "core/threading/spinlock.h"
+#include "core/threading/workstealingdeque.h"
 
 namespace Cat {
 
 	class AsyncTaskRunnerThread;
 	class AsyncTask;
-	class AsyncTaskQueuedItem;
 	class AsyncResult;
 
 	enum AsyncTaskRunnerState { RUNNER_STARTED, RUNNER_STOPPING, RUNNER_STOPPED };
 
+	/**
+	 * How the AsyncTaskRunner picks the next task to run.
+	 */
+	enum AsyncTaskSchedule { 
+		SCHEDULE_WORK_STEALING,	/**< Per thread queues, ignores the priority (the default) */
+		SCHEDULE_PRIORITY			/**< Shared queues by priority, with aging */
+	};
+
+	/**
+	 * A FIFO ring buffer of tasks, that grows as needed.  NOT thread safe.
+	 */
+	class AsyncTaskQueue {
+	  public:
+		AsyncTaskQueue(U32 capacity = 16);
+		~AsyncTaskQueue();
+
+		void push(AsyncTask* task);
+		/**
+		 * @return The oldest task in the queue, or NIL if it is empty.
+		 */
+		AsyncTask* pop();
+		inline U32 size() const { return count_; }
+
+	  private:
+		AsyncTaskQueue(const AsyncTaskQueue& src);
+		AsyncTaskQueue& operator=(const AsyncTaskQueue& src);
+
+		AsyncTask**		tasks_;
+		U32				capacity_;
+		U32				first_;
+		U32				count_;
+	};
+
+	/**
+	 * The AsyncTaskPriorityQueue keeps one FIFO queue per priority level, and always gives
+	 * the oldest task of the highest level, except to prevent starvation: every time a task
+	 * is taken ahead of a waiting lower level, that level ages by one, and once it has aged
+	 * kAgingThreshold times its oldest task is given next.  So a task waits for at most
+	 * kAgingThreshold tasks of each higher level, and a high priority task waits for at most
+	 * one aged task per level below it.
+	 */
+	class AsyncTaskPriorityQueue {
+	  public:
+		static const U32 kNumLevels = 4;
+		static const U32 kAgingThreshold = 16;
+
+		AsyncTaskPriorityQueue();
+
+		/**
+		 * Adds a task at the level of its priority (priorities above the last level use
+		 * the last level).  Thread safe.
+		 */
+		void push(AsyncTask* task);
+		/**
+		 * Takes the next task to run.  Thread safe.
+		 * @return The next task, or NIL if the queue is empty.
+		 */
+		AsyncTask* pop();
+		inline Boolean isEmpty() const { return count_.val() == 0; }
+
+		static inline U32 getLevel(U32 priority) {
+			return priority < kNumLevels ? priority : kNumLevels - 1;
+		}
+
+	  private:
+		Spinlock				lock_;
+		AsyncTaskQueue		levels_[kNumLevels];
+		U32					age_[kNumLevels];
+		AtomicI32			count_;
+	};
+
 	/**
 	 * The AsyncTaskRunner class is used to run tasks in parallel.  
 	 * The AsyncTaskRunner contains a set amount of threads that are constantly 
 	 * running (or waiting) on which tasks are run.  The number of threads should be equal to 
 	 * the number of processor cores to ensure maximum parallellism.  
+	 *
+	 * Each thread has its own WorkStealingDeque of tasks and an inbox for the tasks run from
+	 * other threads.  A task run from one of the runner's threads (e.g., a task that splits
+	 * its work) goes on that thread's deque, anything else goes to the inboxes in turn.  A
+	 * thread runs the newest task of its own deque first, then the tasks in its inbox, and
+	 * when both are empty it steals the oldest task of another thread, starting from a
+	 * random victim.  A thread with nothing to steal parks, and a new task wakes exactly one
+	 * parked thread.
+	 *
+	 * With SCHEDULE_PRIORITY, every task goes to one shared AsyncTaskPriorityQueue instead,
+	 * so a high priority task (e.g., an I/O completion) is run by the next free thread even
+	 * when the runner is saturated with low priority batch work.  The shared queue costs some
+	 * throughput for very fine grained tasks.
 	 */
 	class AsyncTaskRunner {
 	  public:
@@ -40,6 +125,12 @@ namespace Cat {
 		 * @param number_of_threads The number of threads the runner has.
 		 */
 		AsyncTaskRunner(U32 number_of_threads);
+		/**
+		 * Initializes a AsyncTaskRunner with the specified number of threads and scheduling.
+		 * @param number_of_threads The number of threads the runner has.
+		 * @param schedule How the next task to run is picked.
+		 */
+		AsyncTaskRunner(U32 number_of_threads, AsyncTaskSchedule schedule);
 		/**
 		 * The destructor waits for the threads to all terminate.
 		 */
@@ -58,33 +149,72 @@ namespace Cat {
 		 */
 		AsyncResult* run(AsyncTask* task);
 
+		/**
+		 * Tests if a task run from the calling thread would be run, which is
+		 * not the case once the AsyncTaskRunner is stopped.
+		 * @return True if the AsyncTaskRunner accepts tasks from the calling thread.
+		 */
+		inline Boolean canRun() const {
+			return state_ == RUNNER_STARTED || getCurrentThread() != NIL;
+		}
+
 		/**
 		 * Get the number of threads in the AsyncTaskRunner.
 		 * @return The number of threads in the AsyncTaskRunner.
 		 */
 		inline U32 getNumberOfThreads() const;
+		inline AsyncTaskSchedule getSchedule() const;
+
+		/**
+		 * Gets the runner thread the caller is running on.
+		 * @return The AsyncTaskRunnerThread of the calling thread, or NIL if the calling
+		 * thread does not belong to this AsyncTaskRunner.
+		 */
+		AsyncTaskRunnerThread* getCurrentThread() const;
 
 
 		friend class AsyncTaskRunnerThread;
 
 	  private:
-		ConditionVariable*	sync_controller_;	/**< The condition variable for threads to wait on */
-			
-		AsyncTaskQueuedItem*	first_;			/**< The first queued task */
-		AsyncTaskQueuedItem*	last_;			/**< The last queued task */
-
 		AsyncTaskRunnerThread**	runners_;	/**< The array of threads */
-		AsyncTaskRunnerState		state_;		/**< The current state of the AsyncTaskRunner */
+		volatile AsyncTaskRunnerState	state_;		/**< The current state of the AsyncTaskRunner */
+		AtomicI32	parked_threads_;	/**< The number of threads waiting for a task */
+		AtomicI32	next_inbox_;		/**< The inbox the next task from outside goes to */
+		AsyncTaskPriorityQueue*	priority_queue_;	/**< The shared queue with SCHEDULE_PRIORITY */
 
 		U32 	number_of_threads_;	/**< The number of threads in the array */
+#if defined (OS_WINDOWS)
+		DWORD				thread_key_;	/**< The key of the AsyncTaskRunnerThread of each thread */
+#else
+		pthread_key_t	thread_key_;	/**< The key of the AsyncTaskRunnerThread of each thread */
+#endif
+
+
 
+		void initAsyncTaskRunner(U32 number_of_threads, AsyncTaskSchedule schedule);
 
+		/**
+		 * Wakes up one parked thread, trying the preferred thread first.
+		 * @param preferred The index of the thread to wake up if it is parked.
+		 */
+		void wakeThread(U32 preferred);
 
-		void initAsyncTaskRunner(U32 number_of_threads);
+		/**
+		 * Tests if any thread has a task waiting to be run.
+		 */
+		Boolean hasQueuedTasks() const;
+
+		/**
+		 * Completes and destroys a task without running it.
+		 */
+		static void discardTask(AsyncTask* task);
 
 	};
 
 	inline U32 AsyncTaskRunner::getNumberOfThreads() const { return number_of_threads_; }
+	inline AsyncTaskSchedule AsyncTaskRunner::getSchedule() const {
+		return priority_queue_ ? SCHEDULE_PRIORITY : SCHEDULE_WORK_STEALING;
+	}
 
 	/**
 	 * The AsyncTaskRunnerThread encompases a thread of the AsyncTaskRunner that is able 
@@ -96,14 +226,14 @@ namespace Cat {
 		 * Creates a new AsyncTaskRunnerThread in a waiting state.
 		 * @param runner The AsyncTaskRunner that created the thread.
 		 */
-		AsyncTaskRunnerThread(AsyncTaskRunner* runner, U32 id) : runner_(runner), id_(id) {}
+		AsyncTaskRunnerThread(AsyncTaskRunner* runner, U32 id);
 
 		~AsyncTaskRunnerThread();
 
 		/**
-		 * The method to get a task from the AsyncTaskRunner's queue to run on 
-		 * this thread.
-		 * @return A AsyncTask to run, or NIL if the queue is empty.
+		 * The method to get a task to run on this thread, from its own deque, its inbox, or
+		 * stolen from another thread.
+		 * @return A AsyncTask to run, or NIL if there are no tasks anywhere.
 		 * */
 		AsyncTask* getTaskToRun();
 
@@ -112,29 +242,53 @@ namespace Cat {
 		 */
 		I32 run();
 
+		inline U32 getID() const { return id_; }
+
+		friend class AsyncTaskRunner;
+
 	  private:
+		/**
+		 * Adds a task to the inbox, can be called from any thread.
+		 */
+		void pushInbox(AsyncTask* task);
+		/**
+		 * Takes the oldest task from the inbox, can be called from any thread.
+		 */
+		AsyncTask* takeInbox();
+		inline Boolean hasQueuedTasks() const { return inbox_count_.val() != 0 || !deque_.isEmpty(); }
+
+		/**
+		 * Steals a task from another thread, starting with a random one.
+		 */
+		AsyncTask* stealTask();
+
+		/**
+		 * Waits until another thread wakes this one up, unless there is a task to run.
+		 */
+		void park();
+		/**
+		 * Wakes the thread up if it is parked.
+		 * @return True if the thread was parked.
+		 */
+		Boolean unpark();
+
 		AsyncTaskRunner* 		runner_;	/**< The ower of this thread */
-		U32 						id_;		/**< A numeric identifier of the thread runner */
-			
+		WorkStealingDeque<AsyncTask>	deque_;	/**< The tasks run from this thread */
 
-	};
+		Spinlock					inbox_lock_;
+		AsyncTaskQueue			inbox_;				/**< The tasks run from other threads */
+		AtomicI32				inbox_count_;
 
-	/**
-	 * A simple class to hold a queued task to be run on a thread.
-	 */
-	class AsyncTaskQueuedItem {
-	  public:
-		AsyncTaskQueuedItem(AsyncTask* ptask, AsyncTaskQueuedItem* pprev = NIL);
-		~AsyncTaskQueuedItem();
+		Mutex						park_lock_;
+		ConditionVariable		park_signal_;
+		AtomicU64				parked_;			/**< 1 while the thread is (about to be) waiting */
 
-		AsyncTask*				task;
-		AsyncTaskQueuedItem* next;
-		AsyncTaskQueuedItem* prev;
+		U32						random_;			/**< The state of the victim picking xorshift */
+		U32 						id_;		/**< A numeric identifier of the thread runner */
 			
+
 	};
 
 } // namespace Cat
 
 #endif // CAT_CORE_THREADING_ASYNCTASKRUNNER_H
-
-
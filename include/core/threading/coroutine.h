@@ -0,0 +1,503 @@
+#ifndef CAT_CORE_THREADING_COROUTINE_H
+#define CAT_CORE_THREADING_COROUTINE_H
+/**
+ * @copyright Catlin Zilinksi, 2015.  All rights reserved.
+ *
+ * @file coroutine.h
+ * @brief Contains the CoTask coroutine type and the awaitables for Futures and
+ * AsyncTaskRunners, to write asynchronous steps as straight-line code.
+ *
+ * Only available when compiled as C++20 (e.g., -std=c++20), otherwise the header
+ * is empty and CAT_HAS_COROUTINES is not defined.
+ *
+ * @author Catlin Zilinski
+ * @date Apr 6, 2015
+ */
+
+#include "core/corelib.h"
+#include "core/threading/future.h"
+#include "core/threading/task.h"
+#include "core/threading/taskrunner.h"
+
+#if defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L
+#define CAT_HAS_COROUTINES 1
+
+#include <coroutine>
+
+namespace Cat {
+
+	class CoroutineTask;
+	template <typename T> class CoTask;
+
+	/**
+	 * The value a CoTask completes its Future with, a CoTask<void> completes with true.
+	 */
+	template <typename T>
+	struct CoTaskValue {
+		typedef T Type;
+	};
+
+	template <>
+	struct CoTaskValue<void> {
+		typedef Boolean Type;
+	};
+
+	/**
+	 * @class CoroutineScheduler coroutine.h "core/threading/coroutine.h"
+	 * @brief Where a suspended coroutine is resumed once what it awaits is done.
+	 *
+	 * A coroutine started on an AsyncTaskRunner is resumed by a task on the runner, a
+	 * coroutine run by a CoroutineTask is resumed by the TaskRunner running the task,
+	 * and any other coroutine is resumed on the thread that completes what it awaits.
+	 *
+	 * @author Catlin Zilinski
+	 * @version 1
+	 * @since Apr 6, 2015
+	 */
+	class CoroutineScheduler {
+	  public:
+		CoroutineScheduler() : m_pRunner(NIL), m_pTask(NIL) {}
+
+		/**
+		 * @brief Resumes the coroutine where it is scheduled.
+		 * @param handle The suspended coroutine.
+		 */
+		inline void resume(std::coroutine_handle<> handle) const;
+
+		inline AsyncTaskRunner* runner() const { return m_pRunner; }
+		inline CoroutineTask* task() const { return m_pTask; }
+
+		inline void setRunner(AsyncTaskRunner* runner) {
+			m_pRunner = runner;
+			m_pTask = NIL;
+		}
+
+		inline void setTask(CoroutineTask* task) {
+			m_pRunner = NIL;
+			m_pTask = task;
+		}
+
+	  private:
+		AsyncTaskRunner*	m_pRunner;
+		CoroutineTask*		m_pTask;	/**< Not retained, the task owns the coroutine */
+	};
+
+	/**
+	 * @brief Gets the scheduler of the coroutine, if it is a CoTask.
+	 * @param handle The coroutine.
+	 * @return The scheduler of the coroutine, which resumes it inline if it is not a CoTask.
+	 */
+	template <typename P>
+	inline CoroutineScheduler coroutineSchedulerOf(std::coroutine_handle<P> handle) {
+		if constexpr (requires { handle.promise().scheduler(); }) {
+			return handle.promise().scheduler();
+		} else {
+			return CoroutineScheduler();
+		}
+	}
+
+	/**
+	 * The AsyncTask run on an AsyncTaskRunner to resume a coroutine.
+	 */
+	class CoroutineResumeTask : public AsyncTask {
+	  public:
+		CoroutineResumeTask(std::coroutine_handle<> handle) : m_handle(handle) {
+			setDestroyable(true);
+		}
+
+		I32 run() {
+			resume();
+			return 0;
+		}
+
+		void onCompletion() {
+			// Discarded by a stopping AsyncTaskRunner, the coroutine still has to finish.
+			resume();
+		}
+
+	  private:
+		inline void resume() {
+			if (m_handle) {
+				std::coroutine_handle<> handle = m_handle;
+				m_handle = nullptr;
+				handle.resume();
+			}
+		}
+
+		std::coroutine_handle<>	m_handle;
+	};
+
+	/**
+	 * Resumes a CoTask that awaited the CoTask finishing, or destroys a started
+	 * CoTask that nothing awaits.
+	 */
+	struct CoTaskFinalAwaiter {
+		inline bool await_ready() const noexcept { return false; }
+
+		template <typename P>
+		std::coroutine_handle<> await_suspend(std::coroutine_handle<P> handle) noexcept {
+			std::coroutine_handle<> next = handle.promise().continuation();
+			if (next) {
+				return next;
+			}
+			if (handle.promise().isDetached()) {
+				handle.destroy();
+			}
+			return std::noop_coroutine();
+		}
+
+		inline void await_resume() const noexcept {}
+	};
+
+	/**
+	 * The promise shared by the CoTask promise types.
+	 */
+	template <typename T>
+	class CoTaskPromiseBase {
+	  public:
+		typedef typename CoTaskValue<T>::Type ValueType;
+
+		CoTaskPromiseBase() : m_detached(false) {}
+
+		inline std::suspend_always initial_suspend() const noexcept { return std::suspend_always(); }
+		inline CoTaskFinalAwaiter final_suspend() const noexcept { return CoTaskFinalAwaiter(); }
+		inline void unhandled_exception() { m_result.setError(-1); }
+
+		inline std::coroutine_handle<> continuation() const { return m_continuation; }
+		inline void setContinuation(std::coroutine_handle<> continuation) { m_continuation = continuation; }
+
+		inline Boolean isDetached() const { return m_detached; }
+		inline void detach() { m_detached = true; }
+
+		inline Future<ValueType> future() const { return m_result.getFuture(); }
+
+		inline CoroutineScheduler& scheduler() { return m_scheduler; }
+
+	  protected:
+		Promise<ValueType>		m_result;
+
+	  private:
+		std::coroutine_handle<>	m_continuation;
+		CoroutineScheduler		m_scheduler;
+		Boolean						m_detached;
+	};
+
+	template <typename T>
+	class CoTaskPromise : public CoTaskPromiseBase<T> {
+	  public:
+		inline CoTask<T> get_return_object();
+		inline void return_value(const T& value) { this->m_result.setValue(value); }
+	};
+
+	template <>
+	class CoTaskPromise<void> : public CoTaskPromiseBase<void> {
+	  public:
+		inline CoTask<void> get_return_object();
+		inline void return_void() { m_result.setValue(true); }
+	};
+
+	/**
+	 * @class CoTask coroutine.h "core/threading/coroutine.h"
+	 * @brief A coroutine that can await Futures, AsyncResults and other CoTasks.
+	 *
+	 * A CoTask does nothing until it is awaited by another CoTask, started with
+	 * start(), or run by a CoroutineTask.  Awaiting suspends the coroutine instead of
+	 * blocking its thread, so a pipeline of reads holds no thread while a read is in
+	 * flight:
+	 *
+	 *     CoTask<U32> readCount(AsyncDataInputStream* stream, U32* count) {
+	 *        AsyncResult* result = co_await futureOf(stream->readU32(count, 1));
+	 *        co_return result->hasError() ? 0 : *count;
+	 *     }
+	 *
+	 * Awaiting a Future gives its value, or a default value if the Future failed,
+	 * was cancelled or timed out, so check the Future when it can.  An awaited CoTask
+	 * is resumed where the CoTask awaiting it is (see CoroutineScheduler), and
+	 * co_await schedule(runner) moves the coroutine onto the runner.
+	 *
+	 * Named CoTask since a Task is the unit of work of a TaskRunner.
+	 *
+	 * @author Catlin Zilinski
+	 * @version 1
+	 * @since Apr 6, 2015
+	 */
+	template <typename T>
+	class CoTask {
+	  public:
+		typedef CoTaskPromise<T> promise_type;
+		typedef typename CoTaskValue<T>::Type ValueType;
+
+		/**
+		 * Suspends the awaiting coroutine, and runs this one until it finishes.
+		 */
+		class Awaiter {
+		  public:
+			Awaiter(std::coroutine_handle<promise_type> handle) : m_handle(handle) {}
+
+			inline bool await_ready() const { return m_handle.done(); }
+
+			template <typename P>
+			std::coroutine_handle<> await_suspend(std::coroutine_handle<P> awaiting) {
+				m_handle.promise().scheduler() = coroutineSchedulerOf(awaiting);
+				m_handle.promise().setContinuation(awaiting);
+				return m_handle;
+			}
+
+			inline ValueType await_resume() const {
+				return m_handle.promise().future().state()->value();
+			}
+
+		  private:
+			std::coroutine_handle<promise_type>	m_handle;
+		};
+
+		explicit CoTask(std::coroutine_handle<promise_type> handle) : m_handle(handle) {}
+
+		CoTask(CoTask&& src) noexcept : m_handle(src.m_handle) {
+			src.m_handle = nullptr;
+		}
+
+		~CoTask() {
+			if (m_handle) {
+				m_handle.destroy();
+			}
+		}
+
+		CoTask& operator=(CoTask&& src) noexcept {
+			if (this != &src) {
+				if (m_handle) {
+					m_handle.destroy();
+				}
+				m_handle = src.m_handle;
+				src.m_handle = nullptr;
+			}
+			return *this;
+		}
+
+		CoTask(const CoTask& src) = delete;
+		CoTask& operator=(const CoTask& src) = delete;
+
+		inline Awaiter operator co_await() const { return Awaiter(m_handle); }
+
+		/**
+		 * @brief Get the Future of the value the coroutine returns.
+		 * @return The Future of the value.
+		 */
+		inline Future<ValueType> future() const { return m_handle.promise().future(); }
+
+		/**
+		 * @brief Get the coroutine.
+		 * @return The coroutine, or a null handle once it was started.
+		 */
+		inline std::coroutine_handle<promise_type> handle() const { return m_handle; }
+
+		/**
+		 * @brief Check if the coroutine has finished.
+		 * @return True if the coroutine has run to its end.
+		 */
+		inline Boolean isDone() const { return !m_handle || m_handle.done(); }
+
+		/**
+		 * @brief Starts the coroutine, which then deletes itself once it finishes.
+		 * @param runner The AsyncTaskRunner to run the coroutine on, or NIL to run it on
+		 * the calling thread until it first suspends.
+		 * @return The Future of the value the coroutine returns.
+		 */
+		Future<ValueType> start(AsyncTaskRunner* runner = NIL) {
+			std::coroutine_handle<promise_type> handle = m_handle;
+			m_handle = nullptr;
+			Future<ValueType> future = handle.promise().future();
+			handle.promise().detach();
+			handle.promise().scheduler().setRunner(runner);
+			handle.promise().scheduler().resume(handle);
+			return future;
+		}
+
+	  private:
+		std::coroutine_handle<promise_type>	m_handle;
+	};
+
+	template <typename T>
+	inline CoTask<T> CoTaskPromise<T>::get_return_object() {
+		return CoTask<T>(std::coroutine_handle<CoTaskPromise<T> >::from_promise(*this));
+	}
+
+	inline CoTask<void> CoTaskPromise<void>::get_return_object() {
+		return CoTask<void>(std::coroutine_handle<CoTaskPromise<void> >::from_promise(*this));
+	}
+
+	/**
+	 * @class CoroutineTask coroutine.h "core/threading/coroutine.h"
+	 * @brief A Task that runs a CoTask<void> on a TaskRunner.
+	 *
+	 * The coroutine is started the first time the task is run.  While it is suspended
+	 * the TaskRunner parks the task and runs its other tasks, once what the coroutine
+	 * awaits is done the task is woken and the TaskRunner resumes it, so the whole
+	 * coroutine runs on the TaskRunner's thread.  The task succeeds once the coroutine
+	 * finishes, or fails if it ends with an uncaught exception.
+	 *
+	 * @author Catlin Zilinski
+	 * @version 1
+	 * @since Apr 6, 2015
+	 */
+	class CoroutineTask : public Task {
+	  public:
+		CoroutineTask(CoTask<void>&& body) : m_body(std::move(body)), m_started(false) {}
+		CoroutineTask(const Char* name, CoTask<void>&& body)
+			: Task(name), m_body(std::move(body)), m_started(false) {}
+
+		void run() {
+			if (!m_started) {
+				m_started = true;
+				m_body.handle().promise().scheduler().setTask(this);
+				m_body.handle().resume();
+			} else {
+				U64 woken = m_woken.val();
+				if (woken != 0 && m_woken.compareAndSwap(woken, 0)) {
+					std::coroutine_handle<>::from_address((VPtr)woken).resume();
+				}
+			}
+			if (m_body.isDone()) {
+				if (m_body.future().isReady()) {
+					succeeded();
+				} else {
+					failed();
+				}
+			}
+		}
+
+		Boolean park(TaskRunner* runner) {
+			m_runner.store((U64)runner);
+			/* Either a wake() after this sees the runner, or we see what it woke. */
+			memoryBarrier();
+			return runner != NIL && isWaiting();
+		}
+
+		Boolean isWaiting() const {
+			return m_woken.val() == 0;
+		}
+
+		/**
+		 * @brief Resumes the coroutine the next time the task is run, and wakes the
+		 * TaskRunner if it parked the task.  Can be called by any thread.
+		 * @param handle The coroutine of the task, or a CoTask it awaits.
+		 */
+		inline void wake(std::coroutine_handle<> handle) {
+			m_woken.store((U64)handle.address());
+			memoryBarrier();
+			TaskRunner* runner = (TaskRunner*)m_runner.val();
+			if (runner) {
+				runner->wakeParkedTasks();
+			}
+		}
+
+	  private:
+		CoTask<void>	m_body;
+		Boolean			m_started;
+		AtomicU64		m_woken;	/**< The address of the coroutine to resume, or 0 */
+		AtomicU64		m_runner;	/**< The TaskRunner that parked the task, or 0 */
+	};
+
+	inline void CoroutineScheduler::resume(std::coroutine_handle<> handle) const {
+		if (m_pTask) {
+			m_pTask->wake(handle);
+		} else if (m_pRunner && m_pRunner->canRun()) {
+			m_pRunner->run(new CoroutineResumeTask(handle));
+		} else {
+			handle.resume();
+		}
+	}
+
+	/**
+	 * Resumes a coroutine once the Future it awaits is done.  Keeps the CoroutineTask
+	 * of the coroutine alive, since the task owns the coroutine.
+	 */
+	class CoroutineResumeCallback : public FutureCallback {
+	  public:
+		CoroutineResumeCallback(const CoroutineScheduler& scheduler, std::coroutine_handle<> handle)
+			: FutureCallback(NIL), m_scheduler(scheduler), m_handle(handle) {
+			if (scheduler.task()) {
+				m_task = TaskPtr(scheduler.task());
+			}
+		}
+
+		void invoke() {
+			m_scheduler.resume(m_handle);
+		}
+
+	  private:
+		CoroutineScheduler		m_scheduler;
+		TaskPtr						m_task;
+		std::coroutine_handle<>	m_handle;
+	};
+
+	/**
+	 * Suspends a coroutine until a Future is done.
+	 */
+	template <typename T>
+	class FutureAwaiter {
+	  public:
+		FutureAwaiter(const Future<T>& future) : m_future(future) {}
+
+		inline bool await_ready() const { return m_future.isDone(); }
+
+		template <typename P>
+		void await_suspend(std::coroutine_handle<P> awaiting) {
+			// May resume the coroutine right away, so nothing is touched after.
+			m_future.state()->addCallback(new CoroutineResumeCallback(coroutineSchedulerOf(awaiting), awaiting));
+		}
+
+		inline T await_resume() const { return m_future.state()->value(); }
+
+	  private:
+		Future<T>	m_future;
+	};
+
+	/**
+	 * @brief Lets a coroutine co_await a Future for its value.
+	 */
+	template <typename T>
+	inline FutureAwaiter<T> operator co_await(const Future<T>& future) {
+		return FutureAwaiter<T>(future);
+	}
+
+	/**
+	 * Suspends a coroutine and resumes it on an AsyncTaskRunner.
+	 */
+	class ScheduleAwaiter {
+	  public:
+		ScheduleAwaiter(AsyncTaskRunner* runner) : m_pRunner(runner) {}
+
+		inline bool await_ready() const { return false; }
+
+		template <typename P>
+		void await_suspend(std::coroutine_handle<P> awaiting) {
+			CoroutineScheduler scheduler;
+			scheduler.setRunner(m_pRunner);
+			if constexpr (requires { awaiting.promise().scheduler(); }) {
+				awaiting.promise().scheduler() = scheduler;
+			}
+			scheduler.resume(awaiting);
+		}
+
+		inline void await_resume() const {}
+
+	  private:
+		AsyncTaskRunner*	m_pRunner;
+	};
+
+	/**
+	 * @brief Moves the coroutine onto the runner, co_await schedule(runner) resumes
+	 * it on one of the runner's threads, and the coroutine is resumed there after.
+	 * @param runner The AsyncTaskRunner to run the coroutine on.
+	 * @return The awaitable.
+	 */
+	inline ScheduleAwaiter schedule(AsyncTaskRunner* runner) {
+		return ScheduleAwaiter(runner);
+	}
+
+} // namespace Cat
+
+#endif // __cpp_impl_coroutine
+
+#endif // CAT_CORE_THREADING_COROUTINE_H
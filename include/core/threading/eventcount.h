@@ -0,0 +1,94 @@
+#ifndef CAT_CORE_THREADING_EVENTCOUNT_H
+#define CAT_CORE_THREADING_EVENTCOUNT_H
+/**
+ * @copyright Catlin Zilinksi, 2015.  All rights reserved.
+ *
+ * @file eventcount.h
+ * @brief Contains the EventCount class, to sleep until a lock-free queue has an item.
+ *
+ * @author Catlin Zilinski
+ * @date Mar 28, 2015
+ */
+
+#include "core/corelib.h"
+#include "core/threading/atomic.h"
+#include "core/threading/mutex.h"
+#include "core/threading/conditionvariable.h"
+
+namespace Cat {
+
+	/**
+	 * @class EventCount eventcount.h "core/threading/eventcount.h"
+	 * @brief Lets a thread sleep until a condition it checks without a lock becomes true.
+	 *
+	 * The waiting thread calls prepareWait(), checks the condition again, and then either
+	 * calls cancelWait() or wait() with the key it got.  The thread that makes the
+	 * condition true calls notifyAll() after, which only takes the lock when a thread is
+	 * actually waiting, so a producer pushing onto a busy queue never touches the mutex.
+	 *
+	 * @author Catlin Zilinski
+	 * @version 1
+	 * @since Mar 28, 2015
+	 */
+	class EventCount {
+	  public:
+		EventCount() {}
+
+		/**
+		 * @brief Registers the calling thread as about to wait.
+		 * @return The key to pass to wait().
+		 */
+		inline I32 prepareWait() {
+			// The increment is a full barrier, so the condition is checked after it.
+			m_waiters.increment();
+			return m_epoch.val();
+		}
+
+		/**
+		 * @brief Unregisters the calling thread, when the condition was true after all.
+		 */
+		inline void cancelWait() {
+			m_waiters.decrement();
+		}
+
+		/**
+		 * @brief Sleeps until notifyAll() has been called since prepareWait().
+		 * @param key The key returned by prepareWait().
+		 */
+		inline void wait(I32 key) {
+			m_lock.lock();
+			while (m_epoch.val() == key) {
+				m_signal.wait(m_lock);
+			}
+			m_lock.unlock();
+			m_waiters.decrement();
+		}
+
+		/**
+		 * @brief Wakes up all the waiting threads, call after making the condition true.
+		 */
+		inline void notifyAll() {
+			// Pairs with the barrier in prepareWait(), either we see the waiter or it sees the condition.
+			memoryBarrier();
+			if (m_waiters.val() == 0) {
+				return;
+			}
+			m_lock.lock();
+			m_epoch.increment();
+			m_signal.broadcast();
+			m_lock.unlock();
+		}
+
+	  private:
+		EventCount(const EventCount& src);
+		EventCount& operator=(const EventCount& src);
+
+		AtomicI32				m_epoch;
+		AtomicI32				m_waiters;
+		Mutex						m_lock;
+		ConditionVariable		m_signal;
+	};
+
+} // namespace Cat
+
+#endif // CAT_CORE_THREADING_EVENTCOUNT_H
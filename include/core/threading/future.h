@@ -0,0 +1,851 @@
+#ifndef CAT_CORE_THREADING_FUTURE_H
+#define CAT_CORE_THREADING_FUTURE_H
+/**
+ * @copyright Catlin Zilinksi, 2015.  All rights reserved.
+ *
+ * @file future.h
+ * @brief Contains the Future and Promise classes, typed results of asynchronous work
+ * that continuations can be chained onto.
+ *
+ * @author Catlin Zilinski
+ * @date Apr 4, 2015
+ */
+
+#include "core/corelib.h"
+#include "core/threading/atomic.h"
+#include "core/threading/mutex.h"
+#include "core/threading/conditionvariable.h"
+#include "core/threading/asynctask.h"
+#include "core/threading/asyncresult.h"
+#include "core/threading/asynctaskrunner.h"
+#include "core/threading/thread.h"
+
+namespace Cat {
+
+	/**
+	 * The states of a Future, it starts pending and is done once it has any other.
+	 */
+	enum FutureStatus {
+		kFSPending = 0x0,	/**< Not done yet */
+		kFSReady,			/**< Done with a value */
+		kFSFailed,			/**< Done with an error code */
+		kFSCancelled,		/**< Cancelled before it had a value */
+		kFSTimedOut			/**< Gave up waiting for a value */
+	};
+
+	/**
+	 * @class CancellationToken future.h "core/threading/future.h"
+	 * @brief A shared flag that stops the work that has not started yet.
+	 *
+	 * Copies of a token share the flag, so the token given to each stage of a chain
+	 * of continuations cancels every stage that has not started when cancel() is called.
+	 * A stage that is cancelled completes its Future with kFSCancelled, which cancels
+	 * the rest of the chain.
+	 *
+	 * @author Catlin Zilinski
+	 * @version 1
+	 * @since Apr 4, 2015
+	 */
+	class CancellationToken {
+	  public:
+		/**
+		 * @brief Creates a new token that is not cancelled.
+		 */
+		CancellationToken();
+		CancellationToken(const CancellationToken& src);
+		~CancellationToken();
+
+		CancellationToken& operator=(const CancellationToken& src);
+
+		/**
+		 * @brief Cancels the work of every copy of the token.
+		 */
+		void cancel();
+
+		/**
+		 * @brief Check if the token has been cancelled.
+		 * @return True if cancel() has been called on a copy of the token.
+		 */
+		inline Boolean isCancelled() const {
+			return m_pState && m_pState->cancelled.val() != 0;
+		}
+
+		/**
+		 * @brief Get a token that can never be cancelled.
+		 * @return A token that can never be cancelled.
+		 */
+		static CancellationToken none();
+
+	  private:
+		struct State {
+			AtomicI32	refs;
+			AtomicI32	cancelled;
+		};
+
+		explicit CancellationToken(State* state) : m_pState(state) {}
+
+		State*	m_pState;
+	};
+
+	/**
+	 * @class FutureCallback future.h "core/threading/future.h"
+	 * @brief The work to do once a Future is done.
+	 *
+	 * The callback is run as a task on its AsyncTaskRunner when the Future completes,
+	 * so no thread waits for the Future.  Without a runner, or once the runner is
+	 * stopped, the callback is run on the thread that completes the Future, so it
+	 * should be short.  The callback is deleted after it is invoked.
+	 *
+	 * The callback does not hold a reference to the state it waits on, which would
+	 * never be let go of if the state is never completed.  The state keeps itself
+	 * alive until its callbacks have run instead.
+	 *
+	 * @author Catlin Zilinski
+	 * @version 1
+	 * @since Apr 4, 2015
+	 */
+	class FutureCallback {
+	  public:
+		FutureCallback(AsyncTaskRunner* runner) : m_pRunner(runner), m_pNext(NIL) {}
+		virtual ~FutureCallback() {}
+
+		/**
+		 * @brief Called once the Future is done.
+		 */
+		virtual void invoke() = 0;
+
+		/**
+		 * @brief Get the runner the callback is run on.
+		 * @return The AsyncTaskRunner to run the callback on, or NIL to run it inline.
+		 */
+		inline AsyncTaskRunner* runner() const { return m_pRunner; }
+
+		friend class FutureStateBase;
+
+	  private:
+		AsyncTaskRunner*	m_pRunner;
+		FutureCallback*	m_pNext;
+	};
+
+	/**
+	 * @class FutureStateBase future.h "core/threading/future.h"
+	 * @brief The state shared by a Promise and its Futures, without the value.
+	 *
+	 * The state is reference counted, and deleted by the last Future, Promise or
+	 * callback to let go of it.  The first completion wins, any later one is ignored.
+	 *
+	 * @author Catlin Zilinski
+	 * @version 1
+	 * @since Apr 4, 2015
+	 */
+	class FutureStateBase {
+	  public:
+		FutureStateBase();
+		virtual ~FutureStateBase();
+
+		inline void retain() { m_refs.increment(kMORelaxed); }
+		inline void release() {
+			if (m_refs.decrement(kMOAcqRel) == 0) {
+				delete this;
+			}
+		}
+
+		/**
+		 * @brief Adds a callback to invoke once the state is done, or dispatches it
+		 * right away if it already is.
+		 * @param callback The callback, which is deleted after it is invoked.
+		 */
+		void addCallback(FutureCallback* callback);
+
+		/**
+		 * @brief Completes the state without a value.
+		 * @param status The status to complete with, anything but kFSPending or kFSReady.
+		 * @param error The error code, for kFSFailed.
+		 * @return False if the state was already done.
+		 */
+		Boolean complete(FutureStatus status, I32 error = 0);
+
+		/**
+		 * @brief Get the error code of a failed state.
+		 * @return The error code, 0 unless the state failed.
+		 */
+		I32 error();
+
+		/**
+		 * @brief Check if the state is done.
+		 * @return True if the state is no longer pending.
+		 */
+		inline Boolean isDone() { return status() != kFSPending; }
+
+		/**
+		 * @brief Get the status of the state.
+		 * @return The status of the state.
+		 */
+		FutureStatus status();
+
+		/**
+		 * @brief Blocks until the state is done.
+		 */
+		void wait();
+
+		/**
+		 * @brief Blocks until the state is done or the timeout has passed.
+		 * @param timeout The longest time to wait, in nanoseconds.
+		 * @return True if the state is done.
+		 */
+		Boolean waitFor(U64 timeout);
+
+	  protected:
+		/**
+		 * @brief Sets the status, wakes up the waiting threads, unlocks the state and
+		 * dispatches the callbacks.  Must be called with the lock held.
+		 */
+		void finishLocked(FutureStatus status, I32 error);
+
+		/**
+		 * @brief Runs the callback on its runner, or inline, keeping the state alive
+		 * until it has run.
+		 */
+		void dispatch(FutureCallback* callback);
+
+		inline Boolean isPendingLocked() const { return m_status == kFSPending; }
+
+		Mutex						m_lock;
+
+	  private:
+		FutureStateBase(const FutureStateBase& src);
+		FutureStateBase& operator=(const FutureStateBase& src);
+
+		ConditionVariable		m_signal;
+		FutureStatus			m_status;
+		I32						m_error;
+		AtomicI32				m_refs;
+		FutureCallback*		m_pCallbacks;	/**< Newest first */
+	};
+
+	/**
+	 * @class FutureState future.h "core/threading/future.h"
+	 * @brief The state shared by a Promise and its Futures, with the value.
+	 * The value type must have a default constructor and be copyable.
+	 */
+	template <typename T>
+	class FutureState : public FutureStateBase {
+	  public:
+		FutureState() : m_value() {}
+
+		/**
+		 * @brief Completes the state with a value.
+		 * @param value The value.
+		 * @return False if the state was already done.
+		 */
+		Boolean setValue(const T& value) {
+			m_lock.lock();
+			if (!isPendingLocked()) {
+				m_lock.unlock();
+				return false;
+			}
+			m_value = value;
+			finishLocked(kFSReady, 0);
+			return true;
+		}
+
+		/**
+		 * @brief Get the value, only valid once the state is ready.
+		 * @return The value, or a default value if the state has none.
+		 */
+		inline const T& value() const { return m_value; }
+
+	  private:
+		T	m_value;
+	};
+
+	template <typename T> class Future;
+	class FutureTimer;
+
+	/**
+	 * Resolves the state of a continuation with the value the continuation returned.
+	 * A continuation returning a Future is flattened, so the state is completed with
+	 * the returned Future instead of holding a Future of a Future.
+	 */
+	template <typename R>
+	struct FutureResolver {
+		typedef R ValueType;
+		typedef Future<R> FutureType;
+
+		static inline void resolve(FutureState<R>* state, const R& value) {
+			state->setValue(value);
+		}
+	};
+
+	template <typename R>
+	struct FutureResolver< Future<R> > {
+		typedef R ValueType;
+		typedef Future<R> FutureType;
+
+		static void resolve(FutureState<R>* state, const Future<R>& value);
+	};
+
+	/**
+	 * Completes a state the same way as another one, once the other is done.
+	 */
+	template <typename T>
+	class FutureForwardCallback : public FutureCallback {
+	  public:
+		FutureForwardCallback(FutureState<T>* source, FutureState<T>* dest)
+			: FutureCallback(NIL), m_pSource(source), m_pDest(dest) {
+			m_pDest->retain();
+		}
+
+		~FutureForwardCallback() {
+			m_pDest->release();
+		}
+
+		void invoke() {
+			FutureStatus status = m_pSource->status();
+			if (status == kFSReady) {
+				m_pDest->setValue(m_pSource->value());
+			} else {
+				m_pDest->complete(status, m_pSource->error());
+			}
+		}
+
+	  private:
+		FutureState<T>*	m_pSource;
+		FutureState<T>*	m_pDest;
+	};
+
+	/**
+	 * Calls a continuation with the value of a ready state, or passes on how the state
+	 * completed without calling it.
+	 */
+	template <typename T, typename F>
+	class FutureThenCallback : public FutureCallback {
+	  public:
+		typedef FutureResolver<typename F::result_type> Resolver;
+
+		FutureThenCallback(AsyncTaskRunner* runner, FutureState<T>* source,
+								 FutureState<typename Resolver::ValueType>* dest,
+								 const F& func, const CancellationToken& token)
+			: FutureCallback(runner), m_pSource(source), m_pDest(dest),
+			  m_func(func), m_token(token) {
+			m_pDest->retain();
+		}
+
+		~FutureThenCallback() {
+			m_pDest->release();
+		}
+
+		void invoke() {
+			FutureStatus status = m_pSource->status();
+			if (status != kFSReady) {
+				m_pDest->complete(status, m_pSource->error());
+			} else if (m_token.isCancelled()) {
+				m_pDest->complete(kFSCancelled);
+			} else {
+				Resolver::resolve(m_pDest, m_func(m_pSource->value()));
+			}
+		}
+
+	  private:
+		FutureState<T>*										m_pSource;
+		FutureState<typename Resolver::ValueType>*	m_pDest;
+		F															m_func;
+		CancellationToken										m_token;
+	};
+
+	/**
+	 * Adapts a function taking the value of a Future into a continuation.
+	 */
+	template <typename T, typename R>
+	class FutureFunction {
+	  public:
+		typedef R result_type;
+
+		FutureFunction(R (*func)(const T&)) : m_func(func) {}
+		inline R operator()(const T& value) const { return m_func(value); }
+
+	  private:
+		R (*m_func)(const T&);
+	};
+
+	/**
+	 * @class Future future.h "core/threading/future.h"
+	 * @brief A handle to a value that becomes available later.
+	 *
+	 * Rather than waiting for the value, chain the next step onto the Future with
+	 * then(), which runs the step as a task on an AsyncTaskRunner once the value is
+	 * ready.  The step returns the value of the Future then() returns, or a Future
+	 * to wait on without blocking, so a chain like read header -> read body ->
+	 * deserialize holds no thread while the reads are in flight:
+	 *
+	 *     futureOf(stream->read(header, 16)).then(runner, ReadBody(stream)).then(runner, Deserialize())
+	 *
+	 * A step is a function taking a const T&, or a function object with a result_type
+	 * typedef.  If a Future fails, is cancelled or times out, the steps after it are
+	 * not called and their Futures complete the same way.
+	 *
+	 * Copies of a Future share the same state.
+	 *
+	 * @author Catlin Zilinski
+	 * @version 1
+	 * @since Apr 4, 2015
+	 */
+	template <typename T>
+	class Future {
+	  public:
+		/**
+		 * @brief Creates an invalid Future, with no state.
+		 */
+		Future() : m_pState(NIL) {}
+
+		/**
+		 * @brief Creates a Future for the state.
+		 * @param state The state of the Future.
+		 */
+		explicit Future(FutureState<T>* state) : m_pState(state) {
+			if (m_pState) {
+				m_pState->retain();
+			}
+		}
+
+		Future(const Future& src) : m_pState(src.m_pState) {
+			if (m_pState) {
+				m_pState->retain();
+			}
+		}
+
+		~Future() {
+			if (m_pState) {
+				m_pState->release();
+			}
+		}
+
+		Future& operator=(const Future& src) {
+			if (src.m_pState) {
+				src.m_pState->retain();
+			}
+			if (m_pState) {
+				m_pState->release();
+			}
+			m_pState = src.m_pState;
+			return *this;
+		}
+
+		/**
+		 * @brief Cancels the Future if it is not done yet.  The producer of the value
+		 * can check Promise::isCancelled() to stop early.
+		 * @return True if the Future was cancelled.
+		 */
+		inline Boolean cancel() { return m_pState->complete(kFSCancelled); }
+
+		/**
+		 * @brief Get the error code of a failed Future.
+		 * @return The error code, 0 unless the Future failed.
+		 */
+		inline I32 error() const { return m_pState->error(); }
+
+		/**
+		 * @brief Blocks until the Future is done and gets the value.  Never call it
+		 * from a task on the AsyncTaskRunner that produces the value, use then().
+		 * @return The value, or a default value if the Future is not ready.
+		 */
+		inline const T& get() const {
+			m_pState->wait();
+			return m_pState->value();
+		}
+
+		/**
+		 * @brief Check if the Future is done.
+		 * @return True if the Future is no longer pending.
+		 */
+		inline Boolean isDone() const { return m_pState->isDone(); }
+
+		/**
+		 * @brief Check if the Future has a value.
+		 * @return True if the Future is ready.
+		 */
+		inline Boolean isReady() const { return m_pState->status() == kFSReady; }
+
+		/**
+		 * @brief Check if the Future has a state.
+		 * @return True if the Future has a state.
+		 */
+		inline Boolean isValid() const { return m_pState != NIL; }
+
+		/**
+		 * @brief Get the state of the Future.
+		 * @return The state of the Future.
+		 */
+		inline FutureState<T>* state() const { return m_pState; }
+
+		/**
+		 * @brief Get the status of the Future.
+		 * @return The status of the Future.
+		 */
+		inline FutureStatus status() const { return m_pState->status(); }
+
+		/**
+		 * @brief Chains a step to run on the runner once the value is ready.
+		 * @param runner The AsyncTaskRunner to run the step on, or NIL to run it on the
+		 * thread that completes this Future.
+		 * @param func The function object to call with the value.
+		 * @param token The token that cancels the step before it starts.
+		 * @return The Future of the value the step returns.
+		 */
+		template <typename F>
+		typename FutureResolver<typename F::result_type>::FutureType
+		then(AsyncTaskRunner* runner, const F& func,
+			  const CancellationToken& token = CancellationToken::none()) const {
+			typedef typename FutureResolver<typename F::result_type>::ValueType R;
+			FutureState<R>* dest = new FutureState<R>();
+			Future<R> future(dest);
+			m_pState->addCallback(new FutureThenCallback<T, F>(runner, m_pState, dest, func, token));
+			return future;
+		}
+
+		/**
+		 * @brief Chains a function to run on the runner once the value is ready.
+		 * @param runner The AsyncTaskRunner to run the function on, or NIL to run it on
+		 * the thread that completes this Future.
+		 * @param func The function to call with the value.
+		 * @param token The token that cancels the function before it starts.
+		 * @return The Future of the value the function returns.
+		 */
+		template <typename R>
+		typename FutureResolver<R>::FutureType
+		then(AsyncTaskRunner* runner, R (*func)(const T&),
+			  const CancellationToken& token = CancellationToken::none()) const {
+			return then(runner, FutureFunction<T, R>(func), token);
+		}
+
+		/**
+		 * @brief Blocks until the Future is done.
+		 */
+		inline void wait() const { m_pState->wait(); }
+
+		/**
+		 * @brief Blocks until the Future is done or the timeout has passed.
+		 * @param timeout The longest time to wait, in nanoseconds.
+		 * @return True if the Future is done.
+		 */
+		inline Boolean waitFor(U64 timeout) const { return m_pState->waitFor(timeout); }
+
+		/**
+		 * @brief Gets a Future that completes like this one, or times out first.
+		 * @param timer The FutureTimer that times out the Future.
+		 * @param timeout The time to wait for this Future, in nanoseconds.
+		 * @return The Future with the timeout.
+		 */
+		Future<T> withTimeout(FutureTimer* timer, U64 timeout) const;
+
+		/**
+		 * @brief Creates a Future that already has a value.
+		 * @param value The value of the Future.
+		 * @return The ready Future.
+		 */
+		static Future<T> ready(const T& value) {
+			Future<T> future(new FutureState<T>());
+			future.m_pState->setValue(value);
+			return future;
+		}
+
+		/**
+		 * @brief Creates a Future that is already done without a value, for a step
+		 * that has to fail the rest of a chain.
+		 * @param status The status of the Future.
+		 * @param error The error code, for kFSFailed.
+		 * @return The done Future.
+		 */
+		static Future<T> failed(FutureStatus status, I32 error = 0) {
+			Future<T> future(new FutureState<T>());
+			future.m_pState->complete(status, error);
+			return future;
+		}
+
+	  private:
+		FutureState<T>*	m_pState;
+	};
+
+	/**
+	 * @class Promise future.h "core/threading/future.h"
+	 * @brief The producer's side of a Future, sets the value or the error.
+	 *
+	 * @author Catlin Zilinski
+	 * @version 1
+	 * @since Apr 4, 2015
+	 */
+	template <typename T>
+	class Promise {
+	  public:
+		/**
+		 * @brief Creates a Promise with a new pending state.
+		 */
+		Promise() : m_pState(new FutureState<T>()) {
+			m_pState->retain();
+		}
+
+		Promise(const Promise& src) : m_pState(src.m_pState) {
+			m_pState->retain();
+		}
+
+		~Promise() {
+			m_pState->release();
+		}
+
+		Promise& operator=(const Promise& src) {
+			src.m_pState->retain();
+			m_pState->release();
+			m_pState = src.m_pState;
+			return *this;
+		}
+
+		/**
+		 * @brief Get the Future of the Promise.
+		 * @return The Future of the Promise.
+		 */
+		inline Future<T> getFuture() const { return Future<T>(m_pState); }
+
+		/**
+		 * @brief Check if the Future was cancelled or timed out, so the value is not needed.
+		 * @return True if the Future is done without a value being set.
+		 */
+		inline Boolean isCancelled() const {
+			FutureStatus status = m_pState->status();
+			return status == kFSCancelled || status == kFSTimedOut;
+		}
+
+		/**
+		 * @brief Fails the Future.
+		 * @param error The error code.
+		 * @return False if the Future was already done.
+		 */
+		inline Boolean setError(I32 error) { return m_pState->complete(kFSFailed, error); }
+
+		/**
+		 * @brief Completes the Future with a value.
+		 * @param value The value.
+		 * @return False if the Future was already done.
+		 */
+		inline Boolean setValue(const T& value) { return m_pState->setValue(value); }
+
+	  private:
+		FutureState<T>*	m_pState;
+	};
+
+	/**
+	 * @class FutureTimer future.h "core/threading/future.h"
+	 * @brief Times out Futures from one thread, so no thread waits on each of them.
+	 *
+	 * The timer keeps the deadlines in order and sleeps until the earliest one.  A
+	 * Future that is done before its deadline is dropped the next time the timer
+	 * wakes up or a Future is added.
+	 *
+	 * @author Catlin Zilinski
+	 * @version 1
+	 * @since Apr 4, 2015
+	 */
+	class FutureTimer : public Runnable {
+	  public:
+		/**
+		 * @brief Creates a FutureTimer and starts its thread.
+		 */
+		FutureTimer();
+
+		/**
+		 * @brief Stops the thread, the Futures not timed out yet are left pending.
+		 */
+		~FutureTimer();
+
+		/**
+		 * @brief Times out the state with kFSTimedOut if it is not done in time.
+		 * @param state The state to time out.
+		 * @param timeout The time to wait for the state, in nanoseconds.
+		 */
+		void schedule(FutureStateBase* state, U64 timeout);
+
+		/**
+		 * @brief Stops the thread and drops every deadline.
+		 */
+		void stop();
+
+		I32 run();
+
+	  private:
+		struct Deadline {
+			U64					time;
+			FutureStateBase*	state;
+			Deadline*			next;
+		};
+
+		FutureTimer(const FutureTimer& src);
+		FutureTimer& operator=(const FutureTimer& src);
+
+		/**
+		 * Drops the deadlines of the states that are already done.  Must be called
+		 * with the lock held.
+		 */
+		void pruneLocked();
+
+		Mutex						m_lock;
+		ConditionVariable		m_signal;
+		Deadline*				m_pDeadlines;	/**< Earliest first */
+		Boolean					m_running;
+		ThreadHandle*			m_pThread;
+	};
+
+	/**
+	 * Completes a state once all the states of a whenAll() are ready, or any one of
+	 * the states of a whenAny() is done.
+	 */
+	class FutureJoinCallback : public FutureCallback {
+	  public:
+		FutureJoinCallback(FutureStateBase* source, FutureState<U32>* dest,
+								 AtomicI32* remaining, U32 value);
+		~FutureJoinCallback();
+
+		void invoke();
+
+	  private:
+		FutureStateBase*		m_pSource;
+		FutureState<U32>*		m_pDest;
+		AtomicI32*				m_pRemaining;	/**< NIL for whenAny() */
+		U32						m_value;			/**< The value to complete the state with */
+	};
+
+	/**
+	 * @brief Gets a Future that is ready once all of the Futures are.  It fails as
+	 * soon as one of them is done without a value, the same way as that one.
+	 * @param futures The Futures to wait for.
+	 * @param count The number of Futures.
+	 * @return The Future of the number of Futures.
+	 */
+	template <typename T>
+	Future<U32> whenAll(const Future<T>* futures, U32 count) {
+		if (count == 0) {
+			return Future<U32>::ready(0);
+		}
+		FutureState<U32>* dest = new FutureState<U32>();
+		Future<U32> future(dest);
+		// The last callback to finish deletes the count.
+		AtomicI32* remaining = new AtomicI32();
+		for (U32 i = 0; i < count; ++i) {
+			remaining->increment();
+		}
+		for (U32 i = 0; i < count; ++i) {
+			futures[i].state()->addCallback(new FutureJoinCallback(futures[i].state(), dest, remaining, count));
+		}
+		return future;
+	}
+
+	/**
+	 * @brief Gets a Future that is ready once any one of the Futures is done.
+	 * @param futures The Futures to wait for.
+	 * @param count The number of Futures, at least one.
+	 * @return The Future of the index of the first Future done.
+	 */
+	template <typename T>
+	Future<U32> whenAny(const Future<T>* futures, U32 count) {
+		FutureState<U32>* dest = new FutureState<U32>();
+		Future<U32> future(dest);
+		for (U32 i = 0; i < count; ++i) {
+			futures[i].state()->addCallback(new FutureJoinCallback(futures[i].state(), dest, NIL, i));
+		}
+		return future;
+	}
+
+	/**
+	 * The task run on the AsyncTaskRunner by runAsync().
+	 */
+	template <typename F>
+	class FutureTask : public AsyncTask {
+	  public:
+		typedef FutureResolver<typename F::result_type> Resolver;
+
+		FutureTask(FutureState<typename Resolver::ValueType>* state, const F& func,
+					  const CancellationToken& token)
+			: m_pState(state), m_func(func), m_token(token) {
+			m_pState->retain();
+			setDestroyable(true);
+		}
+
+		I32 run() {
+			if (m_token.isCancelled()) {
+				m_pState->complete(kFSCancelled);
+			} else if (!m_pState->isDone()) {
+				Resolver::resolve(m_pState, m_func());
+			}
+			m_pState->release();
+			m_pState = NIL;
+			return 0;
+		}
+
+		void onCompletion() {
+			// Discarded by a stopping AsyncTaskRunner without being run.
+			if (m_pState) {
+				m_pState->complete(kFSCancelled);
+				m_pState->release();
+				m_pState = NIL;
+			}
+		}
+
+	  private:
+		FutureState<typename Resolver::ValueType>*	m_pState;
+		F															m_func;
+		CancellationToken										m_token;
+	};
+
+	/**
+	 * @brief Runs a function object on the runner.
+	 * @param runner The AsyncTaskRunner to run the function object on.
+	 * @param func The function object, with a result_type typedef.
+	 * @param token The token that cancels the function object before it starts.
+	 * @return The Future of the value the function object returns, cancelled if the
+	 * runner is stopped.
+	 */
+	template <typename F>
+	typename FutureResolver<typename F::result_type>::FutureType
+	runAsync(AsyncTaskRunner* runner, const F& func,
+				const CancellationToken& token = CancellationToken::none()) {
+		typedef typename FutureResolver<typename F::result_type>::ValueType R;
+		FutureState<R>* state = new FutureState<R>();
+		Future<R> future(state);
+		// A stopped runner would never run the task, so the Future would never be done.
+		if (!runner->canRun()) {
+			state->complete(kFSCancelled);
+			return future;
+		}
+		runner->run(new FutureTask<F>(state, func, token));
+		return future;
+	}
+
+	/**
+	 * @brief Gets a Future for the result of an AsyncTask, so steps can be chained on
+	 * it instead of waiting.  The Future is ready with the result once it completes,
+	 * failed with the error of the result, or cancelled if the task is destroyed first.
+	 * This sets the listener of the result.
+	 * @param result The AsyncResult of the task.
+	 * @return The Future of the AsyncResult.
+	 */
+	Future<AsyncResult*> futureOf(AsyncResult* result);
+
+	template <typename R>
+	void FutureResolver< Future<R> >::resolve(FutureState<R>* state, const Future<R>& value) {
+		if (!value.isValid()) {
+			state->complete(kFSFailed);
+			return;
+		}
+		value.state()->addCallback(new FutureForwardCallback<R>(value.state(), state));
+	}
+
+	template <typename T>
+	Future<T> Future<T>::withTimeout(FutureTimer* timer, U64 timeout) const {
+		FutureState<T>* dest = new FutureState<T>();
+		Future<T> future(dest);
+		timer->schedule(dest, timeout);
+		m_pState->addCallback(new FutureForwardCallback<T>(m_pState, dest));
+		return future;
+	}
+
+} // namespace Cat
+
+#endif // CAT_CORE_THREADING_FUTURE_H
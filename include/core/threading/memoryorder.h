@@ -0,0 +1,44 @@
+#ifndef CAT_CORE_THREADING_MEMORYORDER_H
+#define CAT_CORE_THREADING_MEMORYORDER_H
+/**
+ * @copyright Catlin Zilinksi, 2015.  All rights reserved.
+ *
+ * @file memoryorder.h
+ * @brief Contains the MemoryOrder of an atomic operation.
+ *
+ * @author Catlin Zilinski
+ * @date Apr 8, 2015
+ */
+
+namespace Cat {
+
+	/**
+	 * How an atomic operation orders the reads and writes around it, the same
+	 * orders as the C++11 memory model.  The values match the GCC __ATOMIC_*
+	 * constants, so they can be passed straight to the builtins.
+	 */
+	enum MemoryOrder {
+		kMORelaxed = 0,	/**< Only the operation itself is atomic, nothing is ordered */
+		kMOAcquire = 2,	/**< No read or write after it is moved before it */
+		kMORelease = 3,	/**< No read or write before it is moved after it */
+		kMOAcqRel = 4,		/**< Both acquire and release, for read-modify-writes */
+		kMOSeqCst = 5		/**< Acquire and release, in a single order seen by every thread */
+	};
+
+	/**
+	 * @brief Get the order a failed compare and swap loads with, which cannot release.
+	 * @param order The order of the compare and swap.
+	 * @return The order of the load when the swap fails.
+	 */
+	inline MemoryOrder failureOrderOf(MemoryOrder order) {
+		if (order == kMOAcqRel) {
+			return kMOAcquire;
+		} else if (order == kMORelease) {
+			return kMORelaxed;
+		}
+		return order;
+	}
+
+} // namespace Cat
+
+#endif // CAT_CORE_THREADING_MEMORYORDER_H
@@ -0,0 +1,267 @@
+#ifndef CAT_CORE_THREADING_MPSCQUEUE_H
+#define CAT_CORE_THREADING_MPSCQUEUE_H
+/**
+ * @copyright Catlin Zilinksi, 2015.  All rights reserved.
+ *
+ * @file mpscqueue.h
+ * @brief Contains the MPSCQueue class, a bounded lock-free queue with many producers.
+ *
+ * @author Catlin Zilinski
+ * @date Mar 28, 2015
+ */
+
+#include "core/corelib.h"
+#include "core/threading/atomic.h"
+
+namespace Cat {
+
+	/**
+	 * @class MPSCQueue mpscqueue.h "core/threading/mpscqueue.h"
+	 * @brief A fixed size lock-free queue, any thread can push but only one thread can pop.
+	 *
+	 * Each slot of the ring has a sequence number that tells whether it is free for the
+	 * producer that claimed that position, or holds an item for the consumer.  Producers
+	 * claim a position with a compare and swap on the tail, so they only contend with each
+	 * other, never with the consumer.  The queue does not block; use an EventCount to
+	 * sleep while it is empty.
+	 *
+	 * The interface follows SimpleQueue, so a value equal to the null value is returned
+	 * when the queue is empty.
+	 *
+	 * @author Catlin Zilinski
+	 * @version 1
+	 * @since Mar 28, 2015
+	 */
+	template<typename T>
+	class MPSCQueue {
+	  public:
+		/**
+		 * @brief Walks the queued items from the oldest.  ONLY the consumer thread may use it.
+		 */
+		class Iterator {
+		  public:
+			inline Iterator(MPSCQueue<T>* queue)
+				: m_pQueue(queue), m_pos(queue->m_head.val()) {}
+
+			inline Boolean isValid() const { return m_pQueue->isQueued(m_pos); }
+			inline Boolean hasNext() const { return isValid() && m_pQueue->isQueued(m_pos + 1); }
+			inline void next() { ++m_pos; }
+			inline T& val() { return m_pQueue->slot(m_pos)->value; }
+
+		  private:
+			MPSCQueue<T>*	m_pQueue;
+			U64				m_pos;
+		};
+
+		/**
+		 * @brief Creates an empty queue with no slots.
+		 */
+		MPSCQueue() : m_capacity(0), m_pSlots(NIL) {}
+
+		/**
+		 * @brief Creates a MPSCQueue with the specified capacity.
+		 * @param capacity The capacity of the queue.
+		 * @param nullValue The value returned when the queue is empty.
+		 */
+		MPSCQueue(Size capacity, const T& nullValue) : m_capacity(0), m_pSlots(NIL) {
+			initWithCapacity(capacity, nullValue);
+		}
+
+		~MPSCQueue() {
+			if (m_pSlots) {
+				delete[] m_pSlots;
+				m_pSlots = NIL;
+			}
+		}
+
+		/**
+		 * @brief Initialize the queue with the specified capacity and null value.
+		 * Not thread safe, must be called before the queue is used.
+		 * @param capacity The capacity of the queue.
+		 * @param nullValue The value returned when the queue is empty.
+		 */
+		void initWithCapacity(Size capacity, const T& nullValue) {
+			if (m_pSlots) {
+				delete[] m_pSlots;
+			}
+			m_capacity = capacity;
+			m_nullValue = nullValue;
+			m_pSlots = new Slot[capacity];
+			for (Size i = 0; i < capacity; ++i) {
+				m_pSlots[i].sequence.set(i);
+				m_pSlots[i].value = nullValue;
+			}
+			m_head.set(0);
+			m_tail.set(0);
+		}
+
+		/**
+		 * @brief Get an iterator to the oldest item.  ONLY the consumer thread may call this.
+		 * @return An iterator to the oldest item.
+		 */
+		inline Iterator begin() { return Iterator(this); }
+
+		/**
+		 * @brief Gets the capacity of the MPSCQueue.
+		 * @return The capacity of the MPSCQueue.
+		 */
+		inline Size capacity() const { return m_capacity; }
+
+		/**
+		 * @brief Pop all the items.  ONLY the consumer thread may call this.
+		 */
+		inline void clear() {
+			while (!isEmpty()) {
+				pop();
+			}
+		}
+
+		/**
+		 * @brief Check if there is an item to pop (only a hint for other threads than the consumer).
+		 * @return True if the queue is empty.
+		 */
+		inline Boolean isEmpty() const {
+			return !isQueued(m_head.val());
+		}
+
+		/**
+		 * @brief Check if the queue is full (only a hint while other threads use it).
+		 * @return True if there is no room to push another item.
+		 */
+		inline Boolean isFull() const {
+			return m_tail.val() - m_head.val() >= m_capacity;
+		}
+
+		/**
+		 * @brief Get the null value for this queue.
+		 * @return The null value for this queue.
+		 */
+		inline const T& nullValue() const { return m_nullValue; }
+
+		/**
+		 * @brief Pop the oldest item.  ONLY the consumer thread may call this.
+		 * @return The oldest item, or the null value if the queue is empty.
+		 */
+		T pop();
+
+		/**
+		 * @brief Push an item onto the queue, can be called by any thread.
+		 * @param item The item to push.
+		 * @return True if the item was pushed, false if the queue is full.
+		 */
+		Boolean push(const T& item);
+
+		/**
+		 * @brief Push as many of the items as fit, claiming all their slots at once.
+		 * Can be called by any thread.  The items are pushed in order, and the items
+		 * of one call are never interleaved with the items of another producer.
+		 * @param items The items to push.
+		 * @param count The number of items.
+		 * @return The number of items pushed, starting from the first item.
+		 */
+		Size push(const T* items, Size count);
+
+		/**
+		 * @brief Get the number of items in the queue (only a hint while other threads use it).
+		 * @return The number of items pushed but not yet popped.
+		 */
+		inline Size size() const {
+			return (Size)(m_tail.val() - m_head.val());
+		}
+
+	  private:
+		struct Slot {
+			AtomicU64	sequence;	// pos while free for position pos, pos + 1 once it holds an item.
+			T				value;
+		};
+
+		MPSCQueue(const MPSCQueue& src);
+		MPSCQueue& operator=(const MPSCQueue& src);
+
+		inline Slot* slot(U64 pos) const { return &(m_pSlots[pos % m_capacity]); }
+		inline Boolean isQueued(U64 pos) const {
+			return m_capacity > 0 && slot(pos)->sequence.val() == pos + 1;
+		}
+
+		Size			m_capacity;
+		T				m_nullValue;
+		Slot*			m_pSlots;
+		AtomicU64	m_head;
+		U8				m_pad[64];	// Keep the producers' tail off the consumer's cache line.
+		AtomicU64	m_tail;
+	};
+
+	template <typename T>
+	T MPSCQueue<T>::pop() {
+		U64 head = m_head.val();
+		if (!isQueued(head)) {
+			return m_nullValue;
+		}
+		Slot* s = slot(head);
+		T item = s->value;
+		s->value = m_nullValue;
+		// Free the slot for the producer that wraps around to it.
+		s->sequence.store(head + m_capacity);
+		m_head.store(head + 1);
+		return item;
+	}
+
+	template <typename T>
+	Boolean MPSCQueue<T>::push(const T& item) {
+		if (m_capacity == 0) {
+			return false;
+		}
+		U64 tail = m_tail.val();
+		Slot* s;
+		while (true) {
+			s = slot(tail);
+			I64 diff = (I64)(s->sequence.val() - tail);
+			if (diff == 0) {
+				if (m_tail.compareAndSwap(tail, tail + 1)) {
+					break;
+				}
+			} else if (diff < 0) {
+				// The consumer has not popped the item from the last time round.
+				return false;
+			}
+			tail = m_tail.val();
+		}
+		s->value = item;
+		s->sequence.store(tail + 1);
+		return true;
+	}
+
+	template <typename T>
+	Size MPSCQueue<T>::push(const T* items, Size count) {
+		if (m_capacity == 0 || count == 0) {
+			return 0;
+		}
+		U64 tail;
+		U64 claimed;
+		while (true) {
+			// Read the head first, so the tail can only be ahead of it.
+			U64 head = m_head.val();
+			tail = m_tail.val();
+			if (tail - head >= m_capacity) {
+				return 0;
+			}
+			// Every slot up to head + capacity has been popped, so they are all free.
+			claimed = m_capacity - (tail - head);
+			if (claimed > count) {
+				claimed = count;
+			}
+			if (m_tail.compareAndSwap(tail, tail + claimed)) {
+				break;
+			}
+		}
+		for (U64 i = 0; i < claimed; ++i) {
+			Slot* s = slot(tail + i);
+			s->value = items[i];
+			s->sequence.store(tail + i + 1);
+		}
+		return (Size)claimed;
+	}
+
+} // namespace Cat
+
+#endif // CAT_CORE_THREADING_MPSCQUEUE_H
@@ -12,10 +12,141 @@
  */
 
 #include "core/corelib.h"
+#include "core/threading/memoryorder.h"
 #include <libkern/OSAtomic.h>
 
+#if defined(__GCC_HAVE_SYNC_COMPARE_AND_SWAP_16)
+#define CAT_HAS_ATOMIC_128 1
+#endif
+
 namespace Cat {
 
+	/**
+	 * @class Atomic atomic.h "core/threading/atomic.h"
+	 * @brief An atomic integer or pointer, each operation taking the MemoryOrder it needs.
+	 *
+	 * The operations default to kMOSeqCst, pass a weaker order where the code only
+	 * needs that, e.g., a counter nobody synchronizes on can be incremented with
+	 * kMORelaxed.  The fetch operations are only for integer types.
+	 *
+	 * @author Catlin Zilinski
+	 * @version 1
+	 * @since Apr 8, 2015
+	 */
+	template <typename T>
+	class Atomic {
+	  public:
+		Atomic() : m_val(0) {}
+		Atomic(T val) : m_val(val) {}
+
+		/**
+		 * @brief Atomically replace the value if it is still equal to the expected value.
+		 * @param expected The value we expect to be stored.
+		 * @param desired The value to store if the current value is expected.
+		 * @param order The order of the operation.
+		 * @return True if the value was swapped.
+		 */
+		inline Boolean compareAndSwap(T expected, T desired, MemoryOrder order = kMOSeqCst) {
+			return compareExchange(expected, desired, order);
+		}
+
+		/**
+		 * @brief Atomically replace the value if it is still equal to the expected value.
+		 * @param expected The value we expect to be stored, set to the stored value if it was not.
+		 * @param desired The value to store if the current value is expected.
+		 * @param order The order of the operation.
+		 * @return True if the value was swapped.
+		 */
+		inline Boolean compareExchange(T& expected, T desired, MemoryOrder order = kMOSeqCst) {
+			return __atomic_compare_exchange_n(&m_val, &expected, desired, false, order, failureOrderOf(order));
+		}
+
+		/**
+		 * @brief Atomically store a value.
+		 * @param val The new value.
+		 * @param order The order of the operation.
+		 * @return The value stored before.
+		 */
+		inline T exchange(T val, MemoryOrder order = kMOSeqCst) {
+			return __atomic_exchange_n(&m_val, val, order);
+		}
+
+		/**
+		 * @brief Atomically add to the value.
+		 * @param amount The amount to add.
+		 * @param order The order of the operation.
+		 * @return The value before adding amount.
+		 */
+		inline T fetchAdd(T amount, MemoryOrder order = kMOSeqCst) {
+			return __atomic_fetch_add(&m_val, amount, order);
+		}
+
+		/**
+		 * @brief Atomically and the value with bits.
+		 * @param bits The bits to keep.
+		 * @param order The order of the operation.
+		 * @return The value before the and.
+		 */
+		inline T fetchAnd(T bits, MemoryOrder order = kMOSeqCst) {
+			return __atomic_fetch_and(&m_val, bits, order);
+		}
+
+		/**
+		 * @brief Atomically or the value with bits.
+		 * @param bits The bits to set.
+		 * @param order The order of the operation.
+		 * @return The value before the or.
+		 */
+		inline T fetchOr(T bits, MemoryOrder order = kMOSeqCst) {
+			return __atomic_fetch_or(&m_val, bits, order);
+		}
+
+		/**
+		 * @brief Atomically subtract from the value.
+		 * @param amount The amount to subtract.
+		 * @param order The order of the operation.
+		 * @return The value before subtracting amount.
+		 */
+		inline T fetchSub(T amount, MemoryOrder order = kMOSeqCst) {
+			return __atomic_fetch_sub(&m_val, amount, order);
+		}
+
+		/**
+		 * @brief Atomically xor the value with bits.
+		 * @param bits The bits to flip.
+		 * @param order The order of the operation.
+		 * @return The value before the xor.
+		 */
+		inline T fetchXor(T bits, MemoryOrder order = kMOSeqCst) {
+			return __atomic_fetch_xor(&m_val, bits, order);
+		}
+
+		/**
+		 * @brief Atomically load the value.
+		 * @param order The order of the operation, kMORelaxed, kMOAcquire or kMOSeqCst.
+		 * @return The stored value.
+		 */
+		inline T load(MemoryOrder order = kMOSeqCst) const {
+			return __atomic_load_n(&m_val, order);
+		}
+
+		/**
+		 * @brief Atomically store a value.
+		 * @param val The new value.
+		 * @param order The order of the operation, kMORelaxed, kMORelease or kMOSeqCst.
+		 */
+		inline void store(T val, MemoryOrder order = kMOSeqCst) {
+			__atomic_store_n(&m_val, val, order);
+		}
+
+	  private:
+		Atomic(const Atomic& src);
+		Atomic& operator=(const Atomic& src);
+
+		volatile T m_val;
+	};
+
+
 	/**
 	 * @class AtomicI32 atomic.h "core/threading/atomic.h"
 	 * @brief An Atomic Integer type.
@@ -30,28 +161,164 @@ namespace Cat {
 		AtomicI32(I32 val) : m_val(val) {}
 
 		/**
+		 * @param order The order of the operation, a retain count can use kMORelaxed.
 		 * @return The value incrememented by 1.
 		 */
-		inline I32 increment() {
-			return OSAtomicIncrement32(&m_val);
+		inline I32 increment(MemoryOrder order = kMOSeqCst) {
+			return __atomic_add_fetch(&m_val, 1, order);
+		}
+
+		/**
+		 * @param order The order of the operation, a release of a retain count needs
+		 * kMOAcqRel so the last owner sees every write before deleting.
+		 * @return The value decremented by 1.
+		 */
+		inline I32 decrement(MemoryOrder order = kMOSeqCst) {
+			return __atomic_sub_fetch(&m_val, 1, order);
+		}
+
+		/**
+		 * @param order The order of the load.
+		 * @return The stored value.
+		 */
+		inline I32 val(MemoryOrder order = kMOAcquire) const { return __atomic_load_n(&m_val, order); }
+
+	  private:
+		volatile I32 m_val;
+	};
+
+	/**
+	 * @class AtomicU64 atomic.h "core/threading/atomic.h"
+	 * @brief An Atomic 64 bit unsigned integer that supports compare and swap.
+	 *
+	 * @author Catlin Zilinski
+	 * @version 1
+	 * @since Mar 15, 2014
+	 */
+	class AtomicU64 {
+	  public:
+		AtomicU64() : m_val(0) {}
+		AtomicU64(U64 val) : m_val(val) {}
+
+		/**
+		 * @brief Atomically replace the value if it is still equal to the expected value.
+		 * @param expected The value we expect to be stored.
+		 * @param desired The value to store if the current value is expected.
+		 * @return True if the value was swapped.
+		 */
+		inline Boolean compareAndSwap(U64 expected, U64 desired) {
+			return OSAtomicCompareAndSwap64Barrier((I64)expected, (I64)desired, (volatile I64*)&m_val);
+		}
+
+		/**
+		 * @brief Atomically add to the value.
+		 * @param amount The amount to add.
+		 * @return The value after adding amount.
+		 */
+		inline U64 add(U64 amount) {
+			return (U64)OSAtomicAdd64Barrier((I64)amount, (volatile I64*)&m_val);
+		}
+
+		/**
+		 * @brief Set the stored value (not safe against concurrent compareAndSwap).
+		 * @param val The new value.
+		 */
+		inline void set(U64 val) {
+			m_val = val;
+			OSMemoryBarrier();
 		}
 
 		/**
-		 * @brief The value decremented by 1.
+		 * @brief Store a value, making every write before it visible to a thread that reads it.
+		 * @param val The new value.
 		 */
-		inline I32 decrement() {
-			return OSAtomicDecrement32(&m_val);
+		inline void store(U64 val) {
+			OSMemoryBarrier();
+			m_val = val;
 		}
 
 		/**
 		 * @return The stored value.
 		 */
-		inline I32 val() const { return m_val; }		
+		inline U64 val() const { return m_val; }
 
 	  private:
-		I32 m_val;		
+		volatile U64 m_val;
 	};
 
+#if defined(CAT_HAS_ATOMIC_128)
+	/**
+	 * Two 64 bit words swapped together by an AtomicU128.
+	 */
+	struct U64Pair {
+		U64 low;
+		U64 high;
+	};
+
+	/**
+	 * @class AtomicU128 atomic.h "core/threading/atomic.h"
+	 * @brief Two 64 bit words that are compared and swapped together.
+	 *
+	 * Lets a lock-free structure swap a whole pointer together with a 64 bit tag.
+	 * Only defined when the CPU has a 16 byte compare and swap (CAT_HAS_ATOMIC_128),
+	 * x86-64 needs -mcx16 for it.
+	 *
+	 * @author Catlin Zilinski
+	 * @version 1
+	 * @since Apr 8, 2015
+	 */
+	class AtomicU128 {
+	  public:
+		AtomicU128() : m_val(0) {}
+		AtomicU128(const U64Pair& val) : m_val(toWord(val)) {}
+
+		/**
+		 * @brief Atomically replace both words if they are still equal to the expected words.
+		 * @param expected The words we expect to be stored, set to the stored words if they were not.
+		 * @param desired The words to store if the current words are expected.
+		 * @return True if the words were swapped.
+		 */
+		inline Boolean compareExchange(U64Pair& expected, const U64Pair& desired) {
+			unsigned __int128 old = toWord(expected);
+			unsigned __int128 found = __sync_val_compare_and_swap(&m_val, old, toWord(desired));
+			if (found == old) {
+				return true;
+			}
+			expected = toPair(found);
+			return false;
+		}
+
+		/**
+		 * @return Both stored words, read together.
+		 */
+		inline U64Pair val() const {
+			// A swap of zero for zero reads both words in one instruction.
+			return toPair(__sync_val_compare_and_swap(&m_val, 0, 0));
+		}
+
+	  private:
+		static inline unsigned __int128 toWord(const U64Pair& pair) {
+			return ((unsigned __int128)pair.high << 64) | pair.low;
+		}
+
+		static inline U64Pair toPair(unsigned __int128 word) {
+			U64Pair pair;
+			pair.low = (U64)word;
+			pair.high = (U64)(word >> 64);
+			return pair;
+		}
+
+		mutable volatile unsigned __int128 m_val __attribute__((aligned(16)));
+	};
+#endif // CAT_HAS_ATOMIC_128
+
+	/**
+	 * @brief A full memory barrier, no read or write is moved across it.
+	 */
+	inline void memoryBarrier() {
+		OSMemoryBarrier();
+	}
+
 } // namespace Cat
 
 #endif // CAT_CORE_THREADING_OSX_ATOMIC_H
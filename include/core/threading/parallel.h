@@ -0,0 +1,374 @@
+#ifndef CAT_CORE_THREADING_PARALLEL_H
+#define CAT_CORE_THREADING_PARALLEL_H
+/**
+ * Copyright Catlin Zilinksi, 2015.  All rights reserved.
+ *
+ * parallel.h: Contains the parallelFor, parallelReduce and parallelSort functions, which
+ * split a range of indices over the threads of an AsyncTaskRunner.
+ *
+ * Author: Catlin Zilinski
+ * Date: Mar 26, 2015
+ */
+
+#include <algorithm>
+#include <functional>
+#include "core/corelib.h"
+#include "core/threading/asynctask.h"
+#include "core/threading/asynctaskrunner.h"
+#include "core/threading/mutex.h"
+#include "core/threading/conditionvariable.h"
+#include "core/threading/spinlock.h"
+#include "core/util/vector.h"
+#include "core/util/arraylist.h"
+
+namespace Cat {
+
+	/**
+	 * The ParallelJob class hands out chunks of a range of indices to the threads working
+	 * on it.  The chunks start large and shrink as the range runs out (each chunk is the
+	 * remaining length divided by twice the number of workers, but never less than the
+	 * grain), so there are few chunks to claim while still balancing the end of the range.
+	 *
+	 * The thread that starts the job works on it too, and only waits for the chunks other
+	 * threads are still running.  The helper tasks that start after the range is used up do
+	 * nothing, so the job is reference counted and deleted by the last one to let go of it.
+	 */
+	class ParallelJob {
+	  public:
+		ParallelJob(Size begin, Size end, Size grain, U32 workers);
+		virtual ~ParallelJob() {}
+
+		/**
+		 * Runs the job on the runner's threads and the calling thread, and waits for the
+		 * whole range to be done.  Releases the caller's reference to the job.
+		 * @param runner The AsyncTaskRunner to run the helper tasks on, or NIL to run the
+		 * whole range on the calling thread.
+		 */
+		void runAndWait(AsyncTaskRunner* runner);
+
+		/**
+		 * Works on the job until there are no more chunks, called by each worker.
+		 */
+		virtual void execute() = 0;
+
+		inline void retain() { refs_.increment(kMORelaxed); }
+		inline void release() {
+			if (refs_.decrement(kMOAcqRel) == 0) {
+				delete this;
+			}
+		}
+
+		/**
+		 * Gets the default grain for a range, so each worker gets about 8 chunks.
+		 */
+		static Size getDefaultGrain(Size length, U32 workers);
+
+	  protected:
+		/**
+		 * Claims the next chunk of the range.
+		 * @param begin Set to the first index of the chunk.
+		 * @param end Set to one past the last index of the chunk.
+		 * @return False if the whole range has been claimed.
+		 */
+		Boolean claim(Size* begin, Size* end);
+
+		/**
+		 * Marks a number of indices as done, and wakes up the waiting thread once they all are.
+		 */
+		void finish(Size count);
+
+	  private:
+		ParallelJob(const ParallelJob& src);
+		ParallelJob& operator=(const ParallelJob& src);
+
+		AtomicU64			next_;
+		Size					end_;
+		Size					grain_;
+		U32					workers_;
+		U64					length_;
+		AtomicU64			done_;
+		AtomicI32			refs_;
+		Mutex					done_lock_;
+		ConditionVariable	done_signal_;
+	};
+
+	/**
+	 * The AsyncTask run on the AsyncTaskRunner for each helper thread of a ParallelJob.
+	 */
+	class ParallelJobTask : public AsyncTask {
+	  public:
+		ParallelJobTask(ParallelJob* job) : job_(job) {
+			job_->retain();
+			setDestroyable(true);
+		}
+
+		I32 run() {
+			job_->execute();
+			job_->release();
+			job_ = NIL;
+			return 0;
+		}
+
+	  private:
+		ParallelJob* job_;
+	};
+
+	template <typename Body>
+	class ParallelForJob : public ParallelJob {
+	  public:
+		ParallelForJob(Size begin, Size end, Size grain, U32 workers, const Body& body)
+			: ParallelJob(begin, end, grain, workers), body_(body) {}
+
+		void execute() {
+			Size begin, end;
+			while (claim(&begin, &end)) {
+				body_(begin, end);
+				finish(end - begin);
+			}
+		}
+
+	  private:
+		Body body_;
+	};
+
+	template <typename T, typename Body, typename Join>
+	class ParallelReduceJob : public ParallelJob {
+	  public:
+		ParallelReduceJob(Size begin, Size end, Size grain, U32 workers,
+								const T& identity, const Body& body, const Join& join)
+			: ParallelJob(begin, end, grain, workers), identity_(identity),
+			  result_(identity), body_(body), join_(join) {}
+
+		void execute() {
+			Size begin, end, count = 0;
+			T partial = identity_;
+			while (claim(&begin, &end)) {
+				partial = join_(partial, body_(begin, end));
+				count += end - begin;
+			}
+			if (count > 0) {
+				// Only counted as done once joined, so the caller never sees a partial result.
+				result_lock_.lock();
+				result_ = join_(result_, partial);
+				result_lock_.unlock();
+				finish(count);
+			}
+		}
+
+		inline const T& getResult() const { return result_; }
+
+	  private:
+		T			identity_;
+		T			result_;
+		Spinlock	result_lock_;
+		Body		body_;
+		Join		join_;
+	};
+
+	/**
+	 * Calls body(chunk_begin, chunk_end) on chunks of the range [begin, end), on the
+	 * threads of the runner and on the calling thread, and returns once every chunk is done.
+	 * It can be called from a task running on the runner.
+	 * @param runner The AsyncTaskRunner to use, or NIL to run everything on the calling thread.
+	 * @param begin The first index.
+	 * @param end One past the last index.
+	 * @param grain The smallest chunk given to a thread, or 0 to pick one from the length.
+	 * @param body The function object to call for each chunk (it is copied once).
+	 */
+	template <typename Body>
+	void parallelFor(AsyncTaskRunner* runner, Size begin, Size end, Size grain, const Body& body) {
+		if (end <= begin) {
+			return;
+		}
+		U32 workers = runner ? runner->getNumberOfThreads() + 1 : 1;
+		(new ParallelForJob<Body>(begin, end, grain, workers, body))->runAndWait(runner);
+	}
+
+	/**
+	 * Reduces the range [begin, end) to one value.  Each thread joins the results of
+	 * body(chunk_begin, chunk_end) for its chunks, and then joins its result into the total,
+	 * so join must be associative and commutative, and identity must not change a value
+	 * it is joined with.
+	 * @param runner The AsyncTaskRunner to use, or NIL to run everything on the calling thread.
+	 * @param begin The first index.
+	 * @param end One past the last index.
+	 * @param grain The smallest chunk given to a thread, or 0 to pick one from the length.
+	 * @param identity The value for an empty range.
+	 * @param body The function object returning the value of a chunk.
+	 * @param join The function object that joins two values.
+	 * @return The joined values of all the chunks.
+	 */
+	template <typename T, typename Body, typename Join>
+	T parallelReduce(AsyncTaskRunner* runner, Size begin, Size end, Size grain,
+						  const T& identity, const Body& body, const Join& join) {
+		if (end <= begin) {
+			return identity;
+		}
+		U32 workers = runner ? runner->getNumberOfThreads() + 1 : 1;
+		ParallelReduceJob<T, Body, Join>* job =
+			new ParallelReduceJob<T, Body, Join>(begin, end, grain, workers, identity, body, join);
+		job->retain();
+		job->runAndWait(runner);
+		T result = job->getResult();
+		job->release();
+		return result;
+	}
+
+	/**
+	 * Sorts the items of an array: the array is cut in pieces that are each sorted with
+	 * std::sort on a separate thread, and then the sorted pieces are merged pairwise in
+	 * parallel.  The sort is not stable.
+	 * @param runner The AsyncTaskRunner to use, or NIL to sort on the calling thread.
+	 * @param items The items to sort.
+	 * @param count The number of items.
+	 * @param less The function object comparing two items.
+	 * @param grain The smallest piece sorted on its own, or 0 for the default.
+	 */
+	template <typename T, typename Compare>
+	void parallelSort(AsyncTaskRunner* runner, T* items, Size count, const Compare& less, Size grain = 0);
+
+	template <typename T>
+	inline void parallelSort(AsyncTaskRunner* runner, T* items, Size count) {
+		parallelSort(runner, items, count, std::less<T>());
+	}
+
+	template <typename T, typename Compare>
+	inline void parallelSort(AsyncTaskRunner* runner, Vector<T>& vector, const Compare& less) {
+		parallelSort(runner, vector.dataPtr(), vector.size(), less);
+	}
+
+	template <typename T>
+	inline void parallelSort(AsyncTaskRunner* runner, Vector<T>& vector) {
+		parallelSort(runner, vector.dataPtr(), vector.size(), std::less<T>());
+	}
+
+	/**
+	 * Calls func(item) for each item of a Vector, in parallel.
+	 * @param runner The AsyncTaskRunner to use.
+	 * @param vector The Vector of items.
+	 * @param func The function object to call on each item.
+	 * @param grain The smallest chunk given to a thread, or 0 to pick one from the length.
+	 */
+	template <typename T, typename Func>
+	void parallelForEach(AsyncTaskRunner* runner, Vector<T>& vector, const Func& func, Size grain = 0);
+
+	/**
+	 * Calls func(item) for each item of an ArrayList, in parallel.  The blocks of the
+	 * ArrayList are looked up without its access cache, so the ArrayList must not be
+	 * changed while this runs.
+	 * @param runner The AsyncTaskRunner to use.
+	 * @param list The ArrayList of items.
+	 * @param func The function object to call on each item.
+	 * @param grain The smallest chunk given to a thread, or 0 to pick one from the length.
+	 */
+	template <typename T, typename Func>
+	void parallelForEach(AsyncTaskRunner* runner, ArrayList<T>& list, const Func& func, Size grain = 0);
+
+	template <typename T, typename Compare>
+	class ParallelSortPieces {
+	  public:
+		ParallelSortPieces(T* items, Size count, Size pieces, Size width, const Compare& less)
+			: items_(items), count_(count), pieces_(pieces), width_(width), less_(less) {}
+
+		/**
+		 * With a width of 0 sorts each piece, otherwise merges each pair of runs that are
+		 * width pieces long.
+		 */
+		void operator()(Size begin, Size end) const {
+			for (Size i = begin; i < end; ++i) {
+				if (width_ == 0) {
+					std::sort(items_ + offset(i), items_ + offset(i + 1), less_);
+				} else {
+					Size first = i*2*width_;
+					std::inplace_merge(items_ + offset(first),
+											 items_ + offset(std::min(first + width_, pieces_)),
+											 items_ + offset(std::min(first + 2*width_, pieces_)), less_);
+				}
+			}
+		}
+
+	  private:
+		inline Size offset(Size piece) const {
+			return (Size)(((U64)count_ * piece) / pieces_);
+		}
+
+		T*			items_;
+		Size		count_;
+		Size		pieces_;
+		Size		width_;
+		Compare	less_;
+	};
+
+	template <typename T, typename Compare>
+	void parallelSort(AsyncTaskRunner* runner, T* items, Size count, const Compare& less, Size grain) {
+		if (grain == 0) {
+			grain = 4096;
+		}
+		U32 workers = runner ? runner->getNumberOfThreads() + 1 : 1;
+		if (workers == 1 || count <= grain*2) {
+			std::sort(items, items + count, less);
+			return;
+		}
+
+		Size pieces = 1;
+		while (pieces < workers && count / (pieces*2) >= grain) {
+			pieces *= 2;
+		}
+		parallelFor(runner, 0, pieces, 1, ParallelSortPieces<T, Compare>(items, count, pieces, 0, less));
+		for (Size width = 1; width < pieces; width *= 2) {
+			Size pairs = (pieces + 2*width - 1) / (2*width);
+			parallelFor(runner, 0, pairs, 1, ParallelSortPieces<T, Compare>(items, count, pieces, width, less));
+		}
+	}
+
+	template <typename T, typename Func>
+	class ParallelForEachItem {
+	  public:
+		ParallelForEachItem(T* items, const Func& func) : items_(items), func_(func) {}
+
+		void operator()(Size begin, Size end) const {
+			for (Size i = begin; i < end; ++i) {
+				func_(items_[i]);
+			}
+		}
+
+	  private:
+		T*		items_;
+		Func	func_;
+	};
+
+	template <typename T, typename Func>
+	class ParallelForEachListItem {
+	  public:
+		ParallelForEachListItem(ArrayList<T>* list, const Func& func) : list_(list), func_(func) {}
+
+		void operator()(Size begin, Size end) const {
+			while (begin < end) {
+				Size count;
+				T* items = list_->getContiguous(begin, &count);
+				count = std::min(count, end - begin);
+				for (Size i = 0; i < count; ++i) {
+					func_(items[i]);
+				}
+				begin += count;
+			}
+		}
+
+	  private:
+		ArrayList<T>*	list_;
+		Func				func_;
+	};
+
+	template <typename T, typename Func>
+	void parallelForEach(AsyncTaskRunner* runner, Vector<T>& vector, const Func& func, Size grain) {
+		parallelFor(runner, 0, vector.size(), grain, ParallelForEachItem<T, Func>(vector.dataPtr(), func));
+	}
+
+	template <typename T, typename Func>
+	void parallelForEach(AsyncTaskRunner* runner, ArrayList<T>& list, const Func& func, Size grain) {
+		parallelFor(runner, 0, list.size(), grain, ParallelForEachListItem<T, Func>(&list, func));
+	}
+
+} // namespace Cat
+
+#endif // CAT_CORE_THREADING_PARALLEL_H
@@ -254,7 +254,7 @@ namespace Cat {
 		 * @brief Increase the retain count by one.
 		 */
 		inline void retain() {
-		   m_retainCount.increment();			
+		   m_retainCount.increment(kMORelaxed);			
 		}
 
 		/**
@@ -262,11 +262,7 @@ namespace Cat {
 		 * @return True if there are no more references to the Process.
 		 */
 		inline Boolean release() {
-		   m_retainCount.decrement();	
-			if (m_retainCount.val() <= 0) {
-				return true;
-			}
-			return false;
+			return m_retainCount.decrement(kMOAcqRel) <= 0;
 		}
 
 		/**
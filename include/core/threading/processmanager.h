@@ -13,6 +13,7 @@
 #include "core/corelib.h"
 #include "core/threading/process.h"
 #include "core/threading/processrunner.h"
+#include "core/util/hashedid.h"
 #include "core/util/staticmap.h"
 
 namespace Cat {
@@ -22,7 +23,10 @@ namespace Cat {
 	 * @brief The Class that is responsible for holding multiple ProcessRunners.
 	 *
 	 * The ProcessManager provides a means of running multiple ProcessRunners 
-	 * simultaneously.
+	 * simultaneously.  Processes can be queued on a named runner, or on the
+	 * least loaded one.  With a migration threshold set, a runner with more
+	 * running processes than another by more than the threshold moves some of
+	 * them to it, so the runners act as one pool spread over all their threads.
 	 *
 	 * @since Mar 7, 2014
 	 * @version 1
@@ -33,7 +37,7 @@ namespace Cat {
 		/**
 		 * @brief Initializes an empty ProcessManager with no process runners.
 		 */
-		ProcessManager() { }		
+		ProcessManager() : m_migrationThreshold(0) { }		
 
 		/**
 		 * @brief Create a new Process Manager with the specified number of runners.
@@ -50,10 +54,14 @@ namespace Cat {
 		 * @brief Create a new ProcessRunner.
 		 * @param name The name of the process runner.
 		 * @param queueSize the number of processes that can be run on the runner.
+		 * @param options The options to start the runner's thread with.
 		 */
-		Boolean createProcessRunner(const Char* name, Size queueSize = 32) {
+		Boolean createProcessRunner(const Char* name, Size queueSize = 32, const ThreadOptions& options = ThreadOptions()) {
 			if (!m_runners.contains(crc32(name)) && m_runners.size() != m_runners.capacity()) {
-				m_runners.insert(crc32(name), new ProcessRunner(name, queueSize));
+				ProcessRunner* runner = new ProcessRunner(name, queueSize, options);
+				runner->setProcessManager(m_migrationThreshold > 0 ? this : NIL);
+				m_runners.insert(crc32(name), runner);
+				D(HashedID(name).record());
 				return true;				
 			}
 			else {
@@ -69,6 +77,15 @@ namespace Cat {
 			}			
 		}
 
+		/**
+		 * @brief Find a runner to move processes to from a busy runner.
+		 * @param busy The runner looking for somewhere to move processes to.
+		 * @param busyLoad The number of processes running on the busy runner.
+		 * @return The least loaded running runner, if its load is more than the
+		 * migration threshold below the busy runner's, else NIL.
+		 */
+		ProcessRunner* findIdleProcessRunner(ProcessRunner* busy, U32 busyLoad);
+
 		/**
 		 * @brief Get a pointer to the specified process runner.
 		 * @param id The id of the process runner.
@@ -86,6 +103,9 @@ namespace Cat {
 		inline ProcessRunner* getProcessRunner(const Char* name) {
 			return getProcessRunner(crc32(name));
 		}
+		inline ProcessRunner* getProcessRunner(const HashedID& name) {
+			return getProcessRunner(name.id());
+		}
 
 		/**
 		 * @brief Find the specified process on the specified process runner.
@@ -118,6 +138,9 @@ namespace Cat {
 		inline ProcessPtr getProcess(const Char* pname, const Char* runnerName) {
 			return getProcess(crc32(pname), crc32(runnerName));
 		}
+		inline ProcessPtr getProcess(const HashedID& pname, const HashedID& runnerName) {
+			return getProcess(pname.id(), runnerName.id());
+		}
 
 		/**
 		 * @brief Find the specified process (looks on all process runner).
@@ -132,6 +155,16 @@ namespace Cat {
 		inline ProcessPtr getProcess(const Char* name) {
 			return getProcess(crc32(name));
 		}
+		inline ProcessPtr getProcess(const HashedID& name) {
+			return getProcess(name.id());
+		}
+
+		/**
+		 * @brief Get the runner with the least processes running or waiting.
+		 * Only runners that are running or not started yet are considered.
+		 * @return The least loaded runner, or NIL if there is none.
+		 */
+		ProcessRunner* leastLoadedProcessRunner();
 
 		/**
 		 * @brief Get the max number of process runners we can have.
@@ -139,6 +172,12 @@ namespace Cat {
 		 */
 		inline U32 maxProcessRunners() const { return m_runners.capacity(); }		
 
+		/**
+		 * @brief Get the difference in load at which processes migrate between runners.
+		 * @return The migration threshold, 0 if processes stay on their runner.
+		 */
+		inline U32 migrationThreshold() const { return m_migrationThreshold; }
+
 		/**
 		 * @brief Get the number of process runners we have.
 		 * @return The number of process runners we have.
@@ -174,6 +213,9 @@ namespace Cat {
 		inline void pauseProcess(const Char* pname, const Char* runnerName) {
 			pauseProcess(crc32(pname), crc32(runnerName));		
 		}
+		inline void pauseProcess(const HashedID& pname, const HashedID& runnerName) {
+			pauseProcess(pname.id(), runnerName.id());
+		}
 
 		/**
 		 * @brief Pause the specified process.  
@@ -184,6 +226,9 @@ namespace Cat {
 		inline void pauseProcess(const Char* name) {
 			return pauseProcess(crc32(name));
 		}
+		inline void pauseProcess(const HashedID& name) {
+			return pauseProcess(name.id());
+		}
 		
 		/**
 		 * @brief Add a new process to the process runner.
@@ -200,6 +245,20 @@ namespace Cat {
 			}		
 		}
 
+		/**
+		 * @brief Add a new process to the least loaded process runner.
+		 * @param process The process to add to be run.
+		 */
+		inline Boolean queueProcess(const ProcessPtr& process) {
+			ProcessRunner* runner = leastLoadedProcessRunner();
+			if (runner) {
+				return runner->queueProcess(process);
+			} else {
+				DWARN("No running Runner to queue process " << process->name() << " on!");
+				return false;
+			}
+		}
+
 		/**
 		 * @brief Add a new process to the process runner.
 		 * @param runnerName The name of the process runner to run the process on.		 
@@ -208,6 +267,50 @@ namespace Cat {
 		inline Boolean queueProcess(const Char* runnerName, const ProcessPtr& process) {
 		   return queueProcess(crc32(runnerName), process);				
 		}
+		inline Boolean queueProcess(const HashedID& runnerName, const ProcessPtr& process) {
+			return queueProcess(runnerName.id(), process);
+		}
+
+		/**
+		 * @brief Add several processes to the process runner, waking it up only once.
+		 * @param runnerID The ID of the process runner to run the processes on.
+		 * @param processes The processes to add to be run.
+		 * @param count The number of processes.
+		 * @return The number of processes queued, starting from the first.
+		 */
+		inline Size queueProcesses(OID runnerID, const ProcessPtr* processes, Size count) {
+			ProcessRunner* runner = m_runners.at(runnerID);
+			if (runner) {
+				return runner->queueProcesses(processes, count);
+			} else {
+				DWARN("No such Runner with ID " << runnerID << "!");
+				return 0;
+			}
+		}
+
+		/**
+		 * @brief Add several processes to the process runner, waking it up only once.
+		 * @param runnerName The name of the process runner to run the processes on.
+		 * @param processes The processes to add to be run.
+		 * @param count The number of processes.
+		 * @return The number of processes queued, starting from the first.
+		 */
+		inline Size queueProcesses(const Char* runnerName, const ProcessPtr* processes, Size count) {
+			return queueProcesses(crc32(runnerName), processes, count);
+		}
+		inline Size queueProcesses(const HashedID& runnerName, const ProcessPtr* processes, Size count) {
+			return queueProcesses(runnerName.id(), processes, count);
+		}
+
+		/**
+		 * @brief Add all the processes in the Vector to the process runner.
+		 * @param runnerID The ID of the process runner to run the processes on.
+		 * @param processes The processes to add to be run.
+		 * @return The number of processes queued, starting from the first.
+		 */
+		inline Size queueProcesses(OID runnerID, const Vector<ProcessPtr>& processes) {
+			return queueProcesses(runnerID, processes.dataPtr(), processes.size());
+		}
 
 		/**
 		 * @brief Resume the specified process on the specified process runner.
@@ -238,6 +341,9 @@ namespace Cat {
 		inline void resumeProcess(const Char* pname, const Char* runnerName) {
 			resumeProcess(crc32(pname), crc32(runnerName));		
 		}
+		inline void resumeProcess(const HashedID& pname, const HashedID& runnerName) {
+			resumeProcess(pname.id(), runnerName.id());
+		}
 
 		/**
 		 * @brief Resume the specified process.  
@@ -248,6 +354,26 @@ namespace Cat {
 		inline void resumeProcess(const Char* name) {
 			return resumeProcess(crc32(name));
 		}
+		inline void resumeProcess(const HashedID& name) {
+			return resumeProcess(name.id());
+		}
+
+		/**
+		 * @brief Pass on a message for a process a runner does not have.
+		 * Used by the runners when a process moved away before a message for it arrived.
+		 * @param from The runner the message was sent to.
+		 * @param message The message for the process.
+		 */
+		void routeMessage(ProcessRunner* from, const ProcessRunner::PMMessage& message);
+
+		/**
+		 * @brief Let busy runners move running processes to less loaded ones.
+		 * Processes are only moved when the busy runner has more than threshold
+		 * more processes running than the other.  Must be set before the
+		 * runners are started.
+		 * @param threshold The difference in load to move processes at, 0 to keep processes on their runner.
+		 */
+		void setMigrationThreshold(U32 threshold);
 
 		/**
 		 * @brief Start all the process runners.
@@ -274,6 +400,9 @@ namespace Cat {
 		inline void terminateAllProcesses(const Char* runnerName) {
 		   terminateAllProcesses(crc32(runnerName));			
 		}
+		inline void terminateAllProcesses(const HashedID& runnerName) {
+			terminateAllProcesses(runnerName.id());
+		}
 
 		/**
 		 * @brief Terminate all processes on all process runners.
@@ -306,6 +435,9 @@ namespace Cat {
 		inline void terminateProcessRunner(const Char* runnerName) {
 			terminateProcessRunner(crc32(runnerName));
 		}
+		inline void terminateProcessRunner(const HashedID& runnerName) {
+			terminateProcessRunner(runnerName.id());
+		}
 
 		/**
 		 * @brief Terminate the specified process on the specified process runner.
@@ -336,6 +468,9 @@ namespace Cat {
 		inline void terminateProcess(const Char* pname, const Char* runnerName) {
 			terminateProcess(crc32(pname), crc32(runnerName));		
 		}
+		inline void terminateProcess(const HashedID& pname, const HashedID& runnerName) {
+			terminateProcess(pname.id(), runnerName.id());
+		}
 
 		/**
 		 * @brief Terminate the specified process.  
@@ -346,6 +481,9 @@ namespace Cat {
 		inline void terminateProcess(const Char* name) {
 			return terminateProcess(crc32(name));
 		}
+		inline void terminateProcess(const HashedID& name) {
+			return terminateProcess(name.id());
+		}
 
 		/**
 		 * @brief Wait for all the process runners to terminate.
@@ -355,6 +493,7 @@ namespace Cat {
 
 	  private:
 		StaticMap<ProcessRunner*> m_runners;		
+		U32 m_migrationThreshold;
 				
 
 	};
@@ -16,25 +16,32 @@
 
 namespace Cat {
 
+	class ProcessRunner;
+
 	class ProcessQueueNode {
 	  public:
 		ProcessQueueNode* prev;
 		ProcessQueueNode* next;
 		ProcessPtr process;
 		I32 count;		
+		I64 deficit;	/**< Nanoseconds the process may still run for, negative while in debt. */
+		ProcessRunner* movedTo;	/**< The runner the process migrated to, messages for it are forwarded there. */
 		
-		ProcessQueueNode() : prev(NIL), next(NIL), count(0) {};
+		ProcessQueueNode() : prev(NIL), next(NIL), count(0), deficit(0), movedTo(NIL) {};
 		
 		void alloc(ProcessQueueNode* root, const ProcessPtr& pProcess) {
 			detach();
 			attach(root);			
 			process = pProcess;
+			deficit = 0;
+			movedTo = NIL;
 		}
 
 		void dealloc(ProcessQueueNode* root) {
 			detach();
 			attach(root);
 			process.setNull();
+			movedTo = NIL;
 		}
 
 		void initAsRoot() {
@@ -89,8 +96,15 @@ namespace Cat {
 	 * @class ProcessQueueIndex processqueue.h "core/threading/processqueue.h"
 	 * @brief An index Into the processQueue by OID of the process.
 	 *
+	 * The index is an open addressing hash table with linear probing.  The
+	 * pids are CRC32 values, so the low bits of the pid are used as the hash.
+	 * Removed entries are filled by shifting the entries after them back, so
+	 * finding a pid stays fast however many processes come and go.  The table
+	 * is allocated up front for the capacity, and only grows if more entries
+	 * than that are set.
+	 *
 	 * @author Catlin Zilinski
-	 * @version 1
+	 * @version 2
 	 * @since Mar 6, 2014
 	 */
 	class ProcessQueueIndex {
@@ -98,14 +112,14 @@ namespace Cat {
 		/**
 		 * @brief Create an empty ProcessQueueIndex.
 		 */
-		ProcessQueueIndex() : m_capacity(0), m_pIndices(NIL) {}		
+		ProcessQueueIndex() : m_capacity(0), m_size(0), m_mask(0), m_pIndices(NIL) {}		
 
 		/**
 		 * @brief Create a new ProcessQueueIndex with number of spaces.
-		 * @param capacity The number of spaces to have in the index.
+		 * @param capacity The number of entries to have room for.
 		 */
-		ProcessQueueIndex(Size capacity) : m_capacity(capacity) {
-			m_pIndices = new PQICell[m_capacity];
+		ProcessQueueIndex(Size capacity) : m_capacity(0), m_size(0), m_mask(0), m_pIndices(NIL) {
+			initWithCapacity(capacity);
 		}
 
 		/**
@@ -126,13 +140,23 @@ namespace Cat {
 		 */
 		~ProcessQueueIndex();		
 
+		/**
+		 * @brief Get the number of entries the index has room for without growing.
+		 * @return The capacity of the index.
+		 */
+		inline Size capacity() const { return m_capacity; }
+
 		/**
 		 * @brief Find the specified Process location by the OID.
+		 * If the pid was set more than once, the entry set first is found.
 		 * @param pid The OID of the process to find.
-		 * @return The index in the queue of the process.
+		 * @return The node of the process, or NIL if not in the index.
 		 */
 		ProcessQueueNode* find(OID pid) const {
-			for (U32 i = 0; i < m_capacity; i++) {			
+			if (m_size == 0 || pid == 0) {
+				return NIL;
+			}
+			for (U32 i = pid & m_mask; m_pIndices[i].pid != 0; i = (i + 1) & m_mask) {
 				if (m_pIndices[i].pid == pid) {
 					return m_pIndices[i].node;
 				}
@@ -142,78 +166,48 @@ namespace Cat {
 
 		/**
 		 * @brief Initialize the ProcessQueueIndex with the specified capacity.
-		 * @param capacity The Capacity for the PQI to have.
+		 * Removes all the entries.
+		 * @param capacity The number of entries to have room for.
 		 */
-		void initWithCapacity(Size capacity) {
-			PQICell* indices = new PQICell[capacity];
-			PQICell* old = m_pIndices;
-			m_pIndices = indices;
-			m_capacity = capacity;			
-			if (old) {
-				delete[] old;
-			}			
-		}		
-			
+		void initWithCapacity(Size capacity);
 
 		/**
 		 * @brief Remove the specified index entry from the index.
 		 * @param pid The OID of the index to remove.
 		 */
-		void remove(OID pid) {
-			for (U32 i = 0; i < m_capacity; i++) {
-				if (m_pIndices[i].pid == pid) {
-					m_pIndices[i].pid = 0;
-				   return;					
-				}
-			}
-		}
+		void remove(OID pid);
 
 		/**
 		 * @brief Remove all the entries from the index.
 		 */
 		void clear() {
-			for (U32 i = 0; i < m_capacity; i++) {
+			for (U32 i = 0; i <= m_mask && m_pIndices; i++) {
 				m_pIndices[i].pid = 0;				
+				m_pIndices[i].node = NIL;
 			}
+			m_size = 0;
 		}
 
-		/**
-		 * @brief Remove the entry at the specified index.
-		 * @param index The index value to remove.
-		 */
-		inline void removeAtIndex(I32 index) {
-			m_pIndices[index].pid = 0;
-		}		
-		
-
 		/**
 		 * @brief Set the specified entry in the index.
+		 * Grows the index if it is already at capacity.
 		 * @param pid The OID of the process.
 		 * @param node The processqueuenode the process is in.
 		 */
-		inline void set(OID pid, ProcessQueueNode* node) {	
-			for (U32 i = 0; i < m_capacity; i++) {
-				if (m_pIndices[i].pid == 0) {									
-					m_pIndices[i].node = node;
-					m_pIndices[i].pid = pid;
-					return;					
-				}
-			}				
-		}
+		void set(OID pid, ProcessQueueNode* node);
 
 		/**
-		 * @brief Set the specified entry in the index.
-		 * @param pid The OID of the process.
-		 * @param node The processqueuenode the process is in.
+		 * @brief Get the number of entries in the index.
+		 * @return The number of entries in the index.
 		 */
-		inline void setAtIndex(U32 idx, OID pid, ProcessQueueNode* node) {
-			m_pIndices[idx].pid = 0;
-			m_pIndices[idx].node = node;								
-		}
-		
+		inline Size size() const { return m_size; }
 
 	  private:
+		void insert(OID pid, ProcessQueueNode* node);
+
 		Size m_capacity;
+		Size m_size;
+		U32 m_mask;		/**< The number of cells minus one, the cells are a power of two */
 		PQICell* m_pIndices;
 	};
 
@@ -12,13 +12,19 @@
 
 #include "core/corelib.h"
 #include "core/threading/threaddefs.h"
+#include "core/threading/threadoptions.h"
+#include "core/threading/atomic.h"
+#include "core/threading/mutex.h"
 #include "core/threading/conditionvariable.h"
-#include "core/threading/spinlock.h"
+#include "core/threading/eventcount.h"
+#include "core/threading/mpscqueue.h"
 #include "core/threading/processqueue.h"
-#include "core/util/simplequeue.h"
+#include "core/util/vector.h"
 
 namespace Cat {
 
+	class ProcessManager;
+
 	/**
 	 * @class ProcessRunner processrunner.h "core/threading/processrunner.h"
 	 * @brief A class capable of running multiple tasks at a time on a single thread.
@@ -26,6 +32,22 @@ namespace Cat {
 	 * executing multiple tasks at once by giving each task a certain amount of 
 	 * time in which to execute, before moving onto the next task.
 	 *
+	 * By default every running process is run once per tick.  With a time budget
+	 * set, each process is given a slice of wall-clock time based on its priority,
+	 * the time it actually runs is measured, and a process that overruns its slice
+	 * is skipped until its debt is paid off (deficit round robin).  The tick stops
+	 * once the budget is used up, and the next tick carries on where it stopped.
+	 *
+	 * Processes stay on the runner they were queued on, unless the runner is given
+	 * a ProcessManager that migrates processes to idle runners.  A process that
+	 * moved leaves a node behind for a few ticks that forwards the messages for
+	 * it, so pausing, resuming and terminating it still work while it moves.
+	 * Processes that are the child or the parent of another process never move.
+	 *
+	 * Processes and messages are passed to the runner thread through lock-free
+	 * MPSCQueues, so queueing never blocks on the runner thread or on the other
+	 * producers, and only wakes the runner thread if it is asleep.
+	 *
 	 * @since Mar 4, 2014
 	 * @version 1
 	 * @author Catlin Zilinski
@@ -50,14 +72,21 @@ namespace Cat {
 			kPMMTerminateProcessRunner
 		};		
 
+		/** The number of ticks a runner forwards the messages for a process that moved away. */
+		static const I32 kMigrationForwardTicks = 16;
+
+		/** The most processes moved to an idle runner at once, so they fit in a buffer on the stack. */
+		static const U32 kMaxSharedProcesses = 16;
+
 		class PMMessage {
 		  public:
 			ProcessRunnerMessage type;
 			OID pid;
+			Boolean routed;	/**< Sent to every runner by the ProcessManager, not routed again */
 			
-			PMMessage() : type(kPMMNoMessage), pid(0) {}
+			PMMessage() : type(kPMMNoMessage), pid(0), routed(false) {}
 			PMMessage(ProcessRunnerMessage pType, OID pPid = 0)
-				: type(pType), pid(pPid) {				
+				: type(pType), pid(pPid), routed(false) {				
 			}
 
 			inline Boolean operator==(const PMMessage& other) const {			
@@ -72,13 +101,18 @@ namespace Cat {
 		 * @brief Initializes an empty ProcessRunner with no processes.
 		 */
 		ProcessRunner() :
-			m_state(kPMSNotStarted), m_oid(0), m_pName(NIL), m_numFree(0), m_numUsed(0), m_pNodeStorage(NIL) {}
+			m_state(kPMSNotStarted), m_oid(0), m_pName(NIL), m_pManager(NIL),
+			m_numFree(0), m_numUsed(0), m_pNodeStorage(NIL),
+			m_tickBudget(0), m_baseSlice(0) {}
 
 		/**
 		 * @brief Create a new Process Runner with the specified name.
 		 * @param name The name of the Process Runner.
+		 * @param queueSize The number of processes that can be queued on the runner.
+		 * @param options The options to start the runner's thread with, the
+		 * thread is named after the runner if the options do not name it.
 		 */
-		ProcessRunner(const Char* name, Size queueSize = 32);		
+		ProcessRunner(const Char* name, Size queueSize = 32, const ThreadOptions& options = ThreadOptions());		
 
 		/**
 		 * @brief Makes sure to stop all the processes, the thread, etc.
@@ -147,6 +181,15 @@ namespace Cat {
 			return (m_state == kPMSNotStarted || m_state == kPMSTerminated);
 		}
 
+		/**
+		 * @brief Get the number of processes running or waiting to run on the runner.
+		 * Paused processes are not counted.  Only a hint while the runner is running.
+		 * @return The number of processes running or waiting to run.
+		 */
+		inline U32 load() const {
+			return (U32)(m_inputQueue.size() + m_load.val());
+		}
+
 		/**
 		 * @brief Get the name of the process manager.
 		 * @return The name of the process manager.
@@ -177,11 +220,8 @@ namespace Cat {
 		 * @return True if the message was posted to pause the process.
 		 */
 		inline Boolean pauseProcess(OID pid) {
-			Boolean success = false;			
-			m_syncLock.lock();
-			success = m_messageQueue.push(PMMessage(kPMMPauseProcess, pid));
-			m_syncLock.broadcast();			
-			m_syncLock.unlock();
+			Boolean success = m_messageQueue.push(PMMessage(kPMMPauseProcess, pid));
+			m_wakeup.notifyAll();
 #if defined (DEBUG)
 			if (!success) {				
 				DWARN("Failed to put kPMMPauseProcess (" << pid << ")  message on Queue, queue full!");
@@ -223,15 +263,15 @@ namespace Cat {
 		 */
 		inline Boolean queueProcess(const ProcessPtr& process) {
 			Boolean success = false;			
-			m_syncLock.lock();
 			if (m_state == kPMSRunning || m_state == kPMSNotStarted) {
-				success = m_inputQueue.push(process);
+				success = m_inputQueue.push(process) && !drainIfTerminated();
 			}			
-			m_syncLock.broadcast();			
-			m_syncLock.unlock();
+			if (success) {
+				m_wakeup.notifyAll();
+			}
 #if defined (DEBUG)
 			if (!success) {
-				if (m_state != kPMSRunning || m_state != kPMSNotStarted) {
+				if (m_state != kPMSRunning && m_state != kPMSNotStarted) {
 					
 					DWARN("Failed to queue process " << process->name() << " Runner in UNuseable state!");
 				}
@@ -243,17 +283,54 @@ namespace Cat {
 			return success;			
 		}
 
+		/**
+		 * @brief Add several processes to the process runner, waking it up only once.
+		 * If the input queue fills up, only the first processes are queued.
+		 * @param processes The processes to add to be run.
+		 * @param count The number of processes.
+		 * @return The number of processes queued, starting from the first.
+		 */
+		inline Size queueProcesses(const ProcessPtr* processes, Size count) {
+			Size queued = 0;
+			if (m_state == kPMSRunning || m_state == kPMSNotStarted) {
+				queued = m_inputQueue.push(processes, count);
+				if (queued > 0 && drainIfTerminated()) {
+					queued = 0;
+				}
+			}
+			if (queued > 0) {
+				m_wakeup.notifyAll();
+			}
+#if defined (DEBUG)
+			if (queued < count) {
+				if (m_state != kPMSRunning && m_state != kPMSNotStarted) {
+					DWARN("Failed to queue " << count << " processes, Runner in UNuseable state!");
+				}
+				else {
+					DWARN("Only queued " << queued << " of " << count << " processes, input queue full!");
+				}
+			}
+#endif /* DEBUG */
+			return queued;
+		}
+
+		/**
+		 * @brief Add all the processes in the Vector to the process runner.
+		 * @param processes The processes to add to be run.
+		 * @return The number of processes queued, starting from the first.
+		 */
+		inline Size queueProcesses(const Vector<ProcessPtr>& processes) {
+			return queueProcesses(processes.dataPtr(), processes.size());
+		}
+
 		/**
 		 * @brief Resume the specified process.
 		 * @param pid The process ID to resume.
 		 * @return True if the message was posted to resume the process.
 		 */
 		inline Boolean resumeProcess(OID pid) {
-			Boolean success = false;			
-			m_syncLock.lock();
-			success = m_messageQueue.push(PMMessage(kPMMResumeProcess, pid));
-			m_syncLock.broadcast();			
-			m_syncLock.unlock();
+			Boolean success = m_messageQueue.push(PMMessage(kPMMResumeProcess, pid));
+			m_wakeup.notifyAll();
 #if defined (DEBUG)
 			if (!success) {				
 				DWARN("Failed to put kPMMResumeProcess (" << pid << ")  message on Queue, queue full!");
@@ -283,6 +360,29 @@ namespace Cat {
 		 */	  
 		void runProcesses(U32 timeForEachProcess);
 
+		/**
+		 * @brief Set the ProcessManager to find idle runners to migrate processes to.
+		 * Must be set before the runner is started.
+		 * @param manager The ProcessManager, or NIL to keep all the processes here.
+		 */
+		inline void setProcessManager(ProcessManager* manager) { m_pManager = manager; }
+
+		/**
+		 * @brief Give the processes wall-clock time slices, and cap the time of each tick.
+		 * Each tick a process earns baseSlice * priority * priorityModifier nanoseconds,
+		 * and is only run while it has some left.  The time it actually ran is taken off,
+		 * so a process that overruns goes into debt and sits out the next ticks.  Unused
+		 * time is not saved up past one slice.  In this mode Process::run() is passed
+		 * the time the process may run for in microseconds.
+		 * Not thread safe, must be called before the runner is started.
+		 * @param tickBudget The most time to spend running processes each tick, in nanoseconds, 0 to run every process once per tick.
+		 * @param baseSlice The slice of a process with a priority of 1, in nanoseconds.
+		 */
+		inline void setTimeBudget(U64 tickBudget, U64 baseSlice) {
+			m_tickBudget = tickBudget;
+			m_baseSlice = baseSlice;
+		}
+
 		/**
 		 * @brief Get the state of the process manager.
 		 * @return The current state of the process manager.
@@ -295,10 +395,8 @@ namespace Cat {
 		 * stop the Process manager from running.
 		 */
 		inline Boolean terminateAllProcesses() {
-			Boolean success = false;
-			m_syncLock.lock();			
-			success = m_messageQueue.push(PMMessage(kPMMTerminateAllProcesses));			
-			m_syncLock.unlock();
+			Boolean success = m_messageQueue.push(PMMessage(kPMMTerminateAllProcesses));			
+			m_wakeup.notifyAll();
 #if defined (DEBUG)
 			if (!success) {				
 				DWARN("Failed to put kPMMTerminateAllProcesses message on Queue, queue full!");
@@ -307,17 +405,26 @@ namespace Cat {
 			return success;			
 		}
 
+		/**
+		 * @brief Get the most time spent running processes each tick.
+		 * @return The tick budget in nanoseconds, 0 if processes are run once per tick.
+		 */
+		inline U64 tickBudget() const { return m_tickBudget; }
+
+		/**
+		 * @brief Get the slice of a process with a priority of 1.
+		 * @return The base slice in nanoseconds.
+		 */
+		inline U64 baseSlice() const { return m_baseSlice; }
+
 		/**
 		 * @brief Terminate the specified process.
 		 * @param pid The process ID to terminate.
 		 * @return True if the message was posted to terminate the process.
 		 */
 		inline Boolean terminateProcess(OID pid) {
-			Boolean success = false;			
-			m_syncLock.lock();
-			success = m_messageQueue.push(PMMessage(kPMMTerminateProcess, pid));
-			m_syncLock.broadcast();			
-			m_syncLock.unlock();
+			Boolean success = m_messageQueue.push(PMMessage(kPMMTerminateProcess, pid));
+			m_wakeup.notifyAll();
 #if defined (DEBUG)
 			if (!success) {				
 				DWARN("Failed to put kPMMTerminateProcess (" << pid << ")  message on Queue, queue full!");
@@ -341,11 +448,8 @@ namespace Cat {
 		 * the process manager as well.
 		 */
 		inline Boolean terminateProcessRunner() {
-			Boolean success = false;			
-			m_syncLock.lock();
-			success = m_messageQueue.push(PMMessage(kPMMTerminateProcessRunner));
-			m_syncLock.broadcast();
-			m_syncLock.unlock();
+			Boolean success = m_messageQueue.push(PMMessage(kPMMTerminateProcessRunner));
+			m_wakeup.notifyAll();
 #if defined (DEBUG)
 			if (!success) {				
 				DWARN("Failed to put kPMMTerminateProcessRunner message on Queue, queue full!");
@@ -360,6 +464,12 @@ namespace Cat {
 		 */
 		inline ThreadHandle* threadPtr() { return &m_thread; }
 
+		/**
+		 * @brief Get the options the runner's thread is started with.
+		 * @return The options of the runner's thread.
+		 */
+		inline const ThreadOptions& threadOptions() const { return m_threadOptions; }
+
 		/**
 		 * @brief Wait for the processRunner to stop running.
 		 * @return True if the processRunner is no longer running.
@@ -377,17 +487,30 @@ namespace Cat {
 		/* ################################################### */
 
 #if defined (DEBUG)
-		SimpleQueue<ProcessPtr>* inputQueue() { return &m_inputQueue; }
+		MPSCQueue<ProcessPtr>* inputQueue() { return &m_inputQueue; }
 		ProcessQueueNode* removedQueue() { return &m_removed; }
-		SimpleQueue<PMMessage>* messageQueue() { return &m_messageQueue; }
+		MPSCQueue<PMMessage>* messageQueue() { return &m_messageQueue; }
 		ProcessQueueNode* runningQueue() { return &m_running; }
 		ProcessQueueNode* pausedQueue() { return &m_paused; }
 #endif // DEBUG
 
 	  private:
+		friend class ProcessManager;
+
 		void addRunningProcess(const ProcessPtr& process);
+		void pullInputQueue();
+		void runWithinBudget(ProcessQueueNode* node, U64 tickStart);
+		U32 shareRunningProcesses(ProcessRunner* idle, U32 count);
+		inline void postMessage(const PMMessage& message) {
+			if (!m_messageQueue.push(message)) {
+				DWARN("Failed to forward message " << message.type << " (" << message.pid << ") to " << name() << ", queue full!");
+			}
+			m_wakeup.notifyAll();
+		}
+		void setState(ProcessRunnerState state);
 		void clearProcesses();
 		void clearInputQueue();	
+		Boolean drainIfTerminated();
 		void terminateRunningProcesses();
 		void terminatePausedProcesses();
 		inline void checkForChildAndRemoveIfNeeded(ProcessPtr& process) {
@@ -405,22 +528,29 @@ namespace Cat {
 		}	
 			
 
-		ProcessRunnerState m_state;
+		volatile ProcessRunnerState m_state;
 		OID					  m_oid;		
 		Char*					  m_pName;		
-		ConditionVariable	  m_syncLock;		
+		ProcessManager*	  m_pManager;		/**< Finds the idle runners to migrate processes to */
+		Mutex					  m_stateLock;		/**< Guards the changes of m_state */
+		ConditionVariable	  m_stateChanged;
+		EventCount			  m_wakeup;			/**< The runner thread sleeps on it while there is nothing to do */
 		ThreadHandle		  m_thread;
+		ThreadOptions		  m_threadOptions;
 
 		U32 m_numFree;
 		U32 m_numUsed;		
-		SimpleQueue<ProcessPtr>		   m_inputQueue;
-		SimpleQueue<PMMessage>		   m_messageQueue;
+		AtomicU64 m_load;		/**< The running processes, read by other threads */
+		MPSCQueue<ProcessPtr>		   m_inputQueue;
+		MPSCQueue<PMMessage>		   m_messageQueue;
 		ProcessQueueIndex m_index;		
 		ProcessQueueNode m_free;		
 		ProcessQueueNode m_running;
 		ProcessQueueNode m_paused;
 		ProcessQueueNode m_removed;
 		ProcessQueueNode* m_pNodeStorage;
+		U64 m_tickBudget;		/**< Time to spend running processes each tick in ns, 0 for no budget */
+		U64 m_baseSlice;		/**< Time slice of a process with a priority of 1 in ns */
 	};
 	
 } // namespace Cat
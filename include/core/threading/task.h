@@ -18,6 +18,7 @@
 #include "core/string/stringutils.h"
 
 namespace Cat {
+	class TaskRunner;
 
 	/**
 	 * @interface Task task.h "core/threading/task.h"
@@ -171,6 +172,21 @@ namespace Cat {
 		 */
 		virtual void onTermination() {}	
 
+		/**
+		 * @brief Park the task if it is waiting to be woken.
+		 * Called by the TaskRunner after a run that did not finish the task, a parked
+		 * task is not run again until it is woken and calls runner->wakeParkedTasks().
+		 * @param runner The runner parking the task, or NIL when the runner lets it go.
+		 * @return True if the task is waiting and was parked.
+		 */
+		virtual Boolean park(TaskRunner* runner) { return false; }
+
+		/**
+		 * @brief Check to see if a parked task is still waiting to be woken.
+		 * @return True if the task should stay parked.
+		 */
+		virtual Boolean isWaiting() const { return false; }
+
 		/**
 		 * @brief method to get the parent task of a child task.
 		 * @return The Parent task or NIL.
@@ -194,18 +210,14 @@ namespace Cat {
 		/**
 		 * @brief Increase the retain count by one.
 		 */
-		inline void retain() { m_retainCount.increment(); }
+		inline void retain() { m_retainCount.increment(kMORelaxed); }
 
 		/**
 		 * @brief Decrement the retainCount by one.
 		 * @return True if there are no more references to the Task.
 		 */
 		inline Boolean release() {
-			m_retainCount.decrement();			
-			if (m_retainCount.val() <= 0) {
-				return true;
-			}
-			return false;
+			return m_retainCount.decrement(kMOAcqRel) <= 0;
 		}
 
 		/**
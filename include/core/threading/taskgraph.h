@@ -0,0 +1,221 @@
+#ifndef CAT_CORE_THREADING_TASKGRAPH_H
+#define CAT_CORE_THREADING_TASKGRAPH_H
+/**
+ * @copyright Catlin Zilinksi, 2015.  All rights reserved.
+ *
+ * @file taskgraph.h
+ * @brief Contains the TaskGraph class, which runs Tasks in dependency order on a TaskManager.
+ *
+ * @author Catlin Zilinski
+ * @date Mar 24, 2015
+ */
+
+#include "core/corelib.h"
+#include "core/threading/task.h"
+#include "core/threading/taskmanager.h"
+#include "core/threading/mutex.h"
+#include "core/threading/conditionvariable.h"
+#include "core/util/vector.h"
+
+namespace Cat {
+
+	class TaskGraph;
+
+	/**
+	 * @class TaskGraphNode taskgraph.h "core/threading/taskgraph.h"
+	 * @brief The Task queued on the TaskRunners for each Task in a TaskGraph.
+	 *
+	 * The node runs the wrapped Task, and when it is done it releases each of its
+	 * successors.  The successor whose last predecessor finishes is the one that queues it.
+	 *
+	 * @author Catlin Zilinski
+	 * @version 1
+	 * @since Mar 24, 2015
+	 */
+	class TaskGraphNode : public Task {
+	  public:
+		TaskGraphNode(TaskGraph* graph, I32 index, const TaskPtr& task);
+
+		/**
+		 * @brief Get the Task this node runs.
+		 * @return The wrapped Task.
+		 */
+		inline const TaskPtr& task() const { return m_task; }
+
+		/**
+		 * @brief Get the index of the node in its TaskGraph.
+		 * @return The index returned by TaskGraph::addTask().
+		 */
+		inline I32 index() const { return m_index; }
+
+		/**
+		 * @brief Get the number of Tasks that must finish before this one can run.
+		 * @return The number of predecessors.
+		 */
+		inline U32 numPredecessors() const { return m_numPredecessors; }
+
+		/**
+		 * @brief Get the number of Tasks waiting on this one.
+		 * @return The number of successors.
+		 */
+		inline U32 numSuccessors() const { return (U32)m_successors.size(); }
+
+		/**
+		 * @brief Check whether the node was cancelled because a predecessor did not succeed.
+		 * @return True if the wrapped Task will not be (or was not) run.
+		 */
+		inline Boolean wasCancelled() const { return m_cancelled.val() != 0; }
+
+		virtual void run();
+		virtual void onSuccess();
+		virtual void onFailure();
+		virtual void onTermination();
+
+	  private:
+		friend class TaskGraph;
+
+		/**
+		 * @brief Called by a predecessor when it is done.
+		 * @param succeeded False to cancel this node.
+		 */
+		void predecessorFinished(Boolean succeeded);
+
+		/**
+		 * @brief Releases all the successors and tells the graph this node is done.
+		 * @param succeeded True if the wrapped Task succeeded.
+		 */
+		void finish(Boolean succeeded);
+
+		TaskGraph*					m_pGraph;
+		I32							m_index;			// The index in the graph.
+		TaskPtr						m_task;
+		Vector<TaskGraphNode*>	m_successors;
+		U32							m_numPredecessors;
+		AtomicI32					m_pending;		// Predecessors not yet finished.
+		AtomicI32					m_cancelled;
+	};
+
+	/**
+	 * @class TaskGraph taskgraph.h "core/threading/taskgraph.h"
+	 * @brief Runs a set of Tasks with dependencies between them on a TaskManager.
+	 *
+	 * Each Task can have any number of predecessors and successors.  When run() is
+	 * called, the Tasks with no predecessors are queued on the TaskManager, and every
+	 * other Task is queued (on whichever TaskRunner has room) as soon as its last
+	 * predecessor succeeds, so independent Tasks run in parallel.  If a Task fails or is
+	 * terminated, all the Tasks that depend on it are cancelled: they are never run and
+	 * only get onTermination() called.
+	 *
+	 * A TaskGraph is run once; wait() blocks until every Task has finished or been
+	 * cancelled.  Do not call wait() from a Task on the same TaskManager.
+	 *
+	 * @author Catlin Zilinski
+	 * @version 1
+	 * @since Mar 24, 2015
+	 */
+	class TaskGraph {
+	  public:
+		/**
+		 * @brief Create an empty TaskGraph.
+		 * @param capacity The initial number of Tasks to make room for.
+		 */
+		explicit TaskGraph(Size capacity = 16);
+
+		/**
+		 * @brief Waits for the graph to finish if it was run.
+		 */
+		~TaskGraph();
+
+		/**
+		 * @brief Add a Task to the graph.
+		 * @param task The Task to add.
+		 * @return The index of the Task in the graph, or -1 if the graph has already run.
+		 */
+		I32 addTask(const TaskPtr& task);
+
+		/**
+		 * @brief Make one Task wait for another.
+		 * @param before The index of the Task that must succeed first.
+		 * @param after The index of the Task that waits for it.
+		 * @return True if the dependency was added.
+		 */
+		Boolean addDependency(I32 before, I32 after);
+
+		/**
+		 * @brief Get the node of a Task in the graph.
+		 * @param index The index returned by addTask().
+		 * @return The TaskGraphNode.
+		 */
+		inline TaskGraphNode* node(I32 index) const {
+			return (TaskGraphNode*)m_nodes.get(index).ptr();
+		}
+
+		/**
+		 * @brief Get the number of Tasks in the graph.
+		 * @return The number of Tasks.
+		 */
+		inline U32 numTasks() const { return (U32)m_nodes.size(); }
+
+		/**
+		 * @brief Get the number of Tasks that did not succeed (failed, terminated or cancelled).
+		 * @return The number of Tasks that did not succeed so far.
+		 */
+		inline U32 numFailed() const { return (U32)m_failed.val(); }
+
+		/**
+		 * @brief Check whether every Task has finished.
+		 * @return True if the graph was run and nothing is left to run.
+		 */
+		inline Boolean isFinished() const {
+			return m_started && m_remaining.val() == 0;
+		}
+
+		/**
+		 * @brief Queue the Tasks with no predecessors on the TaskManager.
+		 * @param manager The TaskManager to run the Tasks on.
+		 * @return False if the graph has a cycle or was already run.
+		 */
+		Boolean run(TaskManager* manager);
+
+		/**
+		 * @brief Block until every Task has finished.
+		 * @return True if every Task succeeded.
+		 */
+		Boolean wait();
+
+	  private:
+		friend class TaskGraphNode;
+
+		TaskGraph(const TaskGraph& src);
+		TaskGraph& operator=(const TaskGraph& src);
+
+		/**
+		 * @brief Check that the dependencies have no cycle.
+		 * @return True if every Task can be reached from the roots.
+		 */
+		Boolean isAcyclic() const;
+
+		/**
+		 * @brief Queue a node whose predecessors have all succeeded.
+		 * @param node The node to queue.
+		 */
+		void dispatch(TaskGraphNode* node);
+
+		/**
+		 * @brief Called by each node once it is done or cancelled.
+		 * @param succeeded True if the node's Task succeeded.
+		 */
+		void nodeFinished(Boolean succeeded);
+
+		Vector<TaskPtr>		m_nodes;
+		TaskManager*			m_pManager;
+		Boolean					m_started;
+		AtomicI32				m_remaining;
+		AtomicI32				m_failed;
+		Mutex						m_lock;
+		ConditionVariable		m_finished;
+	};
+
+} // namespace Cat
+
+#endif // CAT_CORE_THREADING_TASKGRAPH_H
@@ -13,7 +13,9 @@
 #include "core/corelib.h"
 #include "core/threading/task.h"
 #include "core/threading/taskrunner.h"
+#include "core/util/hashedid.h"
 #include "core/util/staticmap.h"
+#include "core/util/vector.h"
 
 namespace Cat {
 
@@ -24,16 +26,27 @@ namespace Cat {
 	 * The TaskManager provides a means of running multiple TaskRunners 
 	 * simultaneously.
 	 *
+	 * Tasks queued without naming a runner are placed by the TaskPlacement
+	 * policy, and with idle pulling turned on a runner with waiting tasks gives
+	 * half of them to a runner that has run out of tasks.
+	 *
 	 * @since Mar 13, 2014
 	 * @version 1
 	 * @author Catlin Zilinski
 	 */
 	class TaskManager {
 	  public:		
+		enum TaskPlacement {
+			kTPLeastQueued = 0x0,	/**< The runner with the fewest waiting tasks */
+			kTPRoundRobin,				/**< Each runner in turn */
+			kTPPowerOfTwoChoices,	/**< The less loaded of two random runners */
+			kTPAffinity					/**< The same runner for the same task OID */
+		};
+
 		/**
 		 * @brief Initializes an empty TaskManager with no task runners.
 		 */
-		TaskManager() { }		
+		TaskManager() : m_placement(kTPLeastQueued), m_idlePulling(false) { }		
 
 		/**
 		 * @brief Create a new Task Manager with the specified number of runners.
@@ -50,10 +63,17 @@ namespace Cat {
 		 * @brief Create a new TaskRunner.
 		 * @param name The name of the task runner.
 		 * @param queueSize the number of taskes that can be run on the runner.
+		 * @param options The options to start the runner's thread with.
 		 */
-		Boolean createTaskRunner(const Char* name, Size queueSize = 32) {
+		Boolean createTaskRunner(const Char* name, Size queueSize = 32, const ThreadOptions& options = ThreadOptions()) {
 			if (!m_runners.contains(crc32(name)) && m_runners.size() != m_runners.capacity()) {
-				m_runners.insert(crc32(name), new TaskRunner(name, queueSize));
+				TaskRunner* runner = new TaskRunner(name, queueSize, options);
+				if (m_idlePulling) {
+					runner->setTaskManager(this);
+				}
+				m_runners.insert(crc32(name), runner);
+				m_runnerList.append(runner);
+				D(HashedID(name).record());
 				return true;				
 			}
 			else {
@@ -86,6 +106,15 @@ namespace Cat {
 		inline TaskRunner* getTaskRunner(const Char* name) {
 			return getTaskRunner(crc32(name));
 		}
+		inline TaskRunner* getTaskRunner(const HashedID& name) {
+			return getTaskRunner(name.id());
+		}
+
+		/**
+		 * @brief Check if idle runners take tasks from busy runners.
+		 * @return True if idle runners take tasks from busy runners.
+		 */
+		inline Boolean isIdlePulling() const { return m_idlePulling; }
 
 		/**
 		 * @brief Get the max number of task runners we can have.
@@ -124,15 +153,97 @@ namespace Cat {
 		inline TaskPtr queueTask(const Char* runnerName, const TaskPtr& task) {
 		   return queueTask(crc32(runnerName), task);				
 		}
+		inline TaskPtr queueTask(const HashedID& runnerName, const TaskPtr& task) {
+			return queueTask(runnerName.id(), task);
+		}
 
 		/**
 		 * @brief Add a new task to a task runner.
-		 * This method chooses a task runner to run the task on.	 
+		 * This method chooses the task runner to run the task on with the
+		 * placement policy, or the least loaded one if its queue is full.
 		 * @param task The task to add to be run.
 		 * @return A pointer to the task if succeeded, or false otherwise.
 		 */
 		TaskPtr queueTask(const TaskPtr& task);
 
+		/**
+		 * @brief Add several tasks to the task runner, waking it up only once.
+		 * @param runnerID The ID of the task runner to run the tasks on.
+		 * @param tasks The tasks to add to be run.
+		 * @param count The number of tasks.
+		 * @return The number of tasks queued, starting from the first.
+		 */
+		inline Size queueTasks(OID runnerID, const TaskPtr* tasks, Size count) {
+			TaskRunner* runner = m_runners.at(runnerID);
+			if (runner) {
+				return runner->queueTasks(tasks, count);
+			} else {
+				DWARN("No such Runner with ID " << runnerID << "!");
+				return 0;
+			}
+		}
+
+		/**
+		 * @brief Add several tasks to the task runner, waking it up only once.
+		 * @param runnerName The name of the task runner to run the tasks on.
+		 * @param tasks The tasks to add to be run.
+		 * @param count The number of tasks.
+		 * @return The number of tasks queued, starting from the first.
+		 */
+		inline Size queueTasks(const Char* runnerName, const TaskPtr* tasks, Size count) {
+			return queueTasks(crc32(runnerName), tasks, count);
+		}
+		inline Size queueTasks(const HashedID& runnerName, const TaskPtr* tasks, Size count) {
+			return queueTasks(runnerName.id(), tasks, count);
+		}
+
+		/**
+		 * @brief Add several tasks, split evenly over the task runners.
+		 * Each runner gets its share in one batch, and the share of a runner
+		 * with a full queue is spread over the runners after it.
+		 * @param tasks The tasks to add to be run.
+		 * @param count The number of tasks.
+		 * @return The number of tasks queued, starting from the first.
+		 */
+		Size queueTasks(const TaskPtr* tasks, Size count);
+
+		/**
+		 * @brief Add all the tasks in the Vector, split evenly over the task runners.
+		 * @param tasks The tasks to add to be run.
+		 * @return The number of tasks queued, starting from the first.
+		 */
+		inline Size queueTasks(const Vector<TaskPtr>& tasks) {
+			return queueTasks(tasks.dataPtr(), tasks.size());
+		}
+
+		/**
+		 * @brief Get the policy used to choose a runner for a task.
+		 * @return The placement policy.
+		 */
+		inline TaskPlacement placement() const { return m_placement; }
+
+		/**
+		 * @brief Find a running task runner with no tasks.
+		 * Called by a TaskRunner with waiting tasks when idle pulling is turned on.
+		 * @param busy The runner looking for help.
+		 * @return The idle runner, or NIL if all the runners have tasks.
+		 */
+		TaskRunner* findIdleTaskRunner(TaskRunner* busy);
+
+		/**
+		 * @brief Turn on or off moving tasks from busy runners to idle runners.
+		 * This lets any task queued on a runner be run on another runner,
+		 * so it must be set before the runners are started.
+		 * @param idlePulling True to let idle runners take tasks.
+		 */
+		void setIdlePulling(Boolean idlePulling);
+
+		/**
+		 * @brief Set the policy used to choose a runner for a task.
+		 * @param placement The placement policy.
+		 */
+		inline void setPlacement(TaskPlacement placement) { m_placement = placement; }
+
 		/**
 		 * @brief Start all the task runners.
 		 */
@@ -158,6 +269,9 @@ namespace Cat {
 		inline void clearAllWaitingTasks(const Char* runnerName) {
 		   clearAllWaitingTasks(crc32(runnerName));			
 		}
+		inline void clearAllWaitingTasks(const HashedID& runnerName) {
+			clearAllWaitingTasks(runnerName.id());
+		}
 
 		/**
 		 * @brief Clear all waiting tasks on all task runners.
@@ -190,6 +304,9 @@ namespace Cat {
 		inline void terminateTaskRunner(const Char* runnerName) {
 			terminateTaskRunner(crc32(runnerName));
 		}
+		inline void terminateTaskRunner(const HashedID& runnerName) {
+			terminateTaskRunner(runnerName.id());
+		}
 
 		/**
 		 * @brief Wait for all the task runners to terminate.
@@ -198,7 +315,14 @@ namespace Cat {
 		Boolean waitForAllTaskRunnersToTerminate();		
 
 	  private:
+		TaskRunner* chooseTaskRunner(const TaskPtr& task);
+		TaskRunner* leastLoadedTaskRunner();
+
 		StaticMap<TaskRunner*> m_runners;		
+		Vector<TaskRunner*>	  m_runnerList;	/**< The runners in the order they were created */
+		AtomicI32					m_nextRunner;
+		TaskPlacement			m_placement;
+		Boolean					m_idlePulling;
 				
 
 	};
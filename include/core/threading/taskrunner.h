@@ -12,19 +12,28 @@
 
 #include "core/corelib.h"
 #include "core/threading/threaddefs.h"
+#include "core/threading/threadoptions.h"
+#include "core/threading/mutex.h"
 #include "core/threading/conditionvariable.h"
-#include "core/threading/spinlock.h"
+#include "core/threading/eventcount.h"
+#include "core/threading/mpscqueue.h"
 #include "core/threading/taskqueuenode.h"
-#include "core/util/simplequeue.h"
+#include "core/util/vector.h"
 
 namespace Cat {
 
+	class TaskManager;
+
 	/**
 	 * @class TaskRunner taskrunner.h "core/threading/taskrunner.h"
 	 * @brief A class to run tasks on a single thread.
 	 * The TaskRunner is designed to encapsulate a single thread which can be 
 	 * tasks one at a time, until completion.
 	 *
+	 * Tasks and messages are passed to the runner thread through lock-free
+	 * MPSCQueues, so queueing a task never blocks on the runner thread or on the
+	 * other producers, and only wakes the runner thread if it is asleep.
+	 *
 	 * @since Mar 13, 2014
 	 * @version 1
 	 * @author Catlin Zilinski
@@ -63,18 +72,24 @@ namespace Cat {
 			}
 		};		
 
+		/** The most tasks given to an idle runner at once, so they fit in a buffer on the stack. */
+		static const U32 kMaxSharedTasks = 16;
+
 		/**
 		 * @brief Initializes an empty TaskRunner with no taskes.
 		 */
 		TaskRunner() :
-			m_state(kTRSNotStarted), m_oid(0), m_pName(NIL),
+			m_state(kTRSNotStarted), m_oid(0), m_pName(NIL), m_pManager(NIL),
 			m_numFree(0), m_numUsed(0),  m_pNodeStorage(NIL) {}
 
 		/**
 		 * @brief Create a new Task Runner with the specified name.
 		 * @param name The name of the Task Runner.
+		 * @param queueSize The number of tasks that can be queued on the runner.
+		 * @param options The options to start the runner's thread with, the
+		 * thread is named after the runner if the options do not name it.
 		 */
-		TaskRunner(const Char* name, Size queueSize = 32);		
+		TaskRunner(const Char* name, Size queueSize = 32, const ThreadOptions& options = ThreadOptions());		
 
 		/**
 		 * @brief Makes sure to stop all the taskes, the thread, etc.
@@ -88,11 +103,8 @@ namespace Cat {
 		 * @return True if the message was posted sucessfully.
 		 */
 		inline Boolean clearAllWaitingTasks() {
-			Boolean success = false;			
-			m_syncLock.lock();
-			success = m_messageQueue.push(TRMessage(kTRMClearAllWaitingTasks));
-			m_syncLock.broadcast();
-			m_syncLock.unlock();
+			Boolean success = m_messageQueue.push(TRMessage(kTRMClearAllWaitingTasks));
+			m_wakeup.notifyAll();
 #if defined (DEBUG)
 			if (!success) {				
 				DWARN("Failed to put kTRMClearAllWaitingTasks message on Queue, queue full!");
@@ -140,6 +152,15 @@ namespace Cat {
 			return (m_state == kTRSNotStarted || m_state == kTRSTerminated);
 		}
 
+		/**
+		 * @brief Get the number of tasks waiting or running on the runner.
+		 * Only a hint while the runner is running.
+		 * @return The number of tasks waiting or running on the runner.
+		 */
+		inline U32 load() const {
+			return (U32)(m_inputQueue.size() + m_numQueued.val());
+		}
+
 		/**
 		 * @brief Get the name of the task manager.
 		 * @return The name of the task manager.
@@ -169,18 +190,19 @@ namespace Cat {
 		 */
 		inline TaskPtr queueTask(const TaskPtr& task) {
 			Boolean success = false;			
-			m_syncLock.lock();
 			if (m_state == kTRSRunning || m_state == kTRSNotStarted) {
 				success = m_inputQueue.push(task);
 			}			
-			m_syncLock.broadcast();			
-			m_syncLock.unlock();
+			if (success && drainIfTerminated()) {
+				success = false;
+			}
 			if (success) {
+				m_wakeup.notifyAll();
 				return task;
 			}
 			else {
 #if defined (DEBUG)
-				if (m_state != kTRSRunning || m_state != kTRSNotStarted) {					
+				if (m_state != kTRSRunning && m_state != kTRSNotStarted) {					
 					DWARN("Failed to queue task " << task->name() << " Task Runner in UNuseable state!");
 				}
 				else {
@@ -191,6 +213,46 @@ namespace Cat {
 			}			
 		}
 		
+		/**
+		 * @brief Add several tasks to the task runner, waking it up only once.
+		 * If the input queue fills up, only the first tasks are queued.
+		 * @param tasks The tasks to add to be run.
+		 * @param count The number of tasks.
+		 * @return The number of tasks queued, starting from the first.
+		 */
+		inline Size queueTasks(const TaskPtr* tasks, Size count) {
+			Size queued = 0;
+			if (m_state == kTRSRunning || m_state == kTRSNotStarted) {
+				queued = m_inputQueue.push(tasks, count);
+				if (queued > 0 && drainIfTerminated()) {
+					queued = 0;
+				}
+			}
+			if (queued > 0) {
+				m_wakeup.notifyAll();
+			}
+#if defined (DEBUG)
+			if (queued < count) {
+				if (m_state != kTRSRunning && m_state != kTRSNotStarted) {
+					DWARN("Failed to queue " << count << " tasks, Task Runner in UNuseable state!");
+				}
+				else {
+					DWARN("Only queued " << queued << " of " << count << " tasks, input queue full!");
+				}
+			}
+#endif /* DEBUG */
+			return queued;
+		}
+
+		/**
+		 * @brief Add all the tasks in the Vector to the task runner.
+		 * @param tasks The tasks to add to be run.
+		 * @return The number of tasks queued, starting from the first.
+		 */
+		inline Size queueTasks(const Vector<TaskPtr>& tasks) {
+			return queueTasks(tasks.dataPtr(), tasks.size());
+		}
+		
 		/**
 		 * @brief Method to start the task manager's threaded loop.
 		 * @return kTRSRunning if succeeded, else, kTRSFailedToStart.
@@ -202,6 +264,13 @@ namespace Cat {
 		 */	  
 		void runNextTask();
 
+		/**
+		 * @brief Set the TaskManager to find idle runners to give waiting tasks to.
+		 * Must be set before the runner is started.
+		 * @param manager The TaskManager, or NIL to keep all the tasks.
+		 */
+		inline void setTaskManager(TaskManager* manager) { m_pManager = manager; }
+
 		/**
 		 * @brief Get the state of the task manager.
 		 * @return The current state of the task manager.
@@ -214,14 +283,15 @@ namespace Cat {
 		 * the task manager as well.
 		 */
 		inline Boolean terminateTaskRunner() {
-			Boolean success = false;			
-			m_syncLock.lock();
-			success = m_messageQueue.push(TRMessage(kTRMTerminateTaskRunner));
-			if (success && m_state == kTRSRunning) {
-				m_state = kTRSWillTerminate;
-			}			
-			m_syncLock.broadcast();
-			m_syncLock.unlock();
+			Boolean success = m_messageQueue.push(TRMessage(kTRMTerminateTaskRunner));
+			if (success) {
+				m_stateLock.lock();
+				if (m_state == kTRSRunning) {
+					m_state = kTRSWillTerminate;
+				}
+				m_stateLock.unlock();
+			}
+			m_wakeup.notifyAll();
 #if defined (DEBUG)
 			if (!success) {				
 				DWARN("Failed to put kTRMTerminateTaskRunner message on Queue, queue full!");
@@ -236,6 +306,20 @@ namespace Cat {
 		 */
 		inline ThreadHandle* threadPtr() { return &m_thread; }
 
+		/**
+		 * @brief Get the options the runner's thread is started with.
+		 * @return The options of the runner's thread.
+		 */
+		inline const ThreadOptions& threadOptions() const { return m_threadOptions; }
+
+		/**
+		 * @brief Wake the runner to run the parked tasks that have been woken.
+		 * Called by a parked Task once it can run again, from any thread.
+		 */
+		inline void wakeParkedTasks() {
+			m_wakeup.notifyAll();
+		}
+
 		/**
 		 * @brief Wait for the taskRunner to stop running.
 		 * @return True if the taskRunner is no longer running.
@@ -253,8 +337,8 @@ namespace Cat {
 		/* ################################################### */
 
 #if defined (DEBUG)
-		inline SimpleQueue<TaskPtr>* inputQueue() { return &m_inputQueue; }
-		inline SimpleQueue<TRMessage>* messageQueue() { return &m_messageQueue; }
+		inline MPSCQueue<TaskPtr>* inputQueue() { return &m_inputQueue; }
+		inline MPSCQueue<TRMessage>* messageQueue() { return &m_messageQueue; }
 		inline TaskQueueNode* queuedRoot() { return &m_queued; }
 		inline U32 numFree() const { return m_numFree; }
 		inline U32 numUsed() const { return m_numUsed; }
@@ -262,8 +346,16 @@ namespace Cat {
 
 	  private:
 		void addTaskToQueue(const TaskPtr& task);		
+		void setState(TaskRunnerState state);
 		void removeRunningTask();
+		void requeueRunningTask();
+		Boolean parkRunningTask();
+		Boolean hasWokenTasks() const;
+		void unparkWokenTasks();
 		void clearInputAndQueue();
+		void clearInput();
+		Boolean drainIfTerminated();
+		void shareQueuedTasks(TaskRunner* idle);
 		inline void checkForChildAndRemoveIfNeeded(TaskPtr& task) {
 			if (task->hasChild()) {
 				TaskPtr child = task->takeChild();
@@ -282,20 +374,26 @@ namespace Cat {
 					
 				
 
-		TaskRunnerState     m_state;
+		volatile TaskRunnerState m_state;
 		OID					  m_oid;		
 		Char*					  m_pName;		
-		ConditionVariable	  m_syncLock;		
+		TaskManager*		  m_pManager;		/**< Finds the idle runners to give waiting tasks to */
+		Mutex					  m_stateLock;		/**< Guards the changes of m_state */
+		ConditionVariable	  m_stateChanged;
+		EventCount			  m_wakeup;			/**< The runner thread sleeps on it while there is nothing to do */
 		ThreadHandle		  m_thread;
+		ThreadOptions		  m_threadOptions;
 
 		U32 m_numFree;
 		U32 m_numUsed;		
+		AtomicI32 m_numQueued;	/**< The queued and running tasks, read by other threads */
 
-		SimpleQueue<TaskPtr>	  m_inputQueue;
-		SimpleQueue<TRMessage> m_messageQueue;
+		MPSCQueue<TaskPtr>	  m_inputQueue;
+		MPSCQueue<TRMessage>	  m_messageQueue;
 		TaskPtr			        m_running;
 		TaskQueueNode          m_free;
 		TaskQueueNode          m_queued;
+		TaskQueueNode          m_parked;	/**< Tasks waiting to be woken, not run until then */
 		TaskQueueNode*         m_pNodeStorage;		
 		
 	};
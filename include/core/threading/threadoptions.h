@@ -0,0 +1,165 @@
+#ifndef CAT_CORE_THREADING_THREADOPTIONS_H
+#define CAT_CORE_THREADING_THREADOPTIONS_H
+/**
+ * @copyright Catlin Zilinksi, 2015.  All rights reserved.
+ *
+ * @file threadoptions.h
+ * @brief Contains the ThreadOptions class, the settings a new thread is started with.
+ *
+ * @author Catlin Zilinski
+ * @date Apr 2, 2015
+ */
+
+#include <cstring>
+#include "core/corelib.h"
+
+namespace Cat {
+
+	/**
+	 * @class ThreadOptions threadoptions.h "core/threading/threadoptions.h"
+	 * @brief The name, stack size, CPU affinity and scheduling of a new thread.
+	 *
+	 * The default options start a thread like the OS does by default, each
+	 * setting only changes the thread when it is set.  The setters return the
+	 * options, so they can be chained:
+	 *
+	 *     ThreadOptions().setName("physics").pinToCpu(2).setScheduling(ThreadOptions::kTSPFifo, 10)
+	 *
+	 * @author Catlin Zilinski
+	 * @version 1
+	 * @since Apr 2, 2015
+	 */
+	class ThreadOptions {
+	  public:
+		enum SchedulingPolicy {
+			kTSPInherit = 0x0,	/**< Use the policy and priority of the creating thread */
+			kTSPOther,				/**< The normal time sharing policy */
+			kTSPFifo,				/**< Real time, runs until it blocks or yields */
+			kTSPRoundRobin			/**< Real time, with time slices among equal priorities */
+		};
+
+		/** The longest name the OS keeps, including the terminating null. */
+		static const Size kMaxNameLength = 16;
+
+		/** The number of CPUs that fit in the affinity mask. */
+		static const U32 kMaxCpus = 64;
+
+		/**
+		 * @brief Creates the options for a thread with the OS defaults.
+		 */
+		ThreadOptions()
+			: m_stackSize(0), m_affinity(0), m_policy(kTSPInherit), m_priority(0) {
+			m_name[0] = '\0';
+		}
+
+		/**
+		 * @brief Get the CPUs the thread may run on.
+		 * @return A mask with bit n set if the thread may run on CPU n, 0 for any CPU.
+		 */
+		inline U64 affinity() const { return m_affinity; }
+
+		/**
+		 * @brief Check if the thread is given a name.
+		 * @return True if the thread is given a name.
+		 */
+		inline Boolean hasName() const { return m_name[0] != '\0'; }
+
+		/**
+		 * @brief Get the name of the thread.
+		 * @return The name of the thread, empty if the OS names it.
+		 */
+		inline const Char* name() const { return m_name; }
+
+		/**
+		 * @brief Let the thread run on the specified CPU, adding to the CPUs already allowed.
+		 * @param cpu The index of the CPU, less than kMaxCpus.
+		 * @return These options.
+		 */
+		inline ThreadOptions& pinToCpu(U32 cpu) {
+			if (cpu < kMaxCpus) {
+				m_affinity |= ((U64)1 << cpu);
+			} else {
+				DWARN("Cannot pin a thread to CPU " << cpu << ", only the first " << kMaxCpus << " are supported.");
+			}
+			return *this;
+		}
+
+		/**
+		 * @brief Get the scheduling policy of the thread.
+		 * @return The scheduling policy of the thread.
+		 */
+		inline SchedulingPolicy policy() const { return m_policy; }
+
+		/**
+		 * @brief Get the scheduling priority of the thread.
+		 * @return The priority within the scheduling policy.
+		 */
+		inline I32 priority() const { return m_priority; }
+
+		/**
+		 * @brief Set the CPUs the thread may run on.
+		 * @param affinity A mask with bit n set if the thread may run on CPU n, 0 for any CPU.
+		 * @return These options.
+		 */
+		inline ThreadOptions& setAffinity(U64 affinity) {
+			m_affinity = affinity;
+			return *this;
+		}
+
+		/**
+		 * @brief Set the name of the thread, as shown by debuggers and profilers.
+		 * Names longer than kMaxNameLength - 1 characters are cut short.
+		 * @param name The name of the thread.
+		 * @return These options.
+		 */
+		inline ThreadOptions& setName(const Char* name) {
+			if (name) {
+				strncpy(m_name, name, kMaxNameLength - 1);
+				m_name[kMaxNameLength - 1] = '\0';
+			} else {
+				m_name[0] = '\0';
+			}
+			return *this;
+		}
+
+		/**
+		 * @brief Set the scheduling policy and priority of the thread.
+		 * The real time policies usually need privileges, without them the thread
+		 * is started with the policy of the creating thread instead.
+		 * @param policy The scheduling policy.
+		 * @param priority The priority within the policy, clamped to what the policy allows.
+		 * @return These options.
+		 */
+		inline ThreadOptions& setScheduling(SchedulingPolicy policy, I32 priority = 0) {
+			m_policy = policy;
+			m_priority = priority;
+			return *this;
+		}
+
+		/**
+		 * @brief Set the size of the thread's stack.
+		 * @param stackSize The size of the stack in bytes, 0 for the OS default.
+		 * @return These options.
+		 */
+		inline ThreadOptions& setStackSize(Size stackSize) {
+			m_stackSize = stackSize;
+			return *this;
+		}
+
+		/**
+		 * @brief Get the size of the thread's stack.
+		 * @return The size of the stack in bytes, 0 for the OS default.
+		 */
+		inline Size stackSize() const { return m_stackSize; }
+
+	  private:
+		Char					m_name[kMaxNameLength];
+		Size					m_stackSize;
+		U64					m_affinity;
+		SchedulingPolicy	m_policy;
+		I32					m_priority;
+	};
+
+} // namespace Cat
+
+#endif // CAT_CORE_THREADING_THREADOPTIONS_H
@@ -9,6 +9,7 @@
  * Date: July 22, 2013
  */
 
+#include <time.h>
 #include "core/threading/mutex.h"
 
 
@@ -26,9 +27,24 @@ namespace Cat {
 			inline void wait(Mutex& p_lock) {
 				pthread_cond_wait(&m_cv, &(p_lock.m_mutex));
 			}
+
+			/**
+			 * Waits until signalled or until the timeout has passed.
+			 * @param p_lock The locked mutex to release while waiting.
+			 * @param p_timeout The longest time to wait, in nanoseconds.
+			 * @return False if the wait timed out.
+			 */
+			inline Boolean waitFor(Mutex& p_lock, U64 p_timeout) {
+				timespec deadline;
+				clock_gettime(CLOCK_REALTIME, &deadline);
+				U64 nanos = (U64)deadline.tv_nsec + p_timeout;
+				deadline.tv_sec += (time_t)(nanos / 1000000000);
+				deadline.tv_nsec = (long)(nanos % 1000000000);
+				return pthread_cond_timedwait(&m_cv, &(p_lock.m_mutex), &deadline) != ETIMEDOUT;
+			}
 			  
 			inline void signal() {
-				p_thread_cond_signal(&m_cv);
+				pthread_cond_signal(&m_cv);
 			}
 			
 			inline void broadcast() {
@@ -138,7 +138,7 @@ namespace Cat {
 } // namespace Cat
 
 #ifdef DEBUG
-std::ostream& operator<<(std::ostream& out, cc::Runnable* runnable);
+std::ostream& operator<<(std::ostream& out, Cat::Runnable* runnable);
 #endif //DEBUG
 
 
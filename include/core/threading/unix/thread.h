@@ -14,6 +14,7 @@
  */
 
 #include "core/threading/unix/runnable.h"
+#include "core/threading/threadoptions.h"
 
 namespace Cat {
 
@@ -26,7 +27,9 @@ namespace Cat {
 	 * @brief Static class to run and join threads.
 	 *
 	 * The Thread class is a simple static class that contains methods to 
-	 * start, join, and wait for threads.
+	 * start, join, and wait for threads.  The threads can be started with
+	 * ThreadOptions to name them, pin them to CPUs, and set their stack size
+	 * and scheduling.
 	 *
 	 * @since July 23, 2013
 	 * @version 2
@@ -37,12 +40,13 @@ namespace Cat {
 		/**
 		 * @brief Runs a specified Runnable object in a new thread.
 		 * @param runnable The object that implements the Runnable interface.
+		 * @param options The options to start the thread with.
 		 * @return A Pointer to the ThreadHandle of the Runnable if the thread starts successfully, else NIL.
 		 */
-		static ThreadHandle* run(Runnable* runnable);
+		static ThreadHandle* run(Runnable* runnable, const ThreadOptions& options = ThreadOptions());
 
 		/**
-		 * @brief Runs a specified ProcessRunner in a new thread.
+		 * @brief Runs a specified ProcessRunner in a new thread, with the runner's ThreadOptions.
 		 * @param manager The ProcessRunner to run.
 		 * @return A Pointer to the ThreadHandle of the ProcessRunner 
 		 * if the thread starts successfully, else NIL.
@@ -50,7 +54,7 @@ namespace Cat {
 		static ThreadHandle* runProcessRunner(ProcessRunner* runner);
 
 		/**
-		 * @brief Runs a specified TaskRunner in a new thread.
+		 * @brief Runs a specified TaskRunner in a new thread, with the runner's ThreadOptions.
 		 * @param manager The TaskRunner to run.
 		 * @return A Pointer to the ThreadHandle of the TaskRunner 
 		 * if the thread starts successfully, else NIL.
@@ -73,6 +77,9 @@ namespace Cat {
 			return pthread_self();
 		}		
 
+	  private:
+		static I32 create(ThreadHandle* threadHandle, const ThreadOptions& options, VPtr (*entry)(VPtr), VPtr data);
+
 	};
 	
 	VPtr process_runner_func_entry__(VPtr data);
@@ -11,9 +11,198 @@
  * @date Mar 3, 2015
  */
 
+#include <intrin.h>
 #include "core/corelib.h"
+#include "core/threading/memoryorder.h"
+
+#if defined(_M_X64)
+#define CAT_HAS_ATOMIC_128 1
+#endif
+
 namespace Cat {
 
+	/**
+	 * The Interlocked functions for a 4 or 8 byte Atomic.  Each Interlocked function
+	 * is a full barrier, so the MemoryOrder only decides the barriers around plain
+	 * loads and stores.
+	 */
+	template <Size N>
+	struct AtomicOps;
+
+	template <>
+	struct AtomicOps<4> {
+		typedef LONG Word;
+
+		static inline Word add(volatile Word* dest, Word amount) { return InterlockedExchangeAdd(dest, amount); }
+		static inline Word bitAnd(volatile Word* dest, Word bits) { return InterlockedAnd(dest, bits); }
+		static inline Word bitOr(volatile Word* dest, Word bits) { return InterlockedOr(dest, bits); }
+		static inline Word bitXor(volatile Word* dest, Word bits) { return InterlockedXor(dest, bits); }
+		static inline Word compareExchange(volatile Word* dest, Word desired, Word expected) {
+			return InterlockedCompareExchange(dest, desired, expected);
+		}
+		static inline Word exchange(volatile Word* dest, Word val) { return InterlockedExchange(dest, val); }
+	};
+
+	template <>
+	struct AtomicOps<8> {
+		typedef LONGLONG Word;
+
+		static inline Word add(volatile Word* dest, Word amount) { return InterlockedExchangeAdd64(dest, amount); }
+		static inline Word bitAnd(volatile Word* dest, Word bits) { return InterlockedAnd64(dest, bits); }
+		static inline Word bitOr(volatile Word* dest, Word bits) { return InterlockedOr64(dest, bits); }
+		static inline Word bitXor(volatile Word* dest, Word bits) { return InterlockedXor64(dest, bits); }
+		static inline Word compareExchange(volatile Word* dest, Word desired, Word expected) {
+			return InterlockedCompareExchange64(dest, desired, expected);
+		}
+		static inline Word exchange(volatile Word* dest, Word val) { return InterlockedExchange64(dest, val); }
+	};
+
+	/**
+	 * @class Atomic atomic.h "core/threading/atomic.h"
+	 * @brief An atomic integer or pointer, each operation taking the MemoryOrder it needs.
+	 *
+	 * The operations default to kMOSeqCst, pass a weaker order where the code only
+	 * needs that, e.g., a counter nobody synchronizes on can be incremented with
+	 * kMORelaxed.  The fetch operations are only for integer types.
+	 *
+	 * @author Catlin Zilinski
+	 * @version 1
+	 * @since Apr 8, 2015
+	 */
+	template <typename T>
+	class Atomic {
+	  public:
+		Atomic() : m_val(0) {}
+		Atomic(T val) : m_val(val) {}
+
+		/**
+		 * @brief Atomically replace the value if it is still equal to the expected value.
+		 * @param expected The value we expect to be stored.
+		 * @param desired The value to store if the current value is expected.
+		 * @param order The order of the operation.
+		 * @return True if the value was swapped.
+		 */
+		inline Boolean compareAndSwap(T expected, T desired, MemoryOrder order = kMOSeqCst) {
+			return compareExchange(expected, desired, order);
+		}
+
+		/**
+		 * @brief Atomically replace the value if it is still equal to the expected value.
+		 * @param expected The value we expect to be stored, set to the stored value if it was not.
+		 * @param desired The value to store if the current value is expected.
+		 * @param order The order of the operation.
+		 * @return True if the value was swapped.
+		 */
+		inline Boolean compareExchange(T& expected, T desired, MemoryOrder order = kMOSeqCst) {
+			T found = (T)Ops::compareExchange(word(), (Word)desired, (Word)expected);
+			if (found == expected) {
+				return true;
+			}
+			expected = found;
+			return false;
+		}
+
+		/**
+		 * @brief Atomically store a value.
+		 * @param val The new value.
+		 * @param order The order of the operation.
+		 * @return The value stored before.
+		 */
+		inline T exchange(T val, MemoryOrder order = kMOSeqCst) {
+			return (T)Ops::exchange(word(), (Word)val);
+		}
+
+		/**
+		 * @brief Atomically add to the value.
+		 * @param amount The amount to add.
+		 * @param order The order of the operation.
+		 * @return The value before adding amount.
+		 */
+		inline T fetchAdd(T amount, MemoryOrder order = kMOSeqCst) {
+			return (T)Ops::add(word(), (Word)amount);
+		}
+
+		/**
+		 * @brief Atomically and the value with bits.
+		 * @param bits The bits to keep.
+		 * @param order The order of the operation.
+		 * @return The value before the and.
+		 */
+		inline T fetchAnd(T bits, MemoryOrder order = kMOSeqCst) {
+			return (T)Ops::bitAnd(word(), (Word)bits);
+		}
+
+		/**
+		 * @brief Atomically or the value with bits.
+		 * @param bits The bits to set.
+		 * @param order The order of the operation.
+		 * @return The value before the or.
+		 */
+		inline T fetchOr(T bits, MemoryOrder order = kMOSeqCst) {
+			return (T)Ops::bitOr(word(), (Word)bits);
+		}
+
+		/**
+		 * @brief Atomically subtract from the value.
+		 * @param amount The amount to subtract.
+		 * @param order The order of the operation.
+		 * @return The value before subtracting amount.
+		 */
+		inline T fetchSub(T amount, MemoryOrder order = kMOSeqCst) {
+			return (T)Ops::add(word(), -(Word)amount);
+		}
+
+		/**
+		 * @brief Atomically xor the value with bits.
+		 * @param bits The bits to flip.
+		 * @param order The order of the operation.
+		 * @return The value before the xor.
+		 */
+		inline T fetchXor(T bits, MemoryOrder order = kMOSeqCst) {
+			return (T)Ops::bitXor(word(), (Word)bits);
+		}
+
+		/**
+		 * @brief Atomically load the value.
+		 * @param order The order of the operation, kMORelaxed, kMOAcquire or kMOSeqCst.
+		 * @return The stored value.
+		 */
+		inline T load(MemoryOrder order = kMOSeqCst) const {
+			T val = m_val;
+			if (order != kMORelaxed) {
+				_ReadWriteBarrier();
+			}
+			return val;
+		}
+
+		/**
+		 * @brief Atomically store a value.
+		 * @param val The new value.
+		 * @param order The order of the operation, kMORelaxed, kMORelease or kMOSeqCst.
+		 */
+		inline void store(T val, MemoryOrder order = kMOSeqCst) {
+			if (order == kMOSeqCst) {
+				Ops::exchange(word(), (Word)val);
+			} else {
+				if (order != kMORelaxed) {
+					_ReadWriteBarrier();
+				}
+				m_val = val;
+			}
+		}
+
+	  private:
+		typedef AtomicOps<sizeof(T)> Ops;
+		typedef typename Ops::Word Word;
+
+		Atomic(const Atomic& src);
+		Atomic& operator=(const Atomic& src);
+
+		inline volatile Word* word() { return (volatile Word*)&m_val; }
+
+		volatile T m_val;
+	};
+
 	/**
 	 * @class AtomicI32 atomic.h "core/threading/atomic.h"
 	 * @brief An Atomic Integer type.
@@ -28,23 +217,27 @@ namespace Cat {
 		AtomicI32(I32 val) : m_val(val) {}
 
 		/**
+		 * @param order The order of the operation, a retain count can use kMORelaxed.
 		 * @return The value incrememented by 1.
 		 */
-		inline I32 increment() {
+		inline I32 increment(MemoryOrder order = kMOSeqCst) {
 			return InterlockedIncrement(&m_val);
 		}
 
 		/**
-		 * @brief The value decremented by 1.
+		 * @param order The order of the operation, a release of a retain count needs
+		 * kMOAcqRel so the last owner sees every write before deleting.
+		 * @return The value decremented by 1.
 		 */
-		inline I32 decrement() {
+		inline I32 decrement(MemoryOrder order = kMOSeqCst) {
 			return InterlockedDecrement(&m_val);
 		}
 
 		/**
+		 * @param order The order of the load.
 		 * @return The stored value.
 		 */
-		inline I32 val() const { return m_val; }		
+		inline I32 val(MemoryOrder order = kMOAcquire) const { return m_val; }		
 
 	  private:
 		I32 m_val;		
@@ -53,6 +246,137 @@ namespace Cat {
 	namespace Math {
 	} // namespace Math
 
+	/**
+	 * @class AtomicU64 atomic.h "core/threading/atomic.h"
+	 * @brief An Atomic 64 bit unsigned integer that supports compare and swap.
+	 *
+	 * @author Catlin Zilinski
+	 * @version 1
+	 * @since Mar 3, 2015
+	 */
+	class AtomicU64 {
+	  public:
+		AtomicU64() : m_val(0) {}
+		AtomicU64(U64 val) : m_val(val) {}
+
+		/**
+		 * @brief Atomically replace the value if it is still equal to the expected value.
+		 * @param expected The value we expect to be stored.
+		 * @param desired The value to store if the current value is expected.
+		 * @return True if the value was swapped.
+		 */
+		inline Boolean compareAndSwap(U64 expected, U64 desired) {
+			return (U64)InterlockedCompareExchange64((volatile LONGLONG*)&m_val, (LONGLONG)desired, (LONGLONG)expected) == expected;
+		}
+
+		/**
+		 * @brief Atomically add to the value.
+		 * @param amount The amount to add.
+		 * @return The value after adding amount.
+		 */
+		inline U64 add(U64 amount) {
+			return (U64)InterlockedExchangeAdd64((volatile LONGLONG*)&m_val, (LONGLONG)amount) + amount;
+		}
+
+		/**
+		 * @brief Set the stored value (not safe against concurrent compareAndSwap).
+		 * @param val The new value.
+		 */
+		inline void set(U64 val) {
+			m_val = val;
+			MemoryBarrier();
+		}
+
+		/**
+		 * @brief Store a value, making every write before it visible to a thread that reads it.
+		 * @param val The new value.
+		 */
+		inline void store(U64 val) {
+			MemoryBarrier();
+			m_val = val;
+		}
+
+		/**
+		 * @return The stored value.
+		 */
+		inline U64 val() const { return m_val; }
+
+	  private:
+		volatile U64 m_val;
+	};
+
+#if defined(CAT_HAS_ATOMIC_128)
+	/**
+	 * Two 64 bit words swapped together by an AtomicU128.
+	 */
+	struct U64Pair {
+		U64 low;
+		U64 high;
+	};
+
+	/**
+	 * @class AtomicU128 atomic.h "core/threading/atomic.h"
+	 * @brief Two 64 bit words that are compared and swapped together.
+	 *
+	 * Lets a lock-free structure swap a whole pointer together with a 64 bit tag.
+	 * Only defined when the CPU has a 16 byte compare and swap (CAT_HAS_ATOMIC_128).
+	 *
+	 * @author Catlin Zilinski
+	 * @version 1
+	 * @since Apr 8, 2015
+	 */
+	class AtomicU128 {
+	  public:
+		AtomicU128() {
+			m_val[0] = 0;
+			m_val[1] = 0;
+		}
+		AtomicU128(const U64Pair& val) {
+			m_val[0] = (LONG64)val.low;
+			m_val[1] = (LONG64)val.high;
+		}
+
+		/**
+		 * @brief Atomically replace both words if they are still equal to the expected words.
+		 * @param expected The words we expect to be stored, set to the stored words if they were not.
+		 * @param desired The words to store if the current words are expected.
+		 * @return True if the words were swapped.
+		 */
+		inline Boolean compareExchange(U64Pair& expected, const U64Pair& desired) {
+			LONG64 found[2] = { (LONG64)expected.low, (LONG64)expected.high };
+			if (_InterlockedCompareExchange128(m_val, (LONG64)desired.high, (LONG64)desired.low, found)) {
+				return true;
+			}
+			expected.low = (U64)found[0];
+			expected.high = (U64)found[1];
+			return false;
+		}
+
+		/**
+		 * @return Both stored words, read together.
+		 */
+		inline U64Pair val() const {
+			// A swap of zero for zero reads both words in one instruction.
+			LONG64 found[2] = { 0, 0 };
+			_InterlockedCompareExchange128(const_cast<volatile LONG64*>(m_val), 0, 0, found);
+			U64Pair pair;
+			pair.low = (U64)found[0];
+			pair.high = (U64)found[1];
+			return pair;
+		}
+
+	  private:
+		__declspec(align(16)) volatile LONG64 m_val[2];
+	};
+#endif // CAT_HAS_ATOMIC_128
+
+	/**
+	 * @brief A full memory barrier, no read or write is moved across it.
+	 */
+	inline void memoryBarrier() {
+		MemoryBarrier();
+	}
+
 } // namespace Cat
 
 #endif // CAT_CORE_THREADING_WIN32_ATOMIC_H
@@ -68,6 +68,17 @@ namespace Cat {
 			SleepConditionVariableCS(m_pCV, p_lock.m_pMutex, INFINITE);
 		}
 
+		/**
+		 * @brief Wait on the condition variable until signalled or the timeout has passed.
+		 * @param p_lock The locked mutex to release while waiting.
+		 * @param p_timeout The longest time to wait, in nanoseconds.
+		 * @return False if the wait timed out.
+		 */
+		inline Boolean waitFor(Mutex& p_lock, U64 p_timeout) {
+			DWORD millis = (DWORD)((p_timeout + 999999) / 1000000);
+			return SleepConditionVariableCS(m_pCV, p_lock.m_pMutex, millis) || GetLastError() != ERROR_TIMEOUT;
+		}
+
 	  private:
 		void tryDestroy();
 		
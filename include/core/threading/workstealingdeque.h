@@ -0,0 +1,175 @@
+#ifndef CAT_CORE_THREADING_WORKSTEALINGDEQUE_H
+#define CAT_CORE_THREADING_WORKSTEALINGDEQUE_H
+/**
+ * @copyright Catlin Zilinksi, 2015.  All rights reserved.
+ *
+ * @file workstealingdeque.h
+ * @brief Contains the WorkStealingDeque class, a lock-free deque of pointers.
+ *
+ * @author Catlin Zilinski
+ * @date Mar 20, 2015
+ */
+
+#include <cstdlib>
+#include "core/threading/atomic.h"
+
+namespace Cat {
+
+	/**
+	 * @class WorkStealingDeque workstealingdeque.h "core/threading/workstealingdeque.h"
+	 * @brief A Chase-Lev work stealing deque.
+	 *
+	 * The thread that owns the deque pushes and pops items at the bottom (LIFO), while
+	 * any other thread can steal items from the top (FIFO) without taking a lock.  The
+	 * array grows when it is full; the old arrays are kept until the deque is destroyed,
+	 * since a thief may still be reading from them.
+	 *
+	 * @author Catlin Zilinski
+	 * @version 1
+	 * @since Mar 20, 2015
+	 */
+	template <typename T>
+	class WorkStealingDeque {
+	  public:
+		/**
+		 * @brief Creates an empty deque.
+		 * @param capacity The initial capacity (rounded up to a power of 2).
+		 */
+		explicit WorkStealingDeque(U32 capacity = 64);
+		~WorkStealingDeque();
+
+		/**
+		 * @brief Pushes an item at the bottom of the deque.  ONLY the owner thread may push.
+		 * @param item The item to push.
+		 */
+		void push(T* item);
+
+		/**
+		 * @brief Pops the last item pushed.  ONLY the owner thread may pop.
+		 * @return The item, or NIL if the deque is empty.
+		 */
+		T* pop();
+
+		/**
+		 * @brief Steals the oldest item from the deque, can be called by any thread.
+		 * @return The item, or NIL if the deque is empty or another thread took it first.
+		 */
+		T* steal();
+
+		/**
+		 * @brief Tests if the deque is empty (only a hint while other threads use it).
+		 * @return True if there are no items in the deque.
+		 */
+		inline Boolean isEmpty() const {
+			return (I64)(m_bottom.val() - m_top.val()) <= 0;
+		}
+
+	  private:
+		struct Array {
+			U64			mask;
+			Array*		prev;		// The array this one replaced.
+			T* volatile	items[1];
+		};
+
+		WorkStealingDeque(const WorkStealingDeque& src);
+		WorkStealingDeque& operator=(const WorkStealingDeque& src);
+
+		static Array* createArray(U64 capacity, Array* prev);
+		Array* grow(Array* array, U64 top, U64 bottom);
+		inline Array* array() const { return (Array*)(Addr)m_array.val(); }
+
+		AtomicU64	m_top;
+		AtomicU64	m_bottom;
+		AtomicU64	m_array;
+	};
+
+	template <typename T>
+	WorkStealingDeque<T>::WorkStealingDeque(U32 capacity) {
+		U64 size = 2;
+		while (size < capacity) {
+			size <<= 1;
+		}
+		m_array.set((U64)(Addr)createArray(size, NIL));
+	}
+
+	template <typename T>
+	WorkStealingDeque<T>::~WorkStealingDeque() {
+		Array* array = this->array();
+		while (array) {
+			Array* prev = array->prev;
+			free(array);
+			array = prev;
+		}
+	}
+
+	template <typename T>
+	void WorkStealingDeque<T>::push(T* item) {
+		U64 bottom = m_bottom.val();
+		U64 top = m_top.val();
+		Array* array = this->array();
+		if (bottom - top > array->mask) {
+			array = grow(array, top, bottom);
+		}
+		array->items[bottom & array->mask] = item;
+		m_bottom.store(bottom + 1);
+	}
+
+	template <typename T>
+	T* WorkStealingDeque<T>::pop() {
+		U64 bottom = m_bottom.val() - 1;
+		Array* array = this->array();
+		// set() is a full barrier, so a thief either sees the smaller bottom or we see its top.
+		m_bottom.set(bottom);
+		U64 top = m_top.val();
+		if ((I64)(bottom - top) < 0) {
+			m_bottom.set(bottom + 1);
+			return NIL;
+		}
+		T* item = array->items[bottom & array->mask];
+		if (bottom == top) {
+			// Last item, race the thieves for it.
+			if (!m_top.compareAndSwap(top, top + 1)) {
+				item = NIL;
+			}
+			m_bottom.set(bottom + 1);
+		}
+		return item;
+	}
+
+	template <typename T>
+	T* WorkStealingDeque<T>::steal() {
+		U64 top = m_top.val();
+		memoryBarrier();
+		U64 bottom = m_bottom.val();
+		if ((I64)(bottom - top) <= 0) {
+			return NIL;
+		}
+		Array* array = this->array();
+		T* item = array->items[top & array->mask];
+		if (!m_top.compareAndSwap(top, top + 1)) {
+			return NIL;
+		}
+		return item;
+	}
+
+	template <typename T>
+	typename WorkStealingDeque<T>::Array* WorkStealingDeque<T>::createArray(U64 capacity, Array* prev) {
+		Array* array = (Array*)malloc(sizeof(Array) + sizeof(T*)*(capacity - 1));
+		array->mask = capacity - 1;
+		array->prev = prev;
+		return array;
+	}
+
+	template <typename T>
+	typename WorkStealingDeque<T>::Array* WorkStealingDeque<T>::grow(Array* array, U64 top, U64 bottom) {
+		Array* bigger = createArray((array->mask + 1) << 1, array);
+		for (U64 i = top; i != bottom; ++i) {
+			bigger->items[i & bigger->mask] = array->items[i & array->mask];
+		}
+		m_array.store((U64)(Addr)bigger);
+		return bigger;
+	}
+
+} // namespace Cat
+
+#endif // CAT_CORE_THREADING_WORKSTEALINGDEQUE_H
@@ -321,7 +321,7 @@ namespace Cat {
 		 */
 		inline void setNano(U64 in_nano) {
 			m_time.tv_sec = in_nano / NANO_PER_SEC;
-			m_time.tv_nsec = (in_nano - (m_time.tv_sec * NANO_PER_SEC))
+			m_time.tv_nsec = (in_nano - (m_time.tv_sec * NANO_PER_SEC));
 		}
 
 		/**
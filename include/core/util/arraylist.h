@@ -13,7 +13,7 @@
 
 #include <cstring>
 #include <cmath>
-#include "core/corelib.h"
+#include "core/memory/stlallocator.h"
 
 
 namespace Cat {
@@ -23,6 +23,9 @@ namespace Cat {
 	 * @class ArrayList arraylist.h "core/util/arraylist.h"
 	 * @brief A simple resizeable array.
 	 *
+	 * The ArrayList can be given a MemoryAllocator to get the memory for its blocks from
+	 * instead of new.
+	 *
 	 * @author Catlin Zilinski
 	 * @version 1
 	 * @since May 17, 2014
@@ -39,20 +42,22 @@ namespace Cat {
 			Size end;	
 			ArrayListBlock* next;
 			ArrayListBlock* prev;			
+			MemoryAllocator* allocator;
 
 			inline ArrayListBlock()
-				: array(NIL), idx(0), start(0), end(0), next(NIL), prev(NIL) {}
+				: array(NIL), idx(0), start(0), end(0), next(NIL), prev(NIL), allocator(NIL) {}
 
 			inline ArrayListBlock(Size pStart, Size pEnd,
-										 ArrayListBlock* pNext, ArrayListBlock* pPrev)
+										 ArrayListBlock* pNext, ArrayListBlock* pPrev,
+										 MemoryAllocator* pAllocator = NIL)
 				: array(NIL), idx(0), start(pStart), end(pEnd),
-				  next(pNext), prev(pPrev) {
-				array = new T[end - start + 1];				
+				  next(pNext), prev(pPrev), allocator(pAllocator) {
+				array = createArray<T>(allocator, end - start + 1);				
 			}
 
 			~ArrayListBlock() {
 				if (array) {
-					delete[] array;
+					destroyArray(allocator, array, end - start + 1);
 					array = NIL;
 				}
 				idx = start = end = 0;
@@ -67,17 +72,18 @@ namespace Cat {
 		 */
 		inline ArrayList()
 			: m_blockSize(0), m_length(0), m_capacity(0), 
-			  m_pLastAccessed(NIL) {
+			  m_pLastAccessed(NIL), m_pAllocator(NIL) {
 			m_root.next = m_root.prev = &m_root;	
 		}
 
 		/**
 		 * @brief Create a new ArrayList with the specified block size.
 		 * @param The size of the initial block to allocate.
+		 * @param allocator The MemoryAllocator to use for the memory, or NIL to use new.
 		 */
-		inline ArrayList(Size blockSize)
+		inline ArrayList(Size blockSize, MemoryAllocator* allocator = NIL)
 			: m_blockSize(0), m_length(0), m_capacity(0),
-			  m_pLastAccessed(NIL) {
+			  m_pLastAccessed(NIL), m_pAllocator(allocator) {
 			m_root.next = m_root.prev = &m_root;
 			initArrayListWithBlockSize(blockSize);			
 		}
@@ -104,14 +110,16 @@ namespace Cat {
 		 * @brief Append nothing to the ArrayList, just increment the length by one.
 		 * This method doesnt actually append anything to the array list, but it 
 		 * makes the next element in the list accessible with at().
+		 * @return False if the ArrayList was full and could not grow.
 		 */
-		inline void append();		
+		inline Boolean append();		
 
 		/**
 		 * @brief Append an element onto the end of the ArrayList.
 		 * @param elem The element to append to the ArrayList.
+		 * @return False if the ArrayList was full and could not grow.
 		 */
-		inline void append(const T& elem);		
+		inline Boolean append(const T& elem);		
 
 		/**
 		 * @brief Get the ArrayList element at the specified index.
@@ -151,6 +159,31 @@ namespace Cat {
 			return block->array[idx - block->start];
 		}
 
+		/**
+		 * @brief Get the MemoryAllocator the ArrayList gets its memory from.
+		 * @return The MemoryAllocator, or NIL if it uses new.
+		 */
+		inline MemoryAllocator* allocator() const { return m_pAllocator; }
+
+		/**
+		 * @brief Get the elements stored contiguously from the specified index.
+		 * Unlike at(), this does not update the last accessed block, so many
+		 * threads can call it at once as long as the ArrayList does not change.
+		 * @param idx The index of the first element.
+		 * @param count Set to the number of elements from idx to the end of its block.
+		 * @return A pointer to the element at idx.
+		 */
+		inline T* getContiguous(Size idx, Size* count) const {
+			D_CONDERR(idx >= m_length, "Accessing ArrayList element "
+						 << idx << " outside range [0.." << m_length << "]!");
+			ArrayListBlock* block = m_root.next;
+			while (idx > block->end) {
+				block = block->next;
+			}
+			*count = ((block->end < m_length) ? block->end + 1 : m_length) - idx;
+			return &(block->array[idx - block->start]);
+		}
+
 		/**
 		 * @brief Gets the capacity of the ArrayList.
 		 * @return The capacity of the ArrayList.
@@ -191,8 +224,9 @@ namespace Cat {
 		/**
 		 * @brief Method to extend the active length of the array.
 		 * @param length The length to extend the array to.
+		 * @return False if the ArrayList could not grow to the length.
 		 */
-		void extendTo(Size length);
+		Boolean extendTo(Size length);
 
 		/**
 		 * @brief Get the first element of the array.
@@ -223,8 +257,9 @@ namespace Cat {
 		 * inclusive.
 		 * @param idx The index to insert the element into.
 		 * @param elem The element to insert.
+		 * @return False if the ArrayList was full and could not grow.
 		 */
-		void insertAt(Size idx, const T& elem);
+		Boolean insertAt(Size idx, const T& elem);
 
 		/**
 		 * @brief Get the last element in the ArrayList.
@@ -269,8 +304,9 @@ namespace Cat {
 		/**
 		 * @brief Reserve the specified capacity in the array.
 		 * @param capacity The amount of elements to reserve for the array.
+		 * @return False if the blocks could not all be allocated.
 		 */
-		void reserve(Size capacity);
+		Boolean reserve(Size capacity);
 
 		/**
 		 * @brief Set the array element at the specified index.
@@ -278,8 +314,9 @@ namespace Cat {
 		 * the length of the array is set to encompass the newly set element.
 		 * @param idx The index of the element to set.
 		 * @param value The value of the element.
+		 * @return False if the ArrayList could not grow to fit the index.
 		 */
-		void set(Size idx, const T& value);
+		Boolean set(Size idx, const T& value);
 
 		/**
 		 * @brief Set all the values in the array to the specified value.
@@ -300,8 +337,37 @@ namespace Cat {
 		 */
 		T takeLast();
 			
+		/**
+		 * @brief Set the MemoryAllocator to get the memory from.
+		 * Can only be called before the ArrayList is initialised.
+		 * @param allocator The MemoryAllocator to use, or NIL to use new.
+		 */
+		void setAllocator(MemoryAllocator* allocator);
+			
 	  private:
-		void increaseArrayListCapacityTo(Size blocks);
+		Boolean increaseArrayListCapacityTo(Size blocks);
+
+		/**
+		 * Create a block with its array, or NIL if the MemoryAllocator has no memory left
+		 * for either (a block without an array would look like the root).
+		 */
+		inline ArrayListBlock* createBlock(Size start, Size end,
+													  ArrayListBlock* next, ArrayListBlock* prev) {
+			ArrayListBlock* block = NIL;
+			if (m_pAllocator) {
+				block = new (*m_pAllocator, kContainerAlignment) ArrayListBlock(start, end, next, prev, m_pAllocator);
+			} else {
+				block = new ArrayListBlock(start, end, next, prev);
+			}
+			if (block && !block->array) {
+				destroyObject(m_pAllocator, block);
+				block = NIL;
+			}
+			if (!block) {
+				DERR("Cannot allocate an ArrayList block of " << (end - start + 1) << " elements!");
+			}
+			return block;
+		}
 
 		inline ArrayListBlock* getBlockForIndex(Size idx) {
 			ArrayListBlock* block = m_pLastAccessed;
@@ -336,14 +402,19 @@ namespace Cat {
 		Size m_capacity;		
 	   ArrayListBlock m_root;
 		ArrayListBlock* m_pLastAccessed;		
+		MemoryAllocator* m_pAllocator;
 		
 	};
 
 	template <typename T> ArrayList<T>::ArrayList(const ArrayList<T>& src)
-		: m_blockSize(0), m_length(0), m_capacity(0), m_pLastAccessed(NIL) {
+		: m_blockSize(0), m_length(0), m_capacity(0), m_pLastAccessed(NIL),
+		  m_pAllocator(src.m_pAllocator) {
 		m_root.next = m_root.prev = &m_root;
 		if (src.m_capacity > 0) {
 			initArrayListWithBlockSize(src.m_capacity);
+			if (m_capacity == 0) {
+				return;
+			}
 			
 			ArrayListBlock* block = m_root.next;
 			ArrayListBlock* srcBlock = src.m_root.next;
@@ -365,6 +436,9 @@ namespace Cat {
 		destroy();
 		if (src.m_capacity > 0) {
 			initArrayListWithBlockSize(src.m_capacity);
+			if (m_capacity == 0) {
+				return *this;
+			}
 			
 			ArrayListBlock* block = m_root.next;
 			ArrayListBlock* srcBlock = src.m_root.next;
@@ -379,30 +453,36 @@ namespace Cat {
 		return *this;		
 	}
 
-	template <typename T> inline void ArrayList<T>::append() {
+	template <typename T> inline Boolean ArrayList<T>::append() {
 		if (m_length == m_capacity) {
 			DMSG("AUTO Resizing ArrayList with length "
 				  << m_length << " from " << m_capacity
 				  << " to " << m_capacity + m_blockSize);
-			increaseArrayListCapacityTo((m_capacity / m_blockSize) + 1);				
+			if (m_blockSize == 0 || !increaseArrayListCapacityTo((m_capacity / m_blockSize) + 1)) {
+				return false;
+			}
 		}
 		ArrayListBlock* block = getLastBlock();	
 		++(block->idx);
 		++m_length;
 		m_pLastAccessed = block;		
+		return true;
 	}
 
-	template <typename T> inline void ArrayList<T>::append(const T& elem) {
+	template <typename T> inline Boolean ArrayList<T>::append(const T& elem) {
 		if (m_length == m_capacity) {
 			DMSG("AUTO Resizing ArrayList with length "
 				  << m_length << " from " << m_capacity
 				  << " to " << m_capacity + m_blockSize);
-			increaseArrayListCapacityTo((m_capacity / m_blockSize) + 1);				
+			if (m_blockSize == 0 || !increaseArrayListCapacityTo((m_capacity / m_blockSize) + 1)) {
+				return false;
+			}
 		}
 		ArrayListBlock* block = getLastBlock();	
 		block->array[block->idx++] = elem;			
 		++m_length;
 		m_pLastAccessed = block;		
+		return true;
 	}
 	
 	
@@ -421,7 +501,7 @@ namespace Cat {
 		ArrayListBlock* next = NIL;	  
 		while (block->array != NIL) {
 			next = block->next;			
-			delete block;
+			destroyObject(m_pAllocator, block);
 			block = next;
 		}
 
@@ -464,9 +544,10 @@ namespace Cat {
 #endif
 	}
 
-	template <typename T> void ArrayList<T>::extendTo(Size length) {
-		if (length > m_capacity) {
-			increaseArrayListCapacityTo((Size)(ceil((F32)length / (F32)m_blockSize)));
+	template <typename T> Boolean ArrayList<T>::extendTo(Size length) {
+		if (length > m_capacity &&
+			 (m_blockSize == 0 || !increaseArrayListCapacityTo((Size)(ceil((F32)length / (F32)m_blockSize))))) {
+			return false;
 		}
 		
 		ArrayListBlock* block = getBlockForIndex(length - 1);		
@@ -477,13 +558,18 @@ namespace Cat {
 			block = block->prev;			
 		}
 		m_length = length;		
+		return true;
 	}
 
 	template <typename T> void ArrayList<T>::initArrayListWithBlockSize(Size blockSize) {
 		if (m_capacity == 0) {
+			ArrayListBlock* block = createBlock(0, blockSize-1, &m_root, &m_root);
+			if (!block) {
+				return;
+			}
 			m_blockSize = blockSize;
 			m_capacity = blockSize;			
-			m_root.next = m_root.prev = new ArrayListBlock(0, blockSize-1, &m_root, &m_root);
+			m_root.next = m_root.prev = block;
 			m_pLastAccessed = m_root.next;			
 		}
 		else {
@@ -491,12 +577,14 @@ namespace Cat {
 		}		
 	}
 
-	template <typename T> void ArrayList<T>::insertAt(Size idx, const T& elem) {
+	template <typename T> Boolean ArrayList<T>::insertAt(Size idx, const T& elem) {
 		if (m_length == m_capacity) {
 			DMSG("AUTO Resizing ArrayList from with length "
 					  << m_length << " from " << m_capacity
 					  << " to " << m_capacity + m_blockSize);
-			increaseArrayListCapacityTo((m_capacity / m_blockSize) + 1);
+			if (m_blockSize == 0 || !increaseArrayListCapacityTo((m_capacity / m_blockSize) + 1)) {
+				return false;
+			}
 		}
 		/* Move all the elements after down one */
 		ArrayListBlock* block = getLastBlock();
@@ -527,6 +615,7 @@ namespace Cat {
 		block->array[idx - block->start] = elem;
 		m_pLastAccessed = block;		
 		++m_length;
+		return true;
 	}
 
 	template <typename T> Boolean ArrayList<T>::removeAt(Size idx) {
@@ -610,13 +699,15 @@ namespace Cat {
 		decreaseSize();
 	}	
 
-	template <typename T> void ArrayList<T>::reserve(Size capacity) {
+	template <typename T> Boolean ArrayList<T>::reserve(Size capacity) {
 		if (capacity > m_capacity) { /* Only if reserving more than we have */
-			increaseArrayListCapacityTo((Size)(ceil((F32)capacity / (F32)m_blockSize)));		
+			return m_blockSize > 0 &&
+				increaseArrayListCapacityTo((Size)(ceil((F32)capacity / (F32)m_blockSize)));
 		}
+		return true;
 	}
 
-	template <typename T> void ArrayList<T>::set(Size idx, const T& value) {
+	template <typename T> Boolean ArrayList<T>::set(Size idx, const T& value) {
 		ArrayListBlock* block = NIL;		
 		if (idx >= m_length) {
 			if (idx >= m_capacity) {
@@ -625,7 +716,10 @@ namespace Cat {
 					  << idx << ".  Resizing to "
 					  << (Size)(ceil((F32)(idx+1) / (F32)m_blockSize)*m_blockSize)
 					  << ".");
-				increaseArrayListCapacityTo((Size)(ceil((F32)(idx+1) / (F32)m_blockSize)));	
+				if (m_blockSize == 0 ||
+					 !increaseArrayListCapacityTo((Size)(ceil((F32)(idx+1) / (F32)m_blockSize)))) {
+					return false;
+				}
 			}
 			block = getLastBlock();			
 		   ++(block->idx);
@@ -642,6 +736,7 @@ namespace Cat {
 		}
 		block->array[idx - block->start] = value;
 		m_pLastAccessed = block;
+		return true;
 	}
 
 	template <typename T> void ArrayList<T>::setAll(const T& value) {
@@ -672,16 +767,29 @@ namespace Cat {
 		}		
 	}
 
-	template <typename T> void ArrayList<T>::increaseArrayListCapacityTo(Size blocks) {
-		I32 curBlocks = (m_capacity / m_blockSize);
-		if (blocks > curBlocks) {
-			m_capacity = blocks * m_blockSize;
-			for (Size i = 0; i < blocks - curBlocks; ++i) {
-				m_root.prev->next = new ArrayListBlock(m_root.prev->end + 1, m_root.prev->end + m_blockSize,
-																	&m_root, m_root.prev);
-				m_root.prev = m_root.prev->next;				
-			}			
-		}	  
+	template <typename T> void ArrayList<T>::setAllocator(MemoryAllocator* allocator) {
+		if (m_capacity == 0) {
+			m_pAllocator = allocator;
+		}
+		else {
+			DWARN("Cannot set the MemoryAllocator of an initialised ArrayList.");
+		}
+	}
+
+	template <typename T> Boolean ArrayList<T>::increaseArrayListCapacityTo(Size blocks) {
+		Size curBlocks = (m_capacity / m_blockSize);
+		/* Link and count each block as it is made, so a failure leaves a whole list. */
+		for (; curBlocks < blocks; ++curBlocks) {
+			ArrayListBlock* block = createBlock(m_root.prev->end + 1, m_root.prev->end + m_blockSize,
+															&m_root, m_root.prev);
+			if (!block) {
+				return false;
+			}
+			m_root.prev->next = block;
+			m_root.prev = block;
+			m_capacity += m_blockSize;
+		}
+		return true;
 	}
 } // namespace Cat
 
@@ -10,7 +10,7 @@
  * @author Catlin Zilinski
  * @date Mar 21, 2014
  */
-#include "core/corelib.h"
+#include "core/memory/stlallocator.h"
 #include "core/util/datanode.h"
 
 namespace Cat {
@@ -19,26 +19,29 @@ namespace Cat {
 	 * @class DataNodePool datanodepool.h "core/util/datanodepool.h"
 	 * @brief A class to hold a storage of allocated DataNodes.
 	 *
+	 * The storage can come from a MemoryAllocator instead of new[].
+	 *
 	 * @author Catlin Zilinski
 	 * @since Mar 21, 2014
 	 * @version 1
 	 */
-	template<typename t>
-	class datanodepool {
+	template<typename T>
+	class DataNodePool {
 	  public:
 
 		/**
 		 * @brief create an empty datanodepool.
 		 */
 		inline DataNodePool()
-			: m_numFree(0), m_pNodeStorage(NIL), m_blockSize(0) {
+			: m_pNodeStorage(NIL), m_numFree(0), m_blockSize(0), m_pAllocator(NIL) {
 		}
 
 		/**
 		 * @brief Create a new DataNodePool with the specified amount of storage.
 		 * @param blockSize The number of DataNodes to allocate.
+		 * @param allocator The MemoryAllocator to use for the storage, or NIL to use new[].
 		 */
-		DataNodePool(Size blockSize);
+		DataNodePool(Size blockSize, MemoryAllocator* allocator = NIL);
 
 		/**
 		 * @brief Deletes all the nodes.
@@ -107,8 +110,10 @@ namespace Cat {
 		/**
 		 * @brief Initialize the node store with the specified block size.
 		 * @param blockSize the size of each block of nodes to allocate.
+		 * @param allocator The MemoryAllocator to use for the storage, or NIL to use new[].
+		 * @return True if the nodes were allocated, the pool stays empty otherwise.
 		 */
-		void initWithBlockSize(U32 blockSize);		
+		Boolean initWithBlockSize(U32 blockSize, MemoryAllocator* allocator = NIL);		
 
 		/**
 		 * @brief Get the number of free nodes available.
@@ -135,12 +140,19 @@ namespace Cat {
 		DataNode<T> *m_pNodeStorage;
 		Size m_numFree;
 		Size m_blockSize;
+		MemoryAllocator* m_pAllocator;
 	};
 
 	template<typename T>
-	DataNodePool<T>::DataNodePool(Size blockSize) {
+	DataNodePool<T>::DataNodePool(Size blockSize, MemoryAllocator* allocator)
+		: m_pNodeStorage(NIL), m_numFree(0), m_blockSize(0) {
 		m_root.initAsRoot();		
-		m_pNodeStorage = new DataNode<T>[blockSize];
+		m_pAllocator = allocator;
+		m_pNodeStorage = createArray<DataNode<T> >(m_pAllocator, blockSize);
+		if (!m_pNodeStorage) {
+			DERR("Failed to allocate " << blockSize << " nodes for the DataNodePool!");
+			return;
+		}
 		m_blockSize = blockSize;
 		putAllNodesOnFreeList();
 	}
@@ -154,23 +166,29 @@ namespace Cat {
 	void DataNodePool<T>::destroy() {	
 		m_root.initAsRoot();
 		if (m_pNodeStorage) {
-			delete m_pNodeStorage;
+			destroyArray(m_pAllocator, m_pNodeStorage, m_blockSize);
 			m_pNodeStorage = NIL;
 		}		
 		m_numFree =  m_blockSize = 0;
 	}
 
 	template<typename T>
-	void DataNodePool<T>::initWithBlockSize(U32 blockSize) {
+	Boolean DataNodePool<T>::initWithBlockSize(U32 blockSize, MemoryAllocator* allocator) {
 		/* Make sure not to initialize already initialized node store */
 		if (m_pNodeStorage != NIL) {
 			DWARN("Cannot initialize DataNodePool twice!");
-			return;			
+			return false;			
 		}		
 		m_root.initAsRoot();		
-		m_pNodeStorage = new DataNode<T>[blockSize];
+		m_pAllocator = allocator;
+		m_pNodeStorage = createArray<DataNode<T> >(m_pAllocator, blockSize);
+		if (!m_pNodeStorage) {
+			DERR("Failed to allocate " << blockSize << " nodes for the DataNodePool!");
+			return false;
+		}
 		m_blockSize = blockSize;
 		putAllNodesOnFreeList();
+		return true;
 	}	
 
 	template<typename T>
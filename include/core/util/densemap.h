@@ -0,0 +1,708 @@
+#ifndef CAT_CORE_UTIL_DENSEMAP_H
+#define CAT_CORE_UTIL_DENSEMAP_H
+/**
+ * @copyright Copyright Catlin Zilinksi, 2015.  All rights reserved.
+ *
+ * @file densemap.h
+ * @brief Defines a hashmap with the Map interface that keeps its entries in contiguous arrays.
+ *
+ * @author Catlin Zilinski
+ * @date Apr 12, 2015
+ */
+
+#include <cmath>
+#include "core/corelib.h"
+#include "core/memory/stlallocator.h"
+
+namespace Cat {
+	/**
+	 * @class DenseMap densemap.h "core/util/densemap.h"
+	 * @brief A hashmap using strings as keys hashed with crc32, stored in contiguous arrays.
+	 *
+	 * The DenseMap has the same interface as the Map, but instead of a chain of nodes per
+	 * bucket it keeps the keys and values packed in two dense arrays, and a sparse index
+	 * of (key, position) slots with linear probing to find them.  A lookup reads the
+	 * slots of one or two cache lines and then the value, iterating reads the arrays in
+	 * order, and the arrays grow whenever they are full.
+	 *
+	 * Removing an entry moves the last entry into its place, so the order of the entries
+	 * changes.  The Iterator walks from the last entry to the first, so the current entry
+	 * can be removed while iterating without skipping any.  Inserting a key that is
+	 * already in the map replaces its value.
+	 *
+	 * The DenseMap can be given a MemoryAllocator to get its arrays from instead of new.
+	 *
+	 * @author Catlin Zilinski
+	 * @version 1
+	 * @since Apr 12, 2015
+	 */
+	template <class T>
+	class DenseMap {
+	  public:
+		/**
+		 * @brief Creates an empty null map, the arrays are allocated on the first insert.
+		 */
+		DenseMap()
+			: m_pSlots(NIL), m_pKeys(NIL), m_pValues(NIL), m_capacity(0), m_numBuckets(0), m_shift(32),
+			  m_nullValue(), m_numObjects(0), m_loadFactor(0.0f), m_pAllocator(NIL) {}
+
+		/**
+		 * @brief Creates an empty map with the specified capacity.
+		 * @param capacity The initial capacity of the hashmap.
+		 * @param nullValue The value of null for the Map types.
+		 * @param allocator The MemoryAllocator to use for the memory, or NIL to use new.
+		 */
+		DenseMap(Size capacity, const T& nullValue, MemoryAllocator* allocator = NIL)
+			: m_pSlots(NIL), m_pKeys(NIL), m_pValues(NIL), m_capacity(0), m_numBuckets(0), m_shift(32),
+			  m_nullValue(nullValue), m_numObjects(0), m_loadFactor(0.8f), m_pAllocator(allocator) {
+			initMapWithCapacityAndLoadFactor(capacity, 0.8f, nullValue);
+		}
+
+		/**
+		 * @brief Creates an empty map with the specified capacity and load factor.
+		 * @param capacity The initial capacity of the hashmap.
+		 * @param loadFactor The most of the index the entries fill before it grows.
+		 * @param nullValue The value of null for the Map types.
+		 * @param allocator The MemoryAllocator to use for the memory, or NIL to use new.
+		 */
+		DenseMap(Size capacity, F32 loadFactor, const T& nullValue, MemoryAllocator* allocator = NIL)
+			: m_pSlots(NIL), m_pKeys(NIL), m_pValues(NIL), m_capacity(0), m_numBuckets(0), m_shift(32),
+			  m_nullValue(nullValue), m_numObjects(0), m_loadFactor(loadFactor), m_pAllocator(allocator) {
+			initMapWithCapacityAndLoadFactor(capacity, loadFactor, nullValue);
+		}
+
+		/**
+		 * @brief Copy constructor, copies the entries into arrays from the same allocator.
+		 * @param src The DenseMap to copy from.
+		 */
+		DenseMap(const DenseMap& src)
+			: m_pSlots(NIL), m_pKeys(NIL), m_pValues(NIL), m_capacity(0), m_numBuckets(0), m_shift(32),
+			  m_nullValue(src.m_nullValue), m_numObjects(0), m_loadFactor(src.m_loadFactor),
+			  m_pAllocator(src.m_pAllocator) {
+			copyFrom(src);
+		}
+
+		/**
+		 * @brief Assignment operator, copies the entries.  Keeps this map's allocator.
+		 * @param src The DenseMap to copy from.
+		 * @return A reference to this DenseMap.
+		 */
+		DenseMap& operator=(const DenseMap& src) {
+			if (this != &src) {
+				if (!copyFrom(src)) {
+					DERR("Cannot copy the DenseMap, keeping the old entries!");
+					return *this;
+				}
+				m_nullValue = src.m_nullValue;
+				m_loadFactor = src.m_loadFactor;
+			}
+			return *this;
+		}
+
+		/**
+		 * @brief The destructor, frees the arrays but doesn't delete the objects stored within.
+		 */
+		~DenseMap() {
+			deleteArrays();
+		}
+
+		/**
+		 * @brief Empties the map but doesn't explicitly delete the objects stored within.
+		 */
+		void clear();
+
+		/**
+		 * @brief Erases all the objects stored in the map (deletes them).
+		 * If called on a map containing non-pointer types... bad things happen.
+		 * SO DON'T DO IT!
+		 */
+		void eraseAll();
+
+		/**
+		 * @brief Test if the map is empty or not
+		 * @return true if the map is empty.
+		 */
+		inline Boolean isEmpty() const { return m_numObjects == 0; }
+
+		/**
+		 * @brief Return the number of elements in the map.
+		 * @return The number of elements in the map.
+		 */
+		inline Size size() const { return m_numObjects; }
+
+		/**
+		 * @brief Return the capacity of the map.
+		 * The capacity is the number of entries the map can hold before it grows.
+		 * @return The capacity of the map.
+		 */
+		inline Size capacity() const { return m_capacity; }
+
+		/**
+		 * @brief Returns the number of slots in the index, a power of two.
+		 * @return The number of slots in the index.
+		 */
+		inline Size numBuckets() const { return m_numBuckets; }
+
+		/**
+		 * @brief Returns the load factor for the map.
+		 * @return The load factor for the map.
+		 */
+		inline F32 loadFactor() const { return m_loadFactor; }
+
+		/**
+		 * @brief Get the MemoryAllocator the DenseMap gets its memory from.
+		 * @return The MemoryAllocator, or NIL if it uses new.
+		 */
+		inline MemoryAllocator* allocator() const { return m_pAllocator; }
+
+		/**
+		 * @brief Set the MemoryAllocator to get the memory from.
+		 * Can only be called before the DenseMap is initialised.
+		 * @param allocator The MemoryAllocator to use, or NIL to use new.
+		 */
+		inline void setAllocator(MemoryAllocator* allocator) {
+			if (!m_pSlots) {
+				m_pAllocator = allocator;
+			} else {
+				DERR("Cannot set the MemoryAllocator of an initialized DenseMap!");
+			}
+		}
+
+		/**
+		 * @brief Access an element of the map via its crc32 object id.
+		 * @param key The name of the element (string).
+		 * @return A reference to the element or nullValue if not found.
+		 */
+		inline T& at(OID key) {
+			Size slot = findSlot(key);
+			if (slot < m_numBuckets) { return m_pValues[m_pSlots[slot].index]; }
+			else { return m_nullValue; }
+		}
+
+		/**
+		 * @brief Access an element of the map via its String key.
+		 * @param key The name of the element (string).
+		 * @return A reference to the element or nullValue if not found.
+		 */
+		inline T& at(const Char* key) { return at(crc32(key)); }
+
+		/**
+		 * @brief Access an element of the map via its crc32 object id.
+		 * @param key The name of the element (string).
+		 * @return A reference to the element or nullValue if not found.
+		 */
+		inline const T& get(OID key) const {
+			Size slot = findSlot(key);
+			if (slot < m_numBuckets) { return m_pValues[m_pSlots[slot].index]; }
+			else { return m_nullValue; }
+		}
+
+		/**
+		 * @brief Access an element of the map via its String key.
+		 * @param key The name of the element (string).
+		 * @return A reference to the element or nullValue if not found.
+		 */
+		inline const T& get(const Char* key) const { return get(crc32(key)); }
+
+		/**
+		 * @brief inserts the object in the map, replacing the value of the key if it is in it.
+		 * @param key The hashed key to insert the value into.
+		 * @param value The value to insert into the map.
+		 * @return False if the map was full and its arrays could not grow.
+		 */
+		Boolean insert(OID key, const T& value);
+
+		/**
+		 * @brief inserts the object in the map, replacing the value of the key if it is in it.
+		 * @param key The String key to insert the value into.
+		 * @param value The value to insert into the map.
+		 * @return False if the map was full and its arrays could not grow.
+		 */
+		inline Boolean insert(const Char* key, const T& value) {
+			return insert(crc32(key), value);
+		}
+
+		/**
+		 * @brief Removes and returns the object from the map.
+		 * @param key The OID of the object to take from the map.
+		 * @return The object taken from the map or nullValue if it wasn't in the map.
+		 */
+		inline T take(OID key) {
+			Size slot = findSlot(key);
+			if (slot < m_numBuckets) {
+				T val = m_pValues[m_pSlots[slot].index];
+				removeSlot(slot);
+				return val;
+			}
+			else { return m_nullValue; }
+		}
+
+		/**
+		 * @brief Removes and returns the object from the map.
+		 * @param key The name of the object to take from the map.
+		 * @return The object taken from the map or nullValue if it wasn't in the map.
+		 */
+		inline T take(const Char* name) { return take(crc32(name)); }
+
+		/**
+		 * @brief Removes and returns the object from the map.
+		 * Will only remove the first occurance of the object it finds.
+		 * @param value The value to take from the map.
+		 * @return The value taken from the map or nullValue if it wasn't in the map.
+		 */
+		T take(const T& value);
+
+		/**
+		 * @brief Removes the object from the map.
+		 * @param key The OID of the object to remove from the map.
+		 */
+		inline void remove(OID key) {
+			Size slot = findSlot(key);
+			if (slot < m_numBuckets) {
+				removeSlot(slot);
+			}
+		}
+
+		/**
+		 * @brief Removes the object from the map.
+		 * @param key The name of the object to remove from the map.
+		 */
+		inline void remove(const Char* key) { remove(crc32(key)); }
+
+		/**
+		 * @brief Removes the object from the map.
+		 * Only removes the first occurance of the value found in the map.
+		 * @param obj The object to remove from the map.
+		 */
+		void remove(const T& value);
+
+		/**
+		 * @brief Removes AND DELETES the object from the map.
+		 * Calling this method on a DenseMap that does not contain pointers, is BAD!
+		 * @param key The OID of the object to delete from the map.
+		 */
+		inline void erase(OID key) {
+			Size slot = findSlot(key);
+			if (slot < m_numBuckets) {
+				delete (m_pValues[m_pSlots[slot].index]);
+				removeSlot(slot);
+			}
+		}
+
+		/**
+		 * @brief Removes AND DELETES the object from the map.
+		 * Calling this method on a DenseMap that does not contain pointers, is BAD!
+		 * @param key The name of the object to delete from the map.
+		 */
+		inline void erase(const Char* key) { erase(crc32(key)); }
+
+		/**
+		 * @brief Removes AND DELETES the object from the map.
+		 * Calling this method on a DenseMap that does not contain pointers, is BAD!
+		 * This method will only delete the first occurance of a value in the map.
+		 * @param obj The object to delete from the map.
+		 */
+		void erase(const T& value);
+
+		/**
+		 * @brief Tests to see if an object is in the map.
+		 * @param key The OID key value of the object.
+		 * @return true if the object is in the map.
+		 */
+		inline Boolean contains(OID key) const {
+			return findSlot(key) < m_numBuckets;
+		}
+
+		/**
+		 * @brief Tests to see if an object is the map.
+		 * @param key The string key value of the object.
+		 * @return true if the object is in the map.
+		 */
+		inline Boolean contains(const Char* key) const {
+			return contains(crc32(key));
+		}
+
+		/**
+		 * @brief Tests to see if the given object is in the map.
+		 * @param value The value to look for.
+		 * @return true if the object is in the map.
+		 */
+		Boolean contains(const T& value) const;
+
+		/**
+		 * @brief Reserves the specified capacity in the DenseMap.
+		 * If capacity < current capacity, nothing happens.
+		 * @param capacity The new capacity to have in the map.
+		 * @return False if the arrays could not be allocated, the map is unchanged.
+		 */
+		inline Boolean reserve(Size capacity) {
+			if (capacity > m_capacity) {
+				return resizeMapToCapacity(capacity);
+			}
+			return true;
+		}
+
+		/**
+		 * @brief Get the null value for the types in this map.
+		 * @return The null value for the types in this map.
+		 */
+		inline const T& nullValue() const { return m_nullValue; }
+
+		class Iterator {
+		  public:
+			inline Iterator(DenseMap* map)
+				: m_pMap(map), m_pos(map->m_numObjects) {}
+
+			inline Boolean hasNext() { return m_pos > 1; }
+			inline Boolean isValid() { return m_pos > 0 && m_pos <= m_pMap->m_numObjects; }
+
+			inline void next() {
+				if (m_pos > 0) {
+					m_pos--;
+				}
+			}
+
+			inline T& val() { return m_pMap->m_pValues[m_pos - 1]; }
+			inline OID key() { return m_pMap->m_pKeys[m_pos - 1]; }
+
+		  private:
+			DenseMap*	m_pMap;
+			Size			m_pos;	/**< 1 + the position of the current entry */
+		};
+
+		/**
+		 * @brief Get an Iterator into the DenseMap, at the last entry.
+		 * @return An iterator into the map.
+		 */
+		inline Iterator iterator() {
+			return Iterator(this);
+		}
+
+		/**
+		 * @brief Create the initial map with the specified capacity.
+		 * @param capacity The initial capacity.
+		 * @param loadFactor The initial load factor to use.
+		 * @param nullValue The null value for the types in the DenseMap.
+		 */
+		void initMapWithCapacityAndLoadFactor(Size capacity, F32 loadFactor,
+														  const T& nullValue);
+
+	  private:
+		/** A slot of the index, where in the arrays the entry with the key is. */
+		struct Slot {
+			OID	key;
+			U32	index;	/**< kEmptySlot if there is no entry */
+		};
+
+		static const U32 kEmptySlot = 0xFFFFFFFF;
+
+		/**
+		 * Fibonacci hashing, the high bits of the key times 2^32 / phi, so keys with the
+		 * same low bits still spread over the index.
+		 */
+		inline Size bucketOf(OID key) const {
+			return (Size)((U32)(key * 2654435769U) >> m_shift);
+		}
+
+		inline Size findSlot(OID key) const {
+			if (m_numObjects == 0) {
+				return m_numBuckets;
+			}
+			Size mask = m_numBuckets - 1;
+			for (Size slot = bucketOf(key); m_pSlots[slot].index != kEmptySlot; slot = (slot + 1) & mask) {
+				if (m_pSlots[slot].key == key) {
+					return slot;
+				}
+			}
+			return m_numBuckets;
+		}
+
+		inline void placeSlot(OID key, U32 index) {
+			Size mask = m_numBuckets - 1;
+			Size slot = bucketOf(key);
+			while (m_pSlots[slot].index != kEmptySlot) {
+				slot = (slot + 1) & mask;
+			}
+			m_pSlots[slot].key = key;
+			m_pSlots[slot].index = index;
+		}
+
+		void removeSlot(Size slot);
+		Boolean allocateArrays(Size capacity, Size numBuckets, OID*& keys, T*& values, Slot*& slots);
+		void freeArrays(OID* keys, T* values, Slot* slots, Size capacity, Size numBuckets);
+		Boolean resizeMapToCapacity(Size capacity);
+		void rebuildIndex(Slot* slots, Size numBuckets);
+		Boolean copyFrom(const DenseMap& src);
+		void deleteArrays();
+
+		Slot*					m_pSlots;
+		OID*					m_pKeys;
+		T*						m_pValues;
+		Size					m_capacity;
+		Size					m_numBuckets;	/**< A power of two */
+		U32					m_shift;			/**< 32 - log2(m_numBuckets) */
+		T						m_nullValue;
+		Size					m_numObjects;
+		F32					m_loadFactor;
+		MemoryAllocator*	m_pAllocator;
+	};
+
+	template <class T>
+	void DenseMap<T>::clear() {
+		for (Size i = 0; i < m_numObjects; i++) {
+			m_pKeys[i] = 0;
+			m_pValues[i] = m_nullValue;
+		}
+		for (Size i = 0; i < m_numBuckets; i++) {
+			m_pSlots[i].index = kEmptySlot;
+		}
+		m_numObjects = 0;
+	}
+
+	template <class T>
+	void DenseMap<T>::eraseAll() {
+		for (Size i = 0; i < m_numObjects; i++) {
+			delete (m_pValues[i]);
+		}
+		clear();
+	}
+
+	template <class T>
+	Boolean DenseMap<T>::insert(OID key, const T& value) {
+		Size slot = findSlot(key);
+		if (slot < m_numBuckets) {
+			m_pValues[m_pSlots[slot].index] = value;
+			return true;
+		}
+		if (m_numObjects >= m_capacity) {
+			DMSG("Resizing map automatically. [capacity: "
+				  << m_capacity << ", numObjects: "
+				  << m_numObjects << "]");
+			if (!resizeMapToCapacity(m_capacity ? m_capacity*2 : 8)) {
+				return false;
+			}
+		}
+		m_pKeys[m_numObjects] = key;
+		m_pValues[m_numObjects] = value;
+		placeSlot(key, (U32)m_numObjects);
+		m_numObjects++;
+		return true;
+	}
+
+	template <class T>
+	T DenseMap<T>::take(const T& value) {
+		for (Size i = 0; i < m_numObjects; i++) {
+			if (m_pValues[i] == value) {
+				T val = m_pValues[i];
+				removeSlot(findSlot(m_pKeys[i]));
+				return val;
+			}
+		}
+		return m_nullValue;
+	}
+
+	template <class T>
+	void DenseMap<T>::remove(const T& value) {
+		for (Size i = 0; i < m_numObjects; i++) {
+			if (m_pValues[i] == value) {
+				removeSlot(findSlot(m_pKeys[i]));
+				return;
+			}
+		}
+	}
+
+	template <class T>
+	void DenseMap<T>::erase(const T& value) {
+		for (Size i = 0; i < m_numObjects; i++) {
+			if (m_pValues[i] == value) {
+				delete (m_pValues[i]);
+				removeSlot(findSlot(m_pKeys[i]));
+				return;
+			}
+		}
+	}
+
+	template <class T>
+	Boolean DenseMap<T>::contains(const T& value) const {
+		for (Size i = 0; i < m_numObjects; i++) {
+			if (m_pValues[i] == value) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	template <class T>
+	void DenseMap<T>::initMapWithCapacityAndLoadFactor(Size capacity, F32 loadFactor,
+																		const T& nullValue) {
+		if (!m_pSlots) {
+			if (loadFactor <= 0.0f || loadFactor > 1.0f) {
+				DERR("Load factor " << loadFactor << " must be in (0, 1], using 0.8.");
+				loadFactor = 0.8f;
+			}
+			m_loadFactor = loadFactor;
+			m_nullValue = nullValue;
+			m_numObjects = 0;
+			resizeMapToCapacity(capacity);
+		}
+		else {
+			DERR("Cannot call initMapWithCapacityAndLoadFactor on initialized DenseMap!");
+		}
+	}
+
+	template <class T>
+	void DenseMap<T>::removeSlot(Size slot) {
+		U32 index = m_pSlots[slot].index;
+		Size mask = m_numBuckets - 1;
+
+		/* Shift back the slots that probed past the hole, so no probe stops at it early. */
+		Size hole = slot;
+		for (Size next = (slot + 1) & mask; m_pSlots[next].index != kEmptySlot; next = (next + 1) & mask) {
+			Size home = bucketOf(m_pSlots[next].key);
+			if (((next - home) & mask) >= ((next - hole) & mask)) {
+				m_pSlots[hole] = m_pSlots[next];
+				hole = next;
+			}
+		}
+		m_pSlots[hole].index = kEmptySlot;
+
+		/* Fill the gap in the arrays with the last entry. */
+		Size last = m_numObjects - 1;
+		if (index != last) {
+			m_pKeys[index] = m_pKeys[last];
+			m_pValues[index] = m_pValues[last];
+			m_numObjects--;
+			m_pSlots[findSlot(m_pKeys[index])].index = index;
+		} else {
+			m_numObjects--;
+		}
+		m_pKeys[last] = 0;
+		m_pValues[last] = m_nullValue;
+	}
+
+	template <class T>
+	Boolean DenseMap<T>::allocateArrays(Size capacity, Size numBuckets,
+													OID*& keys, T*& values, Slot*& slots) {
+		keys = createArray<OID>(m_pAllocator, capacity);
+		values = keys ? createArray<T>(m_pAllocator, capacity) : NIL;
+		slots = values ? createArray<Slot>(m_pAllocator, numBuckets) : NIL;
+		if (!slots) {
+			DERR("Cannot allocate DenseMap arrays with capacity " << capacity << "!");
+			freeArrays(keys, values, slots, capacity, numBuckets);
+			return false;
+		}
+		return true;
+	}
+
+	template <class T>
+	void DenseMap<T>::freeArrays(OID* keys, T* values, Slot* slots, Size capacity, Size numBuckets) {
+		if (keys) {
+			destroyArray(m_pAllocator, keys, capacity);
+		}
+		if (values) {
+			destroyArray(m_pAllocator, values, capacity);
+		}
+		if (slots) {
+			destroyArray(m_pAllocator, slots, numBuckets);
+		}
+	}
+
+	template <class T>
+	Boolean DenseMap<T>::resizeMapToCapacity(Size capacity) {
+		if (m_loadFactor <= 0.0f) {
+			m_loadFactor = 0.8f;
+		}
+		Size numBuckets = 2;
+		while (numBuckets <= capacity || (F32)numBuckets * m_loadFactor < (F32)capacity) {
+			numBuckets <<= 1;
+		}
+
+		/* Allocate everything before letting go of the old arrays, so a failure changes nothing. */
+		OID* keys;
+		T* values;
+		Slot* slots;
+		if (!allocateArrays(capacity, numBuckets, keys, values, slots)) {
+			return false;
+		}
+		for (Size i = 0; i < m_numObjects; i++) {
+			keys[i] = m_pKeys[i];
+			values[i] = m_pValues[i];
+		}
+		for (Size i = m_numObjects; i < capacity; i++) {
+			keys[i] = 0;
+			values[i] = m_nullValue;
+		}
+		freeArrays(m_pKeys, m_pValues, NIL, m_capacity, 0);
+		m_pKeys = keys;
+		m_pValues = values;
+		m_capacity = capacity;
+		rebuildIndex(slots, numBuckets);
+		return true;
+	}
+
+	template <class T>
+	void DenseMap<T>::rebuildIndex(Slot* slots, Size numBuckets) {
+		if (m_pSlots) {
+			destroyArray(m_pAllocator, m_pSlots, m_numBuckets);
+		}
+		m_pSlots = slots;
+		m_numBuckets = numBuckets;
+		m_shift = 32;
+		for (Size n = numBuckets; n > 1; n >>= 1) {
+			m_shift--;
+		}
+		for (Size i = 0; i < numBuckets; i++) {
+			m_pSlots[i].index = kEmptySlot;
+		}
+		for (Size i = 0; i < m_numObjects; i++) {
+			placeSlot(m_pKeys[i], (U32)i);
+		}
+	}
+
+	template <class T>
+	Boolean DenseMap<T>::copyFrom(const DenseMap& src) {
+		if (!src.m_pSlots) {
+			deleteArrays();
+			return true;
+		}
+		OID* keys;
+		T* values;
+		Slot* slots;
+		if (!allocateArrays(src.m_capacity, src.m_numBuckets, keys, values, slots)) {
+			return false;
+		}
+		for (Size i = 0; i < src.m_capacity; i++) {
+			keys[i] = src.m_pKeys[i];
+			values[i] = src.m_pValues[i];
+		}
+		for (Size i = 0; i < src.m_numBuckets; i++) {
+			slots[i] = src.m_pSlots[i];
+		}
+		deleteArrays();
+		m_pKeys = keys;
+		m_pValues = values;
+		m_pSlots = slots;
+		m_capacity = src.m_capacity;
+		m_numBuckets = src.m_numBuckets;
+		m_shift = src.m_shift;
+		m_numObjects = src.m_numObjects;
+		return true;
+	}
+
+	template <class T>
+	void DenseMap<T>::deleteArrays() {
+		if (m_pSlots) {
+			destroyArray(m_pAllocator, m_pSlots, m_numBuckets);
+			destroyArray(m_pAllocator, m_pKeys, m_capacity);
+			destroyArray(m_pAllocator, m_pValues, m_capacity);
+			m_pSlots = NIL;
+			m_pKeys = NIL;
+			m_pValues = NIL;
+		}
+		m_capacity = m_numBuckets = m_numObjects = 0;
+		m_shift = 32;
+	}
+
+} //namespace
+
+#endif // CAT_CORE_UTIL_DENSEMAP_H
@@ -0,0 +1,159 @@
+#ifndef CAT_CORE_UTIL_HASH_H
+#define CAT_CORE_UTIL_HASH_H
+/**
+ * @copyright Copyright Catlin Zilinksi, 2015.  All rights reserved.
+ *
+ * @file hash.h
+ * @brief Contains the HashOf and EqualTo functors a HashMap uses for its keys.
+ *
+ * @author Catlin Zilinski
+ * @date Apr 10, 2015
+ */
+
+#include <cstring>
+#include "core/corelib.h"
+#include "core/string/string.h"
+
+namespace Cat {
+
+	/**
+	 * @brief Hash bytes with 64 bit FNV-1a.
+	 * @param data The bytes to hash.
+	 * @param length The number of bytes.
+	 * @return The hash of the bytes.
+	 */
+	inline U64 hashBytes(const void* data, Size length) {
+		const U8* bytes = (const U8*)data;
+		U64 hash = 0xcbf29ce484222325ULL;
+		for (Size i = 0; i < length; ++i) {
+			hash = (hash ^ bytes[i]) * 0x100000001b3ULL;
+		}
+		return hash;
+	}
+
+	/**
+	 * @brief Hash a null-terminated string, the same as hashBytes() of its characters.
+	 * @param str The string to hash, NIL hashes the same as an empty string.
+	 * @return The hash of the string.
+	 */
+	inline U64 hashString(const Char* str) {
+		U64 hash = 0xcbf29ce484222325ULL;
+		for (const U8* c = (const U8*)str; c && *c; ++c) {
+			hash = (hash ^ *c) * 0x100000001b3ULL;
+		}
+		return hash;
+	}
+
+	/**
+	 * @brief Scramble the bits of a value, so every bit of it reaches the low bits.
+	 * @param value The value to scramble.
+	 * @return The scrambled value.
+	 */
+	inline U64 hashMix(U64 value) {
+		value ^= value >> 30;
+		value *= 0xbf58476d1ce4e5b9ULL;
+		value ^= value >> 27;
+		value *= 0x94d049bb133111ebULL;
+		value ^= value >> 31;
+		return value;
+	}
+
+	/**
+	 * @brief Combine the hash of a member into the hash of a composite key.
+	 *
+	 *     U64 operator()(const CellKey& key) const {
+	 *        return hashCombine(HashOf<I32>()(key.x), HashOf<I32>()(key.y));
+	 *     }
+	 *
+	 * @param seed The hash of the members so far.
+	 * @param hash The hash of the next member.
+	 * @return The combined hash.
+	 */
+	inline U64 hashCombine(U64 seed, U64 hash) {
+		return hashMix(seed ^ (hash + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2)));
+	}
+
+	/**
+	 * The default hash of a HashMap key.  Integers and pointers hash their value,
+	 * strings (const Char* and String) hash their characters.  Specialize it, or
+	 * give the HashMap a functor of its own, for any other key type.
+	 */
+	template <typename T>
+	struct HashOf;
+
+	template <typename T>
+	struct HashOf<T*> {
+		inline U64 operator()(const T* ptr) const { return hashMix((U64)(Size)ptr); }
+	};
+
+#define CAT_HASH_OF_INTEGER(type)													\
+	template <>																				\
+	struct HashOf<type> {																\
+		inline U64 operator()(type value) const { return hashMix((U64)value); } \
+	};
+
+	CAT_HASH_OF_INTEGER(bool)
+	CAT_HASH_OF_INTEGER(char)
+	CAT_HASH_OF_INTEGER(signed char)
+	CAT_HASH_OF_INTEGER(unsigned char)
+	CAT_HASH_OF_INTEGER(short)
+	CAT_HASH_OF_INTEGER(unsigned short)
+	CAT_HASH_OF_INTEGER(int)
+	CAT_HASH_OF_INTEGER(unsigned int)
+	CAT_HASH_OF_INTEGER(long)
+	CAT_HASH_OF_INTEGER(unsigned long)
+	CAT_HASH_OF_INTEGER(long long)
+	CAT_HASH_OF_INTEGER(unsigned long long)
+
+#undef CAT_HASH_OF_INTEGER
+
+	template <>
+	struct HashOf<const Char*> {
+		inline U64 operator()(const Char* str) const { return hashString(str); }
+	};
+
+	template <>
+	struct HashOf<Char*> {
+		inline U64 operator()(const Char* str) const { return hashString(str); }
+	};
+
+	/**
+	 * Hashes a String the same as its characters, so a HashMap keyed by String can
+	 * be searched with a const Char* without making a String.
+	 */
+	template <>
+	struct HashOf<String> {
+		inline U64 operator()(const String& str) const { return hashBytes(str.cStr(), str.length()); }
+		inline U64 operator()(const Char* str) const { return hashString(str); }
+	};
+
+	/**
+	 * The default test of whether two HashMap keys are equal, with operator==.  The
+	 * second key can be of any type the key compares with, e.g., a String with a
+	 * const Char*.
+	 */
+	template <typename T>
+	struct EqualTo {
+		template <typename Q>
+		inline Boolean operator()(const T& key, const Q& other) const { return key == other; }
+	};
+
+	template <>
+	struct EqualTo<const Char*> {
+		inline Boolean operator()(const Char* key, const Char* other) const { return strcmp(key, other) == 0; }
+	};
+
+	template <>
+	struct EqualTo<Char*> {
+		inline Boolean operator()(const Char* key, const Char* other) const { return strcmp(key, other) == 0; }
+	};
+
+	template <>
+	struct EqualTo<String> {
+		inline Boolean operator()(const String& key, const String& other) const { return key == other; }
+		inline Boolean operator()(const String& key, const Char* other) const { return key == other; }
+	};
+
+} // namespace Cat
+
+#endif // CAT_CORE_UTIL_HASH_H
@@ -0,0 +1,102 @@
+#ifndef CAT_CORE_UTIL_HASHEDID_H
+#define CAT_CORE_UTIL_HASHEDID_H
+/**
+ * @copyright Copyright Catlin Zilinksi, 2015.  All rights reserved.
+ *
+ * @file hashedid.h
+ * @brief Contains the HashedID, a name hashed to its OID at compile time.
+ *
+ * @author Catlin Zilinski
+ * @date Apr 11, 2015
+ */
+
+#include "core/corelib.h"
+
+#if __cplusplus >= 201103L
+#define CAT_HASHEDID_CONSTEXPR constexpr
+#else
+#define CAT_HASHEDID_CONSTEXPR
+#endif
+
+namespace Cat {
+
+	/**
+	 * @class HashedID hashedid.h "core/util/hashedid.h"
+	 * @brief A name and its OID, the same OID as crc32(name).
+	 *
+	 * With C++11 a constant name is hashed at compile time, most easily with the _id literal:
+	 *
+	 *     taskManager->queueTask("worker"_id, task);
+	 *     emit("onResize"_id, this);
+	 *
+	 * The TaskManager, ProcessManager and SignalEmitter take a HashedID wherever they take
+	 * a name, and it converts to its OID for anything that takes an OID, e.g., the
+	 * StaticMap, Map and ObjMap.  In DEBUG builds the name of each runner is recorded when
+	 * it is created, and of each signal when it is connected, so nameOf() can give it back
+	 * for logging.  Queueing, emitting and the like only use the OID.
+	 *
+	 * @author Catlin Zilinski
+	 * @version 1
+	 * @since Apr 11, 2015
+	 */
+	class HashedID {
+	  public:
+		/**
+		 * @brief Hash a name, at compile time if the name is a constant.
+		 * @param name The name to hash, must last as long as the HashedID.
+		 */
+		CAT_HASHEDID_CONSTEXPR explicit HashedID(const Char* name)
+#if __cplusplus >= 201103L
+			: m_id(crc32Const(name))
+#else
+			: m_id(crc32(name))
+#endif
+#if defined(DEBUG)
+			, m_pName(name)
+#endif
+		{}
+
+		/**
+		 * @brief Get the OID of the name.
+		 * @return The OID, the same as crc32(name).
+		 */
+		CAT_HASHEDID_CONSTEXPR OID id() const { return m_id; }
+		CAT_HASHEDID_CONSTEXPR operator OID() const { return m_id; }
+
+		/**
+		 * @brief Record the name for nameOf(), only in DEBUG builds.
+		 * Takes a lock, so it is meant for creating and connecting, not every call.
+		 * @return The OID of the name.
+		 */
+#if defined(DEBUG)
+		OID record() const;
+#else
+		inline OID record() const { return m_id; }
+#endif
+
+		/**
+		 * @brief Get the name of a recorded OID.
+		 * @param id The OID to get the name of.
+		 * @return The name, or NIL if no HashedID with the OID was recorded (or not DEBUG).
+		 */
+		static const Char* nameOf(OID id);
+
+	  private:
+		OID				m_id;
+#if defined(DEBUG)
+		const Char*		m_pName;
+#endif
+	};
+
+#if __cplusplus >= 201103L
+	/**
+	 * @brief Makes a HashedID of a string literal at compile time, e.g., "onResize"_id.
+	 */
+	constexpr HashedID operator""_id(const Char* name, Size length) {
+		return HashedID(name);
+	}
+#endif
+
+} // namespace Cat
+
+#endif // CAT_CORE_UTIL_HASHEDID_H
@@ -1,32 +1,552 @@
 #ifndef CAT_CORE_UTIL_HASHMAP_H
 #define CAT_CORE_UTIL_HASHMAP_H
 /**
- * Copyright Catlin Zilinksi, 2013.  All rights reserved.
+ * @copyright Copyright Catlin Zilinksi, 2015.  All rights reserved.
  *
- * hashmap.h: Contains the singleton Manager class for the ConfigManager.
+ * @file hashmap.h
+ * @brief Defines a HashMap with keys of any type, hashed and compared by functors.
  *
- * Author: Catlin Zilinski
- * Date: September 17, 2013
+ * @author Catlin Zilinski
+ * @date Apr 10, 2015
  */
 
-#include <
+#include <cstring>
+#include "core/corelib.h"
+#include "core/memory/stlallocator.h"
+#include "core/util/hash.h"
+
 namespace Cat {
 
-	template<Class Key, Class T>
+	/**
+	 * @class HashMap hashmap.h "core/util/hashmap.h"
+	 * @brief A hashmap with keys of any type.
+	 *
+	 * Unlike the Map, ObjMap and StaticMap, the keys are kept and compared whole, so
+	 * two keys with the same hash never clash, and a key can be a struct of several
+	 * fields given a Hash for it (see hashCombine()).  Hash is a functor returning a
+	 * U64 hash of a key, with its bits spread to the low bits, and Eq a functor
+	 * telling if two keys are equal.
+	 *
+	 * find(), contains() and remove() take any type the Hash and Eq take, so a
+	 * HashMap<String, T> is searched with a const Char* without making a String:
+	 *
+	 *     HashMap<String, Shader*> shaders;
+	 *     Shader** shader = shaders.find("basic");
+	 *
+	 * The entries are stored flat in a power of two array with Robin Hood probing, like
+	 * the StaticMap, and removed without tombstones.  The Map can be given a
+	 * MemoryAllocator to get its arrays from instead of new[].
+	 *
+	 * @author Catlin Zilinski
+	 * @version 1
+	 * @since Apr 10, 2015
+	 */
+	template <typename K, typename V, typename Hash = HashOf<K>, typename Eq = EqualTo<K> >
 	class HashMap {
-		public:
-			HashMap();
+	  public:
+		/** The load factor used when none is given. */
+		static const F32 kDefaultLoadFactor;
+
+		/**
+		 * @class Iterator hashmap.h "core/util/hashmap.h"
+		 * @brief Walks the entries of a HashMap, in no particular order.
+		 *
+		 *     for (HashMap<String, I32>::Iterator it = map.iterator(); it.isValid(); it.next()) {
+		 *        use(it.key(), it.val());
+		 *     }
+		 *
+		 * The HashMap must not be changed while it is walked.
+		 */
+		class Iterator {
+		  public:
+			inline Iterator(HashMap* map) : m_pMap(map), m_idx(0) {
+				skipEmpty();
+			}
+
+			inline Boolean isValid() const { return m_idx < m_pMap->m_arraySize; }
+			inline const K& key() const { return m_pMap->m_pKeys[m_idx]; }
+			inline V& val() const { return m_pMap->m_pValues[m_idx]; }
+
+			inline void next() {
+				m_idx++;
+				skipEmpty();
+			}
+
+		  private:
+			inline void skipEmpty() {
+				while (m_idx < m_pMap->m_arraySize && m_pMap->m_pDistances[m_idx] == 0) {
+					m_idx++;
+				}
+			}
+
+			HashMap*	m_pMap;
+			Size		m_idx;
+		};
+
+		/**
+		 * @brief Creates an empty map, the arrays are allocated on the first insert.
+		 * Use HashMap(0, kDefaultLoadFactor, allocator) for an empty map with an allocator.
+		 */
+		HashMap()
+			: m_capacity(0), m_arraySize(0), m_mask(0), m_loadFactor(kDefaultLoadFactor), m_numEntries(0),
+			  m_pDistances(NIL), m_pKeys(NIL), m_pValues(NIL), m_pAllocator(NIL) {}
+
+		/**
+		 * @brief Creates an empty map with room for the specified number of entries.
+		 * @param capacity The number of entries the map has room for before it grows.
+		 * @param loadFactor The most of the array the entries fill before the map grows.
+		 * @param allocator The MemoryAllocator to use for the memory, or NIL to use new[].
+		 */
+		HashMap(Size capacity, F32 loadFactor = kDefaultLoadFactor, MemoryAllocator* allocator = NIL)
+			: m_capacity(0), m_arraySize(0), m_mask(0), m_loadFactor(loadFactor), m_numEntries(0),
+			  m_pDistances(NIL), m_pKeys(NIL), m_pValues(NIL), m_pAllocator(allocator) {
+			if (m_loadFactor <= 0.0f || m_loadFactor > 1.0f) {
+				DERR("Load factor " << loadFactor << " must be in (0, 1], using " << kDefaultLoadFactor << ".");
+				m_loadFactor = kDefaultLoadFactor;
+			}
+			reserve(capacity);
+		}
+
+		/**
+		 * @brief Copy constructor, copies all the entries into arrays from the same allocator.
+		 * @param src The HashMap to copy from.
+		 */
+		HashMap(const HashMap& src)
+			: m_capacity(0), m_arraySize(0), m_mask(0), m_loadFactor(src.m_loadFactor), m_numEntries(0),
+			  m_pDistances(NIL), m_pKeys(NIL), m_pValues(NIL), m_pAllocator(src.m_pAllocator),
+			  m_hash(src.m_hash), m_equal(src.m_equal) {
+			copyFrom(src);
+		}
+
+		/**
+		 * @brief Assignment operator, copies all the entries.  Keeps this map's allocator.
+		 * @param src The HashMap to copy from.
+		 * @return A reference to this HashMap.
+		 */
+		HashMap& operator=(const HashMap& src) {
+			if (this != &src) {
+				F32 loadFactor = m_loadFactor;
+				m_loadFactor = src.m_loadFactor;
+				if (!copyFrom(src)) {
+					DERR("Cannot copy the HashMap, keeping the old entries!");
+					m_loadFactor = loadFactor;
+					return *this;
+				}
+				m_hash = src.m_hash;
+				m_equal = src.m_equal;
+			}
+			return *this;
+		}
+
+		/**
+		 * @brief Destroys the entries and the arrays.
+		 */
+		~HashMap() {
+			deleteArrays();
+		}
+
+		/**
+		 * @brief Get the MemoryAllocator the HashMap gets its memory from.
+		 * @return The MemoryAllocator, or NIL if it uses new[].
+		 */
+		inline MemoryAllocator* allocator() const { return m_pAllocator; }
+
+		/**
+		 * @brief Return the length of the arrays, a power of two.
+		 * @return The length of the arrays.
+		 */
+		inline Size arrayLength() const { return m_arraySize; }
+
+		/**
+		 * @brief Return the number of entries the map has room for before it grows.
+		 * @return The capacity of the map.
+		 */
+		inline Size capacity() const { return m_capacity; }
+
+		/**
+		 * @brief Removes all the entries, keeping the arrays.
+		 */
+		void clear() {
+			for (Size i = 0; i < m_arraySize; i++) {
+				if (m_pDistances[i] != 0) {
+					emptySlot(i);
+				}
+			}
+			m_numEntries = 0;
+		}
+
+		/**
+		 * @brief Test if a key is in the map.
+		 * @param key The key, or anything the Hash and Eq take in its place.
+		 * @return True if the key is in the map.
+		 */
+		template <typename Q>
+		inline Boolean contains(const Q& key) const {
+			return findIndex(key) < m_arraySize;
+		}
+
+		/**
+		 * @brief Find the value of a key.
+		 * @param key The key, or anything the Hash and Eq take in its place.
+		 * @return A pointer to the value in the map, or NIL if the key is not in it.
+		 * The pointer is good until the map is next changed.
+		 */
+		template <typename Q>
+		inline V* find(const Q& key) {
+			Size idx = findIndex(key);
+			return (idx < m_arraySize) ? &(m_pValues[idx]) : NIL;
+		}
+
+		template <typename Q>
+		inline const V* find(const Q& key) const {
+			Size idx = findIndex(key);
+			return (idx < m_arraySize) ? &(m_pValues[idx]) : NIL;
+		}
+
+		/**
+		 * @brief Insert a value, replacing the value of the key if it is already in the map.
+		 * @param key The key.
+		 * @param value The value.
+		 * @return True if the key was added, false if its value was replaced or the map
+		 * could not allocate the room to add it.
+		 */
+		Boolean insert(const K& key, const V& value) {
+			Size idx = findIndex(key);
+			if (idx < m_arraySize) {
+				m_pValues[idx] = value;
+				return false;
+			}
+			if (m_numEntries >= m_capacity) {
+				Size grown = kMinArraySize;
+				/* A map that cannot grow fills past its load factor, but always leaves a bucket empty. */
+				if (!reserve(m_capacity > grown ? m_capacity*2 : grown) && m_numEntries + 1 >= m_arraySize) {
+					return false;
+				}
+			}
+			K placing = key;
+			V placingValue = value;
+			while (!place(placing, placingValue)) {
+				DWARN("HashMap entry too far from its bucket, the Hash is not spreading the keys.");
+				if (!resizeArrays(m_arraySize*2)) {
+					/* The entry being placed was swapped out of the arrays, so the one lost is not always the new key. */
+					DERR("Cannot grow the HashMap, an entry was dropped!");
+					return false;
+				}
+			}
+			return true;
+		}
+
+		/**
+		 * @brief Test if the map is empty or not
+		 * @return true if the map is empty.
+		 */
+		inline Boolean isEmpty() const { return m_numEntries == 0; }
+
+		/**
+		 * @brief Get an Iterator over the entries.
+		 * @return An Iterator at the first entry.
+		 */
+		inline Iterator iterator() { return Iterator(this); }
 
-			void set(Key &key, T value);
-			Key& find(const Key &key);
+		/**
+		 * @brief Returns the most of the array the entries fill before the map grows.
+		 * @return The load factor of the map.
+		 */
+		inline F32 loadFactor() const { return m_loadFactor; }
 
+		/**
+		 * @brief Rebuild the arrays with a specified length.
+		 * @param arrayLength The length of the arrays, rounded up to a power of two and
+		 * to what the entries in the map need.
+		 * @return False if the arrays could not be allocated, the map is unchanged.
+		 */
+		Boolean rehash(Size arrayLength) {
+			Size needed = arraySizeFor(m_numEntries);
+			return resizeArrays(roundUpToPowerOfTwo(arrayLength > needed ? arrayLength : needed));
+		}
 
+		/**
+		 * @brief Remove a key from the map.
+		 * @param key The key, or anything the Hash and Eq take in its place.
+		 * @return True if the key was in the map.
+		 */
+		template <typename Q>
+		Boolean remove(const Q& key) {
+			Size hole = findIndex(key);
+			if (hole >= m_arraySize) {
+				return false;
+			}
 
-		private: 
-			std::unordered_map<Key, T>	backing_;
+			/* Shift back the entries that probed past the hole, so no probe hits a gap. */
+			Size idx = (hole + 1) & m_mask;
+			while (m_pDistances[idx] > 1) {
+				m_pDistances[hole] = m_pDistances[idx] - 1;
+				m_pKeys[hole] = m_pKeys[idx];
+				m_pValues[hole] = m_pValues[idx];
+				hole = idx;
+				idx = (idx + 1) & m_mask;
+			}
+			emptySlot(hole);
+			m_numEntries--;
+			return true;
+		}
+
+		/**
+		 * @brief Make room for a number of entries, so inserting them does not grow the map.
+		 * If capacity <= the current capacity, nothing happens.
+		 * @param capacity The number of entries to have room for.
+		 * @return False if the arrays could not be allocated, the map is unchanged.
+		 */
+		Boolean reserve(Size capacity) {
+			if (capacity > m_capacity) {
+				return resizeArrays(arraySizeFor(capacity));
+			}
+			return true;
+		}
+
+		/**
+		 * @brief Set the MemoryAllocator to get the memory from.
+		 * Can only be called before the arrays are allocated.
+		 * @param allocator The MemoryAllocator to use, or NIL to use new[].
+		 */
+		inline void setAllocator(MemoryAllocator* allocator) {
+			if (!m_pValues) {
+				m_pAllocator = allocator;
+			} else {
+				DERR("Cannot set the MemoryAllocator of an allocated HashMap!");
+			}
+		}
+
+		/**
+		 * @brief Return the number of entries in the map.
+		 * @return The number of entries in the map.
+		 */
+		inline Size size() const { return m_numEntries; }
+
+	  private:
+		/** The farthest an entry can be from its bucket, the arrays grow before that. */
+		static const U8 kMaxDistance = 0xFF;
+		static const Size kMinArraySize = 8;
+
+		static inline Size roundUpToPowerOfTwo(Size value) {
+			Size size = kMinArraySize;
+			while (size < value) {
+				size <<= 1;
+			}
+			return size;
+		}
+
+		/**
+		 * Get the length of array that keeps capacity entries under the load factor,
+		 * and at least one bucket empty.
+		 */
+		inline Size arraySizeFor(Size capacity) const {
+			Size wanted = (Size)((F32)capacity / m_loadFactor);
+			if (wanted <= capacity) {
+				wanted = capacity + 1;
+			}
+			return roundUpToPowerOfTwo(wanted);
+		}
+
+		template <typename Q>
+		inline Size findIndex(const Q& key) const {
+			if (m_numEntries == 0) {
+				return m_arraySize;
+			}
+			Size idx = (Size)m_hash(key) & m_mask;
+			/* An entry nearer its bucket than the key would be means the key is not here. */
+			for (U32 distance = 1; m_pDistances[idx] >= distance; distance++) {
+				if (m_pDistances[idx] == distance && m_equal(m_pKeys[idx], key)) {
+					return idx;
+				}
+				idx = (idx + 1) & m_mask;
+			}
+			return m_arraySize;
+		}
+
+		/**
+		 * Place a key that is not in the map, taking the bucket of any entry farther from
+		 * its bucket than the key would be.  If an entry gets too far from its bucket it
+		 * is left in key and value, and false returned.
+		 */
+		Boolean place(K& key, V& value) {
+			Size idx = (Size)m_hash(key) & m_mask;
+			U32 distance = 1;
+			while (m_pDistances[idx] != 0) {
+				if (m_pDistances[idx] < distance) {
+					/* Robin Hood, the entry nearer its bucket moves on instead. */
+					U8 movedDistance = m_pDistances[idx];
+					K movedKey = m_pKeys[idx];
+					V movedValue = m_pValues[idx];
+					m_pDistances[idx] = (U8)distance;
+					m_pKeys[idx] = key;
+					m_pValues[idx] = value;
+					distance = movedDistance;
+					key = movedKey;
+					value = movedValue;
+				}
+				idx = (idx + 1) & m_mask;
+				if (++distance >= kMaxDistance) {
+					return false;
+				}
+			}
+			m_pDistances[idx] = (U8)distance;
+			m_pKeys[idx] = key;
+			m_pValues[idx] = value;
+			m_numEntries++;
+			return true;
+		}
+
+		/**
+		 * Empty a bucket, so the key and value it held are let go of now.
+		 */
+		inline void emptySlot(Size idx) {
+			m_pDistances[idx] = 0;
+			m_pKeys[idx] = K();
+			m_pValues[idx] = V();
+		}
+
+		/**
+		 * Create a set of arrays, leaving the map alone.  False if any could not be
+		 * allocated, then none are.
+		 */
+		Boolean allocateArrays(Size arraySize, U8*& distances, K*& keys, V*& values) {
+			distances = createArray<U8>(m_pAllocator, arraySize);
+			keys = distances ? createArray<K>(m_pAllocator, arraySize) : NIL;
+			values = keys ? createArray<V>(m_pAllocator, arraySize) : NIL;
+			if (!values) {
+				DERR("Cannot allocate HashMap arrays of length " << arraySize << "!");
+				freeArrays(distances, keys, values, arraySize);
+				return false;
+			}
+			memset(distances, 0, sizeof(U8)*arraySize);
+			return true;
+		}
+
+		void freeArrays(U8* distances, K* keys, V* values, Size arraySize) {
+			if (distances) {
+				destroyArray(m_pAllocator, distances, arraySize);
+			}
+			if (keys) {
+				destroyArray(m_pAllocator, keys, arraySize);
+			}
+			if (values) {
+				destroyArray(m_pAllocator, values, arraySize);
+			}
+		}
+
+		/**
+		 * Make the map use a set of arrays holding numEntries entries.
+		 */
+		void setArrays(U8* distances, K* keys, V* values, Size arraySize, Size numEntries) {
+			m_pDistances = distances;
+			m_pKeys = keys;
+			m_pValues = values;
+			m_arraySize = arraySize;
+			m_mask = arraySize - 1;
+			m_capacity = (Size)((F32)arraySize * m_loadFactor);
+			if (m_capacity >= arraySize) {
+				m_capacity = arraySize - 1;
+			}
+			m_numEntries = numEntries;
+		}
+
+		void deleteArrays() {
+			if (m_pValues) {
+				freeArrays(m_pDistances, m_pKeys, m_pValues, m_arraySize);
+				m_pDistances = NIL;
+				m_pKeys = NIL;
+				m_pValues = NIL;
+			}
+			m_arraySize = 0;
+			m_mask = 0;
+			m_capacity = 0;
+			m_numEntries = 0;
+		}
+
+		/**
+		 * Move the entries into new arrays of the specified length.  The old arrays are
+		 * kept until the entries are all moved, so the map is unchanged if it fails.
+		 */
+		Boolean resizeArrays(Size arraySize) {
+			U8* oldDistances = m_pDistances;
+			K* oldKeys = m_pKeys;
+			V* oldValues = m_pValues;
+			Size oldArraySize = m_arraySize;
+			Size oldNumEntries = m_numEntries;
+
+			/* Only a terrible Hash pushes an entry too far, then keep doubling until it fits. */
+			for (Boolean placed = false; !placed; arraySize <<= 1) {
+				U8* distances;
+				K* keys;
+				V* values;
+				if (!allocateArrays(arraySize, distances, keys, values)) {
+					return false;
+				}
+				setArrays(distances, keys, values, arraySize, 0);
+				placed = true;
+				for (Size i = 0; i < oldArraySize && placed; i++) {
+					if (oldDistances[i] != 0) {
+						K key = oldKeys[i];
+						V value = oldValues[i];
+						placed = place(key, value);
+					}
+				}
+				if (!placed) {
+					freeArrays(distances, keys, values, arraySize);
+					setArrays(oldDistances, oldKeys, oldValues, oldArraySize, oldNumEntries);
+				}
+			}
+
+			if (oldValues) {
+				freeArrays(oldDistances, oldKeys, oldValues, oldArraySize);
+			}
+			return true;
+		}
+
+		/**
+		 * Replace the entries with copies of those in src, keeping the old ones if the
+		 * arrays cannot be allocated.
+		 */
+		Boolean copyFrom(const HashMap& src) {
+			if (!src.m_pValues) {
+				deleteArrays();
+				return true;
+			}
+			U8* distances;
+			K* keys;
+			V* values;
+			if (!allocateArrays(src.m_arraySize, distances, keys, values)) {
+				return false;
+			}
+			memcpy(distances, src.m_pDistances, sizeof(U8)*src.m_arraySize);
+			for (Size i = 0; i < src.m_arraySize; i++) {
+				if (distances[i] != 0) {
+					keys[i] = src.m_pKeys[i];
+					values[i] = src.m_pValues[i];
+				}
+			}
+			deleteArrays();
+			setArrays(distances, keys, values, src.m_arraySize, src.m_numEntries);
+			return true;
+		}
+
+		Size					m_capacity;		/**< The number of entries before the map grows */
+		Size					m_arraySize;	/**< A power of two */
+		Size					m_mask;			/**< m_arraySize - 1 */
+		F32					m_loadFactor;
+		Size					m_numEntries;
+		U8*					m_pDistances;	/**< 1 + how far each entry is from its bucket, 0 if empty */
+		K*						m_pKeys;
+		V*						m_pValues;
+		MemoryAllocator*	m_pAllocator;	/**< Where the arrays come from (NIL for new[]) */
+		Hash					m_hash;
+		Eq						m_equal;
 	};
 
+	template <typename K, typename V, typename Hash, typename Eq>
+	const F32 HashMap<K, V, Hash, Eq>::kDefaultLoadFactor = 0.8f;
+
 } // namespace Cat
 
 #endif // CAT_CORE_UTIL_HASHMAP_H
-
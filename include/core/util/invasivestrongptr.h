@@ -23,6 +23,11 @@ namespace Cat {
 	/**
 	 * @class InvasiveStrongPtr invasivestrongptr.h "core/util/invasivestrongptr.h"
 	 * @brief A strong reference counting safe pointer.
+	 *
+	 * The pointed to class keeps an AtomicI32 count, retain() can increment it with
+	 * kMORelaxed since a new reference is always made from one already held, and
+	 * release() decrements it with kMOAcqRel so the owner deleting the object sees
+	 * every write the other owners made.
 	 * 
 	 * @author Catlin Zilinski
 	 * @version 1
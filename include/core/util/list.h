@@ -11,7 +11,7 @@
  * @date Nov 10, 2013
  */
 #include <cstring>
-#include "core/corelib.h"
+#include "core/memory/stlallocator.h"
 
 namespace Cat {
 
@@ -31,6 +31,9 @@ namespace Cat {
 	 * @class List list.h "core/util/list.h"
 	 * @brief A simple LinkedList list implementation.
 	 *
+	 * The List can be given a MemoryAllocator to get its nodes from instead of new,
+	 * e.g., a PoolMemoryAllocator with blocks of sizeof(cc_ListNode<T>).
+	 *
 	 * @author Catlin Zilinski
 	 * @version 1
 	 * @since Nov 10, 2013
@@ -46,8 +49,9 @@ namespace Cat {
 		/**
 		 * @brief Create an empty list.
 		 * @param nullValue The value of NIL for the specific element type.
+		 * @param allocator The MemoryAllocator to use for the nodes, or NIL to use new.
 		 */
-		List(const T& nullValue);
+		List(const T& nullValue, MemoryAllocator* allocator = NIL);
 
 
 		/**
@@ -71,8 +75,9 @@ namespace Cat {
 		/**
 		 * @brief Append an element onto the end of the list.
 		 * @param item The element to append to the list.
+		 * @return False if the node could not be allocated.
 		 */
-		inline void append(const T& item);
+		inline Boolean append(const T& item);
 
 		/**
 		 * @brief Get the list element at the specified index.
@@ -82,6 +87,12 @@ namespace Cat {
 		T& at(Size idx);
 		const T& at(Size idx) const;
 
+		/**
+		 * @brief Get the MemoryAllocator the List gets its nodes from.
+		 * @return The MemoryAllocator, or NIL if it uses new.
+		 */
+		inline MemoryAllocator* allocator() const { return m_pAllocator; }
+
 		/**
 		 * @brief Remove all elements from the list.
 		 *
@@ -161,8 +172,9 @@ namespace Cat {
 		 * cause I'm lazy and havn't implemented one yet.
 		 *
 		 * @param item The element to insert into the list.
+		 * @return False if the node could not be allocated.
 		 */
-		inline void insert(const T& item);
+		inline Boolean insert(const T& item);
 
 		/**
 		 * @brief Test to see if the list is empty or not.
@@ -180,8 +192,9 @@ namespace Cat {
 		/**
 		 * @brief Prepends an item to the front of the list.
 		 * @param item The item to prepend.
+		 * @return False if the node could not be allocated.
 		 */
-		inline void prepend(const T& item);
+		inline Boolean prepend(const T& item);
 
 		/**
 		 * @brief Remove the specified element from the list.
@@ -241,6 +254,13 @@ namespace Cat {
 		 */
 		inline const T& getNullValue() const;
 
+		/**
+		 * @brief Set the MemoryAllocator to get the nodes from.
+		 * Can only be called while the List is empty.
+		 * @param allocator The MemoryAllocator to use, or NIL to use new.
+		 */
+		void setAllocator(MemoryAllocator* allocator);
+
 		class Iterator { 
 		  public:
 			Iterator() : m_pNode(NIL) {}
@@ -279,27 +299,39 @@ namespace Cat {
 		inline Iterator end() { return Iterator(m_root.m_pPrev, &m_root); }	
 
 	  private:
+		inline cc_ListNode<T>* createNode(const T& item, cc_ListNode<T>* prev, cc_ListNode<T>* next) {
+			if (m_pAllocator) {
+				cc_ListNode<T>* node = new (*m_pAllocator, kContainerAlignment) cc_ListNode<T>(item, prev, next);
+				D_CONDERR(!node, "Cannot allocate a List node, the MemoryAllocator is out of memory!");
+				return node;
+			}
+			return new cc_ListNode<T>(item, prev, next);
+		}
 		inline void removeNode(cc_ListNode<T>* node);
 
 		Size				m_length;		/**< The number of elements in the List */
 		cc_ListNode<T>	m_root;			
+		MemoryAllocator*	m_pAllocator;	/**< Where the nodes come from (NIL for new) */
 	};
 
 	template <typename T> List<T>::List() {
 		m_root.m_pNext = m_root.m_pPrev = &m_root;
 		m_length = 0;	
+		m_pAllocator = NIL;
 	}
 
-	template <typename T> List<T>::List(const T& nullValue) {
+	template <typename T> List<T>::List(const T& nullValue, MemoryAllocator* allocator) {
 		m_root.m_pNext = m_root.m_pPrev = &m_root;
 		m_root.m_data = nullValue;
 		m_length = 0;	
+		m_pAllocator = allocator;
 	}
 
 
 	template <typename T> List<T>::List(const List<T>& src) {
 		m_root.m_pNext = m_root.m_pPrev = &m_root;
 		m_length = 0;	
+		m_pAllocator = src.m_pAllocator;
 
 		m_root.m_data = src.m_root.m_data;
 		cc_ListNode<T>* ptr = src.m_root.m_pNext;
@@ -324,10 +356,15 @@ namespace Cat {
 		return *this;
 	}
 
-	template <typename T> inline void List<T>::append(const T& item) {
-		m_root.m_pPrev->m_pNext = new cc_ListNode<T>(item, m_root.m_pPrev, &m_root);
-		m_root.m_pPrev = m_root.m_pPrev->m_pNext;
+	template <typename T> inline Boolean List<T>::append(const T& item) {
+		cc_ListNode<T>* node = createNode(item, m_root.m_pPrev, &m_root);
+		if (!node) {
+			return false;
+		}
+		m_root.m_pPrev->m_pNext = node;
+		m_root.m_pPrev = node;
 		++m_length;
+		return true;
 	}
 
 	template <typename T> T& List<T>::at(Size idx) {
@@ -350,7 +387,7 @@ namespace Cat {
 		cc_ListNode<T>* ptr = m_root.m_pNext;
 		while (ptr->m_data != m_root.m_data) {
 			m_root.m_pNext = ptr->m_pNext;
-			delete ptr;
+			destroyObject(m_pAllocator, ptr);
 			ptr = m_root.m_pNext;
 		}
 		m_root.m_pNext = m_root.m_pPrev = &m_root;
@@ -373,7 +410,7 @@ namespace Cat {
 		while (ptr->m_data != m_root.m_data) {
 			m_root.m_pNext = ptr->m_pNext;
 			delete ptr->m_data;
-			delete ptr;
+			destroyObject(m_pAllocator, ptr);
 			ptr = m_root.m_pNext;
 		}
 		m_root.m_pNext = m_root.m_pPrev = &m_root;
@@ -441,8 +478,8 @@ namespace Cat {
 		return m_root.m_data;
 	}
 
-	template <typename T> inline void List<T>::insert(const T& item) {
-		append(item);	
+	template <typename T> inline Boolean List<T>::insert(const T& item) {
+		return append(item);	
 	}
 
 	template <typename T> inline Boolean List<T>::isEmpty() const {
@@ -457,10 +494,15 @@ namespace Cat {
 		return m_root.m_pPrev->m_data;
 	}
 
-	template <typename T> inline void List<T>::prepend(const T& item) {
-		m_root.m_pNext->m_pPrev = new cc_ListNode<T>(item, &m_root, m_root.m_pNext);
-		m_root.m_pNext = m_root.m_pNext->m_pPrev;
+	template <typename T> inline Boolean List<T>::prepend(const T& item) {
+		cc_ListNode<T>* node = createNode(item, &m_root, m_root.m_pNext);
+		if (!node) {
+			return false;
+		}
+		m_root.m_pNext->m_pPrev = node;
+		m_root.m_pNext = node;
 		++m_length;
+		return true;
 	}
 
 	template <typename T> Boolean List<T>::remove(const T& item) {
@@ -546,7 +588,15 @@ namespace Cat {
 #endif
 		node->m_pNext->m_pPrev = node->m_pPrev;
 		node->m_pPrev->m_pNext = node->m_pNext;
-		delete node;
+		destroyObject(m_pAllocator, node);
+	}
+
+	template <typename T> void List<T>::setAllocator(MemoryAllocator* allocator) {
+		if (m_length == 0) {
+			m_pAllocator = allocator;
+		} else {
+			DWARN("Cannot set the MemoryAllocator of a List that is not empty.");
+		}
 	}
 
 
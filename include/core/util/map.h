@@ -12,12 +12,15 @@
 
 #include <cmath>
 #include "core/util/datanodepool.h"
+#include "core/memory/stlallocator.h"
 
 namespace Cat {	
 	/**
 	 * @class Map map.h "core/util/map.h"
 	 * @brief A hashmap using strings as keys hashed with a crc32 algorithm.
 	 *
+	 * The Map can be given a MemoryAllocator to get its buckets and nodes from instead of new.
+	 *
 	 * @author Catlin Zilinski
 	 * @version 1
 	 * @since Oct 21, 2013
@@ -45,16 +48,17 @@ namespace Cat {
 		 */
 		Map()
 			: m_pBuckets(NIL), m_capacity(0), m_numBuckets(0), m_pNodePool(NIL),
-			  m_numObjects(0), m_loadFactor(0.0f) {}		
+			  m_numObjects(0), m_loadFactor(0.0f), m_pAllocator(NIL) {}		
 
 		/**
 		 * @brief Creates an empty map with the specified capacity.
 		 * @param capacity The initial capacity of the hashmap.
 		 * @param nullValue The value of null for the Map types.
+		 * @param allocator The MemoryAllocator to use for the memory, or NIL to use new.
 		 */
-		Map(Size capacity, const T& nullValue)
+		Map(Size capacity, const T& nullValue, MemoryAllocator* allocator = NIL)
 			: m_pBuckets(NIL), m_capacity(capacity), m_numBuckets(0), m_pNodePool(NIL),
-			  m_nullValue(nullValue), m_numObjects(0), m_loadFactor(0.8f) {
+			  m_nullValue(nullValue), m_numObjects(0), m_loadFactor(0.8f), m_pAllocator(allocator) {
 			initMapWithCapacityAndLoadFactor(capacity, 0.8f, nullValue);
 		}		
 
@@ -63,10 +67,11 @@ namespace Cat {
 		 * @param capacity The initial capacity of the hashmap.
 		 * @param loadFactor The initial load factor for the hashmap.
 		 * @param nullValue The value of null for the Map types.
+		 * @param allocator The MemoryAllocator to use for the memory, or NIL to use new.
 		 */
-		Map(Size capacity, F32 loadFactor, const T& nullValue)
+		Map(Size capacity, F32 loadFactor, const T& nullValue, MemoryAllocator* allocator = NIL)
 			: m_pBuckets(NIL), m_capacity(capacity), m_numBuckets(0), m_pNodePool(NIL),
-			  m_nullValue(nullValue), m_numObjects(0), m_loadFactor(loadFactor) {
+			  m_nullValue(nullValue), m_numObjects(0), m_loadFactor(loadFactor), m_pAllocator(allocator) {
 			initMapWithCapacityAndLoadFactor(capacity, loadFactor, nullValue);
 		}		
 
@@ -119,6 +124,25 @@ namespace Cat {
 		 */
 		inline F32 loadFactor() const {  return m_loadFactor; }
 
+		/**
+		 * @brief Get the MemoryAllocator the Map gets its memory from.
+		 * @return The MemoryAllocator, or NIL if it uses new.
+		 */
+		inline MemoryAllocator* allocator() const { return m_pAllocator; }
+
+		/**
+		 * @brief Set the MemoryAllocator to get the memory from.
+		 * Can only be called before the Map is initialised.
+		 * @param allocator The MemoryAllocator to use, or NIL to use new.
+		 */
+		inline void setAllocator(MemoryAllocator* allocator) {
+			if (!m_pBuckets) {
+				m_pAllocator = allocator;
+			} else {
+				DERR("Cannot set the MemoryAllocator of an initialized Map!");
+			}
+		}
+
 		/**
 		 * @brief Access an element of the map via its crc32 object id.
 		 * @param key The name of the element (string).
@@ -161,7 +185,7 @@ namespace Cat {
 		 * @param value The value to insert into the map.
 		 * @return true if the object was inserted.
 		 */
-		inline void insert(OID key, const T& value);
+		inline Boolean insert(OID key, const T& value);
 
 		/**
 		 * @brief inserts the object in the map.
@@ -169,7 +193,7 @@ namespace Cat {
 		 * @param value The value to insert into the map.
 		 * @return true if the object was inserted.
 		 */
-		inline void insert(const Char* key, const T& value) {
+		inline Boolean insert(const Char* key, const T& value) {
 			return insert(crc32(key), value);
 		}		
 
@@ -290,9 +314,10 @@ namespace Cat {
 		 * @brief Reserves the specified capacity in the Map.  
 		 * If capacity < current capacity, nothing happens.
 		 * @param capacity The new capacity to have in the map.
+		 * @return False if the new storage could not be allocated, the map is unchanged then.
 		 */
-		inline void reserve(Size capacity) {
-			resizeMapToCapacity(capacity, m_loadFactor);
+		inline Boolean reserve(Size capacity) {
+			return resizeMapToCapacity(capacity, m_loadFactor);
 		}
 
 		/**
@@ -359,8 +384,9 @@ namespace Cat {
 		 * @param capacity The initial capacity.
 		 * @param loadFactor The initial load factor to use.
 		 * @param nullValue The null value for the types in the Map.
+		 * @return False if the storage could not be allocated, the map stays empty then.
 		 */
-		void initMapWithCapacityAndLoadFactor(Size capacity, F32 loadFactor,
+		Boolean initMapWithCapacityAndLoadFactor(Size capacity, F32 loadFactor,
 														  const T& nullValue);
 
 	  private:
@@ -404,8 +430,24 @@ namespace Cat {
 		 * @brief Resize the map to the specified capacity.
 		 * @param capacity The capacity the Map should have.
 		 * @param loadFactor The loadFactor for the map.
+		 * @return False if the new storage could not be allocated, the map is unchanged then.
 		 */
-		void resizeMapToCapacity(Size capacity, F32 loadFactor);
+		Boolean resizeMapToCapacity(Size capacity, F32 loadFactor);
+
+		inline DataNodePool<Cell>* createNodePool(Size capacity) {
+			DataNodePool<Cell>* pool = NIL;
+			if (m_pAllocator) {
+				pool = new (*m_pAllocator, kContainerAlignment) DataNodePool<Cell>(capacity, m_pAllocator);
+			} else {
+				pool = new DataNodePool<Cell>(capacity);
+			}
+			/* The pool is left empty if its nodes could not be allocated. */
+			if (pool && pool->blockSize() != capacity) {
+				destroyObject(m_pAllocator, pool);
+				pool = NIL;
+			}
+			return pool;
+		}
 
 		DataNode<Cell>*		   m_pBuckets;
 		Size				m_capacity;	
@@ -414,17 +456,18 @@ namespace Cat {
 		T              m_nullValue;		
 		Size				m_numObjects;
 		F32				m_loadFactor;
+		MemoryAllocator*	m_pAllocator;
 											
 	};
 
 	template <class T>
 	Map<T>::~Map() {
 		if (m_pBuckets) {
-			delete[] m_pBuckets;
+			destroyArray(m_pAllocator, m_pBuckets, m_numBuckets);
 			m_pBuckets = NIL;
 		}
 		if (m_pNodePool) {
-			delete m_pNodePool;
+			destroyObject(m_pAllocator, m_pNodePool);
 			m_pNodePool = NIL;
 		}
 		m_capacity = m_numBuckets = m_numObjects = 0;		
@@ -466,7 +509,11 @@ namespace Cat {
 	}
 	
 	template <class T>
-	inline void Map<T>::insert(OID key, const T& value) {
+	inline Boolean Map<T>::insert(OID key, const T& value) {
+		if (!m_pNodePool) {
+			DERR("Cannot insert key " << key << " into a Map with no storage!");
+			return false;
+		}
 #if defined (DEBUG)
 		if (m_pBuckets[key % m_numBuckets].next != &(m_pBuckets[key % m_numBuckets])) {
 			DMSG("Collision inserting key: "
@@ -483,10 +530,15 @@ namespace Cat {
 				  << m_capacity << ", numObjects: "
 				  << m_numObjects << "]");
 			resizeMapToCapacity(m_capacity*2, m_loadFactor);		
+			if (m_numObjects >= m_capacity) {
+				DERR("Failed to insert key " << key << ", the Map could not grow!");
+				return false;
+			}
 		}
 
 		m_pNodePool->alloc(&(m_pBuckets[key % m_numBuckets]), Cell(key, value));
 		m_numObjects++;
+		return true;
 	}
 
 	template <class T>
@@ -559,42 +611,63 @@ namespace Cat {
 	}	
 
 	template <class T>
-	void Map<T>::initMapWithCapacityAndLoadFactor(Size capacity, F32 loadFactor,
-																 const T& nullValue) {
+	Boolean Map<T>::initMapWithCapacityAndLoadFactor(Size capacity, F32 loadFactor,
+																	 const T& nullValue) {
 		if (!m_pBuckets || m_pNodePool) {			
+			Size numBuckets = ceil((F32)capacity / loadFactor);
+			DataNode<Cell>* buckets = createArray<DataNode<Cell> >(m_pAllocator, numBuckets);
+			DataNodePool<Cell>* pool = buckets ? createNodePool(capacity) : NIL;
+			if (!pool) {
+				DERR("Failed to allocate a Map with capacity " << capacity << "!");
+				if (buckets) {
+					destroyArray(m_pAllocator, buckets, numBuckets);
+				}
+				m_capacity = m_numBuckets = m_numObjects = 0;
+				return false;
+			}
 			m_capacity = capacity;
 			m_loadFactor = loadFactor;
 			m_numObjects = 0;			
-			m_numBuckets = ceil((F32)capacity / loadFactor);
-			m_pBuckets = new DataNode<Cell>[m_numBuckets];			
-			m_pNodePool = new DataNodePool<Cell>(m_capacity);
+			m_numBuckets = numBuckets;
+			m_pBuckets = buckets;
+			m_pNodePool = pool;
 			m_nullValue = nullValue;			
+			return true;
 		}
 		else {
 			DERR("Cannot call initMapWithCapacityAndLoadFactor on initialized Map!");
+			return false;
 		}
 	}
 
 	template <class T>
-	void Map<T>::resizeMapToCapacity(Size capacity, F32 loadFactor) {
+	Boolean Map<T>::resizeMapToCapacity(Size capacity, F32 loadFactor) {
 		// If the capacity is lower, we don't do anything.
 		if (capacity > m_capacity && ceil((F32)capacity / loadFactor) > m_numBuckets) {
-			// Store the old list of buckets.			
+			// Create the new buckets and node store, keep the old ones if we cannot.
+			Size numBuckets = ceil((F32)capacity / loadFactor);
+			DataNode<Cell>* buckets = createArray<DataNode<Cell> >(m_pAllocator, numBuckets);
+			DataNodePool<Cell>* pool = buckets ? createNodePool(capacity) : NIL;
+			if (!pool) {
+				DERR("Failed to resize the Map to capacity " << capacity << "!");
+				if (buckets) {
+					destroyArray(m_pAllocator, buckets, numBuckets);
+				}
+				return false;
+			}
+
+			// Store the old list of buckets and node store.
 			DataNode<Cell>* oldBuckets = m_pBuckets;
 			Size oldNumBuckets = m_numBuckets;
+			DataNodePool<Cell>* oldPool = m_pNodePool;
 
-			// Create the new list of buckets.
-			m_numBuckets = ceil((F32)capacity / loadFactor);
-			m_pBuckets = new DataNode<Cell>[m_numBuckets];
+			m_numBuckets = numBuckets;
+			m_pBuckets = buckets;
+			m_pNodePool = pool;
 			m_capacity = capacity;
 			m_loadFactor = loadFactor;
 			m_numObjects = 0;
 
-			// Store old PtrNodeStore.
-			DataNodePool<Cell>* oldPool = m_pNodePool;
-			
-			// Create new node store
-			m_pNodePool = new DataNodePool<Cell>(m_capacity);
 			// rehash
 			DataNode<Cell>* node;
 			for (Size i = 0; i < oldNumBuckets; i++) {
@@ -606,11 +679,12 @@ namespace Cat {
 			}
 			
 			// Delete the old buckets and node store.
-			delete[] oldBuckets;
-			delete oldPool;	
+			destroyArray(m_pAllocator, oldBuckets, oldNumBuckets);
+			destroyObject(m_pAllocator, oldPool);	
+			return true;
 		} 
 		else {
-			return;
+			return true;
 		}
 	}
 
@@ -10,13 +10,15 @@
  * @date Apr 10, 2014
  */
 
-#include "core/corelib.h"
+#include "core/memory/stlallocator.h"
 
 namespace Cat {	
 	/**
 	 * @class Stack stack.h "core/util/stack.h"
 	 * @brief A simple Stack Data structure class.
 	 *
+	 * The Stack can be given a MemoryAllocator to get its memory from instead of new[].
+	 *
 	 * @author Catlin Zilinski
 	 * @version 1
 	 * @since Apr 10, 2014
@@ -29,14 +31,15 @@ namespace Cat {
 		 * @brief Creates an empty null stack.
 		 */
 		Stack()
-			: m_pStack(NIL), m_size(0), m_capacity(0) {}		
+			: m_pStack(NIL), m_size(0), m_capacity(0), m_pAllocator(NIL) {}		
 
 		/**
 		 * @brief Creates an empty stack with the specified capacity.
 		 * @param capacity The initial capacity of the stack.
+		 * @param allocator The MemoryAllocator to use for the memory, or NIL to use new[].
 		 */
-		Stack(Size capacity)
-			: m_pStack(NIL), m_size(0), m_capacity(0) {
+		Stack(Size capacity, MemoryAllocator* allocator = NIL)
+			: m_pStack(NIL), m_size(0), m_capacity(0), m_pAllocator(allocator) {
 			initStackWithCapacity(capacity);
 		}
 
@@ -58,6 +61,12 @@ namespace Cat {
 		 */
 		Stack<T>& operator=(const Stack<T>& src);
 
+		/**
+		 * @brief Get the MemoryAllocator the Stack gets its memory from.
+		 * @return The MemoryAllocator, or NIL if it uses new[].
+		 */
+		inline MemoryAllocator* allocator() const { return m_pAllocator; }
+
 		/**
 		 * @brief Return the capacity of the stack before need to resize.
 		 * @return The capacity of the stack.
@@ -164,7 +173,7 @@ namespace Cat {
 		 * @param value The value to push onto the stack.
 		 * @return true if the object was pushed.
 		 */
-		inline void push(const T& value);
+		inline Boolean push(const T& value);
 
 		/**
 		 * @brief Remove an item from the top of the stack.
@@ -206,6 +215,13 @@ namespace Cat {
 			resizeStackToCapacity(capacity);
 		}
 
+		/**
+		 * @brief Set the MemoryAllocator to get the memory from.
+		 * Can only be called before the Stack is initialised.
+		 * @param allocator The MemoryAllocator to use, or NIL to use new[].
+		 */
+		void setAllocator(MemoryAllocator* allocator);
+
 		/**
 		 * @brief Return the number of elements in the stack.
 		 * @return The number of elements in the stack.
@@ -226,34 +242,39 @@ namespace Cat {
 		/**
 		 * @brief Resize the stack to the specified capacity.
 		 * @param capacity The capacity the Stack should have.
+		 * @return False if the new array could not be allocated, the Stack is unchanged.
 		 */
-		void resizeStackToCapacity(Size capacity);
+		Boolean resizeStackToCapacity(Size capacity);
 
 		T* m_pStack;
 		Size m_size;
 		Size m_capacity;		
+		MemoryAllocator* m_pAllocator;
 											
 	};
 
 	template <class T>
 	Stack<T>::Stack(const Stack<T>& src) {
+		m_pAllocator = src.m_pAllocator;
+		m_pStack = NIL;
+		m_size = m_capacity = 0;
 		if (src.m_capacity > 0) {
-			m_pStack = new T[src.m_capacity];
+			m_pStack = createArray<T>(m_pAllocator, src.m_capacity);
+			if (!m_pStack) {
+				return;
+			}
 			for (Size i = 0; i < src.m_size; i++) {
 				m_pStack[i] = src.m_pStack[i];
 			}			
+			m_size = src.m_size;
+			m_capacity = src.m_capacity;
 		}
-		else {
-			m_pStack = NIL;
-		}
-		m_size = src.m_size;
-		m_capacity = src.m_capacity;
 	}
 	
 	template <class T>
 	Stack<T>::~Stack() {
 		if (m_pStack) {
-			delete[] m_pStack;
+			destroyArray(m_pAllocator, m_pStack, m_capacity);
 			m_pStack = NIL;
 		}
 		m_capacity = m_size = 0;		
@@ -261,18 +282,24 @@ namespace Cat {
 
 	template <class T>
 	Stack<T>& Stack<T>::operator=(const Stack<T>& src) {
-		if (m_pStack) {
-			delete[] m_pStack;
-		}		
+		if (this == &src) {
+			return *this;
+		}
+		T* newStack = NIL;
 		if (src.m_capacity > 0) {
-			m_pStack = new T[src.m_capacity];
+			newStack = createArray<T>(m_pAllocator, src.m_capacity);
+			if (!newStack) {
+				DERR("Cannot copy the Stack, keeping the old contents!");
+				return *this;
+			}
 			for (Size i = 0; i < src.m_size; i++) {
-				m_pStack[i] = src.m_pStack[i];
+				newStack[i] = src.m_pStack[i];
 			}			
 		}
-		else {
-			m_pStack = NIL;
-		}
+		if (m_pStack) {
+			destroyArray(m_pAllocator, m_pStack, m_capacity);
+		}		
+		m_pStack = newStack;
 		m_size = src.m_size;
 		m_capacity = src.m_capacity;
 		return *this;		
@@ -296,23 +323,26 @@ namespace Cat {
 	}
 	
 	template <class T>
-	inline void Stack<T>::push(const T& value) {
+	inline Boolean Stack<T>::push(const T& value) {
 		if (m_size >= m_capacity) {
 			DMSG("Resizing stack automatically. [capacity: "
 				  << m_capacity << ", Size: "
 				  << m_size << "]");
-			resizeStackToCapacity(m_capacity*2);		
+			if (!resizeStackToCapacity(m_capacity*2)) {
+				return false;
+			}
 		}
 		m_pStack[m_size] = value;
 		++m_size;				
+		return true;
 	}
 
 	template <class T>
 	void Stack<T>::initStackWithCapacity(Size capacity) {
 		if (!m_pStack) {
-			m_capacity = capacity;
 			m_size = 0;
-			m_pStack = new T[capacity];
+			m_pStack = createArray<T>(m_pAllocator, capacity);
+			m_capacity = m_pStack ? capacity : 0;
 		}
 		else {
 			DERR("Cannot call initStackWithCapacity on initialized Stack!");
@@ -320,29 +350,37 @@ namespace Cat {
 	}
 
 	template <class T>
-	void Stack<T>::resizeStackToCapacity(Size capacity) {
+	void Stack<T>::setAllocator(MemoryAllocator* allocator) {
+		if (!m_pStack) {
+			m_pAllocator = allocator;
+		}
+		else {
+			DERR("Cannot set the MemoryAllocator of an initialized Stack!");
+		}
+	}
+
+	template <class T>
+	Boolean Stack<T>::resizeStackToCapacity(Size capacity) {
 		// If the capacity is lower, we don't do anything.
 		if (capacity > m_capacity) {
-			// Store the old stack.
-			T* oldStack = m_pStack;					
-			Size oldSize = m_size;
-
-			// Create the new stack.
-			m_capacity = capacity;
-			m_size = 0;
-			m_pStack = new T[capacity];
-
-			for (Size i = 0; i < oldSize; ++i) {
-				m_pStack[i] = oldStack[i];
+			// Create the new stack, keeping the old one if we cannot.
+			T* newStack = createArray<T>(m_pAllocator, capacity);
+			if (!newStack) {
+				DERR("Cannot resize the Stack to " << capacity << ", keeping the old stack!");
+				return false;
+			}
+			for (Size i = 0; i < m_size; ++i) {
+				newStack[i] = m_pStack[i];
 			}
-			m_size = oldSize;			
 			
-			// Delete the old buckets and node store.
-			delete[] oldStack;
+			// Delete the old stack.
+			if (m_pStack) {
+				destroyArray(m_pAllocator, m_pStack, m_capacity);
+			}
+			m_pStack = newStack;
+			m_capacity = capacity;
 		} 
-		else {
-			return;
-		}
+		return true;
 	}
 
 } //namespace
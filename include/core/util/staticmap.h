@@ -6,8 +6,8 @@
  * @file staticmap.h
  * @brief Defines a hashmap based on using crc32 to hash strings to 32 bit integers.
  *
- * This hashmap uses string keys to hash the locations, and assumes that after 
- * the map is built, it is never changed.
+ * This hashmap uses string keys to hash the locations, and is meant to be built
+ * once and then mostly read.
  *
  * @author Catlin Zilinski
  * @date Feb 25, 2014
@@ -23,51 +23,53 @@ namespace Cat {
 	 * @class StaticMap staticmap.h "core/util/staticmap.h"
 	 * @brief A hashmap using strings as keys hashed with a crc32 algorithm.
 	 *
-	 * This hashmap uses string keys to hash the locations, and assumes that after 
-	 * the map is built, it is never changed.
+	 * The map is an open addressing hash table with Robin Hood probing.  The keys
+	 * are CRC32 values, so the low bits of the key are used as the hash, and the
+	 * array is a power of two long so the bucket is found with a mask.  Each entry
+	 * keeps how far it is from its bucket in a byte array of its own, so a lookup
+	 * only compares the keys that can match and stops at the first entry closer to
+	 * its bucket than the key would be.  Removed entries are filled by shifting the
+	 * entries after them back, so the map never fills up with tombstones.
+	 *
+	 * The array is walked with arrayLength(), hasEntryAt(), keyAt() and valueAt().
 	 *
 	 * @author Catlin Zilinski
-	 * @version 1
+	 * @version 2
 	 * @since Feb 25, 2014
 	 */
 	template <class T>
 	class StaticMap {
 	  public:
-
-		class Cell {
-		  public:
-			OID key;
-			T value;
-			Cell() : key(0) {}			
-			Cell(OID pkey, T pvalue) : key(pkey), value(pvalue) {}			
-		};		
 		/**
 		 * @brief Creates an empty map with no array.
 		 */
 		StaticMap() :
-			m_capacity(0), m_arraySize(0), m_loadFactor(0.0f), m_pEntries(NIL), m_numEntries(0) {}
-		
+			m_capacity(0), m_arraySize(0), m_mask(0), m_loadFactor(0.0f), m_pDistances(NIL),
+			m_pKeys(NIL), m_pValues(NIL), m_numEntries(0) {}
+
 
 		/**
 		 * @brief Creates an empty map with the specified capacity.
 		 * @param capacity The initial capacity of the hashmap.
 		 */
 		StaticMap(Size capacity, T nullValue) :
-			m_capacity(0), m_arraySize(0), m_loadFactor(0.0f), m_pEntries(NIL), m_numEntries(0), m_nullValue(nullValue) {
+			m_capacity(0), m_arraySize(0), m_mask(0), m_loadFactor(0.0f), m_pDistances(NIL),
+			m_pKeys(NIL), m_pValues(NIL), m_numEntries(0), m_nullValue(nullValue) {
 			createMapWithCapacity(capacity, 0.5);
 		}
-		
+
 		/**
 		 * @brief Creates an empty map with the specified capacity and load factor.
 		 * @param capacity The initial capacity of the hashmap.
 		 * @param loadFactor The initial load factor for the hashmap.
 		 */
 		StaticMap(Size capacity, F32 loadFactor, T nullValue)  :
-			m_capacity(0), m_arraySize(0), m_loadFactor(0.0f), m_pEntries(NIL), m_numEntries(0), m_nullValue(nullValue) {
+			m_capacity(0), m_arraySize(0), m_mask(0), m_loadFactor(0.0f), m_pDistances(NIL),
+			m_pKeys(NIL), m_pValues(NIL), m_numEntries(0), m_nullValue(nullValue) {
 			createMapWithCapacity(capacity, loadFactor);
 		}
 
-		
+
 		/**
 		 * @brief Copy constructor, creates copy of the map and all the data.
 		 * @param src The Map to copy from.
@@ -80,7 +82,7 @@ namespace Cat {
 		 * @param src The Map to copy from.
 		 * @return A reference to this map.
 		 */
-		StaticMap<T>& operator=(const StaticMap<T>& src);		
+		StaticMap<T>& operator=(const StaticMap<T>& src);
 
 		/**
 		 * @brief The destructor, empties the map of all the nodes.
@@ -88,16 +90,10 @@ namespace Cat {
 		~StaticMap();
 
 		/**
-		 * @brief Get the actual Cell array data.
-		 * @return The Cell Array data.
-		 */
-		inline Cell* arrayData() { return m_pEntries; }
-		
-		/**
-		 * @brief Return the actual array length.
+		 * @brief Return the actual array length, a power of two.
 		 * @return The actual storage array length.
 		 */
-		inline Size arrayLength() const { return m_arraySize; }		
+		inline Size arrayLength() const { return m_arraySize; }
 
 		/**
 		 * @brief Access an element of the map via its String key.
@@ -106,18 +102,21 @@ namespace Cat {
 		 */
 		inline T at(const Char* key) const {
 			return at(crc32(key));
-		}		
+		}
 
 		/**
 		 * @brief Access an element of the map via its crc32 object id.
 		 * @param key The name of the element (string).
 		 * @return The element or the null element.
 		 */
-		inline T at(OID key) const;
-		
+		inline T at(OID key) const {
+			Size idx = find(key);
+			return (idx < m_arraySize) ? m_pValues[idx] : m_nullValue;
+		}
+
 		/**
 		 * @brief Return the capacity of the map.
-		 * The capacity refers to the number of occupied buckets we can have 
+		 * The capacity refers to the number of occupied buckets we can have
 		 * before the map needs to be resized.
 		 * @return The capacity of the map.
 		 */
@@ -127,7 +126,7 @@ namespace Cat {
 		 * @brief Clear the map of all entries.
 		 * Removes all entries from the map.  Does not delete anything.
 		 */
-		void clear();		
+		void clear();
 
 		/**
 		 * @brief Tests to see if an object is the map.
@@ -136,37 +135,43 @@ namespace Cat {
 		 */
 		inline Boolean contains(const Char* key) const {
 			return contains(crc32(key));
-		}		
+		}
 
 		/**
 		 * @brief Tests to see if an object is in the map.
 		 * @param key The OID key value of the object.
 		 * @return true if the object is in the map.
 		 */
-		inline Boolean contains(OID key) const;
+		inline Boolean contains(OID key) const {
+			return find(key) < m_arraySize;
+		}
 
 		/**
 		 * @brief Assumes the types are pointers and deletes them all.
 		 */
 		void eraseAll();
 
+		/**
+		 * @brief Check if there is an entry at a place in the array.
+		 * @param idx The index into the array, less than arrayLength().
+		 * @return True if keyAt(idx) and valueAt(idx) are an entry of the map.
+		 */
+		inline Boolean hasEntryAt(Size idx) const { return m_pDistances[idx] != 0; }
+
 		/**
 		 * @brief Initialize a static map to the specified capacity.
 		 * @param capacity The capacity for the static map to have.
 		 */
 		void initWithCapacityAndLoadFactor(Size capacity, F32 loadFactor, T nullValue) {
-			m_capacity = m_arraySize = 0;						
-			if (m_pEntries) {
-				delete[] m_pEntries;
-				m_pEntries = NIL;
-			}
+			m_capacity = m_arraySize = 0;
+			deleteArrays();
 			m_numEntries = 0;
 			m_nullValue = nullValue;
 			createMapWithCapacity(capacity, loadFactor);
 		}
 
 		/**
-		 * @brief inserts the object in the map.
+		 * @brief inserts the object in the map, replacing the value of a key already in it.
 		 * @param key The Key of the key-value pair to insert into the map.
 		 * @param value The value to insert into the map.
 		 */
@@ -174,7 +179,7 @@ namespace Cat {
 		inline void insert(const Char* key, T value) {
 			insert(crc32(key), value);
 		}
-		
+
 		/**
 		 * @brief Test if the map is empty or not
 		 * @return true if the map is empty.
@@ -183,6 +188,13 @@ namespace Cat {
 			return m_numEntries == 0;
 		}
 
+		/**
+		 * @brief Get the key of the entry at a place in the array.
+		 * @param idx The index into the array, with hasEntryAt(idx) true.
+		 * @return The key of the entry.
+		 */
+		inline OID keyAt(Size idx) const { return m_pKeys[idx]; }
+
 		/**
 		 * @brief Returns the load factor for the map.
 		 * @return The load factor for the map.
@@ -190,20 +202,30 @@ namespace Cat {
 		inline F32 loadFactor() const {
 			return m_loadFactor;
 		}
-		
+
 		/**
 		 * @brief Get the Null value for this map.
 		 * @return The null value for this map.
 		 */
 		inline const T& nullValue() const { return m_nullValue; }
 
+		/**
+		 * @brief Remove an entry from the map.  Does not delete anything.
+		 * @param key The OID key of the entry.
+		 * @return True if the key was in the map.
+		 */
+		Boolean remove(OID key);
+		inline Boolean remove(const Char* key) {
+			return remove(crc32(key));
+		}
+
 		/**
 		 * @brief Return the number of elements in the map.
 		 * @return The number of elements in the map.
 		 */
 		inline Size size() const {
-			return m_numEntries;			
-		}		
+			return m_numEntries;
+		}
 
 		/**
 		 * @brief Return an array with all the values in it.
@@ -211,7 +233,24 @@ namespace Cat {
 		 */
 		T* toArray() const;
 
+		/**
+		 * @brief Get the value of the entry at a place in the array.
+		 * @param idx The index into the array, with hasEntryAt(idx) true.
+		 * @return The value of the entry.
+		 */
+		inline const T& valueAt(Size idx) const { return m_pValues[idx]; }
+		inline T& valueAt(Size idx) { return m_pValues[idx]; }
+
 	  private:
+		/** The farthest an entry can be from its bucket, the array grows before that. */
+		static const U8 kMaxDistance = 0xFF;
+
+		/**
+		 * @brief Allocate the arrays, with no entries.
+		 * @param arraySize The length of the arrays, a power of two.
+		 */
+		void allocateArrays(Size arraySize);
+
 		/**
 		 * @brief Create the initial map with the specified capacity.
 		 * @param capacity The initial capacity.
@@ -219,6 +258,54 @@ namespace Cat {
 		 */
 		void createMapWithCapacity(Size capacity, F32 loadFactor);
 
+		/**
+		 * @brief Delete the arrays.
+		 */
+		void deleteArrays();
+
+		/**
+		 * @brief Find the place of a key in the array.
+		 * @param key The key to find.
+		 * @return The index of the key, or arrayLength() if it is not in the map.
+		 */
+		inline Size find(OID key) const {
+			if (m_numEntries == 0) {
+				return m_arraySize;
+			}
+			Size idx = key & m_mask;
+			/* An entry nearer its bucket than the key would be means the key is not here. */
+			for (U32 distance = 1; m_pDistances[idx] >= distance; distance++) {
+				if (m_pDistances[idx] == distance && m_pKeys[idx] == key) {
+					return idx;
+				}
+				idx = (idx + 1) & m_mask;
+			}
+			return m_arraySize;
+		}
+
+		/**
+		 * @brief Place a key that is not in the map, taking the bucket of any entry
+		 * farther from its bucket than the key would be.
+		 * @param key The key, set to the key of the entry left over if it fails.
+		 * @param value The value, set to the value of the entry left over if it fails.
+		 * @return False if an entry got too far from its bucket and was not placed.
+		 */
+		Boolean place(OID& key, T& value);
+
+		/**
+		 * @brief Get the length of array for a capacity.
+		 * @param capacity The capacity.
+		 * @param loadFactor The load factor.
+		 * @return The power of two array length, with room for at least one empty bucket.
+		 */
+		static Size arraySizeFor(Size capacity, F32 loadFactor);
+
+		/**
+		 * @brief Rehash the entries into a new array.
+		 * @param arraySize The length of the new array, a power of two.
+		 */
+		void rehash(Size arraySize);
+
 		/**
 		 * @brief Resize the map to the specified capacity.
 		 * @param capacity The capacity the Map should have.
@@ -227,199 +314,267 @@ namespace Cat {
 		void resizeMapToCapacity(Size capacity, F32 loadFactor);
 
 		/**
-		 * @brief Fill the array with nullValues.
+		 * @brief Copy the entries of another map into freshly allocated arrays.
+		 * @param src The map to copy from.
 		 */
-		void fillWithNull() {
-			for (Size i = 0; i < m_arraySize; i++) {
-				m_pEntries[i] = typename StaticMap<T>::Cell(0, m_nullValue);
-			}
-		}
-		
-			
+		void copyFrom(const StaticMap<T>& src);
+
 		Size				m_capacity;    /**< The number of buckets in use before needing resizing */
-		Size           m_arraySize;		
+		Size           m_arraySize;	/**< A power of two */
+		Size				m_mask;			/**< m_arraySize - 1 */
 		F32				m_loadFactor;	/**< The percent of full buckets before resize */
-		Cell*		      m_pEntries; 	
+		U8*				m_pDistances;	/**< 1 + how far each entry is from its bucket, 0 if empty */
+		OID*				m_pKeys;
+		T*					m_pValues;
 		Size				m_numEntries;	/**< The actual number of entries */
-		T              m_nullValue;		
+		T              m_nullValue;
 
 	};
 
 	// ######## CONSTRUCTORS ################ //
 
 	template <class T>
-	StaticMap<T>::StaticMap(const StaticMap<T>& src) {
-		m_capacity = src.m_capacity;
-		m_arraySize = src.m_arraySize;
-		m_loadFactor = src.m_loadFactor;
-		m_pEntries = NIL;		
-		m_numEntries = src.m_numEntries;
-		m_nullValue = src.m_nullValue;
-		if (src.m_pEntries) {
-			m_pEntries = new Cell[m_arraySize];
-			memcpy(m_pEntries, src.m_pEntries, sizeof(Cell)*m_arraySize);
-		}
+	StaticMap<T>::StaticMap(const StaticMap<T>& src)
+		: m_pDistances(NIL), m_pKeys(NIL), m_pValues(NIL) {
+		copyFrom(src);
 	}
 
 	template <class T>
 	StaticMap<T>& StaticMap<T>::operator=(const StaticMap<T>& src) {
-		if (m_pEntries) {
-			delete[] m_pEntries;
-		}		
+		if (this != &src) {
+			deleteArrays();
+			copyFrom(src);
+		}
+		return *this;
+	}
+
+	template <class T>
+	StaticMap<T>::~StaticMap() {
+		deleteArrays();
+		m_numEntries = 0;
+		m_capacity = 0;
+		m_arraySize = 0;
+	}
+
+	template <class T>
+	void StaticMap<T>::copyFrom(const StaticMap<T>& src) {
 		m_capacity = src.m_capacity;
 		m_arraySize = src.m_arraySize;
+		m_mask = src.m_mask;
 		m_loadFactor = src.m_loadFactor;
-		m_pEntries = NIL;		
 		m_numEntries = src.m_numEntries;
 		m_nullValue = src.m_nullValue;
-		if (src.m_pEntries) {
-			m_pEntries = new Cell[m_arraySize];
-			memcpy(m_pEntries, src.m_pEntries, sizeof(Cell)*m_arraySize);
+		if (src.m_pValues) {
+			m_pDistances = new U8[m_arraySize];
+			m_pKeys = new OID[m_arraySize];
+			m_pValues = new T[m_arraySize];
+			memcpy(m_pDistances, src.m_pDistances, sizeof(U8)*m_arraySize);
+			memcpy(m_pKeys, src.m_pKeys, sizeof(OID)*m_arraySize);
+			for (Size i = 0; i < m_arraySize; i++) {
+				m_pValues[i] = src.m_pValues[i];
+			}
 		}
-		return *this;		
 	}
-	
+
 	template <class T>
-	StaticMap<T>::~StaticMap() {
-		if (m_pEntries) {			
-			delete[] m_pEntries;
-			m_pEntries = NIL;
-			m_numEntries = 0;
-			m_capacity = 0;
-			m_arraySize = 0;			
-		}		
+	void StaticMap<T>::deleteArrays() {
+		if (m_pValues) {
+			delete[] m_pDistances;
+			delete[] m_pKeys;
+			delete[] m_pValues;
+			m_pDistances = NIL;
+			m_pKeys = NIL;
+			m_pValues = NIL;
+		}
+	}
+
+	template <class T>
+	void StaticMap<T>::allocateArrays(Size arraySize) {
+		m_arraySize = arraySize;
+		m_mask = arraySize - 1;
+		m_pDistances = new U8[arraySize];
+		m_pKeys = new OID[arraySize];
+		m_pValues = new T[arraySize];
+		memset(m_pDistances, 0, sizeof(U8)*arraySize);
+		memset(m_pKeys, 0, sizeof(OID)*arraySize);
+		for (Size i = 0; i < arraySize; i++) {
+			m_pValues[i] = m_nullValue;
+		}
 	}
 
 	template <class T>
 	void StaticMap<T>::eraseAll() {
-		if (m_pEntries) {
-			for (Size i = 0; i < m_arraySize; i++) {
-				if (m_pEntries[i].key != 0) {
-					delete m_pEntries[i].value;
-					m_pEntries[i] = typename StaticMap<T>::Cell(0, m_nullValue);					
-				}
+		for (Size i = 0; i < m_arraySize; i++) {
+			if (m_pDistances[i] != 0) {
+				delete m_pValues[i];
+				m_pDistances[i] = 0;
+				m_pKeys[i] = 0;
+				m_pValues[i] = m_nullValue;
 			}
-			m_numEntries = 0;			
-		}		
+		}
+		m_numEntries = 0;
 	}
 
 	template <class T>
 	void StaticMap<T>::clear() {
-		if (m_pEntries) {
-			for (Size i = 0; i < m_arraySize; i++) {
-				if (m_pEntries[i].key != 0) {
-					m_pEntries[i] = StaticMap<T>::Cell(0, m_nullValue);					
-				}
+		for (Size i = 0; i < m_arraySize; i++) {
+			if (m_pDistances[i] != 0) {
+				m_pDistances[i] = 0;
+				m_pKeys[i] = 0;
+				m_pValues[i] = m_nullValue;
 			}
-			m_numEntries = 0;			
 		}
+		m_numEntries = 0;
 	}
 
-	template <class T> inline T StaticMap<T>::at(OID key) const {
-		Size idx = key % m_arraySize;
-		if (m_pEntries[idx].key == key || m_pEntries[idx].key == 0) {
-			return m_pEntries[idx].value;
-		}
-		else {
-			while (m_pEntries[idx % m_arraySize].key != key && m_pEntries[idx % m_arraySize].key != 0) {
-				idx++;
-			}
-			return m_pEntries[idx % m_arraySize].value;
-		}		
-	}
-	
 	template <class T>
 	void StaticMap<T>::insert(OID key, T value) {
-#if defined (DEBUG)
-		if (m_pEntries[key % m_arraySize].key != 0) {
-			DMSG("Collision inserting key: " << key << ", into StaticMap, already occupied by value with key " << m_pEntries[key % m_arraySize].key << ".");
+		Size idx = find(key);
+		if (idx < m_arraySize) {
+			m_pValues[idx] = value;
+			return;
 		}
-#endif
 		if (m_numEntries >= m_capacity) {
 			DMSG("Resizing map automatically. [capacity: " << m_capacity << ", numEntries: " << m_numEntries << "]");
-			resizeMapToCapacity(m_capacity*2, m_loadFactor);		
+			resizeMapToCapacity(m_capacity ? m_capacity*2 : 1, m_loadFactor ? m_loadFactor : 0.5f);
+		}
+		while (!place(key, value)) {
+			DWARN("StaticMap entry too far from its bucket, growing the array to " << m_arraySize*2 << ".");
+			rehash(m_arraySize*2);
 		}
+	}
 
-		Size idx = key % m_arraySize;		
-	   while (m_pEntries[idx % m_arraySize].key != 0) {
-			idx++;			
+	template <class T>
+	Boolean StaticMap<T>::place(OID& key, T& value) {
+		Size idx = key & m_mask;
+		U32 distance = 1;
+		while (m_pDistances[idx] != 0) {
+			if (m_pDistances[idx] < distance) {
+				/* Robin Hood, the entry nearer its bucket moves on instead. */
+				U8 movedDistance = m_pDistances[idx];
+				OID movedKey = m_pKeys[idx];
+				T movedValue = m_pValues[idx];
+				m_pDistances[idx] = (U8)distance;
+				m_pKeys[idx] = key;
+				m_pValues[idx] = value;
+				distance = movedDistance;
+				key = movedKey;
+				value = movedValue;
+			}
+			idx = (idx + 1) & m_mask;
+			if (++distance >= kMaxDistance) {
+				return false;
+			}
 		}
-		
-		m_pEntries[idx % m_arraySize] = typename StaticMap<T>::Cell(key, value);	
+		m_pDistances[idx] = (U8)distance;
+		m_pKeys[idx] = key;
+		m_pValues[idx] = value;
 		m_numEntries++;
+		return true;
 	}
 
+	template <class T>
+	Boolean StaticMap<T>::remove(OID key) {
+		Size hole = find(key);
+		if (hole >= m_arraySize) {
+			return false;
+		}
 
-	template <class T> inline Boolean StaticMap<T>::contains(OID key) const {
-		Size idx = key % m_arraySize;
-		if (m_pEntries[idx].key == key || m_pEntries[idx].key == 0) {
-			return m_pEntries[idx].key != 0;			
-		}		
-		else {
-			while (m_pEntries[idx % m_arraySize].key != key && m_pEntries[idx % m_arraySize].key != 0) {
-				idx++;
-			}
-			return m_pEntries[idx % m_arraySize].key != 0;
-		}				
+		/* Shift back the entries that probed past the hole, so no probe hits a gap. */
+		Size idx = (hole + 1) & m_mask;
+		while (m_pDistances[idx] > 1) {
+			m_pDistances[hole] = m_pDistances[idx] - 1;
+			m_pKeys[hole] = m_pKeys[idx];
+			m_pValues[hole] = m_pValues[idx];
+			hole = idx;
+			idx = (idx + 1) & m_mask;
+		}
+		m_pDistances[hole] = 0;
+		m_pKeys[hole] = 0;
+		m_pValues[hole] = m_nullValue;
+		m_numEntries--;
+		return true;
 	}
 
 	template <class T> T* StaticMap<T>::toArray() const {
 		T* array = new T[m_numEntries];
-		Size idx = 0;		
-		for (U32 i = 0; i < m_arraySize; i++) {
-			if (m_pEntries[i].key != 0) {
-				array[idx++] = m_pEntries[i].value;
+		Size idx = 0;
+		for (Size i = 0; i < m_arraySize; i++) {
+			if (m_pDistances[i] != 0) {
+				array[idx++] = m_pValues[i];
 			}
 		}
 		return array;
-	}	
+	}
 
+	template <class T>
+	Size StaticMap<T>::arraySizeFor(Size capacity, F32 loadFactor) {
+		Size wanted = (Size)ceil((F32)capacity / loadFactor);
+		if (wanted <= capacity) {
+			wanted = capacity + 1;
+		}
+		Size arraySize = 1;
+		while (arraySize < wanted) {
+			arraySize <<= 1;
+		}
+		return arraySize;
+	}
 
 	template <class T>
 	void StaticMap<T>::createMapWithCapacity(Size capacity, F32 loadFactor) {
 		m_capacity = capacity;
-		m_loadFactor = loadFactor;	
-
-		m_arraySize = ceil((F32)m_capacity / m_loadFactor);
-		if (m_arraySize < 1) {
-			DERR("Array size < 1.... not good.  very not good.");
-			DERR("Capacity: " << capacity << ", loadFactor: " << loadFactor);
-		}		
-		m_pEntries = new Cell[m_arraySize];
-		fillWithNull();		
+		m_loadFactor = loadFactor;
+		if (loadFactor <= 0.0f) {
+			DERR("Load factor " << loadFactor << " must be above 0, using 0.5.");
+			m_loadFactor = 0.5f;
+		}
+		allocateArrays(arraySizeFor(m_capacity, m_loadFactor));
+	}
+
+	template <class T>
+	void StaticMap<T>::rehash(Size arraySize) {
+		U8* oldDistances = m_pDistances;
+		OID* oldKeys = m_pKeys;
+		T* oldValues = m_pValues;
+		Size oldArraySize = m_arraySize;
+
+		/* Only a terrible hash pushes an entry too far, then keep doubling until it fits. */
+		for (Boolean placed = false; !placed; arraySize <<= 1) {
+			allocateArrays(arraySize);
+			m_numEntries = 0;
+			placed = true;
+			for (Size i = 0; i < oldArraySize && placed; i++) {
+				if (oldDistances[i] != 0) {
+					OID key = oldKeys[i];
+					T value = oldValues[i];
+					placed = place(key, value);
+				}
+			}
+			if (!placed) {
+				deleteArrays();
+			}
+		}
+
+		if (oldValues) {
+			delete[] oldDistances;
+			delete[] oldKeys;
+			delete[] oldValues;
+		}
 	}
 
 	template <class T>
 	void StaticMap<T>::resizeMapToCapacity(Size capacity, F32 loadFactor) {
 		// If the capacity is lower, we don't do anything.
-		if (capacity > m_capacity && ceil((F32)capacity / loadFactor) > m_arraySize) {
-			// Store the old list of buckets.
-			Cell* oldEntries = m_pEntries;
-			Size oldArraySize = m_arraySize;
-
-			// Create the new list of buckets.
-			m_arraySize = ceil((F32)capacity / loadFactor);
-			m_pEntries = new Cell[m_arraySize];
+		if (capacity > m_capacity) {
+			Size arraySize = arraySizeFor(capacity, loadFactor);
 			m_capacity = capacity;
 			m_loadFactor = loadFactor;
-			m_numEntries = 0;
-			fillWithNull();			
-
-			// Go through the old list and rehash all the elements.
-			for (Size idx = 0; idx < oldArraySize; idx++) {
-				if (oldEntries[idx].value != m_nullValue) {				
-				   insert(oldEntries[idx].key, oldEntries[idx].value);					
-				}
+			if (arraySize > m_arraySize) {
+				rehash(arraySize);
 			}
-			
-			// Delete the old buckets
-			delete[] oldEntries;
-		} 
-		else {
-			return;
 		}
 	}
-	
+
 } //namespace
 
 #endif // CAT_CORE_UTIL_STATICMAP_H
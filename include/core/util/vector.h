@@ -14,6 +14,7 @@
 #include <cstdlib>
 #include "core/util/invasivestrongptr.h"
 #include "core/threading/atomic.h"
+#include "core/memory/stlallocator.h"
 
 namespace Cat {
 
@@ -21,6 +22,9 @@ namespace Cat {
 	 * @class Vector vector.h "core/util/vector.h"
 	 * @brief A simple resizeable array.
 	 *
+	 * The array can be given a MemoryAllocator to get its memory from instead of new[], 
+	 * e.g., a StackMemoryAllocator so all the per frame Vectors are freed with one reset().
+	 *
 	 * @author Catlin Zilinski
 	 * @version 2
 	 * @since Nov 1, 2013
@@ -32,14 +36,15 @@ namespace Cat {
 		 * @brief Create an empty null vector.
 		 */
 		inline Vector()
-			: m_capacity(0), m_length(0), m_pVector(NIL) {}		
+			: m_capacity(0), m_length(0), m_pVector(NIL), m_pAllocator(NIL) {}		
 
 		/**
 		 * @brief Create a new vector with the specified number of available spaces.
 		 * @param capacity The initial capacity of the Vector.
+		 * @param allocator The MemoryAllocator to use for the memory, or NIL to use new[].
 		 */
-		inline Vector(Size capacity)
-			: m_capacity(0), m_length(0), m_pVector(NIL) {
+		inline Vector(Size capacity, MemoryAllocator* allocator = NIL)
+			: m_capacity(0), m_length(0), m_pVector(NIL), m_pAllocator(allocator) {
 			initVectorWithCapacity(capacity);
 		}		
 
@@ -63,38 +68,47 @@ namespace Cat {
 
 		/**
 		 * @brief Append an empty element to simply increase the length.
+		 * @return False if the Vector was full and could not grow.
 		 */
-		inline void append() {
+		inline Boolean append() {
 			if (m_length == m_capacity) {
 				DMSG("AUTO Resizing Vector from with length "
 					  << m_length << " from " << m_capacity
 					  << " to " << m_capacity*2);
-				resizeVectorToCapacity(m_capacity*2);
+				if (!resizeVectorToCapacity(m_capacity*2)) {
+					return false;
+				}
 			}
 			++m_length;
+			return true;
 		}
 		
 		
 		/**
 		 * @brief Append an element onto the end of the vector.
 		 * @param elem The element to append to the vector.
+		 * @return False if the Vector was full and could not grow.
 		 */
-		inline void append(const T& elem) {
+		inline Boolean append(const T& elem) {
 			if (m_length == m_capacity) {
 				DMSG("AUTO Resizing Vector from with length "
 					  << m_length << " from " << m_capacity
 					  << " to " << m_capacity*2);
-				resizeVectorToCapacity(m_capacity*2);
+				if (!resizeVectorToCapacity(m_capacity*2)) {
+					return false;
+				}
 			}
 			m_pVector[m_length] = elem;
 			++m_length;
+			return true;
 		}
 
 		/**
 		 * @brief Append all the elements from another vector.
 		 * @param src The other vector to append the elements from.
+		 * @return False if the Vector could not grow to fit them, then nothing is appended.
 		 */
-		void appendAll(const Vector<T>& src);
+		Boolean appendAll(const Vector<T>& src);
 
 		/**
 		 * @brief Get the vector element at the specified index.
@@ -116,6 +130,12 @@ namespace Cat {
 			return m_pVector[idx];
 		}		
 		
+		/**
+		 * @brief Get the MemoryAllocator the Vector gets its memory from.
+		 * @return The MemoryAllocator, or NIL if it uses new[].
+		 */
+		inline MemoryAllocator* allocator() const { return m_pAllocator; }
+
 		/**
 		 * @brief Gets the capacity of the vector.
 		 * @return The capacity of the vector.
@@ -174,8 +194,9 @@ namespace Cat {
 		/**
 		 * @brief Method to extend the active length of the Vector.
 		 * @param length The length to extend the Vector to.
+		 * @return False if the Vector could not grow to the length.
 		 */
-		void extendTo(Size length);
+		Boolean extendTo(Size length);
 
 		/**
 		 * @brief Get the vector element at the specified index.
@@ -210,8 +231,9 @@ namespace Cat {
 		 * inclusive.
 		 * @param idx The index to insert the element into.
 		 * @param elem The element to insert.
+		 * @return False if the Vector was full and could not grow.
 		 */
-		void insertAt(Size idx, const T& elem);		
+		Boolean insertAt(Size idx, const T& elem);		
 		
 		/**
 		 * @brief Get the last element in the vector.
@@ -238,7 +260,7 @@ namespace Cat {
 		 * @return True if there are no more references to the Shader.
 		 */
 		inline Boolean release() {
-		   return m_retainCount.decrement() <= 0;	
+		   return m_retainCount.decrement(kMOAcqRel) <= 0;	
 		}
 
 		/**
@@ -306,14 +328,15 @@ namespace Cat {
 		/**
 		 * @brief Reserve the specified capacity in the vector.
 		 * @param capacity The amount of elements to reserve for the vector.
+		 * @return False if the memory could not be allocated, the Vector is unchanged.
 		 */
-		void reserve(Size capacity);
+		Boolean reserve(Size capacity);
 
 		/**
 		 * @brief Increase the retain count by one.
 		 */
 		inline void retain() {
-			m_retainCount.increment();
+			m_retainCount.increment(kMORelaxed);
 		}
 
 		/**
@@ -330,8 +353,16 @@ namespace Cat {
 		 * the length of the array is set to encompass the newly set element.
 		 * @param idx The index of the element to set.
 		 * @param value The value of the element.
+		 * @return False if the Vector could not grow to fit the index.
 		 */
-		void set(Size idx, const T& value);
+		Boolean set(Size idx, const T& value);
+
+		/**
+		 * @brief Set the MemoryAllocator to get the memory from.
+		 * Can only be called before the Vector is initialised.
+		 * @param allocator The MemoryAllocator to use, or NIL to use new[].
+		 */
+		void setAllocator(MemoryAllocator* allocator);
 
 		/**
 		 * @brief Set all the values in the vector to the specified value.
@@ -368,11 +399,12 @@ namespace Cat {
 		T takeLast();
 
 	  private:
-		void resizeVectorToCapacity(Size capacity);
+		Boolean resizeVectorToCapacity(Size capacity);
 
 		Size		m_capacity;		/**< The current capacity of the Vector */
 		Size		m_length;		/**< The number of elements in the Vector */
 		T*			m_pVector;		/**< The actual vector data */
+		MemoryAllocator*	m_pAllocator;	/**< Where the data comes from (NIL for new[]) */
 		AtomicI32   m_retainCount;
 	};
 
@@ -381,8 +413,12 @@ namespace Cat {
 	template <typename T> Vector<T>::Vector(const Vector<T>& src) {
 		m_capacity = m_length = 0;
 		m_pVector = NIL;
+		m_pAllocator = src.m_pAllocator;
 		if (src.m_capacity > 0) {			
 			initVectorWithCapacity(src.m_capacity);
+			if (!m_pVector) {
+				return;
+			}
 			for (Size i = 0; i < src.m_length; ++i) {
 				m_pVector[i] = src.m_pVector[i];
 			}
@@ -395,28 +431,37 @@ namespace Cat {
 	}
 
 	template <typename T> Vector<T>& Vector<T>::operator=(const Vector<T>& src) {
+		if (this == &src) {
+			return *this;
+		}
+		T* newData = NIL;
+		if (src.m_capacity > 0) {
+			newData = createArray<T>(m_pAllocator, src.m_capacity);
+			if (!newData) {
+				DERR("Cannot copy a Vector of capacity " << src.m_capacity << ", keeping the old contents!");
+				return *this;
+			}
+			for (Size i = 0; i < src.m_length; ++i) {
+				newData[i] = src.m_pVector[i];
+			}
+		}
 		if (m_pVector) {
-			delete[] m_pVector;
-			m_pVector = NIL;			
+			destroyArray(m_pAllocator, m_pVector, m_capacity);
 		}
+		m_pVector = newData;
 		m_capacity = src.m_capacity;
 		m_length = src.m_length;
-		if (m_capacity > 0) {
-			m_pVector = new T[m_capacity];
-			for (Size i = 0; i < m_length; ++i) {
-				m_pVector[i] = src.m_pVector[i];
-			}
-		}		
 		return *this;
 	}
 
 	template <typename T>
-	void Vector<T>::appendAll(const Vector<T>& src) {
-		if (capacity() < size() + src.size()) {
-			reserve(size() + src.size());
+	Boolean Vector<T>::appendAll(const Vector<T>& src) {
+		if (capacity() < size() + src.size() && !reserve(size() + src.size())) {
+			return false;
 		}
 		memcpy(&(m_pVector[m_length]), src.m_pVector, sizeof(T)*src.size());
 		m_length += src.size();		
+		return true;
 	}
 
 	template <typename T>
@@ -432,7 +477,7 @@ namespace Cat {
 
 	template <typename T> void Vector<T>::destroy() {
 		if (m_pVector) {
-			delete[] m_pVector;
+			destroyArray(m_pAllocator, m_pVector, m_capacity);
 			m_pVector = NIL;
 		}
 		m_length = m_capacity = 0;
@@ -461,13 +506,14 @@ namespace Cat {
 #endif
 	}
 
-	template <typename T> void Vector<T>::extendTo(Size length) {
-		if (length > m_capacity) {
-			resizeVectorToCapacity(length);
+	template <typename T> Boolean Vector<T>::extendTo(Size length) {
+		if (length > m_capacity && !resizeVectorToCapacity(length)) {
+			return false;
 		}
 		if (m_length < length) {
 			m_length = length;
 		}
+		return true;
 	}
 
 	template <typename T> I32 Vector<T>::indexOf(const T& elem) const {
@@ -481,19 +527,21 @@ namespace Cat {
 
 	template <typename T> void Vector<T>::initVectorWithCapacity(Size capacity) {
 		if (!m_pVector) {				
-			m_capacity = capacity;
-			m_pVector = new T[m_capacity];
+			m_pVector = createArray<T>(m_pAllocator, capacity);
+			m_capacity = m_pVector ? capacity : 0;
 		} else {
 			DWARN("Cannot initialise already initialised Vector.");
 		}		
 	}
 	
-	template <typename T> void Vector<T>::insertAt(Size idx, const T& elem) {
+	template <typename T> Boolean Vector<T>::insertAt(Size idx, const T& elem) {
 		if (m_length == m_capacity) {
 			DMSG("AUTO Resizing Vector from with length "
 				  << m_length << " from " << m_capacity
 				  << " to " << m_capacity*2);
-			resizeVectorToCapacity(m_capacity*2);
+			if (!resizeVectorToCapacity(m_capacity*2)) {
+				return false;
+			}
 		}
 		/* Move all the elements after down one */
 		for (I32 i = (I32)m_length - 1; i >= (I32)idx; --i) {
@@ -501,6 +549,7 @@ namespace Cat {
 		}
 		m_pVector[idx] = elem;
 		++m_length;
+		return true;
 	}
 
 	template <typename T> Boolean Vector<T>::removeAt(Size idx) {
@@ -563,23 +612,35 @@ namespace Cat {
 #endif
 	}
 
-	template <typename T> void Vector<T>::reserve(Size capacity) {
+	template <typename T> Boolean Vector<T>::reserve(Size capacity) {
 		if (capacity > m_capacity) { /* Only if reserving more than we have */
-			resizeVectorToCapacity(capacity);
+			return resizeVectorToCapacity(capacity);
 		}
+		return true;
 	}			
 
-	template <typename T> void Vector<T>::set(Size idx, const T& value) {
+	template <typename T> void Vector<T>::setAllocator(MemoryAllocator* allocator) {
+		if (!m_pVector) {
+			m_pAllocator = allocator;
+		} else {
+			DWARN("Cannot set the MemoryAllocator of an initialised Vector.");
+		}
+	}
+
+	template <typename T> Boolean Vector<T>::set(Size idx, const T& value) {
 		if (idx >= m_length) {
 			if (idx >= m_capacity) {
 				DMSG("AUTO Resizing Vector with capacity "
 					  << m_capacity << " to fit index "
 					  << idx << ".  Resizing to " << (idx*2) << ".");
-				resizeVectorToCapacity(idx*2);
+				if (!resizeVectorToCapacity(idx*2)) {
+					return false;
+				}
 			}
 			m_length = idx + 1;
 		}
 		m_pVector[idx] = value;
+		return true;
 	}
 	
 	template <typename T> T Vector<T>::takeLast() {
@@ -593,23 +654,28 @@ namespace Cat {
 		}
 	}
 
-	template <typename T> void Vector<T>::resizeVectorToCapacity(Size capacity) {
+	template <typename T> Boolean Vector<T>::resizeVectorToCapacity(Size capacity) {
 		if (capacity > m_length) {
-			m_capacity = capacity;
-			T* newData = new T[m_capacity];
+			T* newData = createArray<T>(m_pAllocator, capacity);
+			if (!newData) {
+				DERR("Cannot resize Vector to capacity " << capacity << ", out of memory!");
+				return false;
+			}
 			if (m_pVector) {
 				for (Size i = 0; i < m_length; ++i) {
 					newData[i] = m_pVector[i];
 				}
-				delete[] m_pVector;
+				destroyArray(m_pAllocator, m_pVector, m_capacity);
 			}			
+			m_capacity = capacity;
 			m_pVector = newData;
+			return true;
 		} 
 		else {
 			DWARN("Cannot resize Vector with length "
 					<< m_length << " to capacity "
 					<< capacity << "!");
-			return;
+			return false;
 		}
 	}
 
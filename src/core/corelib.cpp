@@ -1,5 +1,15 @@
 #include "core/corelib.h"
 #include <cstring>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <nmmintrin.h>
+#define CAT_CRC32C_SSE42 1
+#endif
+#if defined(__GNUC__) && defined(__aarch64__) && defined(__linux__)
+#include <arm_acle.h>
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#define CAT_CRC32_ARMV8 1
+#endif
 /*-
  *  COPYRIGHT (C) 1986 Gary S. Brown.  You may use this program, or
  *  code or tables extracted from it, as desired without restriction.
@@ -90,17 +100,149 @@ namespace Cat {
 	};
 
 
-	OID crc32(const Char* str) {
-		const U8 *p = (U8*)str;
-		U32 crc = (U32)~0U;
+	namespace {
+		/*
+		 * The slicing-by-8 tables, slice[k][b] is the CRC of byte b followed by k zero
+		 * bytes, so eight bytes are folded in with eight lookups and no dependent shifts.
+		 * Slice 0 of the CRC-32 tables is crc32_tab.  Also chooses the CRC instructions
+		 * once, if the CPU has them.
+		 */
+		struct CRC32Tables {
+			U32		crc32[8][256];
+			U32		crc32c[8][256];
+			Boolean	hasCrc32Instructions;
+			Boolean	hasCrc32cInstructions;
+
+			CRC32Tables() : hasCrc32Instructions(false), hasCrc32cInstructions(false) {
+				for (U32 i = 0; i < 256; ++i) {
+					crc32[0][i] = crc32_tab[i];
+					U32 crc = i;
+					for (U32 bit = 0; bit < 8; ++bit) {
+						crc = (crc >> 1) ^ (0x82f63b78U & (0U - (crc & 1U)));
+					}
+					crc32c[0][i] = crc;
+				}
+				for (U32 k = 1; k < 8; ++k) {
+					for (U32 i = 0; i < 256; ++i) {
+						crc32[k][i] = (crc32[k-1][i] >> 8) ^ crc32[0][crc32[k-1][i] & 0xFF];
+						crc32c[k][i] = (crc32c[k-1][i] >> 8) ^ crc32c[0][crc32c[k-1][i] & 0xFF];
+					}
+				}
+#if defined(CAT_CRC32C_SSE42)
+				hasCrc32cInstructions = __builtin_cpu_supports("sse4.2");
+#endif
+#if defined(CAT_CRC32_ARMV8)
+				hasCrc32Instructions = (getauxval(AT_HWCAP) & HWCAP_CRC32) != 0;
+				hasCrc32cInstructions = hasCrc32Instructions;
+#endif
+			}
+		};
+
+		inline const CRC32Tables& crc32Tables() {
+			static const CRC32Tables tables;
+			return tables;
+		}
+
+		/* Little endian, whatever the CPU, the compiler makes it a single load. */
+		inline U32 load32(const U8* p) {
+			return (U32)p[0] | ((U32)p[1] << 8) | ((U32)p[2] << 16) | ((U32)p[3] << 24);
+		}
+
+		U32 sliceBy8(const U32 (*slice)[256], U32 crc, const U8* p, Size length) {
+			while (length >= 8) {
+				U32 low = load32(p) ^ crc;
+				U32 high = load32(p + 4);
+				crc = slice[7][low & 0xFF] ^ slice[6][(low >> 8) & 0xFF] ^
+					slice[5][(low >> 16) & 0xFF] ^ slice[4][low >> 24] ^
+					slice[3][high & 0xFF] ^ slice[2][(high >> 8) & 0xFF] ^
+					slice[1][(high >> 16) & 0xFF] ^ slice[0][high >> 24];
+				p += 8;
+				length -= 8;
+			}
+			while (length--) {
+				crc = slice[0][(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+			}
+			return crc;
+		}
+
+#if defined(CAT_CRC32C_SSE42)
+		__attribute__((target("sse4.2")))
+		U32 crc32cSse42(U32 crc, const U8* p, Size length) {
+#if defined(__x86_64__)
+			U64 crc64 = crc;
+			for (; length >= 8; p += 8, length -= 8) {
+				U64 word;
+				memcpy(&word, p, 8);
+				crc64 = _mm_crc32_u64(crc64, word);
+			}
+			crc = (U32)crc64;
+#endif
+			for (; length >= 4; p += 4, length -= 4) {
+				U32 word;
+				memcpy(&word, p, 4);
+				crc = _mm_crc32_u32(crc, word);
+			}
+			while (length--) {
+				crc = _mm_crc32_u8(crc, *p++);
+			}
+			return crc;
+		}
+#endif
+
+#if defined(CAT_CRC32_ARMV8)
+#define CAT_ARMV8_CRC32_LOOP(crc, p, length, op)		\
+		for (; length >= 8; p += 8, length -= 8) {	\
+			U64 word;										\
+			memcpy(&word, p, 8);							\
+			crc = op##d(crc, word);						\
+		}														\
+		while (length--) {								\
+			crc = op##b(crc, *p++);						\
+		}
+
+		__attribute__((target("+crc")))
+		U32 crc32Armv8(U32 crc, const U8* p, Size length) {
+			CAT_ARMV8_CRC32_LOOP(crc, p, length, __crc32);
+			return crc;
+		}
+
+		__attribute__((target("+crc")))
+		U32 crc32cArmv8(U32 crc, const U8* p, Size length) {
+			CAT_ARMV8_CRC32_LOOP(crc, p, length, __crc32c);
+			return crc;
+		}
+#undef CAT_ARMV8_CRC32_LOOP
+#endif
+	} // namespace
 
-		Size size = strlen(str);
+	OID crc32(const Char* str) {
+		return crc32(str, strlen(str));
+	}
 
-		while (size--) {
-			crc = crc32_tab[(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+	OID crc32(const Char* data, Size length) {
+		const CRC32Tables& tables = crc32Tables();
+		const U8* p = (const U8*)data;
+#if defined(CAT_CRC32_ARMV8)
+		if (tables.hasCrc32Instructions) {
+			return crc32Armv8(~0U, p, length) ^ ~0U;
 		}
+#endif
+		return sliceBy8(tables.crc32, ~0U, p, length) ^ ~0U;
+	}
 
-		return crc ^ ~0U;
+	OID crc32c(const Char* data, Size length) {
+		const CRC32Tables& tables = crc32Tables();
+		const U8* p = (const U8*)data;
+#if defined(CAT_CRC32C_SSE42)
+		if (tables.hasCrc32cInstructions) {
+			return crc32cSse42(~0U, p, length) ^ ~0U;
+		}
+#elif defined(CAT_CRC32_ARMV8)
+		if (tables.hasCrc32cInstructions) {
+			return crc32cArmv8(~0U, p, length) ^ ~0U;
+		}
+#endif
+		return sliceBy8(tables.crc32c, ~0U, p, length) ^ ~0U;
 	}
 
 	Char* copy(const Char* str) {
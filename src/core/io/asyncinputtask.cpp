@@ -86,11 +86,8 @@ namespace Cat {
 	
 
 	void AsyncReadResult::taskCompleted(Size bytesRead) {
-		resultSync().lock();
 		m_bytesRead = bytesRead;
-		setComplete(true);		
-		resultSync().broadcast();
-		resultSync().unlock();
+		complete();
 	}
 
 
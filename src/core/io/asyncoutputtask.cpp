@@ -84,11 +84,8 @@ namespace Cat {
 	//
 
 	void AsyncWriteResult::taskCompleted(Size bytesWritten) {
-		resultSync().lock();
-		setComplete(true);	
 		m_bytesWritten = bytesWritten;
-	   resultSync().broadcast();
-		resultSync().unlock();
+		complete();
 	}
 
 } // namespace Cat
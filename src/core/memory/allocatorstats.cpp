@@ -0,0 +1,54 @@
+#include <cstring>
+#include "core/memory/allocatorstats.h"
+
+namespace Cat {
+
+	void AllocatorStats::clear() {
+		memset(this, 0, sizeof(AllocatorStats));
+	}
+
+	void AllocatorStats::merge(const AllocatorStats& other) {
+		allocs += other.allocs;
+		deallocs += other.deallocs;
+		failed_allocs += other.failed_allocs;
+		live_bytes += other.live_bytes;
+		capacity_bytes += other.capacity_bytes;
+		peak_bytes += other.peak_bytes;
+		for (U32 i = 0; i < kNumSizeClasses; i++) {
+			live_blocks[i] += other.live_blocks[i];
+		}
+		for (U32 i = 0; i < kNumLatencyBuckets; i++) {
+			latency[i] += other.latency[i];
+		}
+	}
+
+	/*
+	 * Only the size classes and latency buckets that were used are printed.
+	 */
+	void dumpAllocatorStats(std::ostream& out, const AllocatorStats& stats) {
+		out << std::dec << "  allocs: " << stats.allocs << ", deallocs: " << stats.deallocs
+			 << ", failed: " << stats.failed_allocs << std::endl;
+		out << "  live bytes: " << stats.live_bytes << ", peak bytes: " << stats.peak_bytes;
+		if (stats.capacity_bytes > 0) {
+			out << ", capacity: " << stats.capacity_bytes
+				 << " (peak " << (stats.peak_bytes * 100 / stats.capacity_bytes) << "%)";
+		}
+		out << std::endl;
+
+		for (U32 i = 0; i < AllocatorStats::kNumSizeClasses; i++) {
+			if (stats.live_blocks[i] != 0) {
+				out << "  live blocks <= " << ((U64)1 << i) << " bytes: " << stats.live_blocks[i] << std::endl;
+			}
+		}
+		for (U32 i = 0; i < AllocatorStats::kNumLatencyBuckets; i++) {
+			if (stats.latency[i] != 0) {
+				out << "  allocs < " << ((U64)2 << i) << "ns";
+				if (i == AllocatorStats::kNumLatencyBuckets - 1) {
+					out << " (or slower)";
+				}
+				out << ": " << stats.latency[i] << std::endl;
+			}
+		}
+	}
+
+} // namespace Cat
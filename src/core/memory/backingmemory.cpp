@@ -0,0 +1,143 @@
+#include <cstdlib>
+#include "core/memory/backingmemory.h"
+
+#if defined (OS_UNIX) || defined (OS_APPLE)
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+#if !defined (MPOL_BIND)
+#define MPOL_BIND 2
+#endif
+
+namespace Cat {
+
+#if defined (OS_UNIX) || defined (OS_APPLE)
+	/*
+	 * Binds the pages of the memory to a NUMA node, must be called before the pages
+	 * are touched.
+	 */
+	static void bindToNumaNode(VPtr ptr, Size size, I32 numa_node) {
+#if defined (SYS_mbind)
+		if (numa_node >= (I32)(sizeof(unsigned long)*8)) {
+			DWARN("NUMA node " << numa_node << " is out of range, not binding memory.");
+			return;
+		}
+		unsigned long node_mask = 1UL << numa_node;
+		// The kernel takes maxnode as one past the last bit it reads, so + 1 to reach the top node.
+		if (syscall(SYS_mbind, ptr, size, MPOL_BIND, &node_mask, sizeof(node_mask)*8 + 1, 0) != 0) {
+			DWARN("mbind() to NUMA node " << numa_node << " failed, memory is not bound.");
+		}
+#else
+		CC_UNUSED(ptr);
+		CC_UNUSED(size);
+		DWARN("NUMA binding not supported, ignoring NUMA node " << numa_node << ".");
+#endif
+	}
+
+	/*
+	 * Maps anonymous memory, trying explicit huge pages first and then transparent
+	 * huge pages on a huge page aligned mapping.
+	 */
+	static Boolean mapBackingMemory(BackingMemory* memory, Size size, BitField32 flags) {
+		if (flags & AllocatorFlags::kAFHugePages) {
+			size = ((size + kHugePageSize - 1) / kHugePageSize) * kHugePageSize;
+#if defined (MAP_HUGETLB)
+			VPtr ptr = mmap(NIL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+			if (ptr != MAP_FAILED) {
+				memory->ptr = ptr;
+				memory->size = size;
+				memory->source = BS_HUGETLB;
+				return true;
+			}
+			DMSG("MAP_HUGETLB failed, falling back to transparent huge pages.");
+#endif
+			// Over map so we can trim the mapping down to a huge page boundary.
+			MemAddr mapped;
+			mapped.ptr = mmap(NIL, size + kHugePageSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+			if (mapped.ptr == MAP_FAILED) {
+				return false;
+			}
+			MemAddr aligned = MemoryAllocator::getAlignedMemoryAddress(mapped, kHugePageSize);
+			Size head = aligned.addr - mapped.addr;
+			if (head > 0) {
+				munmap(mapped.ptr, head);
+			}
+			if (kHugePageSize - head > 0) {
+				munmap((VPtr)(aligned.addr + size), kHugePageSize - head);
+			}
+#if defined (MADV_HUGEPAGE)
+			if (madvise(aligned.ptr, size, MADV_HUGEPAGE) != 0) {
+				DWARN("madvise(MADV_HUGEPAGE) failed, using normal pages.");
+			}
+#else
+			DWARN("Huge pages not supported, using normal pages.");
+#endif
+			memory->ptr = aligned.ptr;
+			memory->size = size;
+			memory->source = BS_MMAP;
+			return true;
+		}
+
+		VPtr ptr = mmap(NIL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (ptr == MAP_FAILED) {
+			return false;
+		}
+		memory->ptr = ptr;
+		memory->size = size;
+		memory->source = BS_MMAP;
+		return true;
+	}
+#endif
+
+	Boolean allocBackingMemory(BackingMemory* memory, Size size, BitField32 flags, I32 numa_node) {
+		memory->ptr = NIL;
+		memory->size = 0;
+		memory->source = BS_NONE;
+
+#if defined (OS_UNIX) || defined (OS_APPLE)
+		if ((flags & AllocatorFlags::kAFHugePages) || numa_node >= 0) {
+			if (mapBackingMemory(memory, size, flags)) {
+				if (numa_node >= 0) {
+					bindToNumaNode(memory->ptr, memory->size, numa_node);
+				}
+				return true;
+			}
+			DWARN("Failed to map " << size << " bytes of backing memory, falling back to malloc.");
+		}
+#else
+		if ((flags & AllocatorFlags::kAFHugePages) || numa_node >= 0) {
+			DWARN("Huge pages and NUMA binding not supported, falling back to malloc.");
+		}
+#endif
+
+		memory->ptr = malloc(size);
+		if (!memory->ptr) {
+			return false;
+		}
+		memory->size = size;
+		memory->source = BS_MALLOC;
+		return true;
+	}
+
+	void freeBackingMemory(BackingMemory* memory) {
+		switch (memory->source) {
+		case BS_MALLOC:
+			::free(memory->ptr);
+			break;
+#if defined (OS_UNIX) || defined (OS_APPLE)
+		case BS_MMAP:
+		case BS_HUGETLB:
+			munmap(memory->ptr, memory->size);
+			break;
+#endif
+		default:
+			break;
+		}
+		memory->ptr = NIL;
+		memory->size = 0;
+		memory->source = BS_NONE;
+	}
+
+} // namespace Cat
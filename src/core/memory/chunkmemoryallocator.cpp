@@ -8,9 +8,10 @@ namespace Cat {
  	 * free memory blocks, using the blocks themselves to store the pointers 
  	 * for the linked list.
  	 */
-	ChunkMemoryAllocator::ChunkMemoryAllocator(U32 chunk_size, U32 number_of_chunks, OID id) {
+	ChunkMemoryAllocator::ChunkMemoryAllocator(U32 chunk_size, U32 number_of_chunks, OID id, U32 region_alignment, BitField32 flags, I32 numa_node) {
 		next_block_.ptr = NIL;
 		unaligned_memory_block_.ptr = NIL;
+		backing_.source = BS_NONE;
 		id_ = id;
 		// Make sure the block_size is >= the size of a pointer
 		if (chunk_size < sizeof(VPtr)) {
@@ -24,13 +25,23 @@ namespace Cat {
 			return;
 		}
 
+		if ((region_alignment & (region_alignment - 1)) != 0) {
+			DERR("region_alignment ( " << region_alignment << " ) must be a power of 2!");
+			return;
+		}
+
 		block_size_ = chunk_size;
 		number_of_blocks_ = number_of_chunks;
+		// Both are powers of two, so aligning to the larger one aligns to both.
+		if (region_alignment < block_size_) {
+			region_alignment = block_size_;
+		}
 
 		// First, allocate the total amount of memory we need, plus the alignment size
 		// to allow us to align the memory properly
-		U32 memory_to_allocate = (block_size_ * number_of_blocks_) + block_size_;
-		unaligned_memory_block_.ptr = malloc(memory_to_allocate);
+		U32 memory_to_allocate = (block_size_ * number_of_blocks_) + region_alignment;
+		allocBackingMemory(&backing_, memory_to_allocate, flags, numa_node);
+		unaligned_memory_block_.ptr = backing_.ptr;
 		if (!unaligned_memory_block_.ptr) {
 			DERR("Failed to get memory for ChunkMemoryAllocator!");
 			return;
@@ -38,7 +49,7 @@ namespace Cat {
 
 		// Calculate the adjusted block address
 		aligned_memory_block_ = next_block_ =
-			MemoryAllocator::getAlignedMemoryAddress(unaligned_memory_block_, block_size_);
+			MemoryAllocator::getAlignedMemoryAddress(unaligned_memory_block_, region_alignment);
 		
 		// Initialize the linked list of memory blocks.
 		DMSG("Created new ChunkMemoryAllocator at block: " << std::hex << aligned_memory_block_.addr << " with block size " << block_size_); 
@@ -62,13 +73,16 @@ namespace Cat {
 	VPtr ChunkMemoryAllocator::alloc(U32 block_size, U32 alignment) {
 		CC_UNUSED(block_size);
 		CC_UNUSED(alignment);
+		U64 start = stats_ ? getStatsTime() : 0;
 		if (next_block_.ptr == NIL) {
 			DWARN("No more free blocks to give!");
+			if (stats_) { stats_->recordFailure(); }
 			return NIL;
 		}
 		
 		MemAddr memory_block = MemoryAllocator::getAlignedMemoryAddress(next_block_, alignment);
 		next_block_.addr = (*((Addr*)next_block_.ptr));
+		if (stats_) { stats_->recordAlloc(block_size_, getStatsTime() - start); }
 
 		return memory_block.ptr;
 
@@ -82,6 +96,7 @@ namespace Cat {
 		next_block_.addr -= (next_block_.addr & (block_size_ - 1)); // Works ONLY because block_size_ is power of 2.
 		
 		*((MemAddr*)next_block_.ptr) = current_block_address;
+		if (stats_) { stats_->recordDealloc(block_size_); }
 	}
 
 	void ChunkMemoryAllocator::dealloc() {
@@ -115,6 +130,7 @@ namespace Cat {
 		*block_ptr = NIL;
 
 		next_block_ = aligned_memory_block_;
+		if (stats_) { stats_->recordReset(); }
 	}
 
 	void ChunkMemoryAllocator::free() {
@@ -124,7 +140,7 @@ namespace Cat {
 			return;
 		}
 
-		::free(unaligned_memory_block_.ptr);
+		freeBackingMemory(&backing_);
 		unaligned_memory_block_.ptr = next_block_.ptr = aligned_memory_block_.ptr = NIL;
 	}
 
@@ -132,5 +148,9 @@ namespace Cat {
 		return id_;
 	}
 
+	U64 ChunkMemoryAllocator::getCapacity() {
+		return (U64)block_size_ * number_of_blocks_;
+	}
+
 
 } // namespace Cat
@@ -0,0 +1,381 @@
+#include <cstdlib>
+#include "core/memory/concurrentpoolmemoryallocator.h"
+
+namespace Cat {
+
+	/**
+	 * The ConcurrentPoolMemoryAllocator constructor creates the memory for the blocks
+	 * and the thread local key used to find each thread's Magazine.
+	 */
+	ConcurrentPoolMemoryAllocator::ConcurrentPoolMemoryAllocator(U32 block_size, U32 number_of_blocks, U32 block_alignment, U32 magazine_size, OID id, BitField32 flags, I32 numa_node) {
+		unaligned_memory_block_.ptr = aligned_memory_block_.ptr = NIL;
+		backing_.source = BS_NONE;
+		block_size_ = block_size;
+		number_of_blocks_ = number_of_blocks;
+		magazine_size_ = magazine_size;
+		batch_size_ = magazine_size / 2;
+		has_key_ = false;
+		id_ = id;
+		free_head_.set(kNilBlock);
+
+		// Make sure the block_size can hold the index of the next block
+		if (block_size < sizeof(U32)) {
+			DERR("block_size must be >= sizeof(U32).");
+			return;
+		}
+		if (magazine_size < 2) {
+			DERR("magazine_size must be >= 2.");
+			return;
+		}
+
+#if defined (OS_WINDOWS)
+		cache_key_ = TlsAlloc();
+		if (cache_key_ == TLS_OUT_OF_INDEXES) {
+#else
+		if (pthread_key_create(&cache_key_, &ConcurrentPoolMemoryAllocator::releaseMagazine) != 0) {
+#endif
+			DERR("Failed to create thread cache key for ConcurrentPoolMemoryAllocator!");
+			return;
+		}
+		has_key_ = true;
+
+		// First, allocate the total amount of memory we need, plus the alignment size
+		// to allow us to align the memory properly
+		U32 memory_to_allocate = (block_size * number_of_blocks) + block_alignment;
+		allocBackingMemory(&backing_, memory_to_allocate, flags, numa_node);
+		unaligned_memory_block_.ptr = backing_.ptr;
+		if (!unaligned_memory_block_.ptr) {
+			DERR("Failed to get memory for ConcurrentPoolMemoryAllocator!");
+			return;
+		}
+
+		aligned_memory_block_ =
+			MemoryAllocator::getAlignedMemoryAddress(unaligned_memory_block_, block_alignment);
+
+		DMSG("Created new ConcurrentPoolMemoryAllocator at block: " << std::hex << aligned_memory_block_.addr);
+		reset();
+	}
+
+	ConcurrentPoolMemoryAllocator::~ConcurrentPoolMemoryAllocator() {
+		DOUT("Calling CONCURRENTPOOLMemoryAllocator DESTRUCTOR\n");
+		free();
+	}
+
+	/*
+	 * Takes a block from the calling thread's Magazine, refilling the Magazine from the
+	 * shared list with a single compare and swap when it is empty.
+	 */
+	VPtr ConcurrentPoolMemoryAllocator::alloc() {
+		U64 start = stats_ ? getStatsTime() : 0;
+		Magazine* magazine = getMagazine();
+		if (!magazine) {
+			return NIL;
+		}
+
+		if (magazine->count == 0) {
+			magazine->count = popBlocks(magazine->blocks, batch_size_);
+			if (magazine->count == 0) {
+				DWARN("No more free blocks to give!");
+				if (stats_) { magazine->stats.recordFailure(); }
+				return NIL;
+			}
+		}
+
+		magazine->count--;
+		if (stats_) { magazine->stats.recordAlloc(block_size_, getStatsTime() - start); }
+		return blockAddress(magazine->blocks[magazine->count]);
+	}
+
+	VPtr ConcurrentPoolMemoryAllocator::alloc(U32 block_size, U32 alignment) {
+		CC_UNUSED(block_size);
+		CC_UNUSED(alignment);
+		return alloc();
+	}
+
+	/*
+	 * Puts the block into the calling thread's Magazine, spilling half of a full
+	 * Magazine back to the shared list first.
+	 */
+	void ConcurrentPoolMemoryAllocator::dealloc(VPtr memory_block) {
+		Magazine* magazine = getMagazine();
+		if (!magazine) {
+			return;
+		}
+
+		if (magazine->count == magazine_size_) {
+			magazine->count -= batch_size_;
+			pushBlocks(magazine->blocks + magazine->count, batch_size_);
+		}
+
+		magazine->blocks[magazine->count] = blockIndex(memory_block);
+		magazine->count++;
+		if (stats_) { magazine->stats.recordDealloc(block_size_); }
+	}
+
+	void ConcurrentPoolMemoryAllocator::dealloc() {
+		DERR("Dealloc() not implemented for ConcurrentPoolMemoryAllocator!");
+	}
+
+	/**
+	 * Rebuilds the shared list of blocks and empties every thread's Magazine.
+	 */
+	void ConcurrentPoolMemoryAllocator::reset() {
+		// Make sure the MemoryAllocator hasn't been free'd yet
+		if (unaligned_memory_block_.ptr == NIL)  {
+			DWARN("ConcurrentPoolMemoryAllocator has been free'd, can't reset!");
+			return;
+		}
+
+		// Link each block to the index of the following block
+		for (U32 i = 0; i + 1 < number_of_blocks_; i++) {
+			nextBlock(i) = i + 1;
+		}
+		if (number_of_blocks_ > 0) {
+			nextBlock(number_of_blocks_ - 1) = kNilBlock;
+		}
+
+		Magazine* magazine = (Magazine*)(Addr)magazines_.val();
+		while (magazine) {
+			magazine->count = 0;
+			magazine->stats.recordReset();
+			magazine = magazine->next_magazine;
+		}
+		taken_blocks_.set(0);
+
+		U64 tag = (free_head_.val() >> 32) + 1;
+		free_head_.set((tag << 32) | (number_of_blocks_ > 0 ? 0 : kNilBlock));
+	}
+
+	void ConcurrentPoolMemoryAllocator::free() {
+		if (has_key_) {
+#if defined (OS_WINDOWS)
+			TlsFree(cache_key_);
+#else
+			pthread_key_delete(cache_key_);
+#endif
+			has_key_ = false;
+		}
+
+		Magazine* magazine = (Magazine*)(Addr)magazines_.val();
+		while (magazine) {
+			Magazine* next = magazine->next_magazine;
+			::free(magazine);
+			magazine = next;
+		}
+		magazines_.set(0);
+
+		// Make sure the MemoryAllocator hasn't been free'd yet
+		if (unaligned_memory_block_.ptr == NIL) {
+			DWARN("ConcurrentPoolMemoryAllocator has already been free'd!");
+			return;
+		}
+
+		freeBackingMemory(&backing_);
+		unaligned_memory_block_.ptr = aligned_memory_block_.ptr = NIL;
+		free_head_.set(kNilBlock);
+	}
+
+	void ConcurrentPoolMemoryAllocator::flushThreadCache() {
+		Magazine* magazine = getMagazine();
+		if (magazine && magazine->count > 0) {
+			pushBlocks(magazine->blocks, magazine->count);
+			magazine->count = 0;
+		}
+	}
+
+	OID ConcurrentPoolMemoryAllocator::getOID() {
+		return id_;
+	}
+
+	U64 ConcurrentPoolMemoryAllocator::getCapacity() {
+		return (U64)block_size_ * number_of_blocks_;
+	}
+
+	/*
+	 * Clears the statistics of every Magazine, and counts the blocks currently out of the
+	 * shared list so the peak starts from the right place.
+	 */
+	void ConcurrentPoolMemoryAllocator::enableStats(Boolean enable) {
+		MemoryAllocator::enableStats(enable);
+		if (!enable) {
+			return;
+		}
+
+		Magazine* magazine = (Magazine*)(Addr)magazines_.val();
+		while (magazine) {
+			magazine->stats.clear();
+			magazine = magazine->next_magazine;
+		}
+
+		U64 free_blocks = 0;
+		if (unaligned_memory_block_.ptr) {
+			U32 index = (U32)free_head_.val();
+			while (index != kNilBlock) {
+				free_blocks++;
+				index = nextBlock(index);
+			}
+		}
+		taken_blocks_.set(number_of_blocks_ - free_blocks);
+		peak_taken_blocks_.set(number_of_blocks_ - free_blocks);
+	}
+
+	Boolean ConcurrentPoolMemoryAllocator::getStats(AllocatorStats* stats) {
+		if (!stats_) {
+			return false;
+		}
+		stats->clear();
+		Magazine* magazine = (Magazine*)(Addr)magazines_.val();
+		while (magazine) {
+			stats->merge(magazine->stats);
+			magazine = magazine->next_magazine;
+		}
+		stats->peak_bytes = peak_taken_blocks_.val() * block_size_;
+		stats->capacity_bytes = getCapacity();
+		return true;
+	}
+
+	/*
+	 * Finds the Magazine for the calling thread.  A thread without one first tries to
+	 * adopt a Magazine left behind by a thread that has exited before creating a new one.
+	 */
+	ConcurrentPoolMemoryAllocator::Magazine* ConcurrentPoolMemoryAllocator::getMagazine() {
+		if (!has_key_) {
+			DERR("ConcurrentPoolMemoryAllocator has no thread cache key!");
+			return NIL;
+		}
+
+#if defined (OS_WINDOWS)
+		Magazine* magazine = (Magazine*)TlsGetValue(cache_key_);
+#else
+		Magazine* magazine = (Magazine*)pthread_getspecific(cache_key_);
+#endif
+		if (magazine) {
+			return magazine;
+		}
+
+		magazine = (Magazine*)(Addr)magazines_.val();
+		while (magazine) {
+			if (magazine->in_use.val() == 0 && magazine->in_use.compareAndSwap(0, 1)) {
+				break;
+			}
+			magazine = magazine->next_magazine;
+		}
+
+		if (!magazine) {
+			magazine = (Magazine*)malloc(sizeof(Magazine) + sizeof(U32)*(magazine_size_ - 1));
+			if (!magazine) {
+				DERR("Failed to allocate thread cache for ConcurrentPoolMemoryAllocator!");
+				return NIL;
+			}
+			new (&(magazine->in_use)) AtomicU64(1);
+			magazine->owner = this;
+			magazine->stats.clear();
+			magazine->count = 0;
+
+			U64 head;
+			do {
+				head = magazines_.val();
+				magazine->next_magazine = (Magazine*)(Addr)head;
+			} while (!magazines_.compareAndSwap(head, (U64)(Addr)magazine));
+		}
+
+#if defined (OS_WINDOWS)
+		TlsSetValue(cache_key_, magazine);
+#else
+		pthread_setspecific(cache_key_, magazine);
+#endif
+		return magazine;
+	}
+
+	/*
+	 * Detaches a chain of up to max_blocks blocks from the front of the shared list
+	 * with a single compare and swap.  The chain is walked before the swap, so any
+	 * index read from a block that was taken by another thread in the meantime is
+	 * thrown away when the tag no longer matches.
+	 */
+	U32 ConcurrentPoolMemoryAllocator::popBlocks(U32* blocks, U32 max_blocks) {
+		for (;;) {
+			U64 head = free_head_.val();
+			U32 index = (U32)head;
+			U32 count = 0;
+			Boolean stale = false;
+
+			while (count < max_blocks && index != kNilBlock) {
+				if (index >= number_of_blocks_) {
+					stale = true;
+					break;
+				}
+				blocks[count++] = index;
+				index = nextBlock(index);
+			}
+			if (stale) {
+				continue;
+			}
+			if (count == 0) {
+				return 0;
+			}
+
+			U64 tag = (head >> 32) + 1;
+			if (free_head_.compareAndSwap(head, (tag << 32) | index)) {
+				if (stats_) { addTakenBlocks(count); }
+				return count;
+			}
+		}
+	}
+
+	/*
+	 * Links the blocks together and pushes the whole chain onto the front of the
+	 * shared list with a single compare and swap.
+	 */
+	void ConcurrentPoolMemoryAllocator::pushBlocks(const U32* blocks, U32 count) {
+		for (U32 i = 0; i + 1 < count; i++) {
+			nextBlock(blocks[i]) = blocks[i + 1];
+		}
+
+		U64 head;
+		U64 tag;
+		do {
+			head = free_head_.val();
+			tag = (head >> 32) + 1;
+			nextBlock(blocks[count - 1]) = (U32)head;
+		} while (!free_head_.compareAndSwap(head, (tag << 32) | blocks[0]));
+		if (stats_) { removeTakenBlocks(count); }
+	}
+
+	/*
+	 * Counts blocks leaving the shared list and raises the peak if needed.
+	 */
+	void ConcurrentPoolMemoryAllocator::addTakenBlocks(U32 count) {
+		U64 taken;
+		do {
+			taken = taken_blocks_.val();
+		} while (!taken_blocks_.compareAndSwap(taken, taken + count));
+		taken += count;
+
+		U64 peak = peak_taken_blocks_.val();
+		while (taken > peak && !peak_taken_blocks_.compareAndSwap(peak, taken)) {
+			peak = peak_taken_blocks_.val();
+		}
+	}
+
+	void ConcurrentPoolMemoryAllocator::removeTakenBlocks(U32 count) {
+		U64 taken;
+		do {
+			taken = taken_blocks_.val();
+		} while (!taken_blocks_.compareAndSwap(taken, taken - count));
+	}
+
+	/*
+	 * Called when a thread exits, returns the cached blocks to the shared list
+	 * and lets another thread adopt the Magazine.
+	 */
+	void ConcurrentPoolMemoryAllocator::releaseMagazine(VPtr data) {
+		Magazine* magazine = (Magazine*)data;
+		if (magazine->count > 0) {
+			magazine->owner->pushBlocks(magazine->blocks, magazine->count);
+			magazine->count = 0;
+		}
+		magazine->in_use.set(0);
+	}
+
+} // namespace Cat
@@ -1,3 +1,5 @@
+#include <cstdlib>
+#include <cstring>
 #include "core/memory/dynamicchunkmemoryallocator.h"
 #include "core/memory/chunkmemoryallocator.h"
 
@@ -6,12 +8,18 @@ namespace Cat {
 	DynamicChunkMemoryAllocator::DynamicChunkMemoryAllocator(U32 default_number_of_chunks, OID id) {
 		number_of_allocators_ = 0;
 		default_number_of_blocks_ = default_number_of_chunks;
+		class_mask_ = free_mask_ = 0;
+		memset(classes_, NIL, sizeof(DCAllocatorNode*)*kNumSizeClasses);
+		memset(free_classes_, NIL, sizeof(DCAllocatorNode*)*kNumSizeClasses);
+		page_map_ = NIL;
+		page_map_capacity_ = page_map_size_ = 0;
+		growable_ = false;
 		id_ = id;
 	}
 
 	DynamicChunkMemoryAllocator::~DynamicChunkMemoryAllocator() {
 		DOUT("Calling DYNAMICCHUNKMemoryAllocator DESTRUCTOR\n");
-		free();		
+		free();
 	}
 
 	VPtr DynamicChunkMemoryAllocator::alloc() {
@@ -19,57 +27,60 @@ namespace Cat {
 		return NIL;
 	}
 
+	/*
+	 * Takes the first chunk with free blocks in the size class of the block, creating a
+	 * new chunk if the size class has none yet (or it is full and we're growable).
+	 */
 	VPtr DynamicChunkMemoryAllocator::alloc(U32 block_size, U32 alignment) {
-		// Check to see if there are no allocators, if not, create one.
-		if (allocators_ == NIL) {
-			addChunk(block_size, default_number_of_blocks_);
-			last_accessed_ = allocators_->allocator;
+		U64 start = stats_ ? getStatsTime() : 0;
+		if (block_size < sizeof(VPtr)) {
+			block_size = sizeof(VPtr);
 		}
-		// Check the most recently used allocator.
-		if (last_accessed_->getBlockSize() > block_size && last_accessed_->getBlockSize() < block_size*2) {
-			return last_accessed_->alloc(block_size, alignment);
+		U32 size_class = getSizeClass(block_size);
+		if (size_class >= kNumSizeClasses) {
+			DERR("Cannot allocate a block of size " << block_size << "!");
+			if (stats_) { stats_->recordFailure(); }
+			return NIL;
 		}
 
-		// Otherwise, check for an appropriate allocator.
-		DCAllocatorNode* ptr = allocators_;
-		while (ptr) {
-			if (ptr->allocator->getBlockSize() >= block_size) {
-				if (ptr->allocator->getBlockSize() < block_size*2) {
-					return ptr->allocator->alloc(block_size, alignment);
-				}
-				break;
+		DCAllocatorNode* node = free_classes_[size_class];
+		if (!node) {
+			if ((class_mask_ & (1u << size_class)) && !growable_) {
+				DWARN("No more free blocks to give!");
+				if (stats_) { stats_->recordFailure(); }
+				return NIL;
+			}
+			if (!addChunk(block_size, default_number_of_blocks_)) {
+				DERR("Could not find correctly sized ChunkMemoryAllocator and could not create a new one!");
+				if (stats_) { stats_->recordFailure(); }
+				return NIL;
 			}
-			ptr = ptr->next;
+			node = free_classes_[size_class];
 		}
 
-		ChunkMemoryAllocator* allocator = addChunk(block_size, default_number_of_blocks_);
-		if (allocator) {
-			last_accessed_ = allocator;
-			return allocator->alloc(block_size, alignment);		
+		VPtr memory_block = node->allocator->alloc(block_size, alignment);
+		if (node->allocator->getNextBlock().ptr == NIL) {
+			removeFromFreeList(node);
 		}
-		DERR("Could not find correctly sized ChunkMemoryAllocator and could not create a new one!");
-		return NIL;
-
+		if (stats_) { stats_->recordAlloc(1u << size_class, getStatsTime() - start); }
+		return memory_block;
 	}
 
+	/*
+	 * Finds the chunk that owns the block through the page map.
+	 */
 	void DynamicChunkMemoryAllocator::dealloc(VPtr memory_block) {
-		// Check to see if it was from the most recently accessed.
-		if (last_accessed_->doesOwnMemory(memory_block)) {
-			last_accessed_->dealloc(memory_block);
+		DCAllocatorNode* node = findPage((Addr)memory_block >> kPageShift);
+		if (!node || !node->allocator->doesOwnMemory(memory_block)) {
+			DERR("Could not find ChunkMemoryAllocator that owns the memory block!");
 			return;
 		}
 
-		// Find where it belongs otherwise.
-		DCAllocatorNode* ptr = allocators_;
-		while (ptr) {
-			if (ptr->allocator->doesOwnMemory(memory_block)) {
-				ptr->allocator->dealloc(memory_block);
-				return;
-			}
-			ptr = ptr->next;
+		node->allocator->dealloc(memory_block);
+		if (!node->has_free) {
+			addToFreeList(node);
 		}
-
-		DERR("Could not find ChunkMemoryAllocator that owns the memory block!");
+		if (stats_) { stats_->recordDealloc(1u << node->size_class); }
 	}
 
 	void DynamicChunkMemoryAllocator::dealloc() {
@@ -77,140 +88,281 @@ namespace Cat {
 	}
 
 	void DynamicChunkMemoryAllocator::reset() {
-		DCAllocatorNode* ptr = allocators_;
-		while (ptr) {
-			ptr->allocator->reset();
-			ptr = ptr->next;
+		for (U32 i = 0; i < kNumSizeClasses; i++) {
+			DCAllocatorNode* ptr = classes_[i];
+			while (ptr) {
+				ptr->allocator->reset();
+				if (!ptr->has_free) {
+					addToFreeList(ptr);
+				}
+				ptr = ptr->next;
+			}
 		}
+		if (stats_) { stats_->recordReset(); }
 	}
 
 	void DynamicChunkMemoryAllocator::free() {
-		DCAllocatorNode* ptr = allocators_;
-		while (ptr) {
-			allocators_ = ptr->next;
-			delete ptr->allocator;
-			delete ptr;
-			ptr = allocators_;
+		for (U32 i = 0; i < kNumSizeClasses; i++) {
+			DCAllocatorNode* ptr = classes_[i];
+			while (ptr) {
+				classes_[i] = ptr->next;
+				delete ptr->allocator;
+				delete ptr;
+				ptr = classes_[i];
+			}
+			free_classes_[i] = NIL;
 		}
 		number_of_allocators_ = 0;
-		last_accessed_ = NIL;
-		allocators_ = NIL;
+		if (stats_) { stats_->recordReset(); }
+		class_mask_ = free_mask_ = 0;
+
+		::free(page_map_);
+		page_map_ = NIL;
+		page_map_capacity_ = page_map_size_ = 0;
 	}
 
 	OID DynamicChunkMemoryAllocator::getOID() {
 		return id_;
 	}
 
+	/*
+	 * The capacity of all the chunks added so far, growable allocators can get bigger.
+	 */
+	U64 DynamicChunkMemoryAllocator::getCapacity() {
+		U64 capacity = 0;
+		for (U32 i = 0; i < kNumSizeClasses; i++) {
+			DCAllocatorNode* ptr = classes_[i];
+			while (ptr) {
+				capacity += ptr->allocator->getCapacity();
+				ptr = ptr->next;
+			}
+		}
+		return capacity;
+	}
+
 	ChunkMemoryAllocator* DynamicChunkMemoryAllocator::addChunk(U32 chunk_size, U32 number_of_chunks) {
 		if (chunk_size < sizeof(VPtr)) {
 			DERR("Cannot allocate a chunk smaller than sizeof(VPtr) = " << sizeof(VPtr) << "!");
 			return NIL;
 		}
+		U32 size_class = getSizeClass(chunk_size);
+		if (size_class >= kNumSizeClasses) {
+			DERR("Cannot allocate a chunk of size " << chunk_size << "!");
+			return NIL;
+		}
 
-		chunk_size = getNextHighestPowerOfTwo(chunk_size);
+		// Align the region to a page, so no page is shared between two chunks.
+		ChunkMemoryAllocator* allocator = ::new ChunkMemoryAllocator(1u << size_class, number_of_chunks, 0, 1u << kPageShift);
+		if (allocator->getUnalignedMemoryBlock().ptr == NIL) {
+			delete allocator;
+			return NIL;
+		}
 
 		DCAllocatorNode* node = new DCAllocatorNode();
-		node->allocator = ::new ChunkMemoryAllocator(chunk_size, number_of_chunks);
-
-		// If there are no allocators yet, then make it the first one.
-		if (allocators_ == NIL) {
-			allocators_ = node;
-			node->next = node->prev = NIL;
-			last_accessed_ = node->allocator;
-			number_of_allocators_++;
-			return node->allocator;
-		}
-
-		// Else, put it in the list, in order.
-		DCAllocatorNode* ptr = allocators_;
-		DCAllocatorNode* prev = NIL;
-		while(ptr) {
-			if (ptr->allocator->getBlockSize() > chunk_size) {
-				break;
-			}
-			prev = ptr;
-			ptr = ptr->next;
-		}
-		if (prev == NIL) { /* Is the smallest allocator yet, so goes on the front of the list */
-			node->prev = NIL;
-			node->next = allocators_;
-			allocators_->prev = node;
-			allocators_ = node;
-		} else if (ptr == NIL) { /* Largest yet, at end of the list */
-			node->next = NIL;
-			node->prev = prev;
-			prev->next = node;
-		} else {
-			node->prev = ptr->prev;
-			node->next = ptr;
-			prev->next = node;
-			ptr->prev = node;
+		node->allocator = allocator;
+		node->size_class = size_class;
+		node->has_free = false;
+		node->next_free = node->prev_free = NIL;
+
+		if (!mapPages(node)) {
+			unmapPages(node);
+			delete allocator;
+			delete node;
+			return NIL;
+		}
+
+		// Put it at the front of the chain for its size class.
+		node->prev = NIL;
+		node->next = classes_[size_class];
+		if (node->next) {
+			node->next->prev = node;
 		}
+		classes_[size_class] = node;
+		class_mask_ |= (1u << size_class);
+
+		addToFreeList(node);
 		number_of_allocators_++;
 		return node->allocator;
 	}
 
 	void DynamicChunkMemoryAllocator::freeChunk(U32 chunk_size) {
-		chunk_size = getNextHighestPowerOfTwo(chunk_size);
-		DCAllocatorNode* ptr = allocators_;
+		U32 size_class = getSizeClass(chunk_size);
+		if (size_class >= kNumSizeClasses || !classes_[size_class]) {
+			DERR("Allocator with chunk_size = " << getNextHighestPowerOfTwo(chunk_size) << " not found!");
+			return;
+		}
+
+		DCAllocatorNode* ptr = classes_[size_class];
 		while (ptr) {
-			if (ptr->allocator->getBlockSize() == chunk_size) {
-				break;
-			}
-			ptr = ptr->next;
+			classes_[size_class] = ptr->next;
+			unmapPages(ptr);
+			delete ptr->allocator;
+			delete ptr;
+			number_of_allocators_--;
+			ptr = classes_[size_class];
 		}
-		if (!ptr) {
-			DERR("Allocator with chunk_size = " << chunk_size << " not found!");
-			return;
+		free_classes_[size_class] = NIL;
+		class_mask_ &= ~(1u << size_class);
+		if (stats_) {
+			stats_->live_bytes -= stats_->live_blocks[size_class] << size_class;
+			stats_->live_blocks[size_class] = 0;
 		}
-		
-		if (ptr->next) {
-			ptr->next->prev = ptr->prev;
+		free_mask_ &= ~(1u << size_class);
+	}
+
+	ChunkMemoryAllocator* DynamicChunkMemoryAllocator::getChunk(U32 chunk_size) {
+		U32 size_class = getSizeClass(chunk_size);
+		if (size_class >= kNumSizeClasses || !classes_[size_class]) {
+			return NIL;
 		}
-		if (ptr->prev) {
-			ptr->prev->next = ptr->next;
+		return classes_[size_class]->allocator;
+	}
+
+	Boolean DynamicChunkMemoryAllocator::canFit(U32 block_size) const {
+		U32 size_class = getSizeClass(block_size);
+		if (size_class >= kNumSizeClasses) {
+			return false;
 		}
+		return (class_mask_ >> size_class) != 0;
+	}
 
-		if (allocators_->allocator->getBlockSize() == ptr->allocator->getBlockSize()) {
-			allocators_ = ptr->next;
+	void DynamicChunkMemoryAllocator::addToFreeList(DCAllocatorNode* node) {
+		U32 size_class = node->size_class;
+		node->prev_free = NIL;
+		node->next_free = free_classes_[size_class];
+		if (node->next_free) {
+			node->next_free->prev_free = node;
 		}
+		free_classes_[size_class] = node;
+		free_mask_ |= (1u << size_class);
+		node->has_free = true;
+	}
 
-		if (last_accessed_->getBlockSize() == ptr->allocator->getBlockSize()) {
-			if (allocators_) {
-				last_accessed_ = allocators_->allocator;
-			} else {
-				last_accessed_ = NIL;
+	void DynamicChunkMemoryAllocator::removeFromFreeList(DCAllocatorNode* node) {
+		U32 size_class = node->size_class;
+		if (node->prev_free) {
+			node->prev_free->next_free = node->next_free;
+		} else {
+			free_classes_[size_class] = node->next_free;
+		}
+		if (node->next_free) {
+			node->next_free->prev_free = node->prev_free;
+		}
+		node->next_free = node->prev_free = NIL;
+		node->has_free = false;
+		if (!free_classes_[size_class]) {
+			free_mask_ &= ~(1u << size_class);
+		}
+	}
+
+	Boolean DynamicChunkMemoryAllocator::mapPages(DCAllocatorNode* node) {
+		ChunkMemoryAllocator* allocator = node->allocator;
+		Addr start = allocator->getAlignedMemoryBlock().addr;
+		Addr end = start + ((Addr)allocator->getBlockSize() * allocator->getNumberOfBlocks());
+		for (Addr page = start >> kPageShift; page <= ((end - 1) >> kPageShift); page++) {
+			if (!insertPage(page, node)) {
+				return false;
 			}
 		}
+		return true;
+	}
 
-		delete ptr->allocator;
-		delete ptr;
-		number_of_allocators_--;
+	void DynamicChunkMemoryAllocator::unmapPages(DCAllocatorNode* node) {
+		ChunkMemoryAllocator* allocator = node->allocator;
+		Addr start = allocator->getAlignedMemoryBlock().addr;
+		Addr end = start + ((Addr)allocator->getBlockSize() * allocator->getNumberOfBlocks());
+		for (Addr page = start >> kPageShift; page <= ((end - 1) >> kPageShift); page++) {
+			removePage(page);
+		}
 	}
 
-	ChunkMemoryAllocator* DynamicChunkMemoryAllocator::getChunk(U32 chunk_size) {
-		chunk_size = getNextHighestPowerOfTwo(chunk_size);
-		DCAllocatorNode* ptr = allocators_;
-		while (ptr) {
-			if (ptr->allocator->getBlockSize() == chunk_size) {
-				break;
+	DCAllocatorNode* DynamicChunkMemoryAllocator::findPage(Addr page) const {
+		if (page_map_size_ == 0) {
+			return NIL;
+		}
+		U32 mask = page_map_capacity_ - 1;
+		U32 idx = hashPage(page) & mask;
+		while (page_map_[idx].node) {
+			if (page_map_[idx].page == page) {
+				return page_map_[idx].node;
 			}
-			ptr = ptr->next;
+			idx = (idx + 1) & mask;
 		}
-		if (!ptr) { return NIL; }
-		return ptr->allocator;
+		return NIL;
 	}
 
-	Boolean DynamicChunkMemoryAllocator::canFit(U32 block_size) const {
-		DCAllocatorNode* ptr = allocators_;	
-		while (ptr) { 
-			if (ptr->allocator->getBlockSize() >= block_size) { 
-				return true; 
-			} 
-			ptr = ptr->next; 
+	Boolean DynamicChunkMemoryAllocator::insertPage(Addr page, DCAllocatorNode* node) {
+		// Keep the load factor at or below one half, or at least one slot empty if the map cannot grow.
+		if ((page_map_size_ + 1) * 2 > page_map_capacity_ &&
+			 !resizePageMap(page_map_capacity_ ? page_map_capacity_ * 2 : 64) &&
+			 page_map_size_ + 1 >= page_map_capacity_) {
+			return false;
+		}
+		U32 mask = page_map_capacity_ - 1;
+		U32 idx = hashPage(page) & mask;
+		while (page_map_[idx].node) {
+			idx = (idx + 1) & mask;
 		}
-		return false;
+		page_map_[idx].page = page;
+		page_map_[idx].node = node;
+		page_map_size_++;
+		return true;
 	}
 
+	/*
+	 * Removes the page by shifting the following entries of the probe sequence back,
+	 * so no tombstones are needed.
+	 */
+	void DynamicChunkMemoryAllocator::removePage(Addr page) {
+		if (page_map_size_ == 0) {
+			return;
+		}
+		U32 mask = page_map_capacity_ - 1;
+		U32 idx = hashPage(page) & mask;
+		while (page_map_[idx].node && page_map_[idx].page != page) {
+			idx = (idx + 1) & mask;
+		}
+		if (!page_map_[idx].node) {
+			return;
+		}
+
+		U32 next = idx;
+		for (;;) {
+			next = (next + 1) & mask;
+			if (!page_map_[next].node) {
+				break;
+			}
+			U32 home = hashPage(page_map_[next].page) & mask;
+			// Move the entry back only if its home slot is not between the hole and itself.
+			if (((next - home) & mask) >= ((next - idx) & mask)) {
+				page_map_[idx] = page_map_[next];
+				idx = next;
+			}
+		}
+		page_map_[idx].node = NIL;
+		page_map_size_--;
+	}
+
+	Boolean DynamicChunkMemoryAllocator::resizePageMap(U32 capacity) {
+		DCPageEntry* new_map = (DCPageEntry*)calloc(capacity, sizeof(DCPageEntry));
+		if (!new_map) {
+			DERR("Cannot allocate a page map of " << capacity << " entries, keeping the old one!");
+			return false;
+		}
+
+		DCPageEntry* old_map = page_map_;
+		U32 old_capacity = page_map_capacity_;
+		page_map_ = new_map;
+		page_map_capacity_ = capacity;
+		page_map_size_ = 0;
+
+		for (U32 i = 0; i < old_capacity; i++) {
+			if (old_map[i].node) {
+				insertPage(old_map[i].page, old_map[i].node);
+			}
+		}
+		::free(old_map);
+		return true;
+	}
 
 } // namespace Cat
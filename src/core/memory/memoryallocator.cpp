@@ -1,6 +1,44 @@
 #include "core/memory/memoryallocator.h"
+#include "core/time/time.h"
 
 namespace Cat {
 
+	MemoryAllocator::~MemoryAllocator() {
+		delete stats_;
+		stats_ = NIL;
+	}
+
+	void MemoryAllocator::enableStats(Boolean enable) {
+		if (enable && !stats_) {
+			stats_ = new AllocatorStats();
+			stats_->clear();
+		} else if (!enable && stats_) {
+			delete stats_;
+			stats_ = NIL;
+		}
+	}
+
+	Boolean MemoryAllocator::getStats(AllocatorStats* stats) {
+		if (!stats_) {
+			return false;
+		}
+		*stats = *stats_;
+		stats->capacity_bytes = getCapacity();
+		return true;
+	}
+
+	void MemoryAllocator::dumpStats(std::ostream& out) {
+		AllocatorStats stats;
+		if (!getStats(&stats)) {
+			out << "MemoryAllocator " << std::dec << getOID() << ": no statistics." << std::endl;
+			return;
+		}
+		out << "MemoryAllocator " << std::dec << getOID() << ":" << std::endl;
+		dumpAllocatorStats(out, stats);
+	}
+
+	U64 MemoryAllocator::getStatsTime() {
+		return Time::currentTimeNano();
+	}
 
 }
@@ -1,6 +1,7 @@
 #include <cstring>
 #include "core/memory/memorymanager.h"
 #include "core/memory/poolmemoryallocator.h"
+#include "core/memory/concurrentpoolmemoryallocator.h"
 #include "core/memory/stackmemoryallocator.h"
 #include "core/memory/chunkmemoryallocator.h"
 #include "core/memory/dynamicchunkmemoryallocator.h"
@@ -74,9 +75,10 @@ namespace Cat {
 	}
 
 	/**
-	 * Creates a new PoolAllocator and returns the OID for it.  The OID is zero only on error.
+	 * Creates a new PoolAllocator (or ConcurrentPoolAllocator) and returns the OID for it.
+	 * The OID is zero only on error.
 	 */
-	OID MemoryManager::createPoolAllocator(U32 block_size, U32 number_of_blocks, U32 alignment) {
+	OID MemoryManager::createPoolAllocator(U32 block_size, U32 number_of_blocks, U32 alignment, BitField32 flags, I32 numa_node) {
 		if (length_ >= list_size_-1) {
 			DWARN("To Many Allocators already created (" << length_ << ").  Try increasing the number of max_allocators?");
 			return 0;
@@ -87,7 +89,14 @@ namespace Cat {
 			return 0;
 		}
 
-		allocator_list_[id] = new PoolMemoryAllocator(block_size, number_of_blocks, alignment, id);
+		if (flags & AllocatorFlags::kAFConcurrent) {
+			allocator_list_[id] = new ConcurrentPoolMemoryAllocator(block_size, number_of_blocks, alignment, 32, id, flags, numa_node);
+		} else {
+			allocator_list_[id] = new PoolMemoryAllocator(block_size, number_of_blocks, alignment, id, flags, numa_node);
+		}
+		if (flags & AllocatorFlags::kAFStats) {
+			allocator_list_[id]->enableStats(true);
+		}
 		length_++;
 		return id;
 	}
@@ -95,7 +104,7 @@ namespace Cat {
 	/**
 	 * Creates a new StackAllocator and returns the OID for it.  The OID is zero only on error.
 	 */
-	OID MemoryManager::createStackAllocator(U32 stack_size) {
+	OID MemoryManager::createStackAllocator(U32 stack_size, BitField32 flags, I32 numa_node) {
 		if (length_ >= list_size_-1) {
 			DWARN("To Many Allocators already created (" << length_ << ").  Try increasing the number of max_allocators?");
 			return 0;
@@ -106,12 +115,15 @@ namespace Cat {
 			return 0;
 		}
 
-		allocator_list_[id] = new StackMemoryAllocator(stack_size, id);
+		allocator_list_[id] = new StackMemoryAllocator(stack_size, id, flags, numa_node);
+		if (flags & AllocatorFlags::kAFStats) {
+			allocator_list_[id]->enableStats(true);
+		}
 		length_++;
 		return id;
 	}
 
-	OID MemoryManager::createChunkAllocator(U32 chunk_size, U32 number_of_chunks) {
+	OID MemoryManager::createChunkAllocator(U32 chunk_size, U32 number_of_chunks, BitField32 flags, I32 numa_node) {
 		if (length_ >= list_size_-1) {
 			DWARN("To Many Allocators already created (" << length_ << ").  Try increasing the number of max_allocators?");
 			return 0;
@@ -122,13 +134,16 @@ namespace Cat {
 			return 0;
 		}
 
-		allocator_list_[id] = new ChunkMemoryAllocator(chunk_size, number_of_chunks, id);
+		allocator_list_[id] = new ChunkMemoryAllocator(chunk_size, number_of_chunks, id, 0, flags, numa_node);
+		if (flags & AllocatorFlags::kAFStats) {
+			allocator_list_[id]->enableStats(true);
+		}
 		length_++;
 		return id;
 
 	}
 
-	OID MemoryManager::createDynamicChunkAllocator(U32 default_number_of_chunks) {
+	OID MemoryManager::createDynamicChunkAllocator(U32 default_number_of_chunks, BitField32 flags) {
 		if (length_ >= list_size_-1) {
 			DWARN("To Many Allocators already created (" << length_ << ").  Try increasing the number of max_allocators?");
 			return 0;
@@ -140,6 +155,9 @@ namespace Cat {
 		}
 
 		allocator_list_[id] = new DynamicChunkMemoryAllocator(default_number_of_chunks, id);
+		if (flags & AllocatorFlags::kAFStats) {
+			allocator_list_[id]->enableStats(true);
+		}
 		length_++;
 		return id;
 
@@ -177,6 +195,31 @@ namespace Cat {
 		return list_size_-1;
 	}
 
+	U32 MemoryManager::getStats(AllocatorStats* stats) {
+		stats->clear();
+		U32 count = 0;
+		AllocatorStats allocator_stats;
+		for (OID id = 1; id < list_size_; id++) {
+			if (allocator_list_[id] && allocator_list_[id]->getStats(&allocator_stats)) {
+				stats->merge(allocator_stats);
+				count++;
+			}
+		}
+		return count;
+	}
+
+	void MemoryManager::dumpStats(std::ostream& out) {
+		for (OID id = 1; id < list_size_; id++) {
+			if (allocator_list_[id] && allocator_list_[id]->isStatsEnabled()) {
+				allocator_list_[id]->dumpStats(out);
+			}
+		}
+		AllocatorStats stats;
+		U32 count = getStats(&stats);
+		out << "MemoryManager totals (" << count << " allocators):" << std::endl;
+		dumpAllocatorStats(out, stats);
+	}
+
 
 	/**
 	 * Finds the next available object id to return.
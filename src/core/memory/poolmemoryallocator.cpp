@@ -8,9 +8,10 @@ namespace Cat {
  	 * free memory blocks, using the blocks themselves to store the pointers 
  	 * for the linked list.
  	 */
-	PoolMemoryAllocator::PoolMemoryAllocator(U32 block_size, U32 number_of_blocks, U32 block_alignment, OID id) {
+	PoolMemoryAllocator::PoolMemoryAllocator(U32 block_size, U32 number_of_blocks, U32 block_alignment, OID id, BitField32 flags, I32 numa_node) {
 		next_block_.ptr = NIL;
 		unaligned_memory_block_.ptr = NIL;
+		backing_.source = BS_NONE;
 		id_ = id;
 		// Make sure the block_size is >= the size of a pointer
 		if (block_size < sizeof(VPtr)) {
@@ -24,7 +25,8 @@ namespace Cat {
 		// First, allocate the total amount of memory we need, plus the alignment size
 		// to allow us to align the memory properly
 		U32 memory_to_allocate = (block_size * number_of_blocks) + block_alignment;
-		unaligned_memory_block_.ptr = malloc(memory_to_allocate);
+		allocBackingMemory(&backing_, memory_to_allocate, flags, numa_node);
+		unaligned_memory_block_.ptr = backing_.ptr;
 		if (!unaligned_memory_block_.ptr) {
 			DERR("Failed to get memory for PoolMemoryAllocator!");
 			return;
@@ -53,13 +55,16 @@ namespace Cat {
 	 * block is fixed.  If there are no free blocks, null is returned
 	 */
 	VPtr PoolMemoryAllocator::alloc() {
+		U64 start = stats_ ? getStatsTime() : 0;
 		if (next_block_.ptr == NIL) {
 			DWARN("No more free blocks to give!");
+			if (stats_) { stats_->recordFailure(); }
 			return NIL;
 		}
 
 		VPtr memory_block = next_block_.ptr;
 		next_block_.addr = (*((Addr*)next_block_.ptr));
+		if (stats_) { stats_->recordAlloc(block_size_, getStatsTime() - start); }
 		return memory_block;
 	}
 
@@ -75,6 +80,7 @@ namespace Cat {
 		
 		MemAddr* block_ptr = (MemAddr*)memory_block;
 		*block_ptr = current_block_address;
+		if (stats_) { stats_->recordDealloc(block_size_); }
 	}
 
 	void PoolMemoryAllocator::dealloc() {
@@ -108,6 +114,7 @@ namespace Cat {
 		*block_ptr = NIL;
 
 		next_block_ = aligned_memory_block_;
+		if (stats_) { stats_->recordReset(); }
 	}
 
 	void PoolMemoryAllocator::free() {
@@ -117,7 +124,7 @@ namespace Cat {
 			return;
 		}
 
-		::free(unaligned_memory_block_.ptr);
+		freeBackingMemory(&backing_);
 		unaligned_memory_block_.ptr = next_block_.ptr = aligned_memory_block_.ptr = NIL;
 	}
 
@@ -125,5 +132,9 @@ namespace Cat {
 		return id_;
 	}
 
+	U64 PoolMemoryAllocator::getCapacity() {
+		return (U64)block_size_ * number_of_blocks_;
+	}
+
 
 } // namespace Cat
@@ -9,9 +9,15 @@ namespace Cat {
 	 * Essentially works as a doubly ended stack, with the markers going down from the top.
 	 * @param stack_size The size of the stack in bytes
 	 */
-	StackMemoryAllocator::StackMemoryAllocator(U32 stack_size, OID id) {
+	StackMemoryAllocator::StackMemoryAllocator(U32 stack_size, OID id, BitField32 flags, I32 numa_node) {
 		id_ = id;
-		unaligned_memory_block_.ptr = next_block_.ptr = malloc(stack_size);
+		flags_ = flags;
+		numa_node_ = numa_node;
+		current_block_ = spare_block_ = NIL;
+		chained_size_ = 0;
+		number_of_chained_blocks_ = 0;
+		allocBackingMemory(&backing_, stack_size, flags, numa_node);
+		unaligned_memory_block_.ptr = next_block_.ptr = backing_.ptr;
 		if (!unaligned_memory_block_.ptr) {
 			DERR("Failed to get memory for StackMemoryAllocator!");
 			return;
@@ -37,16 +43,24 @@ namespace Cat {
 	 * @return a VPtr to the block of memory, or NIL if error
 	 */
 	VPtr StackMemoryAllocator::alloc(U32 block_size, U32 alignment) {
+		U64 start = stats_ ? getStatsTime() : 0;
 		// Calculate the aligned memory block from the next_block_
 		MemAddr aligned_memory_addr = MemoryAllocator::getAlignedMemoryAddress(next_block_, alignment);
 
-		// Make sure we don't collide with the markers
-		if (aligned_memory_addr.addr + block_size > marker_.addr) {
-			DERR("Cannot allocate block of size " << block_size << ", collides with top of stack!");
-			return NIL;
+		// Make sure we don't collide with the markers (or the end of a chained block)
+		if (aligned_memory_addr.addr + block_size > limit_.addr) {
+			if (!(flags_ & AllocatorFlags::kAFGrowable) || !chainBlock(block_size, alignment)) {
+				DERR("Cannot allocate block of size " << block_size << ", collides with top of stack!");
+				if (stats_) { stats_->recordFailure(); }
+				return NIL;
+			}
+			aligned_memory_addr = MemoryAllocator::getAlignedMemoryAddress(next_block_, alignment);
 		}
 
+		// The bytes skipped for alignment count as used, so the peak is the real high water mark.
+		U32 used = (U32)(aligned_memory_addr.addr + block_size - next_block_.addr);
 		next_block_.addr = (aligned_memory_addr.addr + block_size);
+		if (stats_) { stats_->recordAlloc(used, getStatsTime() - start, false); }
 		return aligned_memory_addr.ptr;
 
 
@@ -73,33 +87,74 @@ namespace Cat {
 		mark_addr = *((MemAddr*)marker_.ptr);
 		if (mark_addr.ptr == 0) { 
 			// No markers, deallocate to beginning
-			next_block_ = unaligned_memory_block_;
+			rollback(unaligned_memory_block_);
 		} else {
-			next_block_.ptr = mark_addr.ptr;
 			marker_.addr = (marker_.addr + sizeof(VPtr));
+			if (!current_block_) {
+				limit_ = marker_;
+			}
+			rollback(mark_addr);
 		}
 	}
-	
+
 	/**
-	 * dealloc(memory_block) with a specific memory_block prints an error.
+	 * Rolls the stack back to a marker, popping (and poisoning) every chained block
+	 * allocated after it.
+	 */
+	void StackMemoryAllocator::rollback(const StackMarker& marker) {
+		// Find the block the marker is in first, a stale or foreign marker changes nothing.
+		Addr top = next_block_.addr;
+		ChainedBlock* block = current_block_;
+		while (block && !(marker.addr >= (Addr)(block + 1) && marker.addr <= top)) {
+			top = block->prev_next_block.addr;
+			block = block->prev_block;
+		}
+		if (!block && !(marker.addr >= unaligned_memory_block_.addr && marker.addr <= top)) {
+			DERR("Cannot roll back to " << std::hex << marker.addr << ", it is not on the stack!");
+			return;
+		}
+
+		U64 released = 0;
+		while (current_block_ != block) {
+			Addr block_start = (Addr)(current_block_ + 1);
+			released += next_block_.addr - block_start;
+			poison(block_start, next_block_.addr);
+			popChainedBlock();
+		}
+		released += next_block_.addr - marker.addr;
+		poison(marker.addr, next_block_.addr);
+		next_block_ = marker;
+		if (stats_) { stats_->recordRelease(released); }
+	}
+
+	/**
+	 * dealloc(memory_block) with a specific memory_block does nothing, the block is 
+	 * released with the rest of the stack by dealloc() or reset().
 	 */
 	void StackMemoryAllocator::dealloc(VPtr memory_block) {
 		CC_UNUSED(memory_block);
-		DERR("Cannot dealloc() a specific memory block, must use markers!");
 	}
 
 	/**
 	 * Resets the StackMemoryAllocator to the initial state, removes all markers.
 	 */
 	void StackMemoryAllocator::reset() {
+		while (current_block_) {
+			poison((Addr)(current_block_ + 1), next_block_.addr);
+			popChainedBlock();
+		}
+		poison(unaligned_memory_block_.addr, next_block_.addr);
+
 		// Find the address for the first (NIL) marker
 		MemAddr marker_addr;
 		marker_addr.addr = unaligned_memory_block_.addr + stack_size_ - sizeof(VPtr);
 		marker_ = MemoryAllocator::getAlignedMemoryAddress(marker_addr, sizeof(VPtr));
 		*((Addr*)(marker_.ptr)) = NIL;
+		limit_ = marker_;
 
 		// Reset the next_block_ to the original address
 		next_block_ = unaligned_memory_block_;
+		if (stats_) { stats_->recordReset(); }
 	}
 
 	/**
@@ -113,7 +168,15 @@ namespace Cat {
 			return;
 		}
 
-		::free(unaligned_memory_block_.ptr);
+		while (current_block_) {
+			popChainedBlock();
+		}
+		if (spare_block_) {
+			BackingMemory spare = spare_block_->backing;
+			freeBackingMemory(&spare);
+			spare_block_ = NIL;
+		}
+		freeBackingMemory(&backing_);
 		unaligned_memory_block_.ptr = next_block_.ptr = marker_.ptr = NIL;
 
 	}
@@ -125,17 +188,88 @@ namespace Cat {
 	void StackMemoryAllocator::mark() {
 		MemAddr marker_addr = marker_;
 		marker_addr.addr -= sizeof(VPtr);
+
+		// The markers are always kept at the top of the initial block.
+		Addr top = next_block_.addr;
+		for (ChainedBlock* block = current_block_; block; block = block->prev_block) {
+			top = block->prev_next_block.addr;
+		}
+		if (marker_addr.addr < top) {
+			DERR("Cannot place marker, collides with the allocated blocks!");
+			return;
+		}
 		
 		MemAddr* marker = (MemAddr*)marker_addr.ptr;
 		*marker = next_block_;
 
 		marker_ = marker_addr;
+		if (!current_block_) {
+			limit_ = marker_;
+		}
+	}
+
+	/**
+	 * Switches to a new chained block big enough for the allocation, reusing the spare
+	 * block if it is big enough.
+	 */
+	Boolean StackMemoryAllocator::chainBlock(U32 block_size, U32 alignment) {
+		Size needed = sizeof(ChainedBlock) + block_size + alignment;
+		ChainedBlock* block = NIL;
+		if (spare_block_) {
+			if ((Size)(spare_block_->end.addr - (Addr)spare_block_) >= needed) {
+				block = spare_block_;
+			} else {
+				BackingMemory spare = spare_block_->backing;
+				freeBackingMemory(&spare);
+			}
+			spare_block_ = NIL;
+		}
+		if (!block) {
+			BackingMemory backing;
+			if (!allocBackingMemory(&backing, needed > stack_size_ ? needed : stack_size_, flags_, numa_node_)) {
+				DERR("Failed to get memory to chain a new block to the StackMemoryAllocator!");
+				return false;
+			}
+			block = (ChainedBlock*)backing.ptr;
+			block->backing = backing;
+			block->end.addr = (Addr)backing.ptr + backing.size;
+		}
+		block->prev_block = current_block_;
+		block->prev_next_block = next_block_;
+		current_block_ = block;
+		next_block_.ptr = (VPtr)(block + 1);
+		limit_ = block->end;
+		chained_size_ += limit_.addr - next_block_.addr;
+		number_of_chained_blocks_++;
+		return true;
+	}
+
+	/**
+	 * Goes back to the previous block, keeping the current one as the spare block.
+	 */
+	void StackMemoryAllocator::popChainedBlock() {
+		ChainedBlock* block = current_block_;
+		current_block_ = block->prev_block;
+		next_block_ = block->prev_next_block;
+		limit_ = current_block_ ? current_block_->end : marker_;
+		chained_size_ -= block->end.addr - (Addr)(block + 1);
+		number_of_chained_blocks_--;
+
+		if (spare_block_) {
+			BackingMemory spare = spare_block_->backing;
+			freeBackingMemory(&spare);
+		}
+		spare_block_ = block;
 	}
 
 	OID StackMemoryAllocator::getOID() {
 		return id_;
 	}
 
+	U64 StackMemoryAllocator::getCapacity() {
+		return stack_size_ + chained_size_;
+	}
+
 
 
 } // namespace Cat
@@ -11,7 +11,11 @@ namespace Cat {
 		if (!handlers) {
 			handlers = new Vector<SignalHandler>(4);			
 			DMSG("Creating new signal handler vector for signal " << name);			
-			m_signalMap.insert(name, handlers);
+			if (!m_signalMap.insert(name, handlers)) {
+				DERR("Failed to add signal " << name << ", the signal map cannot grow!");
+				delete handlers;
+				return false;
+			}
 		}
 		
 		for (Size i = 0; i < handlers->size(); ++i) {
@@ -20,8 +24,7 @@ namespace Cat {
 				return false;
 			}
 		}			
-		handlers->append(handler);
-		return true;			
+		return handlers->append(handler);
 	}
 
 	Boolean SignalEmitter::disconnect(OID name, const SignalHandler& handler) {
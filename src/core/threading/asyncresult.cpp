@@ -4,34 +4,64 @@
 namespace Cat {
 
 	Boolean AsyncResult::waitForResult() {
-		m_resultSync.lock();
+		m_resultLock.lock();
 		while (m_pTask && !m_complete) {
-			m_resultSync.wait();
+			m_resultSignal.wait(m_resultLock);
 		}
-		m_resultSync.unlock();
-		return (m_complete);
+		Boolean complete = m_complete;
+		m_resultLock.unlock();
+		return complete;
 	}
 
 	void AsyncResult::destroy() {
-		m_resultSync.lock();
+		m_resultLock.lock();
 		if (m_pTask) {
 			m_pTask->resultDestroyed();
 			m_pTask = NIL;
 		}
-		m_resultSync.unlock();
+		AsyncResultListener* listener = m_pListener;
+		m_pListener = NIL;
+		m_resultLock.unlock();
+		if (listener) {
+			listener->resultCompleted(this);
+		}
 	}
 
 	void AsyncResult::detach() {
-		m_resultSync.lock();
+		m_resultLock.lock();
 		m_pTask = NIL;
 		// Broadcast incase someone is waiting for the result.
-		m_resultSync.broadcast();
-		m_resultSync.unlock();
+		m_resultSignal.broadcast();
+		AsyncResultListener* listener = m_pListener;
+		m_pListener = NIL;
+		m_resultLock.unlock();
+		if (listener) {
+			listener->resultCompleted(this);
+		}
 	}
-	
-	
 
+	void AsyncResult::setListener(AsyncResultListener* listener) {
+		m_resultLock.lock();
+		if (m_complete || !m_pTask) {
+			m_resultLock.unlock();
+			listener->resultCompleted(this);
+			return;
+		}
+		m_pListener = listener;
+		m_resultLock.unlock();
+	}
 
-	
+	void AsyncResult::complete() {
+		m_resultLock.lock();
+		m_complete = true;
+		m_resultSignal.broadcast();
+		// Taken so the listener is only told once, even if the task is detached after.
+		AsyncResultListener* listener = m_pListener;
+		m_pListener = NIL;
+		m_resultLock.unlock();
+		if (listener) {
+			listener->resultCompleted(this);
+		}
+	}
 
 } // namespace Cat
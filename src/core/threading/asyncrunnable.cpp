@@ -55,10 +55,7 @@ namespace Cat {
 	//
 
 	void AsyncRunnableResult::taskCompleted() {
-		resultSync().lock();
-	   setComplete(true);		
-		resultSync().broadcast();
-	   resultSync().unlock();
+		complete();
 	}
 
 } // namespace Cat
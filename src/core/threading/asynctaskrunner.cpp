@@ -5,113 +5,189 @@
 namespace Cat {
 
 	AsyncTaskRunner::AsyncTaskRunner() {
-		initAsyncTaskRunner(8);
+		initAsyncTaskRunner(8, SCHEDULE_WORK_STEALING);
 	}
 
 	AsyncTaskRunner::AsyncTaskRunner(U32 number_of_threads) {
-		initAsyncTaskRunner(number_of_threads);
+		initAsyncTaskRunner(number_of_threads, SCHEDULE_WORK_STEALING);
+	}
+
+	AsyncTaskRunner::AsyncTaskRunner(U32 number_of_threads, AsyncTaskSchedule schedule) {
+		initAsyncTaskRunner(number_of_threads, schedule);
 	}
 
 	AsyncTaskRunner::~AsyncTaskRunner() {
 		stop(); // Make sure the threads are all finished first.
 		if (runners_) {
-			// Delete all the threads runners.
+			// Delete all the threads runners, and any tasks left behind (shouldn't be any).
 			for(U32 i = 0; i < number_of_threads_; i++) {
+				AsyncTask* task;
+				while ((task = runners_[i]->deque_.steal())) {
+					discardTask(task);
+				}
+				while ((task = runners_[i]->takeInbox())) {
+					discardTask(task);
+				}
 				delete runners_[i];
 			}
 			delete[] runners_;
 			runners_ = NIL;
 		}
-		
-		if (sync_controller_) {
-			delete sync_controller_;
-			sync_controller_ = NIL;
-		}
-
-		// Delete any remaining tasks in the queue. (Shouldn't be any)
-		AsyncTaskQueuedItem* task = first_;
-		while(task) {
-			first_ = first_->next;
-			task->task->onCompletion();
-			if (task->task->isDestroyable()) {
-				task->task->destroy();
-				delete task->task;
+		if (priority_queue_) {
+			AsyncTask* task;
+			while ((task = priority_queue_->pop())) {
+				discardTask(task);
 			}
-			delete task;
-			task = first_;
+			delete priority_queue_;
+			priority_queue_ = NIL;
 		}
-		first_ = last_ = NIL;
+#if defined (OS_WINDOWS)
+		TlsFree(thread_key_);
+#else
+		pthread_key_delete(thread_key_);
+#endif
 	}
 
 	/**
 	 * The method to stop the runner.
-	 * After it's stopped, it can no longer accept any new tasks, and the 
-	 * remaining tasks in the queue are run.  The Runner waits until all the 
+	 * After it's stopped, it can no longer accept any new tasks, and the
+	 * remaining tasks in the queues are run.  The Runner waits until all the
 	 * tasks are finished.
 	 */
 	void AsyncTaskRunner::stop() {
 		if (state_ == RUNNER_STARTED && runners_) {
-			sync_controller_->lock();
 			state_ = RUNNER_STOPPING;
-			sync_controller_->broadcast();
-			sync_controller_->unlock();
+			memoryBarrier();
+			for(U32 i = 0; i < number_of_threads_; i++) {
+				runners_[i]->unpark();
+			}
 
 			// Wait on all the threads to finish.
 			for(U32 i = 0; i < number_of_threads_; i++) {
-				//sync_controller_->broadcast();
 				Thread::join(runners_[i]->getThread());
 			}
 			state_ = RUNNER_STOPPED;
 		}
-		
+
 	}
 
 	/**
 	 * The method to try and run a task with this AsyncTaskRunner.
-	 * The Task gets put onto the queue of tasks to run, then the ConditionVariable 
-	 * is signalled.  If there is a thread waiting for a task, it will then wake up and 
-	 * pull the next task off the queue.  If there are no waiting threads, then each thread, once 
-	 * finished, checks to see if there is something yummy in the queue, and pulls it off to run it.
+	 * If called from one of the runner's threads, the task goes on that thread's deque
+	 * (even while the runner is stopping),
+	 * otherwise it goes in the inbox of the next thread in turn.  With SCHEDULE_PRIORITY it
+	 * goes in the shared priority queue instead.  Then one parked thread (if any) is woken 
+	 * up to run it, or steal it.
 	 * @param task The AsyncTask to run on this AsyncTaskRunner.
 	 * @return The AsyncResult associated with the AsyncTask we're running.
 	 */
 	AsyncResult* AsyncTaskRunner::run(AsyncTask* task) {
-		sync_controller_->lock();
-		if (state_ == RUNNER_STARTED) {
-			if (!last_) {
-				first_ = last_ = new AsyncTaskQueuedItem(task);
-			} else {
-				last_->next = new AsyncTaskQueuedItem(task, last_);
-				last_ = last_->next;
+		AsyncResult* result = task->getResult();
+		AsyncTaskRunnerThread* current = getCurrentThread();
+		// A running task can still add tasks while stopping, its thread runs them before exiting.
+		if (state_ != RUNNER_STARTED && !current) {
+			DWARN("Cannot run a task, the AsyncTaskRunner is stopped!");
+			// Completed without running, the result goes with the task if it is destroyed.
+			if (task->isDestroyable() && task->willDestroyResultOnTaskDestruction()) {
+				result = NIL;
 			}
-			// Signal a thread to wakeup if there is one to wakeup.
-			sync_controller_->signal();
+			discardTask(task);
+			return result;
+		}
+
+		U32 preferred;
+		if (priority_queue_) {
+			priority_queue_->push(task);
+			preferred = current ? (current->id_ + 1) % number_of_threads_ : 0;
+		} else if (current) {
+			current->deque_.push(task);
+			preferred = (current->id_ + 1) % number_of_threads_;
+		} else {
+			preferred = (U32)next_inbox_.increment() % number_of_threads_;
+			runners_[preferred]->pushInbox(task);
+		}
+		// Pairs with the barrier in park(), either we see the parked thread or it sees the task.
+		memoryBarrier();
+		if (parked_threads_.val() > 0) {
+			wakeThread(preferred);
 		}
-		sync_controller_->unlock();
-		return task->getResult();
+		return result;
+	}
+
+	AsyncTaskRunnerThread* AsyncTaskRunner::getCurrentThread() const {
+#if defined (OS_WINDOWS)
+		return (AsyncTaskRunnerThread*)TlsGetValue(thread_key_);
+#else
+		return (AsyncTaskRunnerThread*)pthread_getspecific(thread_key_);
+#endif
 	}
 
 	/**
-	 * The initAsyncTaskRunner method initializes the AsyncTaskRunner with the 
+	 * The initAsyncTaskRunner method initializes the AsyncTaskRunner with the
 	 * specified number of threads.
 	 * @param number_of_threads The number of threads to have running.
+	 * @param schedule How the next task to run is picked.
 	 */
-	void AsyncTaskRunner::initAsyncTaskRunner(U32 number_of_threads) {
-		last_ = first_ = NIL;
+	void AsyncTaskRunner::initAsyncTaskRunner(U32 number_of_threads, AsyncTaskSchedule schedule) {
 		runners_ = NIL;
-		sync_controller_ = new ConditionVariable();
-		sync_controller_->lock();
+		priority_queue_ = (schedule == SCHEDULE_PRIORITY) ? new AsyncTaskPriorityQueue() : NIL;
+		state_ = RUNNER_STARTED;
+		if (number_of_threads == 0) {
+			DWARN("Cannot create an AsyncTaskRunner with no threads, using one thread.");
+			number_of_threads = 1;
+		}
+#if defined (OS_WINDOWS)
+		thread_key_ = TlsAlloc();
+#else
+		pthread_key_create(&thread_key_, NIL);
+#endif
 
+		// Create all the threads before starting any, since they steal from each other.
 		number_of_threads_ = number_of_threads;
 		runners_ = new AsyncTaskRunnerThread*[number_of_threads_];
 		for(U32 i = 0; i < number_of_threads_; i++) {
 			runners_[i] = new AsyncTaskRunnerThread(this, i);
+		}
+		memoryBarrier();
+		for(U32 i = 0; i < number_of_threads_; i++) {
 			Thread::run(runners_[i]);
 		}
+	}
 
-		state_ = RUNNER_STARTED;
-		sync_controller_->unlock();
-		
+	void AsyncTaskRunner::wakeThread(U32 preferred) {
+		for (U32 i = 0; i < number_of_threads_; i++) {
+			if (runners_[(preferred + i) % number_of_threads_]->unpark()) {
+				return;
+			}
+		}
+	}
+
+	Boolean AsyncTaskRunner::hasQueuedTasks() const {
+		if (priority_queue_ && !priority_queue_->isEmpty()) {
+			return true;
+		}
+		for (U32 i = 0; i < number_of_threads_; i++) {
+			if (runners_[i]->hasQueuedTasks()) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void AsyncTaskRunner::discardTask(AsyncTask* task) {
+		task->onCompletion();
+		if (task->isDestroyable()) {
+			task->destroy();
+			delete task;
+		}
+	}
+
+	AsyncTaskRunnerThread::AsyncTaskRunnerThread(AsyncTaskRunner* runner, U32 id)
+		: runner_(runner), id_(id) {
+		random_ = 2463534242U ^ (id * 0x9E3779B9U);
+		if (!random_) {
+			random_ = 1;
+		}
 	}
 
 	AsyncTaskRunnerThread::~AsyncTaskRunnerThread() {
@@ -119,40 +195,110 @@ namespace Cat {
 	}
 
 	AsyncTask* AsyncTaskRunnerThread::getTaskToRun() {
-		if (!runner_->first_) {
-			return NIL;
+		if (runner_->priority_queue_) {
+			return runner_->priority_queue_->pop();
+		}
+		AsyncTask* task = deque_.pop();
+		if (!task) {
+			task = takeInbox();
 		}
-		AsyncTaskQueuedItem* item = runner_->first_;
-		if (!item->next) {
-			runner_->first_ = runner_->last_ = NIL;
+		if (!task) {
+			task = stealTask();
+		}
+		return task;
+	}
 
-		} else {
-			runner_->first_ = item->next;
-			//runner_->sync_controller_->signal();
+	void AsyncTaskRunnerThread::pushInbox(AsyncTask* task) {
+		inbox_lock_.lock();
+		inbox_.push(task);
+		inbox_count_.increment();
+		inbox_lock_.unlock();
+	}
+
+	AsyncTask* AsyncTaskRunnerThread::takeInbox() {
+		if (!inbox_count_.val()) {
+			return NIL;
+		}
+		inbox_lock_.lock();
+		AsyncTask* task = inbox_.pop();
+		if (task) {
+			inbox_count_.decrement();
 		}
-		AsyncTask* task = item->task;
-		delete item;
+		inbox_lock_.unlock();
 		return task;
 	}
 
+	AsyncTask* AsyncTaskRunnerThread::stealTask() {
+		U32 count = runner_->number_of_threads_;
+		if (count < 2) {
+			return NIL;
+		}
+		random_ ^= random_ << 13;
+		random_ ^= random_ >> 17;
+		random_ ^= random_ << 5;
+		U32 start = random_ % count;
+		for (U32 i = 0; i < count; i++) {
+			AsyncTaskRunnerThread* victim = runner_->runners_[(start + i) % count];
+			if (victim == this) {
+				continue;
+			}
+			AsyncTask* task = victim->deque_.steal();
+			if (!task) {
+				task = victim->takeInbox();
+			}
+			if (task) {
+				return task;
+			}
+		}
+		return NIL;
+	}
+
+	void AsyncTaskRunnerThread::park() {
+		park_lock_.lock();
+		parked_.set(1);
+		runner_->parked_threads_.increment();
+		// Look again now that we are marked as parked, a task run before may not have seen us.
+		if (runner_->state_ != RUNNER_STARTED || runner_->hasQueuedTasks()) {
+			if (parked_.compareAndSwap(1, 0)) {
+				runner_->parked_threads_.decrement();
+			}
+		}
+		while (parked_.val() == 1) {
+			park_signal_.wait(park_lock_);
+		}
+		park_lock_.unlock();
+	}
+
+	Boolean AsyncTaskRunnerThread::unpark() {
+		if (parked_.val() != 1 || !parked_.compareAndSwap(1, 0)) {
+			return false;
+		}
+		runner_->parked_threads_.decrement();
+		park_lock_.lock();
+		park_signal_.signal();
+		park_lock_.unlock();
+		return true;
+	}
+
 	I32 AsyncTaskRunnerThread::run() {
 		AsyncTask* task = NIL;
 		I32 retVal = 0;
 
+#if defined (OS_WINDOWS)
+		TlsSetValue(runner_->thread_key_, this);
+#else
+		pthread_setspecific(runner_->thread_key_, this);
+#endif
 		D(std::cout << "AsyncTaskRunner[" << id_ << "] STARTED..." << std::endl << std::flush);
 
 		while(true) {
-			runner_->sync_controller_->lock();
-			while(!(task = getTaskToRun())) {
-				// If the runner is no longer running, break out of the thread.
-				if (runner_->state_ != RUNNER_STARTED) {break; }
-				runner_->sync_controller_->wait();
-	
-			}
-			// If the runner is no longer running, break out of the thread.
-			if (runner_->state_ != RUNNER_STARTED && !task) { runner_->sync_controller_->unlock(); break; }
+			if (!(task = getTaskToRun())) {
+				// If the runner is no longer running, and there is nothing left to run, we are done.
+				if (runner_->state_ != RUNNER_STARTED) { break; }
+				park();
+				continue;
+			}
 			D(std::cout << "AsyncTask[" << id_ << "] now RUNNING task...." << std::endl << std::flush);
-			runner_->sync_controller_->unlock();
 
 			task->onStart();
 			retVal = task->run();
@@ -167,28 +313,95 @@ namespace Cat {
 			task = NIL;
 			D(std::cout << "AsyncTask[" << id_ << "] now FINISHED task." << std::endl << std::flush);
 		}
-		if (task) {
-			task->onCompletion();
-			if (task->isDestroyable()) {
-				task->destroy();
-				delete task;
+		D(std::cout << "AsyncTaskRunner[" << id_ << "] FINISHED..." << std::endl << std::flush);
+		return 0;
+	}
+
+	AsyncTaskQueue::AsyncTaskQueue(U32 capacity)
+		: capacity_(capacity ? capacity : 1), first_(0), count_(0) {
+		tasks_ = new AsyncTask*[capacity_];
+	}
+
+	AsyncTaskQueue::~AsyncTaskQueue() {
+		delete[] tasks_;
+		tasks_ = NIL;
+	}
+
+	void AsyncTaskQueue::push(AsyncTask* task) {
+		if (count_ == capacity_) {
+			// Grow the ring buffer, unwrapping it into the new array.
+			AsyncTask** bigger = new AsyncTask*[capacity_ * 2];
+			for (U32 i = 0; i < count_; i++) {
+				bigger[i] = tasks_[(first_ + i) % capacity_];
 			}
-			task = NIL;
+			delete[] tasks_;
+			tasks_ = bigger;
+			first_ = 0;
+			capacity_ *= 2;
+		}
+		tasks_[(first_ + count_) % capacity_] = task;
+		count_++;
+	}
 
+	AsyncTask* AsyncTaskQueue::pop() {
+		if (!count_) {
+			return NIL;
 		}
-		D(std::cout << "AsyncTaskRunner[" << id_ << "] FINISHED..." << std::endl << std::flush);
-		return 0;
+		AsyncTask* task = tasks_[first_];
+		first_ = (first_ + 1) % capacity_;
+		count_--;
+		return task;
 	}
-	
-	AsyncTaskQueuedItem::AsyncTaskQueuedItem(AsyncTask* ptask, AsyncTaskQueuedItem* pprev) {
-		task = ptask;
-		next = NIL;
-		prev = pprev;
+
+	AsyncTaskPriorityQueue::AsyncTaskPriorityQueue() {
+		for (U32 i = 0; i < kNumLevels; i++) {
+			age_[i] = 0;
+		}
 	}
-	AsyncTaskQueuedItem::~AsyncTaskQueuedItem() {
-		task = NIL;
-		next = NIL;
-		prev = NIL;
+
+	void AsyncTaskPriorityQueue::push(AsyncTask* task) {
+		lock_.lock();
+		levels_[getLevel(task->getPriority())].push(task);
+		count_.increment();
+		lock_.unlock();
+	}
+
+	AsyncTask* AsyncTaskPriorityQueue::pop() {
+		if (isEmpty()) {
+			return NIL;
+		}
+		lock_.lock();
+		// An aged level goes first (the lowest one, it has been waiting the longest), then
+		// the highest level with a task.
+		I32 level = -1;
+		for (U32 i = 0; i < kNumLevels; i++) {
+			if (age_[i] >= kAgingThreshold && levels_[i].size()) {
+				level = (I32)i;
+				break;
+			}
+		}
+		if (level < 0) {
+			for (I32 i = kNumLevels - 1; i >= 0; i--) {
+				if (levels_[i].size()) {
+					level = i;
+					break;
+				}
+			}
+		}
+		AsyncTask* task = NIL;
+		if (level >= 0) {
+			task = levels_[level].pop();
+			count_.decrement();
+			age_[level] = 0;
+			// Every waiting level below the one served gets older.
+			for (I32 i = 0; i < level; i++) {
+				if (levels_[i].size()) {
+					age_[i]++;
+				}
+			}
+		}
+		lock_.unlock();
+		return task;
 	}
 
 } // namespace Cat
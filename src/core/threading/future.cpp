@@ -0,0 +1,369 @@
+#include "core/threading/future.h"
+#include "core/time/time.h"
+
+namespace Cat {
+
+	/**
+	 * Runs a FutureCallback as a task on the AsyncTaskRunner.
+	 */
+	class FutureCallbackTask : public AsyncTask {
+	  public:
+		FutureCallbackTask(FutureStateBase* state, FutureCallback* callback)
+			: m_pState(state), m_pCallback(callback) {
+			m_pState->retain();
+			setDestroyable(true);
+		}
+
+		I32 run() {
+			invoke();
+			return 0;
+		}
+
+		void onCompletion() {
+			// Discarded by a stopping AsyncTaskRunner, the callback still has to run.
+			invoke();
+		}
+
+	  private:
+		inline void invoke() {
+			if (m_pCallback) {
+				m_pCallback->invoke();
+				delete m_pCallback;
+				m_pCallback = NIL;
+				m_pState->release();
+				m_pState = NIL;
+			}
+		}
+
+		FutureStateBase*	m_pState;
+		FutureCallback*	m_pCallback;
+	};
+
+	/**
+	 * Completes a Future once the AsyncResult it was made for completes.
+	 */
+	class FutureResultListener : public AsyncResultListener {
+	  public:
+		FutureResultListener(FutureState<AsyncResult*>* state) : m_pState(state) {
+			m_pState->retain();
+		}
+
+		void resultCompleted(AsyncResult* result) {
+			if (result->hasError()) {
+				m_pState->complete(kFSFailed, result->getError());
+			} else if (result->hasResult()) {
+				m_pState->setValue(result);
+			} else {
+				m_pState->complete(kFSCancelled);
+			}
+			m_pState->release();
+			delete this;
+		}
+
+	  private:
+		FutureState<AsyncResult*>*	m_pState;
+	};
+
+	//
+	// ############### CANCELLATION TOKEN ######################
+	//
+
+	CancellationToken::CancellationToken() : m_pState(new State()) {
+		m_pState->refs.increment(kMORelaxed);
+	}
+
+	CancellationToken::CancellationToken(const CancellationToken& src) : m_pState(src.m_pState) {
+		if (m_pState) {
+			m_pState->refs.increment(kMORelaxed);
+		}
+	}
+
+	CancellationToken::~CancellationToken() {
+		if (m_pState && m_pState->refs.decrement(kMOAcqRel) == 0) {
+			delete m_pState;
+		}
+		m_pState = NIL;
+	}
+
+	CancellationToken& CancellationToken::operator=(const CancellationToken& src) {
+		if (src.m_pState) {
+			src.m_pState->refs.increment(kMORelaxed);
+		}
+		if (m_pState && m_pState->refs.decrement(kMOAcqRel) == 0) {
+			delete m_pState;
+		}
+		m_pState = src.m_pState;
+		return *this;
+	}
+
+	void CancellationToken::cancel() {
+		if (m_pState) {
+			m_pState->cancelled.increment();
+		}
+	}
+
+	CancellationToken CancellationToken::none() {
+		return CancellationToken((State*)NIL);
+	}
+
+	//
+	// ############### FUTURE STATE ######################
+	//
+
+	FutureStateBase::FutureStateBase()
+		: m_status(kFSPending), m_error(0), m_pCallbacks(NIL) {}
+
+	FutureStateBase::~FutureStateBase() {
+		// Only left if the state was never completed.
+		while (m_pCallbacks) {
+			FutureCallback* next = m_pCallbacks->m_pNext;
+			delete m_pCallbacks;
+			m_pCallbacks = next;
+		}
+	}
+
+	void FutureStateBase::addCallback(FutureCallback* callback) {
+		m_lock.lock();
+		if (m_status == kFSPending) {
+			callback->m_pNext = m_pCallbacks;
+			m_pCallbacks = callback;
+			m_lock.unlock();
+			return;
+		}
+		m_lock.unlock();
+		retain();
+		dispatch(callback);
+		release();
+	}
+
+	Boolean FutureStateBase::complete(FutureStatus status, I32 error) {
+		m_lock.lock();
+		if (m_status != kFSPending) {
+			m_lock.unlock();
+			return false;
+		}
+		finishLocked(status, error);
+		return true;
+	}
+
+	I32 FutureStateBase::error() {
+		m_lock.lock();
+		I32 error = m_error;
+		m_lock.unlock();
+		return error;
+	}
+
+	FutureStatus FutureStateBase::status() {
+		m_lock.lock();
+		FutureStatus status = m_status;
+		m_lock.unlock();
+		return status;
+	}
+
+	void FutureStateBase::wait() {
+		m_lock.lock();
+		while (m_status == kFSPending) {
+			m_signal.wait(m_lock);
+		}
+		m_lock.unlock();
+	}
+
+	Boolean FutureStateBase::waitFor(U64 timeout) {
+		U64 deadline = Time::currentTimeNano() + timeout;
+		m_lock.lock();
+		while (m_status == kFSPending) {
+			U64 now = Time::currentTimeNano();
+			if (now >= deadline) {
+				break;
+			}
+			m_signal.waitFor(m_lock, deadline - now);
+		}
+		Boolean done = m_status != kFSPending;
+		m_lock.unlock();
+		return done;
+	}
+
+	void FutureStateBase::finishLocked(FutureStatus status, I32 error) {
+		m_status = status;
+		m_error = error;
+		m_signal.broadcast();
+		FutureCallback* callbacks = m_pCallbacks;
+		m_pCallbacks = NIL;
+		// A callback can release the last reference to the state, keep it until done.
+		retain();
+		m_lock.unlock();
+
+		// Reverse the list, so the callbacks are dispatched in the order they were added.
+		FutureCallback* ordered = NIL;
+		while (callbacks) {
+			FutureCallback* next = callbacks->m_pNext;
+			callbacks->m_pNext = ordered;
+			ordered = callbacks;
+			callbacks = next;
+		}
+		while (ordered) {
+			FutureCallback* next = ordered->m_pNext;
+			ordered->m_pNext = NIL;
+			dispatch(ordered);
+			ordered = next;
+		}
+		release();
+	}
+
+	void FutureStateBase::dispatch(FutureCallback* callback) {
+		AsyncTaskRunner* runner = callback->runner();
+		if (runner && runner->canRun()) {
+			runner->run(new FutureCallbackTask(this, callback));
+		} else {
+			callback->invoke();
+			delete callback;
+		}
+	}
+
+	//
+	// ############### FUTURE TIMER ######################
+	//
+
+	FutureTimer::FutureTimer() : m_pDeadlines(NIL), m_running(true), m_pThread(NIL) {
+		m_pThread = Thread::run(this, ThreadOptions().setName("FutureTimer"));
+		if (!m_pThread) {
+			m_running = false;
+		}
+	}
+
+	FutureTimer::~FutureTimer() {
+		stop();
+	}
+
+	void FutureTimer::schedule(FutureStateBase* state, U64 timeout) {
+		Deadline* deadline = new Deadline();
+		deadline->time = Time::currentTimeNano() + timeout;
+		deadline->state = state;
+		state->retain();
+
+		m_lock.lock();
+		if (!m_running) {
+			m_lock.unlock();
+			DWARN("Cannot time out a Future, the FutureTimer is stopped!");
+			state->release();
+			delete deadline;
+			return;
+		}
+		pruneLocked();
+		Deadline** pos = &m_pDeadlines;
+		while (*pos && (*pos)->time <= deadline->time) {
+			pos = &((*pos)->next);
+		}
+		deadline->next = *pos;
+		*pos = deadline;
+		// Only a new earliest deadline changes how long the thread sleeps.
+		if (pos == &m_pDeadlines) {
+			m_signal.broadcast();
+		}
+		m_lock.unlock();
+	}
+
+	void FutureTimer::stop() {
+		m_lock.lock();
+		Boolean wasRunning = m_running;
+		m_running = false;
+		m_signal.broadcast();
+		m_lock.unlock();
+		if (wasRunning && m_pThread) {
+			Thread::join(m_pThread);
+		}
+		m_pThread = NIL;
+
+		m_lock.lock();
+		while (m_pDeadlines) {
+			Deadline* next = m_pDeadlines->next;
+			m_pDeadlines->state->release();
+			delete m_pDeadlines;
+			m_pDeadlines = next;
+		}
+		m_lock.unlock();
+	}
+
+	I32 FutureTimer::run() {
+		m_lock.lock();
+		while (m_running) {
+			pruneLocked();
+			if (!m_pDeadlines) {
+				m_signal.wait(m_lock);
+				continue;
+			}
+			U64 now = Time::currentTimeNano();
+			if (m_pDeadlines->time > now) {
+				m_signal.waitFor(m_lock, m_pDeadlines->time - now);
+				continue;
+			}
+			Deadline* expired = m_pDeadlines;
+			m_pDeadlines = expired->next;
+			// Completing the state dispatches its callbacks, which may add a deadline.
+			m_lock.unlock();
+			expired->state->complete(kFSTimedOut);
+			expired->state->release();
+			delete expired;
+			m_lock.lock();
+		}
+		m_lock.unlock();
+		return 0;
+	}
+
+	void FutureTimer::pruneLocked() {
+		Deadline** pos = &m_pDeadlines;
+		while (*pos) {
+			Deadline* deadline = *pos;
+			if (deadline->state->isDone()) {
+				*pos = deadline->next;
+				deadline->state->release();
+				delete deadline;
+			} else {
+				pos = &(deadline->next);
+			}
+		}
+	}
+
+	//
+	// ############### JOINS ######################
+	//
+
+	FutureJoinCallback::FutureJoinCallback(FutureStateBase* source, FutureState<U32>* dest,
+														AtomicI32* remaining, U32 value)
+		: FutureCallback(NIL), m_pSource(source), m_pDest(dest),
+		  m_pRemaining(remaining), m_value(value) {
+		m_pDest->retain();
+	}
+
+	FutureJoinCallback::~FutureJoinCallback() {
+		// Not invoked when the source is never completed, still count it.
+		if (m_pRemaining && m_pRemaining->decrement() == 0) {
+			delete m_pRemaining;
+		}
+		m_pDest->release();
+	}
+
+	void FutureJoinCallback::invoke() {
+		if (!m_pRemaining) {
+			m_pDest->setValue(m_value);
+			return;
+		}
+		FutureStatus status = m_pSource->status();
+		if (status != kFSReady) {
+			m_pDest->complete(status, m_pSource->error());
+		}
+		if (m_pRemaining->decrement() == 0) {
+			m_pDest->setValue(m_value);
+			delete m_pRemaining;
+		}
+		m_pRemaining = NIL;
+	}
+
+	Future<AsyncResult*> futureOf(AsyncResult* result) {
+		FutureState<AsyncResult*>* state = new FutureState<AsyncResult*>();
+		Future<AsyncResult*> future(state);
+		result->setListener(new FutureResultListener(state));
+		return future;
+	}
+
+} // namespace Cat
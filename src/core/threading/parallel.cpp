@@ -0,0 +1,68 @@
+#include "core/threading/parallel.h"
+
+namespace Cat {
+
+	ParallelJob::ParallelJob(Size begin, Size end, Size grain, U32 workers)
+		: end_(end), workers_(workers), length_(end - begin), refs_(1) {
+		grain_ = grain ? grain : getDefaultGrain(end - begin, workers);
+		next_.set(begin);
+	}
+
+	Size ParallelJob::getDefaultGrain(Size length, U32 workers) {
+		Size grain = length / (8*workers);
+		return grain ? grain : 1;
+	}
+
+	void ParallelJob::runAndWait(AsyncTaskRunner* runner) {
+		if (runner) {
+			// No point in waking up more threads than there are chunks.
+			U64 chunks = (length_ + grain_ - 1) / grain_;
+			U32 helpers = workers_ - 1;
+			if (chunks - 1 < helpers) {
+				helpers = (U32)(chunks - 1);
+			}
+			// A stopped runner drops the task without running it, and the job it retains.
+			for (U32 i = 0; i < helpers && runner->canRun(); ++i) {
+				runner->run(new ParallelJobTask(this));
+			}
+		}
+
+		execute();
+
+		done_lock_.lock();
+		while (done_.val() < length_) {
+			done_signal_.wait(done_lock_);
+		}
+		done_lock_.unlock();
+		release();
+	}
+
+	Boolean ParallelJob::claim(Size* begin, Size* end) {
+		while (true) {
+			U64 next = next_.val();
+			if (next >= end_) {
+				return false;
+			}
+			U64 chunk = (end_ - next) / (2*workers_);
+			if (chunk < grain_) {
+				chunk = grain_;
+			}
+			U64 last = (next + chunk < end_) ? next + chunk : end_;
+			if (next_.compareAndSwap(next, last)) {
+				*begin = (Size)next;
+				*end = (Size)last;
+				return true;
+			}
+		}
+	}
+
+	void ParallelJob::finish(Size count) {
+		U64 done = done_.add(count);
+		if (done == length_) {
+			done_lock_.lock();
+			done_signal_.broadcast();
+			done_lock_.unlock();
+		}
+	}
+
+} // namespace Cat
@@ -2,29 +2,46 @@
 
 namespace Cat {
 
-	ProcessManager::ProcessManager(Size maxProcessRunners) {
+	ProcessManager::ProcessManager(Size maxProcessRunners) : m_migrationThreshold(0) {
 		m_runners.initWithCapacityAndLoadFactor(
 			maxProcessRunners, 0.5f, NIL
 			);
 	}
 
 	ProcessManager::~ProcessManager() {
-		StaticMap<ProcessRunner*>::Cell* data = m_runners.arrayData();
 		for (U32 i = 0; i < m_runners.arrayLength(); i++) {
-			if (data[i].key != 0) {
-				data[i].value->terminateProcessRunner();
-				data[i].value->waitForTermination();
+			if (m_runners.hasEntryAt(i)) {
+				m_runners.valueAt(i)->terminateProcessRunner();
+				m_runners.valueAt(i)->waitForTermination();
 			}
 		}		
 		m_runners.eraseAll();
 	}
 
+	ProcessRunner* ProcessManager::findIdleProcessRunner(ProcessRunner* busy, U32 busyLoad) {
+		ProcessRunner* idle = NIL;
+		U32 idleLoad = 0;
+		for (U32 i = 0; i < m_runners.arrayLength(); i++) {
+			if (m_runners.hasEntryAt(i) && m_runners.valueAt(i) != busy &&
+				 m_runners.valueAt(i)->state() == ProcessRunner::kPMSRunning) {
+				U32 load = m_runners.valueAt(i)->load();
+				if (!idle || load < idleLoad) {
+					idle = m_runners.valueAt(i);
+					idleLoad = load;
+				}
+			}
+		}
+		if (idle && busyLoad > idleLoad + m_migrationThreshold) {
+			return idle;
+		}
+		return NIL;
+	}
+
 	ProcessPtr ProcessManager::getProcess(OID pid) {
-		StaticMap<ProcessRunner*>::Cell* data = m_runners.arrayData();
 		ProcessPtr processPtr;		
 		for (U32 i = 0; i < m_runners.arrayLength(); i++) {
-			if (data[i].key != 0) {
-				processPtr = data[i].value->getProcess(pid);
+			if (m_runners.hasEntryAt(i)) {
+				processPtr = m_runners.valueAt(i)->getProcess(pid);
 				if (processPtr.notNull()) {
 					return processPtr;
 				}				
@@ -33,13 +50,28 @@ namespace Cat {
 		return processPtr;		
 	}
 
+	ProcessRunner* ProcessManager::leastLoadedProcessRunner() {
+		ProcessRunner* least = NIL;
+		U32 leastLoad = 0;
+		for (U32 i = 0; i < m_runners.arrayLength(); i++) {
+			if (m_runners.hasEntryAt(i) && (m_runners.valueAt(i)->state() == ProcessRunner::kPMSRunning ||
+											 m_runners.valueAt(i)->state() == ProcessRunner::kPMSNotStarted)) {
+				U32 load = m_runners.valueAt(i)->load();
+				if (!least || load < leastLoad) {
+					least = m_runners.valueAt(i);
+					leastLoad = load;
+				}
+			}
+		}
+		return least;
+	}
+
 	void ProcessManager::pauseProcess(OID pid) {
-		StaticMap<ProcessRunner*>::Cell* data = m_runners.arrayData();	
 		for (U32 i = 0; i < m_runners.arrayLength(); i++) {
-			if (data[i].key != 0) {
-				ProcessPtr processPtr = data[i].value->getProcess(pid);
+			if (m_runners.hasEntryAt(i)) {
+				ProcessPtr processPtr = m_runners.valueAt(i)->getProcess(pid);
 				if (processPtr.notNull()) {
-					data[i].value->pauseProcess(pid);
+					m_runners.valueAt(i)->pauseProcess(pid);
 					return;					
 				}				
 			}
@@ -47,45 +79,62 @@ namespace Cat {
 	}
 
 	void ProcessManager::resumeProcess(OID pid) {
-		StaticMap<ProcessRunner*>::Cell* data = m_runners.arrayData();	
 		for (U32 i = 0; i < m_runners.arrayLength(); i++) {
-			if (data[i].key != 0) {
-				ProcessPtr processPtr = data[i].value->getProcess(pid);
+			if (m_runners.hasEntryAt(i)) {
+				ProcessPtr processPtr = m_runners.valueAt(i)->getProcess(pid);
 				if (processPtr.notNull()) {
-					data[i].value->resumeProcess(pid);
+					m_runners.valueAt(i)->resumeProcess(pid);
 					return;					
 				}				
 			}
 		}
 	}
 
+	void ProcessManager::setMigrationThreshold(U32 threshold) {
+		m_migrationThreshold = threshold;
+		for (U32 i = 0; i < m_runners.arrayLength(); i++) {
+			if (m_runners.hasEntryAt(i)) {
+				m_runners.valueAt(i)->setProcessManager(threshold > 0 ? this : NIL);
+			}
+		}
+	}
+
+	void ProcessManager::routeMessage(ProcessRunner* from, const ProcessRunner::PMMessage& message) {
+		/* Only a runner's own thread may look in its index, so each of the others is
+		 * sent the message to look for the process itself. */
+		ProcessRunner::PMMessage routed = message;
+		routed.routed = true;
+		for (U32 i = 0; i < m_runners.arrayLength(); i++) {
+			if (m_runners.hasEntryAt(i) && m_runners.valueAt(i) != from) {
+				m_runners.valueAt(i)->postMessage(routed);
+			}
+		}
+	}
+
 	void ProcessManager::startProcessRunners() {
-		StaticMap<ProcessRunner*>::Cell* data = m_runners.arrayData();
 		for (U32 i = 0; i < m_runners.arrayLength(); i++) {
-			if (data[i].key != 0) {
-				data[i].value->run();
-				data[i].value->waitUntilStarted();				
+			if (m_runners.hasEntryAt(i)) {
+				m_runners.valueAt(i)->run();
+				m_runners.valueAt(i)->waitUntilStarted();				
 			}
 		}
 	}
 	
 	
 	void ProcessManager::terminateAllProcesses() {
-		StaticMap<ProcessRunner*>::Cell* data = m_runners.arrayData();	
 		for (U32 i = 0; i < m_runners.arrayLength(); i++) {
-			if (data[i].key != 0) {
-				data[i].value->terminateAllProcesses();
+			if (m_runners.hasEntryAt(i)) {
+				m_runners.valueAt(i)->terminateAllProcesses();
 			}
 		}
 	}
 
 	void ProcessManager::terminateProcess(OID pid) {
-		StaticMap<ProcessRunner*>::Cell* data = m_runners.arrayData();	
 		for (U32 i = 0; i < m_runners.arrayLength(); i++) {
-			if (data[i].key != 0) {
-				ProcessPtr processPtr = data[i].value->getProcess(pid);
+			if (m_runners.hasEntryAt(i)) {
+				ProcessPtr processPtr = m_runners.valueAt(i)->getProcess(pid);
 				if (processPtr.notNull()) {
-					data[i].value->terminateProcess(pid);
+					m_runners.valueAt(i)->terminateProcess(pid);
 					return;					
 				}				
 			}
@@ -93,20 +142,18 @@ namespace Cat {
 	}
 
 	void ProcessManager::terminateAllProcessRunners() {
-		StaticMap<ProcessRunner*>::Cell* data = m_runners.arrayData();	
 		for (U32 i = 0; i < m_runners.arrayLength(); i++) {
-			if (data[i].key != 0) {
-				data[i].value->terminateProcessRunner();				
+			if (m_runners.hasEntryAt(i)) {
+				m_runners.valueAt(i)->terminateProcessRunner();				
 			}
 		}
 	}
 	
 	
 	Boolean ProcessManager::waitForAllProcessRunnersToTerminate() {
-		StaticMap<ProcessRunner*>::Cell* data = m_runners.arrayData();	
 		for (U32 i = 0; i < m_runners.arrayLength(); i++) {
-			if (data[i].key != 0) {
-				data[i].value->waitForTermination();				
+			if (m_runners.hasEntryAt(i)) {
+				m_runners.valueAt(i)->waitForTermination();				
 			}
 		}
 		return true;
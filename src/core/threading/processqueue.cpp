@@ -7,9 +7,13 @@ namespace Cat {
 	/* ############################# */
 	ProcessQueueIndex::ProcessQueueIndex(const ProcessQueueIndex& src) {
 		m_capacity = src.m_capacity;
+		m_size = src.m_size;
+		m_mask = src.m_mask;
 		if (src.m_pIndices) {
-			m_pIndices = new PQICell[m_capacity];
-			memcpy(m_pIndices, src.m_pIndices, sizeof(PQICell)*m_capacity);
+			m_pIndices = new PQICell[m_mask + 1];
+			for (U32 i = 0; i <= m_mask; i++) {
+				m_pIndices[i] = src.m_pIndices[i];
+			}
 		}
 		else {
 			m_pIndices = NIL;
@@ -19,12 +23,19 @@ namespace Cat {
 	ProcessQueueIndex& ProcessQueueIndex::operator=(const ProcessQueueIndex& src) {
 		PQICell* old = m_pIndices;		
 		if (src.m_pIndices) {
-			PQICell* indices = new PQICell[src.m_capacity];						
-			memcpy(indices, src.m_pIndices, sizeof(PQICell)*src.m_capacity);
+			PQICell* indices = new PQICell[src.m_mask + 1];						
+			for (U32 i = 0; i <= src.m_mask; i++) {
+				indices[i] = src.m_pIndices[i];
+			}
 			m_pIndices = indices;
-			m_capacity = src.m_capacity;			
 		}
-		if (old) {
+		else {
+			m_pIndices = NIL;
+		}
+		m_capacity = src.m_capacity;			
+		m_size = src.m_size;
+		m_mask = src.m_mask;
+		if (old && old != m_pIndices) {
 			delete[] old;
 		}		
 		return *this;			
@@ -36,6 +47,85 @@ namespace Cat {
 			m_pIndices = NIL;
 		}
 		m_capacity = 0;		
+		m_size = 0;
+	}
+
+	void ProcessQueueIndex::initWithCapacity(Size capacity) {
+		/* Keep the table at most half full, so the probes stay short. */
+		U32 cells = 8;
+		while (cells < capacity*2) {
+			cells <<= 1;
+		}
+		PQICell* old = m_pIndices;
+		m_pIndices = new PQICell[cells];
+		m_capacity = cells / 2;
+		m_mask = cells - 1;
+		m_size = 0;
+		if (old) {
+			delete[] old;
+		}
+	}
+
+	void ProcessQueueIndex::insert(OID pid, ProcessQueueNode* node) {
+		U32 i = pid & m_mask;
+		while (m_pIndices[i].pid != 0) {
+			i = (i + 1) & m_mask;
+		}
+		m_pIndices[i].pid = pid;
+		m_pIndices[i].node = node;
+		m_size++;
+	}
+
+	void ProcessQueueIndex::remove(OID pid) {
+		if (m_size == 0 || pid == 0) {
+			return;
+		}
+		U32 hole = pid & m_mask;
+		while (m_pIndices[hole].pid != pid) {
+			if (m_pIndices[hole].pid == 0) {
+				return;
+			}
+			hole = (hole + 1) & m_mask;
+		}
+
+		/* Shift back the entries that probed past the hole, so no probe hits a gap. */
+		U32 i = hole;
+		while (true) {
+			i = (i + 1) & m_mask;
+			if (m_pIndices[i].pid == 0) {
+				break;
+			}
+			U32 home = m_pIndices[i].pid & m_mask;
+			if (((i - home) & m_mask) >= ((i - hole) & m_mask)) {
+				m_pIndices[hole] = m_pIndices[i];
+				hole = i;
+			}
+		}
+		m_pIndices[hole].pid = 0;
+		m_pIndices[hole].node = NIL;
+		m_size--;
+	}
+
+	void ProcessQueueIndex::set(OID pid, ProcessQueueNode* node) {
+		if (pid == 0) {
+			return;
+		}
+		if (m_size >= m_capacity) {
+			DWARN("ProcessQueueIndex is full with " << m_size << " entries, growing it!");
+			PQICell* old = m_pIndices;
+			U32 oldCells = old ? m_mask + 1 : 0;
+			m_pIndices = NIL;
+			initWithCapacity(m_capacity ? m_capacity*2 : 4);
+			for (U32 i = 0; i < oldCells; i++) {
+				if (old[i].pid != 0) {
+					insert(old[i].pid, old[i].node);
+				}
+			}
+			if (old) {
+				delete[] old;
+			}
+		}
+		insert(pid, node);
 	}
 
 } // namespace Cat
@@ -1,14 +1,21 @@
 #include "core/threading/processrunner.h"
+#include "core/threading/processmanager.h"
 #include "core/threading/thread.h"
+#include "core/time/time.h"
 #if defined (DEBUG)
 #include <assert.h>
 #endif
 
 namespace Cat {
 
-	ProcessRunner::ProcessRunner(const Char* name, Size queueSize) {
+	ProcessRunner::ProcessRunner(const Char* name, Size queueSize, const ThreadOptions& options)
+		: m_threadOptions(options) {
+		if (!m_threadOptions.hasName()) {
+			m_threadOptions.setName(name);
+		}
 		m_state = kPMSNotStarted;		
 		m_pName = copy(name);
+		m_pManager = NIL;
 		m_oid = crc32(name);		
 		m_inputQueue.initWithCapacity(queueSize, ProcessPtr::nullPtr());
 		m_messageQueue.initWithCapacity((U32)(queueSize * 1.5), PMMessage());
@@ -20,10 +27,10 @@ namespace Cat {
 		m_removed.initAsRoot();
 		m_free.initAsRoot();
 		m_numFree = m_numUsed = 0;
+		m_tickBudget = m_baseSlice = 0;
 		
 		for (U32 i = 0; i < (queueSize * 3); i++) {
 			m_pNodeStorage[i].init(&m_free);
-			m_index.setAtIndex(i, 0, &(m_pNodeStorage[i]));
 			m_numFree++;			
 		}	
 	}
@@ -54,27 +61,65 @@ namespace Cat {
 	}
 
 	ProcessRunner::ProcessRunnerState ProcessRunner::run() {
-		m_syncLock.lock();
+		m_stateLock.lock();
 		if (Thread::runProcessRunner(this) != NIL) {
 			m_state = kPMSRunning;
 			DMSG("Process runner " << name() << " started.");
 		} else {
 			m_state = kPMSFailedToStart;
 		}
-		m_syncLock.broadcast();
-		m_syncLock.unlock();				
+		m_stateChanged.broadcast();
+		m_stateLock.unlock();				
 		return m_state;
 	}
 
+	void ProcessRunner::setState(ProcessRunnerState state) {
+		m_stateLock.lock();
+		m_state = state;
+		m_stateChanged.broadcast();
+		m_stateLock.unlock();
+	}
+
 	void ProcessRunner::processMessages() {
 		PMMessage message;
 		ProcessPtr processPtr;
 		ProcessQueueNode* node = NIL;		
-		while (!m_messageQueue.isEmpty() &&
+		/* Only the messages posted so far, one put back below is seen the next time. */
+		Size numMessages = m_messageQueue.size();
+		while (numMessages-- > 0 && !m_messageQueue.isEmpty() &&
 				 !(m_state == kPMSWillTerminate || m_state == kPMSTerminated)) {
 
 			message = m_messageQueue.pop();
 
+			/* The process moved to another runner, pass the message on to it */
+			if (message.type == kPMMTerminateProcess || message.type == kPMMPauseProcess ||
+				 message.type == kPMMResumeProcess) {
+				node = m_index.find(message.pid);
+				/* A process moved here can still be in the input queue when the message
+				 * forwarded after it arrives, take it in before giving up on it. */
+				if (!node && !m_inputQueue.isEmpty()) {
+					pullInputQueue();
+					node = m_index.find(message.pid);
+					if (!node && !m_inputQueue.isEmpty()) {
+						/* No room to take it in yet, try again once there is. */
+						postMessage(message);
+						continue;
+					}
+				}
+				if (node && node->movedTo) {
+					node->movedTo->postMessage(message);
+					continue;
+				}
+				else if (!node && m_pManager) {
+					/* Moved away so long ago that it is no longer forwarded, the runner that
+					 * has it acts on the routed copy, and the others drop it here. */
+					if (!message.routed) {
+						m_pManager->routeMessage(this, message);
+					}
+					continue;
+				}
+			}
+
 			switch(message.type) {
 				
 			case kPMMTerminateProcess:				
@@ -110,25 +155,21 @@ namespace Cat {
 				break;
 				
 			case kPMMTerminateAllProcesses:
-				m_syncLock.lock();				
 				clearInputQueue();				
 				terminateRunningProcesses();				
 				terminatePausedProcesses();
-				m_syncLock.unlock();				
 				break;
 				
 			case kPMMTerminateProcessRunner:
-				m_syncLock.lock();
 				terminateRunningProcesses();				
 				terminatePausedProcesses();	
 				clearInputQueue();				
 				if (m_state == kPMSNotStarted) {
-					m_state = kPMSTerminated;
+					setState(kPMSTerminated);
 				}				
 				else if (m_state == kPMSRunning) {					
-					m_state = kPMSWillTerminate;
+					setState(kPMSWillTerminate);
 				}				
-				m_syncLock.unlock();				
 				break;
 				
 			default:
@@ -138,9 +179,9 @@ namespace Cat {
 	}
 
 	void ProcessRunner::processingLoop() {
-		m_syncLock.lock();
+		m_stateLock.lock();
 		/* Sync up to make sure have started running */
-		m_syncLock.unlock();
+		m_stateLock.unlock();
 
 		/* Now enter the processing loop. */
 		Boolean loopity = true;
@@ -148,9 +189,13 @@ namespace Cat {
 			if (hasRunning() || !m_inputQueue.isEmpty() || !m_messageQueue.isEmpty() || hasRemoved()) {
 				runProcesses(1);
 			} else {
-				m_syncLock.lock();
-				while (m_inputQueue.isEmpty() && m_state == kPMSRunning && m_messageQueue.isEmpty()) {
-					m_syncLock.wait();
+				/* Check the queues again after registering as a waiter, so a process
+				 * queued in between is either seen here or wakes us up. */
+				I32 key = m_wakeup.prepareWait();
+				if (m_inputQueue.isEmpty() && m_state == kPMSRunning && m_messageQueue.isEmpty()) {
+					m_wakeup.wait(key);
+				} else {
+					m_wakeup.cancelWait();
 				}
 				/* We only want to exit the loop if the process queue is empty, 
 				 * since we have to terminate all the processes before we exit.
@@ -158,23 +203,26 @@ namespace Cat {
 				if (!hasRunning() && !hasRemoved() && m_state != kPMSRunning) {
 					loopity = false; /* Break out of the loop */
 				}				
-				m_syncLock.unlock();
 			}			
 		}
 
-		/* Signal anything waiting on the process runner to terminate */
-		m_syncLock.lock();
-		m_state = kPMSTerminated;		
 		/* Ensure no waiting, removed or paused */
 		clearInputQueue();		
 		m_messageQueue.clear();
 		clearProcesses();		
 		DMSG("Process Runner " << name() << " terminated!" << std::flush);		
-		m_syncLock.broadcast();
-		m_syncLock.unlock();
+		/* Signal anything waiting on the process runner to terminate, and take what was
+		 * pushed by a queueProcess() that checked the state before it changed. */
+		m_stateLock.lock();
+		m_state = kPMSTerminated;
+		memoryBarrier();
+		clearInputQueue();
+		m_stateChanged.broadcast();
+		m_stateLock.unlock();
 	}
 
 	void ProcessRunner::runProcesses(U32 timeForEachProcess) {
+		U64 tickStart = (m_tickBudget > 0) ? Time::currentTimeNano() : 0;
 		
 		/* Decrement the count in any removed processes, and remove the ones with zero count */
 		if (hasRemoved()) {
@@ -183,8 +231,12 @@ namespace Cat {
 			while (rnode != &m_removed) {
 				rnext = rnode->next;
 				if (rnode->count <= 0) {
+					if (rnode->movedTo) {
+						/* Stop forwarding messages for a process that moved away */
+						m_index.remove(rnode->process->pID());
+					}
 					/* If node is a child of a parent, remove the child so references can go to 0 */
-					if (rnode->process.notNull()) {
+					else if (rnode->process.notNull()) {
 						checkForParentAndRemoveIfNeeded(rnode->process);						
 					}
 					
@@ -200,18 +252,26 @@ namespace Cat {
 		}
 
 		/* If there are any processes waiting to be added, add them */
-		while (!m_inputQueue.isEmpty() && hasFreeRoom()) {
-			addRunningProcess(m_inputQueue.pop());			
-		}
+		pullInputQueue();
 
 		if (!m_messageQueue.isEmpty()) {
 			processMessages();
 		}				
 		ProcessQueueNode* node = m_running.next;
 		ProcessQueueNode* next = NIL;		
+		Boolean visitedAny = false;
 			
 		while (node != &m_running) {
 			next = node->next;			
+			/* Out of time, move the processes already visited to the back so this one goes first next tick */
+			if (m_tickBudget > 0 && visitedAny &&
+				 Time::currentTimeNano() >= tickStart + m_tickBudget) {
+				while (m_running.next != node) {
+					m_running.next->realloc(&m_running);
+				}
+				break;
+			}
+			visitedAny = true;
 #if defined (DEBUG)
 			I32 retainCount = node->process.retainCount();
 #endif
@@ -227,7 +287,11 @@ namespace Cat {
 			}
 
 			if (process->state() == Process::kPSRunning) {
-				process->run(process->getRequestedRunTime(timeForEachProcess));
+				if (m_tickBudget == 0) {
+					process->run(process->getRequestedRunTime(timeForEachProcess));
+				} else {
+					runWithinBudget(node, tickStart);
+				}
 			}
 
 			if (process->isDead()) {
@@ -270,28 +334,125 @@ namespace Cat {
 			}
 		   node = next;			
 		}		
+
+		/* Count the running processes, and give some to an idle runner if there are too many. */
+		U32 running = 0;
+		for (node = m_running.next; node != &m_running; node = node->next) {
+			running++;
+		}
+		if (m_pManager && running > 1) {
+			ProcessRunner* idle = m_pManager->findIdleProcessRunner(this, running);
+			U32 idleLoad = idle ? idle->load() : running;
+			if (idleLoad < running) {
+				running -= shareRunningProcesses(idle, (running - idleLoad) / 2);
+			}
+		}
+		m_load.set(running);
+	}
+
+	U32 ProcessRunner::shareRunningProcesses(ProcessRunner* idle, U32 count) {
+		if (count == 0) {
+			return 0;
+		}
+		if (count > kMaxSharedProcesses) {
+			count = kMaxSharedProcesses;
+		}
+
+		/* Take from the back, the processes that would have been run last. */
+		ProcessQueueNode* nodes[kMaxSharedProcesses];
+		ProcessPtr shared[kMaxSharedProcesses];
+		U32 numShared = 0;
+		ProcessQueueNode* node = m_running.prev;
+		while (node != &m_running && numShared < count) {
+			ProcessPtr& process = node->process;
+			if (process->state() == Process::kPSRunning && process->parent().isNull() && !process->hasChild()) {
+				nodes[numShared] = node;
+				shared[numShared++] = process;
+			}
+			node = node->prev;
+		}
+
+		/* Whatever the idle runner has no room for stays here. */
+		Size moved = idle->queueProcesses(shared, numShared);
+		for (Size i = 0; i < moved; ++i) {
+			node = nodes[i];
+			node->movedTo = idle;
+			node->realloc(&m_removed);
+			node->count = kMigrationForwardTicks;
+		}
+		DMSG("Process runner " << name() << " moved " << moved << " processes to " << idle->name() << ".");
+		return (U32)moved;
+	}
+
+	void ProcessRunner::runWithinBudget(ProcessQueueNode* node, U64 tickStart) {
+		ProcessPtr& process = node->process;
+		I64 slice = (I64)m_baseSlice * process->priority() * process->priorityModifier();
+		if (slice < (I64)m_baseSlice) {
+			/* Low or zero priorities still get the base slice, so they are not starved */
+			slice = (I64)m_baseSlice;
+		}
+
+		/* Earn this tick's slice, but do not save up more than one slice */
+		node->deficit += slice;
+		if (node->deficit > slice) {
+			node->deficit = slice;
+		}
+		if (node->deficit <= 0) {
+			return; /* Still paying off the time it overran by */
+		}
+
+		U64 start = Time::currentTimeNano();
+		I64 allowed = (I64)m_tickBudget - (I64)(start - tickStart);
+		if (allowed > node->deficit) {
+			allowed = node->deficit;
+		}
+		if (allowed < 0) {
+			allowed = 0;
+		}
+		process->run((U32)(allowed / 1000));
+		U64 end = Time::currentTimeNano();
+		/* The clock is not monotonic, ignore it going backwards */
+		if (end > start) {
+			node->deficit -= (I64)(end - start);
+		}
 	}
 
 	Boolean ProcessRunner::waitForTermination() {
-		m_syncLock.lock();
+		m_stateLock.lock();
 		while (m_state == kPMSRunning || m_state == kPMSWillTerminate) {
-			m_syncLock.wait();
+			m_stateChanged.wait(m_stateLock);
 		}
-		m_syncLock.unlock();
+		m_stateLock.unlock();
 		return (m_state == kPMSTerminated);		
 	}
 
 	Boolean ProcessRunner::waitUntilStarted() {
-		m_syncLock.lock();
+		m_stateLock.lock();
 		while (m_state == kPMSNotStarted) {
-			m_syncLock.wait();
+			m_stateChanged.wait(m_stateLock);
 		}
-		m_syncLock.unlock();
+		m_stateLock.unlock();
 		return (m_state == kPMSRunning);		
 	}
 
+	void ProcessRunner::pullInputQueue() {
+		while (!m_inputQueue.isEmpty() && hasFreeRoom()) {
+			/* Count it before it leaves the input queue, so load() never misses it */
+			m_load.add(1);
+			addRunningProcess(m_inputQueue.pop());			
+		}
+	}
+
 	void ProcessRunner::addRunningProcess(const ProcessPtr& process) {
-		ProcessQueueNode* node = m_free.next;
+		/* The process moved away and came back, stop forwarding its messages */
+		ProcessQueueNode* node = m_index.find(process->pID());
+		if (node && node->movedTo) {
+			m_index.remove(process->pID());
+			node->movedTo = NIL;
+			node->process.setNull();
+		}
+
+		node = m_free.next;
 		node->alloc(&m_running, process);
 		m_numFree--;
 		m_numUsed++;
@@ -334,7 +495,8 @@ namespace Cat {
 		next = NIL;	 
 		while (node != &m_removed) {
 			next = node->next;
-			if (node->process.notNull()) {
+			/* A process that moved away belongs to the other runner now */
+			if (node->process.notNull() && !node->movedTo) {
 				checkForChildAndRemoveIfNeeded(node->process);
 				checkForParentAndRemoveIfNeeded(node->process);
 			}
@@ -343,6 +505,7 @@ namespace Cat {
 			m_numFree++;	
 		}
 		m_numUsed = 0;		
+		m_load.set(0);
 		m_running.initAsRoot();
 		m_paused.initAsRoot();
 		m_removed.initAsRoot();
@@ -360,6 +523,20 @@ namespace Cat {
 		}
 	}
 	
+	Boolean ProcessRunner::drainIfTerminated() {
+		/* Pairs with the barrier when the loop exits, either the runner's last
+		 * clearInputQueue() sees the push or we see it terminated. */
+		memoryBarrier();
+		if (m_state != kPMSTerminated) {
+			return false;
+		}
+		/* Nothing runs the input queue any more, the lock keeps it to one consumer. */
+		m_stateLock.lock();
+		clearInputQueue();
+		m_stateLock.unlock();
+		return true;
+	}
+
 	void ProcessRunner::terminateRunningProcesses() {
 		ProcessQueueNode* node = m_running.next;		
 		while (node != &m_running) {
@@ -0,0 +1,204 @@
+#include "core/threading/taskgraph.h"
+
+namespace Cat {
+
+	TaskGraphNode::TaskGraphNode(TaskGraph* graph, I32 index, const TaskPtr& task)
+		: m_pGraph(graph), m_index(index), m_task(task), m_successors(4), m_numPredecessors(0) {
+		setPriority(task->priority());
+	}
+
+	void TaskGraphNode::run() {
+		if (!m_task->isInitialized()) {
+			m_task->initialize();
+			m_task->onInitialize();
+		}
+		if (m_task->state() == kTSRunning) {
+			m_task->run();
+		}
+
+		switch (m_task->state()) {
+		case kTSSucceeded:
+			succeeded();
+			break;
+		case kTSFailed:
+			failed();
+			break;
+		case kTSTerminated:
+			terminate();
+			break;
+		default:
+			break;
+		}
+	}
+
+	void TaskGraphNode::onSuccess() {
+		m_task->onSuccess();
+		finish(true);
+	}
+
+	void TaskGraphNode::onFailure() {
+		m_task->onFailure();
+		finish(false);
+	}
+
+	void TaskGraphNode::onTermination() {
+		if (!m_task->isDead()) {
+			m_task->terminate();
+			m_task->onTermination();
+		}
+		finish(false);
+	}
+
+	void TaskGraphNode::predecessorFinished(Boolean succeeded) {
+		if (!succeeded) {
+			m_cancelled.increment();
+		}
+		/* The last predecessor to finish decides what happens to the node. */
+		if (m_pending.decrement() == 0) {
+			if (wasCancelled()) {
+				terminate();
+				onTermination();
+			} else {
+				m_pGraph->dispatch(this);
+			}
+		}
+	}
+
+	void TaskGraphNode::finish(Boolean succeeded) {
+		for (Size i = 0; i < m_successors.size(); ++i) {
+			m_successors.at(i)->predecessorFinished(succeeded);
+		}
+		m_pGraph->nodeFinished(succeeded);
+	}
+
+	TaskGraph::TaskGraph(Size capacity)
+		: m_nodes(capacity > 0 ? capacity : 1), m_pManager(NIL), m_started(false) {}
+
+	TaskGraph::~TaskGraph() {
+		if (m_started) {
+			wait();
+		}
+	}
+
+	I32 TaskGraph::addTask(const TaskPtr& task) {
+		if (m_started) {
+			DWARN("Cannot add a Task to a TaskGraph that has already been run!");
+			return -1;
+		}
+		if (task.isNull()) {
+			DWARN("Cannot add a null Task to a TaskGraph!");
+			return -1;
+		}
+		m_nodes.append(TaskPtr(new TaskGraphNode(this, (I32)m_nodes.size(), task)));
+		m_remaining.increment();
+		return (I32)m_nodes.size() - 1;
+	}
+
+	Boolean TaskGraph::addDependency(I32 before, I32 after) {
+		if (m_started) {
+			DWARN("Cannot add a dependency to a TaskGraph that has already been run!");
+			return false;
+		}
+		if (before < 0 || after < 0 || before == after ||
+			 (Size)before >= m_nodes.size() || (Size)after >= m_nodes.size()) {
+			DWARN("Invalid TaskGraph dependency " << before << " -> " << after << "!");
+			return false;
+		}
+		TaskGraphNode* next = node(after);
+		node(before)->m_successors.append(next);
+		next->m_numPredecessors++;
+		next->m_pending.increment();
+		return true;
+	}
+
+	Boolean TaskGraph::run(TaskManager* manager) {
+		if (m_started) {
+			DWARN("TaskGraph has already been run!");
+			return false;
+		}
+		if (!isAcyclic()) {
+			DERR("Cannot run a TaskGraph with a dependency cycle!");
+			return false;
+		}
+		m_pManager = manager;
+		m_started = true;
+
+		/* The number of predecessors never changes once started, so the roots are
+		 * the same even while the Tasks we already queued are releasing others. */
+		for (Size i = 0; i < m_nodes.size(); ++i) {
+			TaskGraphNode* root = node((I32)i);
+			if (root->numPredecessors() == 0) {
+				dispatch(root);
+			}
+		}
+		return true;
+	}
+
+	Boolean TaskGraph::wait() {
+		if (!m_started) {
+			DWARN("Cannot wait for a TaskGraph that has not been run!");
+			return false;
+		}
+		m_lock.lock();
+		while (m_remaining.val() > 0) {
+			m_finished.wait(m_lock);
+		}
+		m_lock.unlock();
+		return m_failed.val() == 0;
+	}
+
+	Boolean TaskGraph::isAcyclic() const {
+		Size numNodes = m_nodes.size();
+		if (numNodes == 0) {
+			return true;
+		}
+
+		U32* pending = new U32[numNodes];
+		Vector<TaskGraphNode*> ready(numNodes);
+		for (Size i = 0; i < numNodes; ++i) {
+			TaskGraphNode* current = node((I32)i);
+			pending[i] = current->numPredecessors();
+			if (pending[i] == 0) {
+				ready.append(current);
+			}
+		}
+
+		/* Visit the nodes in dependency order, any left unvisited are on a cycle. */
+		Size visited = 0;
+		while (ready.size() > 0) {
+			TaskGraphNode* current = ready.last();
+			ready.removeLast();
+			visited++;
+			for (Size s = 0; s < current->m_successors.size(); ++s) {
+				TaskGraphNode* next = current->m_successors.at(s);
+				if (--pending[next->m_index] == 0) {
+					ready.append(next);
+				}
+			}
+		}
+		delete[] pending;
+		return visited == numNodes;
+	}
+
+	void TaskGraph::dispatch(TaskGraphNode* node) {
+		if (m_pManager->queueTask(TaskPtr(node)).isNull()) {
+			DWARN("Could not queue TaskGraph Task " << node->oID() << ", all TaskRunners are full!");
+			node->terminate();
+			node->onTermination();
+		}
+	}
+
+	void TaskGraph::nodeFinished(Boolean succeeded) {
+		if (!succeeded) {
+			m_failed.increment();
+		}
+		/* Hold the lock so the graph cannot be destroyed by wait() returning
+		 * before we are done signalling it. */
+		m_lock.lock();
+		if (m_remaining.decrement() == 0) {
+			m_finished.broadcast();
+		}
+		m_lock.unlock();
+	}
+
+} // namespace Cat
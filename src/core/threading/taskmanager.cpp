@@ -2,70 +2,156 @@
 
 namespace Cat {
 
-	TaskManager::TaskManager(Size maxTaskRunners) {
+	TaskManager::TaskManager(Size maxTaskRunners)
+		: m_runnerList(maxTaskRunners), m_placement(kTPLeastQueued), m_idlePulling(false) {
 		m_runners.initWithCapacityAndLoadFactor(
 			maxTaskRunners, 0.5f, NIL
 			);
 	}
 
 	TaskManager::~TaskManager() {
-		StaticMap<TaskRunner*>::Cell* data = m_runners.arrayData();
 		for (U32 i = 0; i < m_runners.arrayLength(); i++) {
-			if (data[i].key != 0) {
-				data[i].value->terminateTaskRunner();
-				data[i].value->waitForTermination();
+			if (m_runners.hasEntryAt(i)) {
+				m_runners.valueAt(i)->terminateTaskRunner();
+				m_runners.valueAt(i)->waitForTermination();
 			}
 		}		
 		m_runners.eraseAll();
 	}
 
+	/* Scrambles the counter so the power of two choices are spread out. */
+	static inline U32 mixBits(U32 x) {
+		x ^= x >> 16;
+		x *= 0x85ebca6b;
+		x ^= x >> 13;
+		x *= 0xc2b2ae35;
+		x ^= x >> 16;
+		return x;
+	}
+
+	TaskRunner* TaskManager::chooseTaskRunner(const TaskPtr& task) {
+		U32 length = m_runnerList.size();
+		TaskRunner* runner = NIL;
+		U32 a, b;
+		switch (m_placement) {
+
+		case kTPRoundRobin:
+			runner = m_runnerList.at((U32)m_nextRunner.increment() % length);
+			break;
+
+		case kTPPowerOfTwoChoices:
+			a = mixBits((U32)m_nextRunner.increment());
+			b = a >> 16;
+			runner = m_runnerList.at(a % length);
+			if (m_runnerList.at(b % length)->load() < runner->load()) {
+				runner = m_runnerList.at(b % length);
+			}
+			break;
+
+		case kTPAffinity:
+			/* Tasks without an OID have nothing to be near. */
+			if (task->oID() != 0) {
+				runner = m_runnerList.at(task->oID() % length);
+			}
+			break;
+
+		default:
+			break;
+		}
+
+		if (runner == NIL || runner->hasFullQueue()) {
+			runner = leastLoadedTaskRunner();
+		}
+		return runner;
+	}
+
+	TaskRunner* TaskManager::leastLoadedTaskRunner() {
+		U32 length = m_runnerList.size();
+		/* Start at a different runner each time so ties are spread out. */
+		U32 start = (U32)m_nextRunner.increment() % length;
+		TaskRunner* least = m_runnerList.at(start);
+		U32 leastLoad = least->load();
+		for (U32 n = 1; n < length && leastLoad > 0; n++) {
+			TaskRunner* runner = m_runnerList.at((start + n) % length);
+			U32 load = runner->load();
+			if (load < leastLoad) {
+				least = runner;
+				leastLoad = load;
+			}
+		}
+		return least;
+	}
+
 	TaskPtr TaskManager::queueTask(const TaskPtr& task) {
-		StaticMap<TaskRunner*>::Cell* data = m_runners.arrayData();	
-		for (U32 i = 0; i < m_runners.arrayLength(); i++) {
-			if (data[i].key != 0) {
-				if (!data[i].value->hasFullQueue()) {
-					return data[i].value->queueTask(task);
-				}
+		if (m_runnerList.size() == 0) {
+			return TaskPtr::nullPtr();
+		}
+		return chooseTaskRunner(task)->queueTask(task);
+	}
+
+	Size TaskManager::queueTasks(const TaskPtr* tasks, Size count) {
+		U32 length = m_runnerList.size();
+		if (length == 0 || count == 0) {
+			return 0;
+		}
+		U32 start = (U32)m_nextRunner.increment() % length;
+		Size queued = 0;
+		for (U32 n = 0; n < length && queued < count; n++) {
+			/* Whatever a full runner did not take is shared by the ones left. */
+			Size share = (count - queued + (length - n) - 1) / (length - n);
+			queued += m_runnerList.at((start + n) % length)->queueTasks(tasks + queued, share);
+		}
+		return queued;
+	}
+
+	TaskRunner* TaskManager::findIdleTaskRunner(TaskRunner* busy) {
+		for (U32 i = 0; i < m_runnerList.size(); i++) {
+			TaskRunner* runner = m_runnerList.at(i);
+			if (runner != busy && runner->load() == 0 && runner->state() == TaskRunner::kTRSRunning) {
+				return runner;
 			}
 		}
-		return TaskPtr::nullPtr();		
+		return NIL;
+	}
+
+	void TaskManager::setIdlePulling(Boolean idlePulling) {
+		m_idlePulling = idlePulling;
+		for (U32 i = 0; i < m_runnerList.size(); i++) {
+			m_runnerList.at(i)->setTaskManager(idlePulling ? this : NIL);
+		}
 	}
 
 	void TaskManager::startTaskRunners() {
-		StaticMap<TaskRunner*>::Cell* data = m_runners.arrayData();
 		for (U32 i = 0; i < m_runners.arrayLength(); i++) {
-			if (data[i].key != 0) {
-				data[i].value->run();
-				data[i].value->waitUntilStarted();				
+			if (m_runners.hasEntryAt(i)) {
+				m_runners.valueAt(i)->run();
+				m_runners.valueAt(i)->waitUntilStarted();				
 			}
 		}
 	}
 	
 	
 	void TaskManager::clearAllWaitingTasks() {
-		StaticMap<TaskRunner*>::Cell* data = m_runners.arrayData();	
 		for (U32 i = 0; i < m_runners.arrayLength(); i++) {
-			if (data[i].key != 0) {
-				data[i].value->clearAllWaitingTasks();
+			if (m_runners.hasEntryAt(i)) {
+				m_runners.valueAt(i)->clearAllWaitingTasks();
 			}
 		}
 	}
 
 	void TaskManager::terminateAllTaskRunners() {
-		StaticMap<TaskRunner*>::Cell* data = m_runners.arrayData();	
 		for (U32 i = 0; i < m_runners.arrayLength(); i++) {
-			if (data[i].key != 0) {
-				data[i].value->terminateTaskRunner();				
+			if (m_runners.hasEntryAt(i)) {
+				m_runners.valueAt(i)->terminateTaskRunner();				
 			}
 		}
 	}
 	
 	
 	Boolean TaskManager::waitForAllTaskRunnersToTerminate() {
-		StaticMap<TaskRunner*>::Cell* data = m_runners.arrayData();	
 		for (U32 i = 0; i < m_runners.arrayLength(); i++) {
-			if (data[i].key != 0) {
-				data[i].value->waitForTermination();				
+			if (m_runners.hasEntryAt(i)) {
+				m_runners.valueAt(i)->waitForTermination();				
 			}
 		}
 		return true;
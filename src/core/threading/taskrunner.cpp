@@ -1,4 +1,5 @@
 #include "core/threading/taskrunner.h"
+#include "core/threading/taskmanager.h"
 #include "core/threading/thread.h"
 #if defined (DEBUG)
 #include <assert.h>
@@ -6,9 +7,14 @@
 
 namespace Cat {
 
-	TaskRunner::TaskRunner(const Char* name, Size queueSize) {
+	TaskRunner::TaskRunner(const Char* name, Size queueSize, const ThreadOptions& options)
+		: m_threadOptions(options) {
+		if (!m_threadOptions.hasName()) {
+			m_threadOptions.setName(name);
+		}
 		m_state = kTRSNotStarted;		
 		m_pName = copy(name);
+		m_pManager = NIL;
 		m_oid = crc32(name);		
 		m_inputQueue.initWithCapacity(queueSize, TaskPtr::nullPtr());
 		m_messageQueue.initWithCapacity((U32)(queueSize), TRMessage());
@@ -16,6 +22,7 @@ namespace Cat {
 		m_pNodeStorage = new TaskQueueNode[queueSize];
 		m_free.initAsRoot();
 		m_queued.initAsRoot();		
+		m_parked.initAsRoot();
 		m_numFree = m_numUsed = 0;
 		
 		for (U32 i = 0; i < (queueSize); i++) {
@@ -34,6 +41,7 @@ namespace Cat {
 			removeRunningTask();
 
 			m_queued.initAsRoot();
+			m_parked.initAsRoot();
 			m_free.initAsRoot();
 
 			if (m_pNodeStorage) {				
@@ -49,18 +57,25 @@ namespace Cat {
 	}
 
 	TaskRunner::TaskRunnerState TaskRunner::run() {
-		m_syncLock.lock();
+		m_stateLock.lock();
 		if (Thread::runTaskRunner(this) != NIL) {
 			m_state = kTRSRunning;
 			DMSG("Task runner " << name() << " started.");
 		} else {
 			m_state = kTRSFailedToStart;
 		}
-		m_syncLock.broadcast();
-		m_syncLock.unlock();				
+		m_stateChanged.broadcast();
+		m_stateLock.unlock();				
 		return m_state;
 	}
 
+	void TaskRunner::setState(TaskRunnerState state) {
+		m_stateLock.lock();
+		m_state = state;
+		m_stateChanged.broadcast();
+		m_stateLock.unlock();
+	}
+
 	void TaskRunner::processMessages() {
 		TRMessage message;
 		TaskPtr taskPtr;	
@@ -72,19 +87,15 @@ namespace Cat {
 			switch(message.type) {
 				
 			case kTRMClearAllWaitingTasks:
-				m_syncLock.lock();				
 				clearInputAndQueue();
-				m_syncLock.unlock();				
 				break;
 				
 			case kTRMTerminateTaskRunner:
-				m_syncLock.lock();
 				removeRunningTask();					
 				clearInputAndQueue();
 				if (m_state == kTRSNotStarted) {
-					m_state = kTRSTerminated;
+					setState(kTRSTerminated);
 				}				
-				m_syncLock.unlock();				
 				break;
 				
 			default:
@@ -94,19 +105,28 @@ namespace Cat {
 	}
 
 	void TaskRunner::taskRunLoop() {
-		m_syncLock.lock();
+		m_stateLock.lock();
 		/* Sync up to make sure have started running */
-		m_syncLock.unlock();
+		m_stateLock.unlock();
 
 		/* Now enter the tasking loop. */
 		Boolean loopity = true;
 		while (loopity) {		
-			if (hasQueued() || !m_messageQueue.isEmpty()) {
+			/* A task that takes more than one run is run again even with nothing
+			 * else queued, until the runner is told to terminate.  A parked task
+			 * is not run until it has been woken. */
+			if (hasQueued() || !m_messageQueue.isEmpty() || hasWokenTasks() ||
+				 (m_running.notNull() && m_state == kTRSRunning)) {
 				runNextTask();
 			} else {
-				m_syncLock.lock();
-				while (m_inputQueue.isEmpty() && m_state == kTRSRunning && m_messageQueue.isEmpty()) {
-					m_syncLock.wait();
+				/* Check the queues again after registering as a waiter, so a task
+				 * queued in between is either seen here or wakes us up. */
+				I32 key = m_wakeup.prepareWait();
+				if (m_inputQueue.isEmpty() && m_state == kTRSRunning && m_messageQueue.isEmpty() &&
+					 !hasWokenTasks()) {
+					m_wakeup.wait(key);
+				} else {
+					m_wakeup.cancelWait();
 				}
 				/* We only want to exit the loop if the task queue is empty, 
 				 * since we have to terminate all the taskes before we exit.
@@ -114,20 +134,22 @@ namespace Cat {
 				if (!hasQueued() && m_state != kTRSRunning) {
 					loopity = false; /* Break out of the loop */
 				}				
-				m_syncLock.unlock();
 			}			
 		}
 
-		/* Signal anything waiting on the task runner to terminate */
-		m_syncLock.lock();
-		m_state = kTRSTerminated;		
 		/* Ensure no waiting */
 	   clearInputAndQueue();		
 		m_messageQueue.clear();
 		removeRunningTask();		
 		DMSG("Task Runner " << name() << " terminated!" << std::flush);		
-		m_syncLock.broadcast();
-		m_syncLock.unlock();
+		/* Signal anything waiting on the task runner to terminate, and take what was
+		 * pushed by a queueTask() that checked the state before it changed. */
+		m_stateLock.lock();
+		m_state = kTRSTerminated;
+		memoryBarrier();
+		clearInput();
+		m_stateChanged.broadcast();
+		m_stateLock.unlock();
 	}
 
 	void TaskRunner::runNextTask() {
@@ -137,6 +159,17 @@ namespace Cat {
 			processMessages();				
 		}
 
+		/* Queue the parked tasks that have been woken since. */
+		if (m_parked.next != &m_parked) {
+			unparkWokenTasks();
+		}
+
+		/* A task that did not finish waits its turn behind the queued ones, it
+		 * takes back its node before the input can use it. */
+		if (m_running.notNull() && hasQueued()) {
+			requeueRunningTask();
+		}
+
 		/* If there are any waiting tasks in the input queue, pull them into 
 		 * the queued list. */
 		/* If there are any processes waiting to be added, add them */
@@ -144,8 +177,16 @@ namespace Cat {
 			addTaskToQueue(m_inputQueue.pop());			
 		}
 
+		/* Give some of the waiting tasks to a runner with nothing to do. */
+		if (m_pManager && m_numUsed > 1) {
+			TaskRunner* idle = m_pManager->findIdleTaskRunner(this);
+			if (idle) {
+				shareQueuedTasks(idle);
+			}
+		}
+
 		/* If there is a task to run, run it. */
-		if (m_queued.next != &m_queued) {
+		if (m_running.isNull() && m_queued.next != &m_queued) {
 			m_running = m_queued.next->task;
 			m_queued.next->dealloc(&m_free);
 			m_numFree++;
@@ -193,25 +234,28 @@ namespace Cat {
 
 				/* Remove the task */
 				removeRunningTask();								
+			} else if (m_running->isAlive()) {
+				/* Not run again until it is woken, if it is waiting on something. */
+				parkRunningTask();
 			}
 		}
 	}
 
 	Boolean TaskRunner::waitForTermination() {
-		m_syncLock.lock();
+		m_stateLock.lock();
 		while (m_state == kTRSRunning || m_state == kTRSWillTerminate) {
-			m_syncLock.wait();
+			m_stateChanged.wait(m_stateLock);
 		}
-		m_syncLock.unlock();
+		m_stateLock.unlock();
 		return (m_state == kTRSTerminated);		
 	}
 
 	Boolean TaskRunner::waitUntilStarted() {
-		m_syncLock.lock();
+		m_stateLock.lock();
 		while (m_state == kTRSNotStarted) {
-			m_syncLock.wait();
+			m_stateChanged.wait(m_stateLock);
 		}
-		m_syncLock.unlock();
+		m_stateLock.unlock();
 		return (m_state == kTRSRunning);		
 	}
 
@@ -220,6 +264,7 @@ namespace Cat {
 		node->alloc(&m_queued, task);
 		m_numFree--;
 		m_numUsed++;
+		m_numQueued.increment();
 	}
 
 	void TaskRunner::removeRunningTask() {
@@ -234,12 +279,97 @@ namespace Cat {
 			checkForParentAndRemoveIfNeeded(m_running);			
 			m_running->remove();
 			m_running.setNull();			
+			m_numQueued.decrement();
+		}
+	}
+
+	void TaskRunner::requeueRunningTask() {
+		/* Still counted in m_numQueued, it only moves to the back of the queue. */
+		if (m_numFree > 0) {
+			m_free.next->alloc(&m_queued, m_running);
+			m_numFree--;
+			m_numUsed++;
+			m_running.setNull();
+		}
+	}
+
+	Boolean TaskRunner::parkRunningTask() {
+		if (m_numFree == 0 || !m_running->park(this)) {
+			return false;
+		}
+		/* Still counted in m_numQueued, but not in m_numUsed so it is never shared. */
+		m_free.next->alloc(&m_parked, m_running);
+		m_numFree--;
+		m_running.setNull();
+		return true;
+	}
+
+	Boolean TaskRunner::hasWokenTasks() const {
+		const TaskQueueNode* node = m_parked.next;
+		while (node != &m_parked) {
+			if (!node->task->isWaiting() || !node->task->isAlive()) {
+				return true;
+			}
+			node = node->next;
+		}
+		return false;
+	}
+
+	void TaskRunner::unparkWokenTasks() {
+		TaskQueueNode* node = m_parked.next;
+		TaskQueueNode* next = NIL;
+		while (node != &m_parked) {
+			next = node->next;
+			if (!node->task->isWaiting() || !node->task->isAlive()) {
+				node->task->park(NIL);
+				node->realloc(&m_queued);
+				m_numUsed++;
+			}
+			node = next;
+		}
+	}
+
+	void TaskRunner::shareQueuedTasks(TaskRunner* idle) {
+		U32 count = m_numUsed / 2;
+		if (count == 0) {
+			return;
+		}
+		if (count > kMaxSharedTasks) {
+			count = kMaxSharedTasks;
+		}
+
+		/* Take the newest tasks, the oldest ones are run here next. */
+		TaskPtr tasks[kMaxSharedTasks];
+		U32 numShared = 0;
+		TaskQueueNode* node = m_queued.prev;
+		while (node != &m_queued && numShared < count) {
+			TaskQueueNode* prev = node->prev;
+			if (node->task->parent().isNull() && !node->task->isInitialized()) {
+				tasks[numShared++] = node->task;
+				node->dealloc(&m_free);
+				m_numFree++;
+				m_numUsed--;
+				m_numQueued.decrement();
+			}
+			node = prev;
+		}
+		for (U32 i = 0; i < numShared / 2; ++i) {
+			TaskPtr tmp = tasks[i];
+			tasks[i] = tasks[numShared - 1 - i];
+			tasks[numShared - 1 - i] = tmp;
+		}
+
+		/* Whatever the idle runner has no room for is queued here again. */
+		Size moved = idle->queueTasks(tasks, numShared);
+		for (Size i = moved; i < numShared; ++i) {
+			addTaskToQueue(tasks[i]);
 		}
+		DMSG("Task Runner " << name() << " moved " << moved << " tasks to " << idle->name() << ".");
 	}
 	
 		
 
-	void TaskRunner::clearInputAndQueue() {
+	void TaskRunner::clearInput() {
 		TaskPtr task;		
 		while(!m_inputQueue.isEmpty()) {
 			task = m_inputQueue.pop();
@@ -249,6 +379,24 @@ namespace Cat {
 				task->onTermination();
 			}			
 		}
+	}
+
+	Boolean TaskRunner::drainIfTerminated() {
+		/* Pairs with the barrier when the loop exits, either the runner's last
+		 * clearInput() sees the push or we see it terminated. */
+		memoryBarrier();
+		if (m_state != kTRSTerminated) {
+			return false;
+		}
+		/* Nothing runs the input queue any more, the lock keeps it to one consumer. */
+		m_stateLock.lock();
+		clearInput();
+		m_stateLock.unlock();
+		return true;
+	}
+
+	void TaskRunner::clearInputAndQueue() {
+		clearInput();
 		
 		TaskQueueNode* node = m_queued.next;
 		TaskQueueNode* next = NIL;	 
@@ -263,10 +411,26 @@ namespace Cat {
 			node->dealloc(&m_free);
 			node = next;
 			m_numFree++;	
+			m_numQueued.decrement();
 		}
 		
 		m_numUsed = 0;		
 		m_queued.initAsRoot();
+
+		node = m_parked.next;
+		while (node != &m_parked) {
+			next = node->next;
+			node->task->park(NIL);
+			checkForChildAndRemoveIfNeeded(node->task);
+			checkForParentAndRemoveIfNeeded(node->task);
+			node->task->terminate();
+			node->task->onTermination();
+			node->dealloc(&m_free);
+			node = next;
+			m_numFree++;
+			m_numQueued.decrement();
+		}
+		m_parked.initAsRoot();
 	}	
 	
 	
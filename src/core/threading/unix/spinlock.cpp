@@ -3,14 +3,14 @@
 namespace Cat {
 
 	Spinlock::Spinlock() {
-		int error = pthread_spin_init(m_spinlock, NIL);
+		int error = pthread_spin_init(&m_spinlock, PTHREAD_PROCESS_PRIVATE);
 		if (error != 0) {
 			DERR("Could not initialize Spinlock.  pthread_spin_init failed with code " << error << "!");
 		} 
 	}
 
 	Spinlock::~Spinlock() {
-		int error = pthread_spin_destroy(m_spinlock);
+		int error = pthread_spin_destroy(&m_spinlock);
 		if (error != 0) {
 			DERR("Could not destroy Spinlock.  pthread_spin_destroy failed with code: " << error << "!");
 		}
@@ -1,57 +1,122 @@
 #include "core/threading/unix/thread.h"
 #include <cassert>
+#include <climits>
+#include <sched.h>
 #include "core/threading/processrunner.h"
 #include "core/threading/taskrunner.h"
 
 namespace Cat {
 
-	ThreadHandle* Thread::run(Runnable* runnable) {
-		pthread_attr_t attr;
-		pthread_attr_init(&attr);
-		// Explict for portability.
-		pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
-
+	ThreadHandle* Thread::run(Runnable* runnable, const ThreadOptions& options) {
 		pthread_t* threadId = runnable->getThread();
-		I32 error = pthread_create(threadId, &attr, runnable_func_entry__, (VPtr)runnable);
+		I32 error = create(threadId, options, runnable_func_entry__, (VPtr)runnable);
 		if (error != 0) {
 			runnable->setError(error);
 			DERR("Failed to start thread for running Runnable: " << runnable->getInfo() << " with error: " << error << " (" << getStringErrorCode(error) << ").");
 			return NIL;
 		}
-		pthread_attr_destroy(&attr);
 		return threadId;
 	}
 
 	ThreadHandle* Thread::runProcessRunner(ProcessRunner* runner) {
-		pthread_attr_t attr;
-		pthread_attr_init(&attr);
-		// Explict for portability.
-		pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
-
 		pthread_t* threadId = runner->threadPtr();
-		I32 error = pthread_create(threadId, &attr, process_runner_func_entry__, (VPtr)runner);
+		I32 error = create(threadId, runner->threadOptions(), process_runner_func_entry__, (VPtr)runner);
 		if (error != 0) {			
 			DERR("Failed to start thread for Process Runner!" << runner->name() << " with error: " << error << " (" << getStringErrorCode(error) << ").");
 			return NIL;
 		}
-		pthread_attr_destroy(&attr);
 		return threadId;
 	}
 
-		ThreadHandle* Thread::runTaskRunner(TaskRunner* runner) {
+	ThreadHandle* Thread::runTaskRunner(TaskRunner* runner) {
+		pthread_t* threadId = runner->threadPtr();
+		I32 error = create(threadId, runner->threadOptions(), task_runner_func_entry__, (VPtr)runner);
+		if (error != 0) {			
+			DERR("Failed to start thread for Task Runner!" << runner->name() << " with error: " << error << " (" << getStringErrorCode(error) << ").");
+			return NIL;
+		}
+		return threadId;
+	}
+
+	I32 Thread::create(ThreadHandle* threadHandle, const ThreadOptions& options, VPtr (*entry)(VPtr), VPtr data) {
 		pthread_attr_t attr;
 		pthread_attr_init(&attr);
 		// Explict for portability.
 		pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
 
-		pthread_t* threadId = runner->threadPtr();
-		I32 error = pthread_create(threadId, &attr, task_runner_func_entry__, (VPtr)runner);
-		if (error != 0) {			
-			DERR("Failed to start thread for Task Runner!" << runner->name() << " with error: " << error << " (" << getStringErrorCode(error) << ").");
-			return NIL;
+		if (options.stackSize() > 0) {
+			Size stackSize = options.stackSize();
+			if (stackSize < (Size)PTHREAD_STACK_MIN) {
+				stackSize = PTHREAD_STACK_MIN;
+			}
+			I32 error = pthread_attr_setstacksize(&attr, stackSize);
+			if (error != 0) {
+				DWARN("Could not set the stack size of thread " << options.name() << " to " << stackSize << " (" << getStringErrorCode(error) << ").");
+			}
+		}
+
+		if (options.affinity() != 0) {
+#if defined (OS_APPLE)
+			DWARN("Cannot pin thread " << options.name() << " to CPUs, not supported on this OS.");
+#else
+			cpu_set_t cpus;
+			CPU_ZERO(&cpus);
+			for (U32 cpu = 0; cpu < ThreadOptions::kMaxCpus; ++cpu) {
+				if (options.affinity() & ((U64)1 << cpu)) {
+					CPU_SET(cpu, &cpus);
+				}
+			}
+			I32 error = pthread_attr_setaffinity_np(&attr, sizeof(cpus), &cpus);
+			if (error != 0) {
+				DWARN("Could not pin thread " << options.name() << " to CPUs " << options.affinity() << " (" << getStringErrorCode(error) << ").");
+			}
+#endif
+		}
+
+		Boolean explicitScheduling = false;
+		if (options.policy() != ThreadOptions::kTSPInherit) {
+			I32 policy = SCHED_OTHER;
+			if (options.policy() == ThreadOptions::kTSPFifo) {
+				policy = SCHED_FIFO;
+			} else if (options.policy() == ThreadOptions::kTSPRoundRobin) {
+				policy = SCHED_RR;
+			}
+			sched_param param;
+			param.sched_priority = options.priority();
+			if (param.sched_priority < sched_get_priority_min(policy)) {
+				param.sched_priority = sched_get_priority_min(policy);
+			} else if (param.sched_priority > sched_get_priority_max(policy)) {
+				param.sched_priority = sched_get_priority_max(policy);
+			}
+			explicitScheduling = (pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED) == 0 &&
+										 pthread_attr_setschedpolicy(&attr, policy) == 0 &&
+										 pthread_attr_setschedparam(&attr, &param) == 0);
+			if (!explicitScheduling) {
+				DWARN("Could not set the scheduling of thread " << options.name() << ", using the default.");
+				pthread_attr_setinheritsched(&attr, PTHREAD_INHERIT_SCHED);
+			}
+		}
+
+		I32 error = pthread_create(threadHandle, &attr, entry, data);
+		if (error == EPERM && explicitScheduling) {
+			/* Not allowed to use the policy, rather run with the default one than not at all. */
+			DWARN("Not permitted to set the scheduling of thread " << options.name() << ", using the default.");
+			pthread_attr_setinheritsched(&attr, PTHREAD_INHERIT_SCHED);
+			error = pthread_create(threadHandle, &attr, entry, data);
 		}
 		pthread_attr_destroy(&attr);
-		return threadId;
+
+		if (error == 0 && options.hasName()) {
+#if defined (OS_APPLE)
+			DWARN("Cannot name thread " << options.name() << ", only the thread itself can on this OS.");
+#else
+			I32 nameError = pthread_setname_np(*threadHandle, options.name());
+			if (nameError != 0) {
+				DWARN("Could not name thread " << options.name() << " (" << getStringErrorCode(nameError) << ").");
+			}
+#endif
+		}
+		return error;
 	}
 
 	/**
@@ -74,16 +139,16 @@ namespace Cat {
 	VPtr process_runner_func_entry__(VPtr data) {
 		ProcessRunner* runner = reinterpret_cast<ProcessRunner*>(data);
 		runner->processingLoop();
-		ProcessRunner::ProcessRunnerState state = runner->state();
-		pthread_exit((VPtr)state);
+		/* The runner may already be destroyed by a thread waiting for it to terminate. */
+		pthread_exit((VPtr)ProcessRunner::kPMSTerminated);
 	}
 
 	
 	VPtr task_runner_func_entry__(VPtr data) {
 		TaskRunner* runner = reinterpret_cast<TaskRunner*>(data);
 		runner->taskRunLoop();
-		TaskRunner::TaskRunnerState state = runner->state();
-		pthread_exit((VPtr)state);
+		/* The runner may already be destroyed by a thread waiting for it to terminate. */
+		pthread_exit((VPtr)TaskRunner::kTRSTerminated);
 	}
 
 } // namespace Cat
@@ -0,0 +1,57 @@
+#include "core/util/hashedid.h"
+#if defined(DEBUG)
+#include "core/string/stringutils.h"
+#include "core/threading/spinlock.h"
+#include "core/util/hashmap.h"
+#endif
+
+namespace Cat {
+
+#if defined(DEBUG)
+	namespace {
+		/* The recorded names, kept in copies, as a HashedID may be made of a temporary string. */
+		struct NameRegistry {
+			~NameRegistry() {
+				for (HashMap<OID, Char*>::Iterator it = names.iterator(); it.isValid(); it.next()) {
+					StringUtils::free(it.val());
+				}
+			}
+
+			HashMap<OID, Char*>	names;
+			Spinlock					lock;
+		};
+
+		inline NameRegistry& nameRegistry() {
+			static NameRegistry registry;
+			return registry;
+		}
+	} // namespace
+
+	OID HashedID::record() const {
+		NameRegistry& registry = nameRegistry();
+		registry.lock.lock();
+		Char** name = registry.names.find(m_id);
+		if (!name) {
+			registry.names.insert(m_id, StringUtils::copy(m_pName));
+		} else if (strcmp(*name, m_pName) != 0) {
+			DERR("HashedID collision, \"" << m_pName << "\" has the same OID as \"" << *name << "\": " << m_id);
+		}
+		registry.lock.unlock();
+		return m_id;
+	}
+
+	const Char* HashedID::nameOf(OID id) {
+		NameRegistry& registry = nameRegistry();
+		registry.lock.lock();
+		Char** name = registry.names.find(id);
+		const Char* found = name ? *name : NIL;
+		registry.lock.unlock();
+		return found;
+	}
+#else
+	const Char* HashedID::nameOf(OID id) {
+		return NIL;
+	}
+#endif
+
+} // namespace Cat
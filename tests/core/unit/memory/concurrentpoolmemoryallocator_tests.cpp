@@ -0,0 +1,175 @@
+#include <assert.h>
+#include <ctime>
+#ifndef DEBUG
+#define DEBUG 1
+#endif
+#include "core/memory/concurrentpoolmemoryallocator.h"
+#include "core/threading/thread.h"
+
+#define BEGIN_TEST (std::cout << ">>> BEGINNING " << __FUNCTION__ << std::endl)
+#define FINISH_TEST (std::cout << ">>> FINISHED " << __FUNCTION__ << std::endl << std::endl)
+
+#define NUM_THREADS 8
+#define NUM_ITERATIONS 10000
+
+namespace Cat {
+	class TestOne {
+		public:
+			TestOne(I32 count = -1) {
+				var_one_ = count;
+				var_two_ = 2;
+				var_three_ = 3.3;
+			}
+
+			I32 varOne() const { return var_one_; }
+			U32 varTwo() const { return var_two_; }
+			F32 varThree() const { return var_three_; }
+
+		private:
+			I32 var_one_;
+			U32 var_two_;
+			F32 var_three_;
+	};
+
+	ConcurrentPoolMemoryAllocator* sharedAlloc = NIL;
+
+	I32 allocateAndFree(VPtr data) {
+		I32 id = (I32)(Addr)data;
+		TestOne* objects[16];
+		for (I32 i = 0; i < NUM_ITERATIONS; i++) {
+			for (I32 j = 0; j < 16; j++) {
+				objects[j] = new (*sharedAlloc) TestOne(id);
+				assert(objects[j] != NIL);
+			}
+			for (I32 j = 0; j < 16; j++) {
+				assert(objects[j]->varOne() == id);
+				sharedAlloc->dealloc(objects[j]);
+			}
+		}
+		return 0;
+	}
+
+	void testConcurrentPoolMemoryAllocatorCreation() {
+		BEGIN_TEST;
+		ConcurrentPoolMemoryAllocator* alloc = ::new ConcurrentPoolMemoryAllocator(sizeof(TestOne), 10, 4, 4);
+		assert(alloc->getBlockSize() == sizeof(TestOne));
+		assert(alloc->getNumberOfBlocks() == 10);
+		assert(alloc->getMagazineSize() == 4);
+		assert(alloc->getOID() == 0);
+		alloc->free();
+		delete alloc;
+		FINISH_TEST;
+	}
+
+	void testConcurrentPoolMemoryAllocatorAllocation() {
+		BEGIN_TEST;
+		ConcurrentPoolMemoryAllocator* poolAlloc = ::new ConcurrentPoolMemoryAllocator(sizeof(TestOne), 100, 4, 8);
+		MemoryAllocator* alloc = (MemoryAllocator*)poolAlloc;
+
+		TestOne* tests[100];
+		for (I32 i = 0; i < 100; i++) {
+			tests[i] = new (*alloc) TestOne(i);
+			assert(tests[i] != NIL);
+			assert((Addr)tests[i] >= poolAlloc->getAlignedMemoryBlock().addr);
+			assert((Addr)tests[i] < poolAlloc->getAlignedMemoryBlock().addr + 100*sizeof(TestOne));
+		}
+		// Every block is handed out exactly once.
+		for (I32 i = 0; i < 100; i++) {
+			assert(tests[i]->varOne() == i);
+			for (I32 j = i + 1; j < 100; j++) {
+				assert(tests[i] != tests[j]);
+			}
+		}
+		assert(alloc->alloc() == NIL);
+
+		for (I32 i = 0; i < 100; i++) {
+			alloc->dealloc(tests[i]);
+		}
+		for (I32 i = 0; i < 100; i++) {
+			tests[i] = new (*alloc) TestOne(i);
+			assert(tests[i] != NIL);
+		}
+		assert(alloc->alloc() == NIL);
+
+		alloc->reset();
+		for (I32 i = 0; i < 100; i++) {
+			assert(alloc->alloc() != NIL);
+		}
+		assert(alloc->alloc() == NIL);
+
+		alloc->free();
+		delete alloc;
+		FINISH_TEST;
+	}
+
+	void testConcurrentPoolMemoryAllocatorFlushThreadCache() {
+		BEGIN_TEST;
+		ConcurrentPoolMemoryAllocator* alloc = ::new ConcurrentPoolMemoryAllocator(sizeof(TestOne), 64, 4, 16);
+
+		VPtr blocks[64];
+		for (I32 i = 0; i < 64; i++) {
+			blocks[i] = alloc->alloc();
+			assert(blocks[i] != NIL);
+		}
+		for (I32 i = 0; i < 64; i++) {
+			alloc->dealloc(blocks[i]);
+		}
+		alloc->flushThreadCache();
+		for (I32 i = 0; i < 64; i++) {
+			assert(alloc->alloc() != NIL);
+		}
+		assert(alloc->alloc() == NIL);
+
+		alloc->free();
+		delete alloc;
+		FINISH_TEST;
+	}
+
+	void testConcurrentPoolMemoryAllocatorMultipleThreads() {
+		BEGIN_TEST;
+		sharedAlloc = ::new ConcurrentPoolMemoryAllocator(sizeof(TestOne), NUM_THREADS*64, 4, 32);
+		sharedAlloc->enableStats(true);
+
+		ThreadHandle handles[NUM_THREADS];
+		clock_t start = clock();
+		for (I32 i = 0; i < NUM_THREADS; i++) {
+			handles[i] = *(Thread::run(RunnableFunc::createRunnableFuncToDestroyOnCompletion(allocateAndFree, (VPtr)(Addr)i)));
+		}
+		for (I32 i = 0; i < NUM_THREADS; i++) {
+			Thread::join(&handles[i]);
+		}
+		clock_t total = clock() - start;
+		D(std::cout << "Finished " << NUM_THREADS << " threads in " << std::dec << total << " ticks!" << std::endl);
+
+		// The statistics of the exited threads are kept.
+		AllocatorStats stats;
+		assert(sharedAlloc->getStats(&stats));
+		assert(stats.allocs == (U64)NUM_THREADS*NUM_ITERATIONS*16);
+		assert(stats.deallocs == stats.allocs);
+		assert(stats.failed_allocs == 0 && stats.live_bytes == 0);
+		assert(stats.peak_bytes >= 16*sizeof(TestOne));
+		assert(stats.peak_bytes <= stats.capacity_bytes);
+		D(sharedAlloc->dumpStats(std::cout));
+
+		// All the threads have exited, so every block must be back in the shared list.
+		for (I32 i = 0; i < NUM_THREADS*64; i++) {
+			assert(sharedAlloc->alloc() != NIL);
+		}
+		assert(sharedAlloc->alloc() == NIL);
+
+		sharedAlloc->free();
+		delete sharedAlloc;
+		sharedAlloc = NIL;
+		FINISH_TEST;
+	}
+
+}
+
+int main(int argc, char** argv) {
+	Cat::testConcurrentPoolMemoryAllocatorCreation();
+	Cat::testConcurrentPoolMemoryAllocatorAllocation();
+	Cat::testConcurrentPoolMemoryAllocatorFlushThreadCache();
+	Cat::testConcurrentPoolMemoryAllocatorMultipleThreads();
+
+	return 0;
+}
@@ -190,17 +190,17 @@ namespace cc {
 		assert(alloc->alloc(sizeof(TestOne12Bytes), 4) == NIL);
 		
 		TestTwo20Bytes* test5 = new (*alloc, 8) TestTwo20Bytes;
-		assert(test1->varOne() == 1);
-		assert(test1->varTwo() == 2);
-		assert(test1->varThree() == 3.3f);
+		assert(test5->varOne() == 1);
+		assert(test5->varTwo() == 2);
+		assert(test5->varThree() == 3.3f);
 		TestTwo20Bytes* test6 = new (*alloc, 8) TestTwo20Bytes;
-		assert(test2->varOne() == 1);
-		assert(test2->varTwo() == 2);
-		assert(test2->varThree() == 3.3f);
+		assert(test6->varOne() == 1);
+		assert(test6->varTwo() == 2);
+		assert(test6->varThree() == 3.3f);
 		TestTwo20Bytes* test7 = new (*alloc, 8) TestTwo20Bytes;
-		assert(test3->varOne() == 1);
-		assert(test3->varTwo() == 2);
-		assert(test3->varThree() == 3.3f);
+		assert(test7->varOne() == 1);
+		assert(test7->varTwo() == 2);
+		assert(test7->varThree() == 3.3f);
 
 		assert(alloc->alloc(sizeof(TestTwo20Bytes), 8) == NIL);
 
@@ -346,21 +346,25 @@ namespace cc {
 
 		TestOne12Bytes* test1 = new (*alloc, 4) TestOne12Bytes;
 		TestOne12Bytes* test2 = new (*alloc, 4) TestOne12Bytes;
+		assert(test1 != NIL && test2 != NIL);
 		assert(alloc->alloc(sizeof(TestOne12Bytes), 4) == NIL);
 
 		TestTwo20Bytes* test3 = new (*alloc, 8) TestTwo20Bytes;
 		TestTwo20Bytes* test4 = new (*alloc, 8) TestTwo20Bytes;
+		assert(test3 != NIL && test4 != NIL);
 		assert(alloc->alloc(sizeof(TestTwo20Bytes), 8) == NIL);
 
 		alloc->free();
 
 		test1 = new (*alloc, 4) TestOne12Bytes;
 		test2 = new (*alloc, 4) TestOne12Bytes;
+		assert(test1 != NIL && test2 != NIL);
 		assert(alloc->alloc(sizeof(TestOne12Bytes), 4) == NIL);
 
 		dChunkAlloc->addChunk(sizeof(TestTwo20Bytes), 3);
 		test3 = new (*alloc, 8) TestTwo20Bytes;
 		test4 = new (*alloc, 8) TestTwo20Bytes;
+		assert(test3 != NIL && test4 != NIL);
 		assert(alloc->alloc(sizeof(TestTwo20Bytes), 8) != NIL);
 
 		assert(dChunkAlloc->getNumberOfAllocators() == 2);
@@ -387,7 +391,7 @@ namespace cc {
 
 		TestOne12Bytes* test;
 		TestOne12Bytes* prev = new (*alloc, 4) TestOne12Bytes(0);
-		for(I32 i = 1; i < 100; i++) {
+		for(U32 i = 1; i < 100; i++) {
 			test = new (*alloc, 4) TestOne12Bytes(i);
 			assert(test->varOne() == i);
 			assert(test->varTwo() == 2);
@@ -404,7 +408,7 @@ namespace cc {
 		alloc->reset();
 
 		prev = new (*alloc, 4) TestOne12Bytes(0);
-		for(I32 i = 1; i < 100; i++) {
+		for(U32 i = 1; i < 100; i++) {
 			test = new (*alloc, 4) TestOne12Bytes(i);
 			assert(test->varOne() == i);
 			assert(test->varTwo() == 2);
@@ -436,7 +440,7 @@ namespace cc {
 		TestOne12Bytes* test;
 		clock_t start, end, total1, total2;
 		start = clock();
-		for(I32 i = 1; i < 10000; i++) {
+		for(U32 i = 1; i < 10000; i++) {
 			test = new (*alloc, 4) TestOne12Bytes(i);
 			assert(test->varOne() == i);
 			assert(test->varTwo() == 2);
@@ -447,7 +451,7 @@ namespace cc {
 		D(std::cout << "Finished DynamicChunkMemoryAllocators in " << std::dec << total1 << " ticks!" << std::endl);
 
 		start = clock();
-		for(I32 i = 1; i < 10000; i++) {
+		for(U32 i = 1; i < 10000; i++) {
 			test = new TestOne12Bytes(i);
 			assert(test->varOne() == i);
 			assert(test->varTwo() == 2);
@@ -477,7 +481,7 @@ namespace cc {
 		TestOne12Bytes* test;
 		clock_t start, end, total1, total2;
 		start = clock();
-		for(I32 i = 1; i < 10000; i++) {
+		for(U32 i = 1; i < 10000; i++) {
 			test = new (*alloc, 4) TestOne12Bytes(i);
 			assert(test->varOne() == i);
 			assert(test->varTwo() == 2);
@@ -489,7 +493,7 @@ namespace cc {
 		D(std::cout << "Finished PoolMemoryAllocations in " << std::dec << total1 << " ticks!" << std::endl);
 
 		start = clock();
-		for(I32 i = 1; i < 10000; i++) {
+		for(U32 i = 1; i < 10000; i++) {
 			test = ::new TestOne12Bytes(i);
 			assert(test->varOne() == i);
 			assert(test->varTwo() == 2);
@@ -520,7 +524,7 @@ namespace cc {
 		TestOne12Bytes* test;
 		clock_t start, end, total1, total2;
 		start = clock();
-		for(I32 i = 1; i < 10000; i++) {
+		for(U32 i = 1; i < 10000; i++) {
 			test = new (*alloc, 4) TestOne12Bytes(i);
 			assert(test->varOne() == i);
 			assert(test->varTwo() == 2);
@@ -531,7 +535,7 @@ namespace cc {
 		D(std::cout << "Finished PoolMemoryAllocations in " << std::dec << total1 << " ticks!" << std::endl);
 
 		start = clock();
-		for(I32 i = 1; i < 10000; i++) {
+		for(U32 i = 1; i < 10000; i++) {
 			test = new (malloc(sizeof(TestOne12Bytes))) TestOne12Bytes(i);
 			assert(test->varOne() == i);
 			assert(test->varTwo() == 2);
@@ -549,6 +553,72 @@ namespace cc {
 		FINISH_TEST;
 	}
 
+	void testDynamicChunkMemoryAllocatorGrowable() {
+		BEGIN_TEST;
+		DynamicChunkMemoryAllocator* dChunkAlloc = ::new DynamicChunkMemoryAllocator(4);
+		assert(!dChunkAlloc->isGrowable());
+		dChunkAlloc->setGrowable(true);
+		assert(dChunkAlloc->isGrowable());
+		MemoryAllocator* alloc = (MemoryAllocator*)dChunkAlloc;
+
+		TestOne12Bytes* tests[40];
+		for (U32 i = 0; i < 40; i++) {
+			tests[i] = new (*alloc, 4) TestOne12Bytes(i);
+			assert(tests[i] != NIL);
+		}
+		assert(dChunkAlloc->getNumberOfAllocators() == 10);
+
+		for (U32 i = 0; i < 40; i++) {
+			assert(tests[i]->varOne() == i);
+			alloc->dealloc(tests[i]);
+		}
+		// All the blocks are free again, so no new chunk is needed.
+		for (U32 i = 0; i < 40; i++) {
+			tests[i] = new (*alloc, 4) TestOne12Bytes(i);
+			assert(tests[i] != NIL);
+		}
+		assert(dChunkAlloc->getNumberOfAllocators() == 10);
+
+		dChunkAlloc->freeChunk(sizeof(TestOne12Bytes));
+		assert(dChunkAlloc->getNumberOfAllocators() == 0);
+		assert(!dChunkAlloc->canFit(sizeof(TestOne12Bytes)));
+
+		alloc->free();
+		delete alloc;
+		FINISH_TEST;
+	}
+
+	void testDynamicChunkMemoryAllocatorManySizes() {
+		BEGIN_TEST;
+		DynamicChunkMemoryAllocator* dChunkAlloc = ::new DynamicChunkMemoryAllocator(16);
+		MemoryAllocator* alloc = (MemoryAllocator*)dChunkAlloc;
+
+		VPtr blocks[24][16];
+		for (U32 size_class = 3; size_class < 24; size_class++) {
+			for (U32 i = 0; i < 16; i++) {
+				blocks[size_class][i] = alloc->alloc(1 << size_class, 8);
+				assert(blocks[size_class][i] != NIL);
+				assert(dChunkAlloc->getChunk(1 << size_class)->doesOwnMemory(blocks[size_class][i]));
+			}
+			assert(alloc->alloc(1 << size_class, 8) == NIL);
+		}
+		assert(dChunkAlloc->getNumberOfAllocators() == 21);
+
+		// Free one size class, the rest must still be found by dealloc().
+		dChunkAlloc->freeChunk(1 << 10);
+		for (U32 size_class = 3; size_class < 24; size_class++) {
+			if (size_class == 10) { continue; }
+			for (U32 i = 0; i < 16; i++) {
+				alloc->dealloc(blocks[size_class][i]);
+			}
+			assert(alloc->alloc(1 << size_class, 8) != NIL);
+		}
+
+		alloc->free();
+		delete alloc;
+		FINISH_TEST;
+	}
+
 }
 
 
@@ -560,6 +630,8 @@ int main(int argc, char** argv) {
 	cc::testDynamicChunkMemoryAllocatorMixedAllocation();
 	cc::testDynamicChunkMemoryAllocatorMaxChunks();
 	cc::testDynamicChunkMemoryAllocatorAllocationOneHundredWithReset();
+	cc::testDynamicChunkMemoryAllocatorGrowable();
+	cc::testDynamicChunkMemoryAllocatorManySizes();
 	cc::testDynamicChunkMemoryAllocatorAllocationSpeed();
 	cc::testDynamicChunkMemoryAllocatorAllocationAndDeallocationSpeed();
 	cc::testDynamicChunkMemoryAllocatorAllocationSpeedMalloc();
@@ -6,6 +6,7 @@
 #include "core/memory/memorymanager.h"
 #include "core/memory/stackmemoryallocator.h"
 #include "core/memory/poolmemoryallocator.h"
+#include "core/memory/backingmemory.h"
 
 #define BEGIN_TEST (std::cout << ">>> BEGINNING " << __FUNCTION__ << std::endl)
 #define FINISH_TEST (std::cout << ">>> FINISHED " << __FUNCTION__ << std::endl << std::endl)
@@ -774,6 +775,113 @@ namespace cc {
 		FINISH_TEST;
 
 	}
+	void testCreateHugePageAndNumaAllocators() {
+		BEGIN_TEST;
+
+		MemoryManager::initializeMemoryManagerInstance();
+		MemoryManager* m = MemoryManager::getInstance();
+		assert(m);
+
+		// Falls back gracefully if huge pages or NUMA are not available.
+		OID pool_id = m->createPoolAllocator(sizeof(TestOne), 100000, 4, AllocatorFlags::kAFHugePages);
+		OID stack_id = m->createStackAllocator(sizeof(TestTwo)*1000, AllocatorFlags::kAFNone, 0);
+		OID chunk_id = m->createChunkAllocator(32, 1000, AllocatorFlags::kAFHugePages, 0);
+		assert(pool_id > 0 && stack_id > 0 && chunk_id > 0);
+		assert(len(m) == 3);
+
+		for (I32 i = 0; i < 100000; i++) {
+			TestOne* test1 = new (*(m->get(pool_id))) TestOne;
+			assert(test1 && test1->varOne() == 1);
+		}
+		TestTwo* test2 = new (*(m->get(stack_id)), 8) TestTwo;
+		assert(test2 && test2->varOne() == 1);
+		TestOne* test3 = new (*(m->get(chunk_id)), 4) TestOne;
+		assert(test3 && test3->varOne() == 1);
+
+		BackingMemory memory;
+		assert(allocBackingMemory(&memory, 1000, AllocatorFlags::kAFHugePages));
+		assert(memory.ptr && memory.size >= 1000);
+		assert(memory.source != BS_HUGETLB || memory.size % kHugePageSize == 0);
+		freeBackingMemory(&memory);
+		assert(!memory.ptr && memory.source == BS_NONE);
+
+		MemoryManager::destroyMemoryManagerInstance();
+		assert(!MemoryManager::getInstance());
+
+		FINISH_TEST;
+	}
+	void testAllocatorStats() {
+		BEGIN_TEST;
+
+		MemoryManager::initializeMemoryManagerInstance();
+		MemoryManager* m = MemoryManager::getInstance();
+		assert(m);
+
+		OID pool_id = m->createPoolAllocator(sizeof(TestOne), 10, 4, AllocatorFlags::kAFStats);
+		OID stack_id = m->createStackAllocator(1024, AllocatorFlags::kAFStats);
+		OID dynamic_id = m->createDynamicChunkAllocator(8, AllocatorFlags::kAFStats);
+		OID chunk_id = m->createChunkAllocator(32, 10);
+		assert(!m->get(chunk_id)->isStatsEnabled());
+		assert(!m->get(chunk_id)->getStats(NIL));
+
+		// Pool: fill it up and fail once.
+		MemoryAllocator* pool = m->get(pool_id);
+		TestOne* objs[10];
+		for (U32 i = 0; i < 10; i++) {
+			objs[i] = new (*pool) TestOne;
+		}
+		assert(pool->alloc() == NIL);
+		pool->dealloc(objs[0]);
+		pool->dealloc(objs[1]);
+
+		AllocatorStats stats;
+		assert(pool->getStats(&stats));
+		assert(stats.allocs == 10 && stats.deallocs == 2 && stats.failed_allocs == 1);
+		assert(stats.live_bytes == 8*sizeof(TestOne));
+		assert(stats.peak_bytes == 10*sizeof(TestOne));
+		assert(stats.capacity_bytes == 10*sizeof(TestOne));
+		assert(stats.live_blocks[AllocatorStats::getSizeClass(sizeof(TestOne))] == 8);
+		U64 timed = 0;
+		for (U32 i = 0; i < AllocatorStats::kNumLatencyBuckets; i++) {
+			timed += stats.latency[i];
+		}
+		assert(timed == 10);
+
+		// Stack: the high water mark survives deallocating to a marker.
+		MemoryAllocator* stack = m->get(stack_id);
+		stack->alloc(100, 1);
+		((StackMemoryAllocator*)stack)->mark();
+		stack->alloc(200, 1);
+		stack->dealloc();
+		assert(stack->getStats(&stats));
+		assert(stats.allocs == 2 && stats.deallocs == 1);
+		assert(stats.live_bytes == 100 && stats.peak_bytes == 300);
+
+		// Dynamic chunks: blocks are counted by size class.
+		MemoryAllocator* dynamic = m->get(dynamic_id);
+		VPtr small = dynamic->alloc(16, 8);
+		dynamic->alloc(100, 8);
+		dynamic->alloc(128, 8);
+		dynamic->dealloc(small);
+		assert(dynamic->getStats(&stats));
+		assert(stats.live_blocks[4] == 0 && stats.live_blocks[7] == 2);
+		assert(stats.live_bytes == 256 && stats.capacity_bytes == 8*16 + 8*128);
+
+		// Totals over every allocator with statistics.
+		assert(m->getStats(&stats) == 3);
+		assert(stats.allocs == 10 + 2 + 3);
+		assert(stats.failed_allocs == 1);
+		m->dumpStats(std::cout);
+
+		pool->reset();
+		assert(pool->getStats(&stats) && stats.live_bytes == 0);
+		pool->enableStats(false);
+		assert(!pool->getStats(&stats));
+
+		MemoryManager::destroyMemoryManagerInstance();
+
+		FINISH_TEST;
+	}
 }
 
 int main(int argc, char** argv) {
@@ -787,6 +895,8 @@ int main(int argc, char** argv) {
 	cc::testCreateAndDestroyBeforeFreeing();
 	cc::testCreateWithMaxAllocators();
 	cc::testMemoryManagerGetInstance();
+	cc::testCreateHugePageAndNumaAllocators();
+	cc::testAllocatorStats();
 	
 
 	return 0;
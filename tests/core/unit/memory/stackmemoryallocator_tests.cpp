@@ -417,6 +417,117 @@ namespace cc {
 		FINISH_TEST;
 	}
 
+	void testStackScopeNesting() {
+		BEGIN_TEST;
+		StackMemoryAllocator* stackAlloc = ::new StackMemoryAllocator(4096);
+		MemAddr start = stackAlloc->getNextBlock();
+		U8* outer_bytes;
+		{
+			StackScope request(stackAlloc);
+			outer_bytes = (U8*)request.alloc(64, 8);
+			assert(outer_bytes != NIL);
+			MemAddr after_outer = stackAlloc->getNextBlock();
+			{
+				StackScope sub_request(stackAlloc);
+				assert(sub_request.alloc(128, 8) != NIL);
+				MemAddr after_sub = stackAlloc->getNextBlock();
+				{
+					StackScope parse_buffer(stackAlloc);
+					U8* buffer = (U8*)parse_buffer.alloc(256, 16);
+					assert(buffer != NIL && ((Addr)buffer % 16) == 0);
+					buffer[0] = 42;
+				}
+				assert(stackAlloc->getNextBlock().addr == after_sub.addr);
+				sub_request.release();
+				assert(stackAlloc->getNextBlock().addr == after_outer.addr);
+				assert(sub_request.alloc(32, 8) != NIL);
+			}
+			assert(stackAlloc->getNextBlock().addr == after_outer.addr);
+
+			// A scope can be used together with the markers.
+			stackAlloc->mark();
+			new (*stackAlloc, 4) TestTwo;
+			stackAlloc->dealloc();
+			assert(stackAlloc->getNextBlock().addr == after_outer.addr);
+		}
+		assert(stackAlloc->getNextBlock().addr == start.addr);
+#if defined (DEBUG)
+		// The released memory is poisoned in debug builds.
+		for (U32 i = 0; i < 64; i++) {
+			assert(outer_bytes[i] == StackMemoryAllocator::kStackPoison);
+		}
+#endif
+		delete stackAlloc;
+		FINISH_TEST;
+	}
+
+	void testStackMemoryAllocatorGrowable() {
+		BEGIN_TEST;
+		StackMemoryAllocator* stackAlloc = ::new StackMemoryAllocator(1024, 0, AllocatorFlags::kAFGrowable);
+		stackAlloc->enableStats(true);
+		assert(stackAlloc->getCapacity() == 1024);
+
+		MemAddr start = stackAlloc->getNextBlock();
+		{
+			StackScope scope(stackAlloc);
+			for (U32 i = 0; i < 100; i++) {
+				U32* value = (U32*)scope.alloc(64, 8);
+				assert(value != NIL);
+				*value = i;
+			}
+			assert(stackAlloc->getNumberOfChainedBlocks() > 0);
+			assert(stackAlloc->getCapacity() > 1024);
+
+			// A block larger than the stack gets a chained block of its own.
+			assert(scope.alloc(8000, 8) != NIL);
+
+			{
+				StackScope inner(stackAlloc);
+				U32 chained = stackAlloc->getNumberOfChainedBlocks();
+				assert(inner.alloc(2000, 8) != NIL);
+				assert(stackAlloc->getNumberOfChainedBlocks() == chained + 1);
+			}
+		}
+		assert(stackAlloc->getNumberOfChainedBlocks() == 0);
+		assert(stackAlloc->getNextBlock().addr == start.addr);
+		assert(stackAlloc->getCapacity() == 1024);
+
+		AllocatorStats stats;
+		assert(stackAlloc->getStats(&stats) && stats.live_bytes == 0);
+		assert(stats.failed_allocs == 0);
+
+		// Without the flag, the stack is simply full.
+		StackMemoryAllocator* fixed = ::new StackMemoryAllocator(1024);
+		assert(fixed->alloc(2048, 8) == NIL);
+		assert(fixed->getNumberOfChainedBlocks() == 0);
+
+		// Markers set in a chained block roll back across blocks, and reset drops them all.
+		stackAlloc->alloc(1000, 8);
+		stackAlloc->mark();
+		MemAddr mark = stackAlloc->getNextBlock();
+		stackAlloc->alloc(1000, 8);
+		stackAlloc->alloc(1000, 8);
+		stackAlloc->dealloc();
+		assert(stackAlloc->getNextBlock().addr == mark.addr);
+		stackAlloc->alloc(1000, 8);
+
+		// A marker from another allocator is refused before any block is popped.
+		U32 chained = stackAlloc->getNumberOfChainedBlocks();
+		MemAddr top = stackAlloc->getNextBlock();
+		assert(chained > 0);
+		stackAlloc->rollback(fixed->getMarker());
+		assert(stackAlloc->getNumberOfChainedBlocks() == chained);
+		assert(stackAlloc->getNextBlock().addr == top.addr);
+
+		stackAlloc->reset();
+		assert(stackAlloc->getNumberOfChainedBlocks() == 0);
+		assert(stackAlloc->getNextBlock().addr == start.addr);
+
+		delete fixed;
+		delete stackAlloc;
+		FINISH_TEST;
+	}
+
 
 
 
@@ -431,6 +542,8 @@ int main(int argc, char** argv) {
 	cc::testStackMemoryAllocatorAllocationSpeedMalloc();
 	cc::testStackMemoryAllocatorMarkers();
 	cc::testStackMemoryAllocatorAllocationDifferentSizes();
+	cc::testStackScopeNesting();
+	cc::testStackMemoryAllocatorGrowable();
 
 	return 0;
 }
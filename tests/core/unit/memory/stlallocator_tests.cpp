@@ -0,0 +1,208 @@
+#include <assert.h>
+#include <vector>
+#include <list>
+#include <map>
+#ifndef DEBUG
+#define DEBUG 1
+#endif
+#include "core/memory/stlallocator.h"
+#include "core/memory/stackmemoryallocator.h"
+#include "core/memory/poolmemoryallocator.h"
+#include "core/memory/dynamicchunkmemoryallocator.h"
+#include "core/util/vector.h"
+#include "core/util/list.h"
+#include "core/util/stack.h"
+#include "core/util/map.h"
+
+#define BEGIN_TEST (std::cout << ">>> BEGINNING " << __FUNCTION__ << std::endl)
+#define FINISH_TEST (std::cout << ">>> FINISHED " << __FUNCTION__ << std::endl << std::endl)
+
+namespace Cat {
+
+	class Counted {
+		public:
+			Counted() : value_(0) { ++live_; }
+			Counted(const Counted& src) : value_(src.value_) { ++live_; }
+			~Counted() { --live_; }
+
+			Counted& operator=(const Counted& src) { value_ = src.value_; return *this; }
+
+			I32 value_;
+			static I32 live_;
+	};
+	I32 Counted::live_ = 0;
+
+	void testStlAllocatorEquality() {
+		BEGIN_TEST;
+		StackMemoryAllocator stack(1024);
+		StackMemoryAllocator other(1024);
+
+		StlAllocator<I32> a(&stack);
+		StlAllocator<F64> b(a);
+		StlAllocator<I32> c(&other);
+		StlAllocator<I32> heap;
+
+		assert(a == b);
+		assert(a != c);
+		assert(a != heap);
+		assert(b.getMemoryAllocator() == &stack);
+		assert(heap.getMemoryAllocator() == NIL);
+
+		StlAllocator<I32>::rebind<Counted>::other rebound(a);
+		assert(rebound.getMemoryAllocator() == &stack);
+		FINISH_TEST;
+	}
+
+	void testStlAllocatorStdContainers() {
+		BEGIN_TEST;
+		StackMemoryAllocator stack(64*1024);
+		stack.enableStats(true);
+
+		{
+			std::vector<I32, StlAllocator<I32> > numbers((StlAllocator<I32>(&stack)));
+			for (I32 i = 0; i < 1000; i++) {
+				numbers.push_back(i);
+			}
+			for (I32 i = 0; i < 1000; i++) {
+				assert(numbers[i] == i);
+			}
+			AllocatorStats stats;
+			assert(stack.getStats(&stats) && stats.live_bytes >= 1000*sizeof(I32));
+		}
+
+		{
+			typedef std::map<I32, F32, std::less<I32>, StlAllocator<std::pair<const I32, F32> > > FloatMap;
+			FloatMap floats((std::less<I32>()), StlAllocator<std::pair<const I32, F32> >(&stack));
+			for (I32 i = 0; i < 100; i++) {
+				floats[i] = i * 0.5f;
+			}
+			assert(floats.size() == 100);
+			assert(floats[50] == 25.0f);
+		}
+
+		// The containers are gone, the memory is all released with one reset.
+		AllocatorStats stats;
+		assert(stack.getStats(&stats) && stats.live_bytes > 0);
+		stack.reset();
+		assert(stack.getStats(&stats) && stats.live_bytes == 0);
+
+		// A DynamicChunkMemoryAllocator can free the nodes of a list one at a time.
+		DynamicChunkMemoryAllocator chunks(64);
+		{
+			std::list<I32, StlAllocator<I32> > numbers((StlAllocator<I32>(&chunks)));
+			for (I32 i = 0; i < 50; i++) {
+				numbers.push_back(i);
+			}
+			numbers.remove(10);
+			assert(numbers.size() == 49);
+			assert(chunks.getNumberOfAllocators() == 1);
+		}
+		FINISH_TEST;
+	}
+
+	void testStlAllocatorOutOfMemory() {
+		BEGIN_TEST;
+		StackMemoryAllocator stack(256);
+		StlAllocator<I32> allocator(&stack);
+		Boolean thrown = false;
+		try {
+			allocator.allocate(1000);
+		} catch (std::bad_alloc&) {
+			thrown = true;
+		}
+		assert(thrown);
+		FINISH_TEST;
+	}
+
+	void testVectorWithAllocator() {
+		BEGIN_TEST;
+		StackMemoryAllocator stack(64*1024);
+		MemAddr start = stack.getNextBlock();
+		stack.mark();
+		{
+			Vector<Counted> counted(4, &stack);
+			assert(counted.allocator() == &stack);
+			assert(Counted::live_ == 4);
+			Counted c;
+			for (I32 i = 0; i < 20; i++) {
+				c.value_ = i;
+				counted.append(c);
+			}
+			assert(counted.size() == 20);
+			assert(counted.at(19).value_ == 19);
+
+			Vector<Counted> copy(counted);
+			assert(copy.allocator() == &stack);
+			assert(copy.at(7).value_ == 7);
+		}
+		// Every element was destroyed, even though the memory was not given back.
+		assert(Counted::live_ == 0);
+		stack.dealloc();
+		assert(stack.getNextBlock().addr == start.addr);
+
+		Vector<I32> later;
+		later.setAllocator(&stack);
+		later.initVectorWithCapacity(8);
+		later.append(42);
+		assert(later.allocator() == &stack && later.at(0) == 42);
+		FINISH_TEST;
+	}
+
+	void testListAndStackWithAllocator() {
+		BEGIN_TEST;
+		PoolMemoryAllocator nodes(sizeof(cc_ListNode<I32>), 16, 8);
+		{
+			List<I32> list(-1, &nodes);
+			for (I32 i = 0; i < 16; i++) {
+				list.append(i);
+			}
+			assert(nodes.getNextBlock().ptr == NIL);
+			assert(list.takeFirst() == 0);
+			list.append(16);
+			assert(list.last() == 16 && list.length() == 16);
+		}
+		// All the nodes are back in the pool.
+		for (I32 i = 0; i < 16; i++) {
+			assert(nodes.alloc() != NIL);
+		}
+
+		DynamicChunkMemoryAllocator chunks(8);
+		{
+			Stack<I32> stack(4, &chunks);
+			for (I32 i = 0; i < 100; i++) {
+				stack.push(i);
+			}
+			assert(stack.size() == 100);
+			assert(stack.pop() == 99);
+		}
+		FINISH_TEST;
+	}
+
+	void testMapWithAllocator() {
+		BEGIN_TEST;
+		StackMemoryAllocator stack(64*1024);
+		{
+			Map<I32> map(8, -1, &stack);
+			assert(map.allocator() == &stack);
+			for (I32 i = 1; i <= 100; i++) {
+				map.insert((OID)i, i*2);
+			}
+			assert(map.size() == 100);
+			assert(map.get((OID)50) == 100);
+		}
+		stack.reset();
+		FINISH_TEST;
+	}
+
+} // namespace Cat
+
+int main(int argc, char** argv) {
+	Cat::testStlAllocatorEquality();
+	Cat::testStlAllocatorStdContainers();
+	Cat::testStlAllocatorOutOfMemory();
+	Cat::testVectorWithAllocator();
+	Cat::testListAndStackWithAllocator();
+	Cat::testMapWithAllocator();
+
+	return 0;
+}
@@ -12,6 +12,7 @@
 #include "core/threading/asyncresult.h"
 #include "core/threading/asyncrunnable.h"
 #include "core/threading/spinlock.h"
+#include "core/threading/atomic.h"
 
 
 #define BEGIN_TEST (std::cout << ">>> BEGINNING " << __FUNCTION__ << std::endl << std::flush)
@@ -46,6 +47,72 @@ namespace cc {
 
 
 
+	AtomicI32 split_count;
+
+	/* A task that splits itself in two until the depth reaches zero. */
+	class SplitTask : public AsyncTask {
+	  public:
+		SplitTask(AsyncTaskRunner* runner, I32 depth) : m_pRunner(runner), m_depth(depth) {
+			setDestroyable(true);
+		}
+
+		I32 run() {
+			split_count.increment();
+			if (m_depth > 0) {
+				m_pRunner->run(new SplitTask(m_pRunner, m_depth - 1));
+				m_pRunner->run(new SplitTask(m_pRunner, m_depth - 1));
+			}
+			return 0;
+		}
+
+	  private:
+		AsyncTaskRunner*	m_pRunner;
+		I32					m_depth;
+	};
+
+	AtomicI32 discard_ran;
+	AtomicI32 discard_completed;
+	AtomicI32 discard_deleted;
+
+	/* A task that counts how it was run, completed and deleted. */
+	class DiscardTask : public AsyncTask {
+	  public:
+		DiscardTask() { setDestroyable(true); }
+		~DiscardTask() { discard_deleted.increment(); }
+
+		I32 run() {
+			discard_ran.increment();
+			return 0;
+		}
+
+		void onCompletion() { discard_completed.increment(); }
+	};
+
+	AtomicI32 gate_open;
+	AtomicI32 order_count;
+	I32 order[64];
+
+	/* A task that records the order it ran in, and can wait for the gate to open. */
+	class OrderTask : public AsyncTask {
+	  public:
+		OrderTask(I32 id, U32 priority, Boolean wait = false) : m_id(id), m_wait(wait) {
+			setPriority(priority);
+			setDestroyable(true);
+		}
+
+		I32 run() {
+			while (m_wait && !gate_open.val()) {
+				usleep(1000);
+			}
+			order[order_count.increment() - 1] = m_id;
+			return 0;
+		}
+
+	  private:
+		I32		m_id;
+		Boolean	m_wait;
+	};
+
 	void testAsyncTaskRunnerStartAndFinish() {
 		BEGIN_TEST;
 		
@@ -269,6 +336,101 @@ namespace cc {
 		FINISH_TEST;
 	}
 
+	void testAsyncTaskRunnerRunWhenStopped() {
+		BEGIN_TEST;
+
+		AsyncTaskRunner* runner = new AsyncTaskRunner(2);
+		runner->stop();
+		assert(!runner->canRun());
+
+		// Completed and deleted without being run, instead of leaked.
+		runner->run(new DiscardTask());
+		assert(discard_ran.val() == 0);
+		assert(discard_completed.val() == 1);
+		assert(discard_deleted.val() == 1);
+
+		delete runner;
+		FINISH_TEST;
+	}
+
+	void testAsyncTaskRunnerNestedTasks() {
+		BEGIN_TEST;
+
+		AsyncTaskRunner* runner = new AsyncTaskRunner(4);
+		assert(runner->getCurrentThread() == NIL);
+
+		// Lots of tiny tasks from outside, and a tree of tasks run from inside the runner.
+		for (I32 i = 0; i < 1000; i++) {
+			runner->run(new SplitTask(runner, 0));
+		}
+		runner->run(new SplitTask(runner, 12));
+
+		// Stopping runs everything left, including the tasks added while stopping.
+		delete runner;
+		assert(split_count.val() == 1000 + (1 << 13) - 1);
+
+		FINISH_TEST;
+	}
+
+	void testAsyncTaskPriorityQueueAging() {
+		BEGIN_TEST;
+		AsyncTaskPriorityQueue queue;
+		assert(queue.isEmpty() && queue.pop() == NIL);
+
+		OrderTask low(0, 0);
+		OrderTask normal(1, 1);
+		OrderTask high(2, 7);	// Above the last level.
+		queue.push(&low);
+		queue.push(&normal);
+		queue.push(&high);
+		assert(queue.pop() == &high);
+		assert(queue.pop() == &normal);
+		assert(queue.pop() == &low);
+		assert(queue.isEmpty());
+
+		// A low priority task is not starved by a flood of high priority ones.
+		OrderTask* flood[40];
+		queue.push(&low);
+		for (I32 i = 0; i < 40; i++) {
+			flood[i] = new OrderTask(i, 3);
+			queue.push(flood[i]);
+		}
+		U32 position = 0;
+		while (queue.pop() != &low) {
+			position++;
+		}
+		assert(position == AsyncTaskPriorityQueue::kAgingThreshold);
+		while (queue.pop()) {}
+		for (I32 i = 0; i < 40; i++) {
+			delete flood[i];
+		}
+		FINISH_TEST;
+	}
+
+	void testAsyncTaskRunnerPriority() {
+		BEGIN_TEST;
+		AsyncTaskRunner* runner = new AsyncTaskRunner(1, SCHEDULE_PRIORITY);
+		assert(runner->getSchedule() == SCHEDULE_PRIORITY);
+
+		// Keep the only thread busy while the batch work piles up behind it.
+		runner->run(new OrderTask(-1, 0, true));
+		usleep(10000);
+		for (I32 i = 0; i < 10; i++) {
+			runner->run(new OrderTask(i, 0));
+		}
+		runner->run(new OrderTask(100, 3));
+		gate_open.increment();
+
+		delete runner;
+		assert(order_count.val() == 12);
+		assert(order[0] == -1);
+		assert(order[1] == 100);	// The high priority task skips the queue.
+		for (I32 i = 0; i < 10; i++) {
+			assert(order[i + 2] == i);	// The rest stay in order.
+		}
+		FINISH_TEST;
+	}
+
 
 
 
@@ -283,6 +445,10 @@ int main(int argc, char** argv) {
 	cc::testAsyncTaskRunnerRunMoreFunctionsWithOnlyTwoRunnersAndAlcohol();
 	cc::testAsyncTaskRunnerRunMoreFunctionsWithOnlyTwoRunnersAndWaitForResults();
 	cc::testAsyncTaskRunnerRunAndStopAndDelete();
+	cc::testAsyncTaskRunnerRunWhenStopped();
+	cc::testAsyncTaskRunnerNestedTasks();
+	cc::testAsyncTaskPriorityQueueAging();
+	cc::testAsyncTaskRunnerPriority();
 
 	return 0;
 }
@@ -0,0 +1,139 @@
+#include <assert.h>
+#ifndef DEBUG
+#define DEBUG 1
+#endif
+#include "core/threading/atomic.h"
+#include "core/threading/runnable.h"
+#include "core/threading/thread.h"
+#include "core/util/invasivestrongptr.h"
+
+#define BEGIN_TEST (std::cout << ">>> BEGINNING " << __FUNCTION__ << std::endl << std::flush)
+#define FINISH_TEST (std::cout << ">>> FINISHED " << __FUNCTION__ << std::endl << std::endl << std::flush)
+
+#define NUM_THREADS 4
+#define NUM_ITERATIONS 100000
+
+namespace Cat {
+
+	class Counted {
+	  public:
+		Counted(Atomic<I32>* deleted) : m_pDeleted(deleted) {}
+		~Counted() { m_pDeleted->fetchAdd(1); }
+
+		inline void retain() { m_retainCount.increment(kMORelaxed); }
+		inline Boolean release() { return m_retainCount.decrement(kMOAcqRel) <= 0; }
+		inline I32 retainCount() const { return m_retainCount.val(); }
+
+	  private:
+		Atomic<I32>*	m_pDeleted;
+		AtomicI32		m_retainCount;
+	};
+
+	/* Counts with relaxed adds, copies a shared pointer and swaps a word pair. */
+	class Worker : public Runnable {
+	  public:
+		Worker(Atomic<U64>* counter, const InvasiveStrongPtr<Counted>& shared, VPtr pair)
+			: m_pCounter(counter), m_shared(shared), m_pPair(pair) {}
+
+		I32 run() {
+			for (I32 i = 0; i < NUM_ITERATIONS; i++) {
+				m_pCounter->fetchAdd(1, kMORelaxed);
+				InvasiveStrongPtr<Counted> copy = m_shared;
+			}
+#if defined(CAT_HAS_ATOMIC_128)
+			AtomicU128* pair = (AtomicU128*)m_pPair;
+			for (I32 i = 0; i < NUM_ITERATIONS; i++) {
+				U64Pair expected = pair->val();
+				U64Pair desired;
+				do {
+					desired.low = expected.low + 1;
+					desired.high = expected.high + 2;
+				} while (!pair->compareExchange(expected, desired));
+			}
+#endif
+			m_shared.setNull();
+			return 0;
+		}
+
+	  private:
+		Atomic<U64>*						m_pCounter;
+		InvasiveStrongPtr<Counted>		m_shared;
+		VPtr									m_pPair;
+	};
+
+	void testAtomicOperations() {
+		BEGIN_TEST;
+
+		Atomic<I32> value(5);
+		assert(value.load() == 5 && value.load(kMORelaxed) == 5);
+		assert(value.fetchAdd(3) == 5 && value.load() == 8);
+		assert(value.fetchSub(2, kMOAcqRel) == 8 && value.load(kMOAcquire) == 6);
+		assert(value.fetchOr(0x9) == 6 && value.load() == 0xF);
+		assert(value.fetchAnd(0x5) == 0xF && value.load() == 0x5);
+		assert(value.fetchXor(0x1) == 0x5 && value.load() == 0x4);
+		assert(value.exchange(10, kMOAcquire) == 4);
+		value.store(11, kMORelease);
+		assert(value.load() == 11);
+
+		I32 expected = 3;
+		assert(!value.compareExchange(expected, 12));
+		assert(expected == 11 && value.load() == 11);
+		assert(value.compareExchange(expected, 12, kMOAcqRel) && value.load() == 12);
+		assert(value.compareAndSwap(12, 13, kMORelease) && !value.compareAndSwap(12, 14));
+
+		I32 items[2];
+		Atomic<I32*> ptr(items);
+		assert(ptr.exchange(items + 1) == items);
+		assert(ptr.compareAndSwap(items + 1, NIL) && ptr.load() == NIL);
+
+		AtomicI32 count;
+		assert(count.increment(kMORelaxed) == 1 && count.decrement(kMOAcqRel) == 0);
+		assert(count.val(kMORelaxed) == 0);
+		FINISH_TEST;
+	}
+
+	void testAtomicThreads() {
+		BEGIN_TEST;
+
+		Atomic<U64> counter;
+		Atomic<I32> deleted;
+#if defined(CAT_HAS_ATOMIC_128)
+		AtomicU128 pair;
+		VPtr pairPtr = &pair;
+#else
+		VPtr pairPtr = NIL;
+#endif
+		Worker* workers[NUM_THREADS];
+		{
+			InvasiveStrongPtr<Counted> shared(new Counted(&deleted));
+			for (I32 i = 0; i < NUM_THREADS; i++) {
+				workers[i] = new Worker(&counter, shared, pairPtr);
+				Thread::run(workers[i]);
+			}
+		}
+		for (I32 i = 0; i < NUM_THREADS; i++) {
+			Thread::join(workers[i]->getThread());
+			delete workers[i];
+		}
+
+		assert(counter.load() == (U64)NUM_THREADS*NUM_ITERATIONS);
+		// Deleted exactly once, by whichever thread let go of it last.
+		assert(deleted.load() == 1);
+#if defined(CAT_HAS_ATOMIC_128)
+		U64Pair words = pair.val();
+		assert(words.low == (U64)NUM_THREADS*NUM_ITERATIONS);
+		assert(words.high == 2*words.low);
+#else
+		D(std::cout << "No 16 byte compare and swap, AtomicU128 not tested." << std::endl);
+#endif
+		FINISH_TEST;
+	}
+
+} // namespace Cat
+
+int main(int argc, char** argv) {
+	Cat::testAtomicOperations();
+	Cat::testAtomicThreads();
+
+	return 0;
+}
@@ -0,0 +1,246 @@
+#include <assert.h>
+#include <cstdlib>
+#include <unistd.h>
+#ifndef DEBUG
+#define DEBUG 1
+#endif
+#include "core/threading/coroutine.h"
+#include "core/threading/asyncrunnable.h"
+#include "core/threading/taskrunner.h"
+
+#define BEGIN_TEST (std::cout << ">>> BEGINNING " << __FUNCTION__ << std::endl << std::flush)
+#define FINISH_TEST (std::cout << ">>> FINISHED " << __FUNCTION__ << std::endl << std::endl << std::flush)
+
+#define SECOND_10 10000000000ULL
+#define SIZE_CHAIN 100
+
+#if defined(CAT_HAS_COROUTINES)
+
+namespace Cat {
+
+	I32 g_ran = 0;
+
+	I32 setRan(VPtr data) {
+		g_ran = 1;
+		return 0;
+	}
+
+	class AddValue {
+	  public:
+		typedef I32 result_type;
+
+		AddValue(I32 amount) : amount_(amount) {}
+		I32 operator()() const { return amount_; }
+
+	  private:
+		I32 amount_;
+	};
+
+	class Fulfill {
+	  public:
+		typedef Boolean result_type;
+
+		Fulfill(const Promise<I32>& promise, I32 value) : promise_(promise), value_(value) {}
+		Boolean operator()() const { return promise_.setValue(value_); }
+
+	  private:
+		mutable Promise<I32> promise_;
+		I32 value_;
+	};
+
+	CoTask<I32> addLater(AsyncTaskRunner* runner, I32 a, I32 b) {
+		I32 value = co_await runAsync(runner, AddValue(a));
+		co_return value + b;
+	}
+
+	CoTask<I32> pipeline(AsyncTaskRunner* runner) {
+		I32 header = co_await addLater(runner, 1, 2);
+		I32 body = co_await addLater(runner, header, 4);
+		co_return header*body;
+	}
+
+	/* Each read is fulfilled by a task queued after the coroutine suspends. */
+	CoTask<I32> readMany(AsyncTaskRunner* runner) {
+		I32 total = 0;
+		for (I32 i = 0; i < SIZE_CHAIN; i++) {
+			Promise<I32> promise;
+			runAsync(runner, Fulfill(promise, 1));
+			total += co_await promise.getFuture();
+		}
+		co_return total;
+	}
+
+	CoTask<Boolean> moveToRunner(AsyncTaskRunner* runner) {
+		Boolean before = runner->getCurrentThread() != NIL;
+		co_await schedule(runner);
+		co_return !before && runner->getCurrentThread() != NIL;
+	}
+
+	CoTask<I32> awaitResult(AsyncResult* result) {
+		AsyncResult* done = co_await futureOf(result);
+		co_return (done == result && done->hasResult()) ? 1 : 0;
+	}
+
+	CoTask<void> taskBody(AsyncTaskRunner* runner, I32* value, Boolean* sameThread) {
+		ThreadHandle self = Thread::self();
+		*value = co_await addLater(runner, 5, 6);
+		*sameThread = pthread_equal(self, Thread::self()) != 0;
+	}
+
+	CoTask<void> waitBody(Future<I32> future, I32* value) {
+		*value = co_await future;
+	}
+
+	class DoneTask : public Task {
+	  public:
+		DoneTask() : Task("Done") {}
+		void run() { succeeded(); }
+	};
+
+	void testCoTaskAwait() {
+		BEGIN_TEST;
+
+		AsyncTaskRunner* runner = new AsyncTaskRunner(2);
+
+		Future<I32> future = pipeline(runner).start(runner);
+		assert(future.waitFor(SECOND_10));
+		assert(future.get() == 21);
+
+		// Started on the calling thread, and awaited before it finishes.
+		assert(addLater(runner, 2, 3).start().get() == 5);
+
+		delete runner;
+		FINISH_TEST;
+	}
+
+	void testCoTaskNoBlocking() {
+		BEGIN_TEST;
+
+		// With one thread, a coroutine that blocked for a read would never finish.
+		AsyncTaskRunner* runner = new AsyncTaskRunner(1);
+		Future<I32> future = readMany(runner).start(runner);
+		assert(future.waitFor(SECOND_10));
+		assert(future.get() == SIZE_CHAIN);
+
+		delete runner;
+		FINISH_TEST;
+	}
+
+	void testCoTaskSchedule() {
+		BEGIN_TEST;
+
+		AsyncTaskRunner* runner = new AsyncTaskRunner(2);
+		assert(moveToRunner(runner).start().get());
+
+		delete runner;
+		FINISH_TEST;
+	}
+
+	void testCoTaskAwaitAsyncResult() {
+		BEGIN_TEST;
+
+		AsyncTaskRunner* runner = new AsyncTaskRunner(2);
+		AsyncTask* task = AsyncRunnable::createAsyncRunnable(RunnableFunc::createRunnableFuncToDestroyOnCompletion(setRan));
+		task->setDestroyResultOnTaskDestruction(true);
+		AsyncResult* result = runner->run(task);
+		assert(awaitResult(result).start(runner).get() == 1);
+		assert(g_ran == 1);
+
+		delete runner;
+		delete task;
+		FINISH_TEST;
+	}
+
+	void testCoroutineTask() {
+		BEGIN_TEST;
+
+		AsyncTaskRunner* runner = new AsyncTaskRunner(2);
+		TaskRunner* tr = new TaskRunner("CR", 4);
+		tr->run();
+		tr->waitUntilStarted();
+
+		I32 value = 0;
+		Boolean sameThread = false;
+		TaskPtr task(new CoroutineTask("Coroutine", taskBody(runner, &value, &sameThread)));
+		tr->queueTask(task);
+		while (task->state() != Task::kTSRemoved) {
+			usleep(1000);
+		}
+		// Resumed by the TaskRunner, not by the AsyncTaskRunner that completed the read.
+		assert(value == 11);
+		assert(sameThread);
+
+		tr->terminateTaskRunner();
+		tr->waitForTermination();
+		delete tr;
+		delete runner;
+		FINISH_TEST;
+	}
+
+	void testCoroutineTaskParked() {
+		BEGIN_TEST;
+
+		TaskRunner* tr = new TaskRunner("CR", 4);
+		tr->run();
+		tr->waitUntilStarted();
+
+		Promise<I32> promise;
+		I32 value = 0;
+		TaskPtr waiting(new CoroutineTask("Waiting", waitBody(promise.getFuture(), &value)));
+		tr->queueTask(waiting);
+		while (waiting->state() == Task::kTSNotStarted) {
+			usleep(1000);
+		}
+
+		// Queued while the coroutine is suspended, it runs instead of being lost.
+		TaskPtr other(new DoneTask());
+		tr->queueTask(other);
+		while (other->state() != Task::kTSRemoved) {
+			usleep(1000);
+		}
+		assert(waiting->isAlive());
+
+		// The suspended task is parked, not left running, and still counted.
+		for (I32 i = 0; i < 1000 && (tr->hasRunningTask() || tr->load() != 1); ++i) {
+			usleep(1000);
+		}
+		assert(!tr->hasRunningTask());
+		assert(tr->load() == 1);
+
+		promise.setValue(7);
+		while (waiting->state() != Task::kTSRemoved) {
+			usleep(1000);
+		}
+		assert(value == 7);
+		for (I32 i = 0; i < 1000 && tr->load() != 0; ++i) {
+			usleep(1000);
+		}
+		assert(tr->load() == 0);
+
+		tr->terminateTaskRunner();
+		tr->waitForTermination();
+		delete tr;
+		FINISH_TEST;
+	}
+
+} // namespace Cat
+
+int main(int argc, char** argv) {
+	Cat::testCoTaskAwait();
+	Cat::testCoTaskNoBlocking();
+	Cat::testCoTaskSchedule();
+	Cat::testCoTaskAwaitAsyncResult();
+	Cat::testCoroutineTask();
+	Cat::testCoroutineTaskParked();
+
+	return 0;
+}
+
+#else
+
+int main(int argc, char** argv) {
+	std::cout << ">>> SKIPPED coroutine tests, compile with -std=c++20." << std::endl;
+	return 0;
+}
+
+#endif // CAT_HAS_COROUTINES
@@ -0,0 +1,280 @@
+#include <assert.h>
+#include <cstdlib>
+#ifndef DEBUG
+#define DEBUG 1
+#endif
+#include "core/threading/future.h"
+#include "core/threading/asyncrunnable.h"
+
+#define BEGIN_TEST (std::cout << ">>> BEGINNING " << __FUNCTION__ << std::endl << std::flush)
+#define FINISH_TEST (std::cout << ">>> FINISHED " << __FUNCTION__ << std::endl << std::endl << std::flush)
+
+#define MILLI_10 10000000
+#define SECOND_10 10000000000ULL
+#define SIZE_CHAIN 100
+#define SIZE_JOIN 64
+
+namespace Cat {
+
+	I32 g_ran = 0;
+
+	I32 doubleValue(const I32& value) {
+		return value*2;
+	}
+
+	I32 setRan(VPtr data) {
+		g_ran = 1;
+		return 0;
+	}
+
+	class AddValue {
+	  public:
+		typedef I32 result_type;
+
+		AddValue(I32 amount) : amount_(amount) {}
+		I32 operator()(const I32& value) const { return value + amount_; }
+		I32 operator()() const { return amount_; }
+
+	  private:
+		I32 amount_;
+	};
+
+	/* Returns the Future of a Promise that a later task fulfills, so the step must not wait. */
+	class ReadLater {
+	  public:
+		typedef Future<I32> result_type;
+
+		ReadLater(AsyncTaskRunner* runner) : runner_(runner) {}
+		Future<I32> operator()(const I32& value) const {
+			Promise<I32> promise;
+			runAsync(runner_, Fulfill(promise, value + 1));
+			return promise.getFuture();
+		}
+
+	  private:
+		class Fulfill {
+		  public:
+			typedef Boolean result_type;
+
+			Fulfill(const Promise<I32>& promise, I32 value) : promise_(promise), value_(value) {}
+			Boolean operator()() const { return promise_.setValue(value_); }
+
+		  private:
+			mutable Promise<I32> promise_;
+			I32 value_;
+		};
+
+		AsyncTaskRunner* runner_;
+	};
+
+	class FailStep {
+	  public:
+		typedef Future<I32> result_type;
+
+		Future<I32> operator()(const I32& value) const {
+			return Future<I32>::failed(kFSFailed, value);
+		}
+	};
+
+	class CountCalls {
+	  public:
+		typedef I32 result_type;
+
+		CountCalls(AtomicI32* calls) : calls_(calls) {}
+		I32 operator()(const I32& value) const {
+			calls_->increment();
+			return value;
+		}
+
+	  private:
+		AtomicI32* calls_;
+	};
+
+	void testPromise() {
+		BEGIN_TEST;
+
+		Promise<I32> promise;
+		Future<I32> future = promise.getFuture();
+		assert(future.isValid() && !future.isDone() && future.status() == kFSPending);
+		assert(!future.waitFor(MILLI_10));
+
+		assert(promise.setValue(42));
+		assert(!promise.setValue(7));
+		assert(!promise.setError(3));
+		assert(future.isReady() && future.get() == 42 && future.error() == 0);
+		assert(future.waitFor(MILLI_10));
+
+		Promise<I32> failing;
+		assert(failing.setError(5));
+		assert(failing.getFuture().status() == kFSFailed && failing.getFuture().error() == 5);
+
+		Promise<I32> cancelled;
+		Future<I32> cancelledFuture = cancelled.getFuture();
+		assert(cancelledFuture.cancel());
+		assert(cancelled.isCancelled() && !cancelled.setValue(1));
+		assert(cancelledFuture.status() == kFSCancelled && cancelledFuture.get() == 0);
+
+		assert(Future<I32>::ready(3).get() == 3);
+		assert(!Future<I32>().isValid());
+
+		FINISH_TEST;
+	}
+
+	void testFutureThen() {
+		BEGIN_TEST;
+
+		AsyncTaskRunner* runner = new AsyncTaskRunner(2);
+
+		Future<I32> future = runAsync(runner, AddValue(5))
+			.then(runner, doubleValue)
+			.then(runner, AddValue(1));
+		assert(future.get() == 11);
+
+		// Chained onto a Future that is already done, and inline without a runner.
+		Future<I32> ready = Future<I32>::ready(2);
+		assert(ready.then(runner, doubleValue).get() == 4);
+		assert(ready.then((AsyncTaskRunner*)NIL, AddValue(3)).get() == 5);
+
+		// A step returning a Future is flattened.
+		Future<I32> flattened = Future<I32>::ready(1).then(runner, ReadLater(runner)).then(runner, doubleValue);
+		assert(flattened.get() == 4);
+
+		// A failed step skips the rest of the chain.
+		AtomicI32 calls;
+		Future<I32> failed = Future<I32>::ready(9)
+			.then(runner, FailStep())
+			.then(runner, CountCalls(&calls));
+		failed.wait();
+		assert(failed.status() == kFSFailed && failed.error() == 9 && calls.val() == 0);
+
+		// Cancelling the token stops the steps that have not started.
+		CancellationToken token;
+		Promise<I32> source;
+		Future<I32> cancelled = source.getFuture()
+			.then(runner, CountCalls(&calls), token)
+			.then(runner, CountCalls(&calls), token);
+		token.cancel();
+		source.setValue(1);
+		cancelled.wait();
+		assert(cancelled.status() == kFSCancelled && calls.val() == 0);
+		assert(runAsync(runner, AddValue(1), token).status() != kFSReady);
+
+		// A stopped runner cancels the Future instead of leaving it pending.
+		runner->stop();
+		Future<I32> stopped = runAsync(runner, AddValue(1));
+		assert(stopped.waitFor(SECOND_10) && stopped.status() == kFSCancelled);
+
+		delete runner;
+		FINISH_TEST;
+	}
+
+	void testFutureNoBlocking() {
+		BEGIN_TEST;
+
+		// With one thread, a step that waited for the next read would never finish.
+		AsyncTaskRunner* runner = new AsyncTaskRunner(1);
+		Future<I32> chain = runAsync(runner, AddValue(0));
+		for (I32 i = 0; i < SIZE_CHAIN; i++) {
+			chain = chain.then(runner, ReadLater(runner));
+		}
+		assert(chain.waitFor(SECOND_10) && chain.get() == SIZE_CHAIN);
+
+		delete runner;
+		FINISH_TEST;
+	}
+
+	void testFutureWhenAllAny() {
+		BEGIN_TEST;
+
+		AsyncTaskRunner* runner = new AsyncTaskRunner(4);
+		Future<I32> futures[SIZE_JOIN];
+		for (I32 i = 0; i < SIZE_JOIN; i++) {
+			futures[i] = runAsync(runner, AddValue(i));
+		}
+		Future<U32> all = whenAll(futures, SIZE_JOIN);
+		assert(all.get() == SIZE_JOIN);
+		for (I32 i = 0; i < SIZE_JOIN; i++) {
+			assert(futures[i].isReady() && futures[i].get() == i);
+		}
+		assert(whenAll((Future<I32>*)NIL, 0).get() == 0);
+
+		// Fails as soon as one fails, without waiting for the rest.
+		Promise<I32> promises[3];
+		Future<I32> pending[3];
+		for (I32 i = 0; i < 3; i++) {
+			pending[i] = promises[i].getFuture();
+		}
+		Future<U32> failing = whenAll(pending, 3);
+		promises[0].setValue(1);
+		assert(!failing.isDone());
+		promises[2].setError(8);
+		assert(failing.status() == kFSFailed && failing.error() == 8);
+		promises[1].setValue(2);
+
+		Promise<I32> slow[3];
+		Future<I32> any[3];
+		for (I32 i = 0; i < 3; i++) {
+			any[i] = slow[i].getFuture();
+		}
+		Future<U32> first = whenAny(any, 3);
+		assert(!first.isDone());
+		slow[1].setValue(5);
+		assert(first.get() == 1);
+		slow[0].setValue(6);
+		assert(first.get() == 1);
+
+		delete runner;
+		FINISH_TEST;
+	}
+
+	void testFutureTimeout() {
+		BEGIN_TEST;
+
+		FutureTimer* timer = new FutureTimer();
+		Promise<I32> never;
+		Future<I32> timedOut = never.getFuture().withTimeout(timer, MILLI_10);
+		Future<I32> later = never.getFuture().withTimeout(timer, SECOND_10);
+		timedOut.wait();
+		assert(timedOut.status() == kFSTimedOut && !later.isDone());
+
+		Promise<I32> quick;
+		Future<I32> inTime = quick.getFuture().withTimeout(timer, SECOND_10);
+		quick.setValue(4);
+		assert(inTime.get() == 4);
+
+		// The Futures left pending stay pending once the timer is gone.
+		delete timer;
+		assert(!later.isDone());
+		FINISH_TEST;
+	}
+
+	void testFutureOfAsyncResult() {
+		BEGIN_TEST;
+
+		AsyncTaskRunner* runner = new AsyncTaskRunner(2);
+		AsyncTask* task = AsyncRunnable::createAsyncRunnable(RunnableFunc::createRunnableFuncToDestroyOnCompletion(setRan));
+		task->setDestroyResultOnTaskDestruction(true);
+		AsyncResult* result = runner->run(task);
+		Future<AsyncResult*> future = futureOf(result);
+		assert(future.get() == result && g_ran == 1);
+
+		// The result is already complete, the Future is ready right away.
+		assert(futureOf(result).isReady());
+
+		delete runner;
+		delete task;
+		FINISH_TEST;
+	}
+
+} // namespace Cat
+
+int main(int argc, char** argv) {
+	Cat::testPromise();
+	Cat::testFutureThen();
+	Cat::testFutureNoBlocking();
+	Cat::testFutureWhenAllAny();
+	Cat::testFutureTimeout();
+	Cat::testFutureOfAsyncResult();
+
+	return 0;
+}
@@ -0,0 +1,161 @@
+#include <assert.h>
+#ifndef DEBUG
+#define DEBUG 1
+#endif
+#include "core/threading/mpscqueue.h"
+#include "core/threading/eventcount.h"
+#include "core/threading/runnable.h"
+#include "core/threading/thread.h"
+
+#define BEGIN_TEST (std::cout << ">>> BEGINNING " << __FUNCTION__ << std::endl << std::flush)
+#define FINISH_TEST (std::cout << ">>> FINISHED " << __FUNCTION__ << std::endl << std::endl << std::flush)
+
+#define NUM_PRODUCERS 4
+#define NUM_ITEMS 50000
+
+namespace Cat {
+
+	class Producer : public Runnable {
+	  public:
+		Producer(MPSCQueue<I32>* queue, EventCount* wakeup, I32 id, I32 batch = 1) 
+			: m_pQueue(queue), m_pWakeup(wakeup), m_id(id), m_batch(batch), m_retries(0) {}
+
+		I32 run() {
+			I32 items[NUM_ITEMS];
+			for (I32 i = 0; i < NUM_ITEMS; i++) {
+				items[i] = m_id*NUM_ITEMS + i;
+			}
+			for (I32 i = 0; i < NUM_ITEMS; ) {
+				Size pushed = 0;
+				if (m_batch == 1) {
+					pushed = m_pQueue->push(items[i]) ? 1 : 0;
+				} else {
+					I32 count = (NUM_ITEMS - i < m_batch) ? NUM_ITEMS - i : m_batch;
+					pushed = m_pQueue->push(items + i, count);
+				}
+				if (pushed > 0) {
+					m_pWakeup->notifyAll();
+					i += pushed;
+				} else {
+					m_retries++;
+				}
+			}
+			return 0;
+		}
+
+		inline U32 retries() const { return m_retries; }
+
+	  private:
+		MPSCQueue<I32>*	m_pQueue;
+		EventCount*			m_pWakeup;
+		I32					m_id;
+		I32					m_batch;
+		U32					m_retries;
+	};
+
+	void testMPSCQueueSingleThread() {
+		BEGIN_TEST;
+		// The capacity does not have to be a power of two.
+		MPSCQueue<I32> queue(3, -1);
+		assert(queue.isEmpty());
+		assert(queue.pop() == -1);
+		assert(queue.capacity() == 3);
+
+		assert(queue.push(1));
+		assert(queue.push(2));
+		assert(queue.push(3));
+		assert(queue.isFull());
+		assert(!queue.push(4));
+		assert(queue.size() == 3);
+
+		MPSCQueue<I32>::Iterator it = queue.begin();
+		assert(it.isValid() && it.val() == 1 && it.hasNext());
+		it.next();
+		it.next();
+		assert(it.isValid() && it.val() == 3 && !it.hasNext());
+		it.next();
+		assert(!it.isValid());
+
+		// Wraps around the end of the ring.
+		assert(queue.pop() == 1);
+		assert(queue.push(4));
+		assert(queue.pop() == 2);
+		assert(queue.pop() == 3);
+		assert(queue.pop() == 4);
+		assert(queue.isEmpty());
+		assert(queue.pop() == -1);
+
+		queue.push(5);
+		queue.push(6);
+		queue.clear();
+		assert(queue.isEmpty() && queue.size() == 0);
+
+		// A batch only pushes the items that fit.
+		I32 batch[] = { 7, 8, 9, 10 };
+		assert(queue.push(batch, 2) == 2);
+		assert(queue.push(batch + 2, 2) == 1);
+		assert(queue.push(batch + 3, 1) == 0);
+		assert(queue.pop() == 7);
+		assert(queue.push(batch + 3, 1) == 1);
+		assert(queue.pop() == 8 && queue.pop() == 9 && queue.pop() == 10);
+		assert(queue.push(batch, 0) == 0);
+		assert(queue.isEmpty());
+		FINISH_TEST;
+	}
+
+	void testMPSCQueueManyProducers(I32 batch) {
+		BEGIN_TEST;
+		// A small queue so the producers keep finding it full.
+		MPSCQueue<I32> queue(7, -1);
+		EventCount wakeup;
+		Producer* producers[NUM_PRODUCERS];
+		for (I32 i = 0; i < NUM_PRODUCERS; i++) {
+			producers[i] = new Producer(&queue, &wakeup, i, batch);
+			Thread::run(producers[i]);
+		}
+
+		I32 last[NUM_PRODUCERS];
+		for (I32 i = 0; i < NUM_PRODUCERS; i++) {
+			last[i] = -1;
+		}
+		I32 popped = 0;
+		U32 sleeps = 0;
+		while (popped < NUM_PRODUCERS*NUM_ITEMS) {
+			I32 key = wakeup.prepareWait();
+			if (queue.isEmpty()) {
+				wakeup.wait(key);
+				sleeps++;
+				continue;
+			}
+			wakeup.cancelWait();
+
+			I32 item = queue.pop();
+			assert(item != -1);
+			// The items of each producer come out in the order it pushed them.
+			I32 producer = item / NUM_ITEMS;
+			assert(item % NUM_ITEMS == last[producer] + 1);
+			last[producer] = item % NUM_ITEMS;
+			popped++;
+		}
+
+		U32 retries = 0;
+		for (I32 i = 0; i < NUM_PRODUCERS; i++) {
+			Thread::join(producers[i]->getThread());
+			retries += producers[i]->retries();
+			delete producers[i];
+		}
+		D(std::cout << "Slept " << sleeps << " times, producers retried " << retries << " times." << std::endl);
+		assert(queue.isEmpty());
+		assert(queue.pop() == -1);
+		FINISH_TEST;
+	}
+
+} // namespace Cat
+
+int main(int argc, char** argv) {
+	Cat::testMPSCQueueSingleThread();
+	Cat::testMPSCQueueManyProducers(1);
+	Cat::testMPSCQueueManyProducers(5);
+
+	return 0;
+}
@@ -0,0 +1,227 @@
+#include <assert.h>
+#include <cstdlib>
+#ifndef DEBUG
+#define DEBUG 1
+#endif
+#include "core/threading/parallel.h"
+
+#define BEGIN_TEST (std::cout << ">>> BEGINNING " << __FUNCTION__ << std::endl << std::flush)
+#define FINISH_TEST (std::cout << ">>> FINISHED " << __FUNCTION__ << std::endl << std::endl << std::flush)
+
+#define SIZE_01 100000
+
+namespace Cat {
+
+	class MarkRange {
+	  public:
+		MarkRange(AtomicI32* marks, AtomicI32* chunks) : marks_(marks), chunks_(chunks) {}
+
+		void operator()(Size begin, Size end) const {
+			chunks_->increment();
+			for (Size i = begin; i < end; ++i) {
+				marks_[i].increment();
+			}
+		}
+
+	  private:
+		AtomicI32* marks_;
+		AtomicI32* chunks_;
+	};
+
+	class SumRange {
+	  public:
+		SumRange(const U32* values) : values_(values) {}
+
+		U64 operator()(Size begin, Size end) const {
+			U64 sum = 0;
+			for (Size i = begin; i < end; ++i) {
+				sum += values_[i];
+			}
+			return sum;
+		}
+
+	  private:
+		const U32* values_;
+	};
+
+	class Add {
+	  public:
+		U64 operator()(U64 a, U64 b) const { return a + b; }
+	};
+
+	class Double {
+	  public:
+		void operator()(I32& value) const { value *= 2; }
+	};
+
+	class GreaterThan {
+	  public:
+		bool operator()(I32 a, I32 b) const { return a > b; }
+	};
+
+	/* Runs a parallelFor from inside a parallelFor, on the runner's threads. */
+	class NestedRange {
+	  public:
+		NestedRange(AsyncTaskRunner* runner, AtomicI32* marks) : runner_(runner), marks_(marks) {}
+
+		void operator()(Size begin, Size end) const {
+			for (Size i = begin; i < end; ++i) {
+				AtomicI32 chunks;
+				parallelFor(runner_, i*100, (i + 1)*100, 10, MarkRange(marks_, &chunks));
+			}
+		}
+
+	  private:
+		AsyncTaskRunner* runner_;
+		AtomicI32* marks_;
+	};
+
+	void testParallelFor() {
+		BEGIN_TEST;
+
+		AsyncTaskRunner* runner = new AsyncTaskRunner(4);
+		AtomicI32* marks = new AtomicI32[SIZE_01];
+		AtomicI32 chunks;
+
+		parallelFor(runner, 0, SIZE_01, 0, MarkRange(marks, &chunks));
+		for (I32 i = 0; i < SIZE_01; i++) {
+			assert(marks[i].val() == 1);
+		}
+		// The chunks shrink towards the end, but never below the default grain.
+		assert(chunks.val() > 5);
+		assert(chunks.val() <= (I32)(SIZE_01 / ParallelJob::getDefaultGrain(SIZE_01, 5)));
+
+		// A sub range with a large grain, only the range is touched.
+		AtomicI32 big_chunks;
+		parallelFor(runner, 10, 1010, 500, MarkRange(marks, &big_chunks));
+		assert(big_chunks.val() == 2);
+		assert(marks[9].val() == 1 && marks[10].val() == 2 && marks[1009].val() == 2 && marks[1010].val() == 1);
+
+		// An empty range does nothing, and no runner runs everything on this thread.
+		AtomicI32 no_chunks;
+		parallelFor(runner, 5, 5, 0, MarkRange(marks, &no_chunks));
+		assert(no_chunks.val() == 0);
+		parallelFor((AsyncTaskRunner*)NIL, 0, 10, 1, MarkRange(marks, &no_chunks));
+		assert(no_chunks.val() > 0 && marks[0].val() == 2);
+
+		// A stopped runner takes no helpers, this thread runs the whole range.
+		runner->stop();
+		AtomicI32 stopped_chunks;
+		parallelFor(runner, 0, SIZE_01, 0, MarkRange(marks, &stopped_chunks));
+		assert(stopped_chunks.val() > 0 && marks[SIZE_01 - 1].val() == 2);
+
+		delete[] marks;
+		delete runner;
+		FINISH_TEST;
+	}
+
+	void testParallelForNested() {
+		BEGIN_TEST;
+
+		AsyncTaskRunner* runner = new AsyncTaskRunner(3);
+		AtomicI32* marks = new AtomicI32[SIZE_01];
+
+		parallelFor(runner, 0, SIZE_01 / 100, 1, NestedRange(runner, marks));
+		for (I32 i = 0; i < SIZE_01; i++) {
+			assert(marks[i].val() == 1);
+		}
+
+		delete[] marks;
+		delete runner;
+		FINISH_TEST;
+	}
+
+	void testParallelReduce() {
+		BEGIN_TEST;
+
+		AsyncTaskRunner* runner = new AsyncTaskRunner(4);
+		U32* values = new U32[SIZE_01];
+		U64 expected = 0;
+		for (I32 i = 0; i < SIZE_01; i++) {
+			values[i] = (U32)rand();
+			expected += values[i];
+		}
+
+		U64 sum = parallelReduce(runner, 0, SIZE_01, 0, (U64)0, SumRange(values), Add());
+		assert(sum == expected);
+		sum = parallelReduce(runner, 0, SIZE_01, 7, (U64)0, SumRange(values), Add());
+		assert(sum == expected);
+		sum = parallelReduce(runner, 100, 100, 0, (U64)42, SumRange(values), Add());
+		assert(sum == 42);
+
+		delete[] values;
+		delete runner;
+		FINISH_TEST;
+	}
+
+	void testParallelSort() {
+		BEGIN_TEST;
+
+		AsyncTaskRunner* runner = new AsyncTaskRunner(4);
+		const I32 counts[] = { 0, 1, 100, 10000, SIZE_01, SIZE_01 + 13 };
+		for (U32 c = 0; c < sizeof(counts) / sizeof(I32); c++) {
+			I32* items = new I32[counts[c]];
+			for (I32 i = 0; i < counts[c]; i++) {
+				items[i] = rand() % 1000;
+			}
+			parallelSort(runner, items, counts[c], std::less<I32>(), 1000);
+			for (I32 i = 1; i < counts[c]; i++) {
+				assert(items[i - 1] <= items[i]);
+			}
+			delete[] items;
+		}
+
+		Vector<I32> vector(SIZE_01);
+		for (I32 i = 0; i < SIZE_01; i++) {
+			vector.append(rand());
+		}
+		parallelSort(runner, vector, GreaterThan());
+		for (I32 i = 1; i < SIZE_01; i++) {
+			assert(vector.at(i - 1) >= vector.at(i));
+		}
+
+		delete runner;
+		FINISH_TEST;
+	}
+
+	void testParallelForEach() {
+		BEGIN_TEST;
+
+		AsyncTaskRunner* runner = new AsyncTaskRunner(4);
+
+		Vector<I32> vector(SIZE_01);
+		ArrayList<I32> list(1000);
+		for (I32 i = 0; i < SIZE_01; i++) {
+			vector.append(i);
+			list.append(i);
+		}
+
+		parallelForEach(runner, vector, Double());
+		// A grain that does not line up with the blocks of the ArrayList.
+		parallelForEach(runner, list, Double(), 333);
+		for (I32 i = 0; i < SIZE_01; i++) {
+			assert(vector.at(i) == i*2);
+			assert(list.at(i) == i*2);
+		}
+
+		Size count;
+		I32* items = list.getContiguous(1500, &count);
+		assert(count == 500 && items[0] == 3000);
+		items = list.getContiguous(SIZE_01 - 1, &count);
+		assert(count == 1 && items[0] == (SIZE_01 - 1)*2);
+
+		delete runner;
+		FINISH_TEST;
+	}
+
+} // namespace Cat
+
+int main(int argc, char** argv) {
+	Cat::testParallelFor();
+	Cat::testParallelForNested();
+	Cat::testParallelReduce();
+	Cat::testParallelSort();
+	Cat::testParallelForEach();
+
+	return 0;
+}
@@ -9,7 +9,8 @@ namespace cc {
 
 	class TestProcess : public Process {		
 	  public:
-		ConditionVariable lock;
+		Mutex lock;
+		ConditionVariable signal;
 		
 		TestProcess()
 			: Process(), m_ran(0), m_val(0) {}
@@ -28,7 +29,7 @@ namespace cc {
 		void onFailure() {
 			DMSG("Test process (" << m_val << ") failed!" << std::flush);
 			lock.lock();
-			lock.broadcast();
+			signal.broadcast();
 			lock.unlock();	
 		}
 		void onInitialize() {
@@ -37,13 +38,13 @@ namespace cc {
 		void onSuccess() {
 			DMSG("Test process (" << m_val << ") succeeded!" << std::flush);
 			lock.lock();
-			lock.broadcast();
+			signal.broadcast();
 			lock.unlock();	
 		}
 		void onTermination() {
 			DMSG("Test process (" << m_val << ") terminated!" << std::flush);
 			lock.lock();
-			lock.broadcast();
+			signal.broadcast();
 			lock.unlock();	
 		}
 
@@ -61,7 +62,7 @@ namespace cc {
 		void waitForFinished() {
 			lock.lock();
 			while (state() == Process::kPSNotStarted || isAlive()) {
-				lock.wait();
+				signal.wait(lock);
 			}
 			lock.unlock();
 		}		
@@ -82,7 +83,8 @@ namespace cc {
 
 	class LongTestProcess : public Process {		
 	  public:
-		ConditionVariable lock;
+		Mutex lock;
+		ConditionVariable signal;
 		
 		LongTestProcess()
 			: Process(), m_sudoState(0), m_ran(0), m_val(0) {}
@@ -101,25 +103,25 @@ namespace cc {
 		void onFailure() {
 			DMSG("Long Test process (" << m_val << ") failed!" << std::flush);
 			lock.lock();
-			lock.broadcast();
+			signal.broadcast();
 			lock.unlock();	
 		}
 		void onInitialize() {
 			DMSG("Long Test process (" << m_val << ") initialized!" << std::flush);
 			lock.lock();
-			lock.broadcast();
+			signal.broadcast();
 			lock.unlock();			
 		}
 		void onSuccess() {
 			DMSG("Long Test process (" << m_val << ") succeeded!" << std::flush);
 			lock.lock();
-			lock.broadcast();
+			signal.broadcast();
 			lock.unlock();	
 		}
 		void onTermination() {
 			DMSG("Long Test process (" << m_val << ") terminated!" << std::flush);
 			lock.lock();
-			lock.broadcast();
+			signal.broadcast();
 			lock.unlock();	
 		}
 
@@ -143,7 +145,7 @@ namespace cc {
 		void waitForFinished() {
 			lock.lock();
 			while (state() == Process::kPSNotStarted || isAlive()) {
-				lock.wait();
+				signal.wait(lock);
 			}
 			lock.unlock();
 		}
@@ -151,7 +153,7 @@ namespace cc {
 		void waitUntilStarted() {
 			lock.lock();
 			while (state() == Process::kPSNotStarted) {
-				lock.wait();
+				signal.wait(lock);
 			}
 			lock.unlock();
 		}
@@ -185,6 +187,69 @@ namespace cc {
 		U32 m_timeEachRun;		
 	};
 
+	/* Counts its runs, and how many times it was run on a different thread than the last time. */
+	class MigratingProcess : public Process {
+	  public:
+		Mutex lock;
+		ConditionVariable signal;
+
+		MigratingProcess(const Char* name)
+			: Process(name), m_finish(false), m_succeeded(false) {}
+
+		void onSuccess() {
+			lock.lock();
+			m_succeeded = true;
+			signal.broadcast();
+			lock.unlock();
+		}
+		void onTermination() {
+			lock.lock();
+			signal.broadcast();
+			lock.unlock();
+		}
+
+		void run(U32 time) {
+			pthread_t self = pthread_self();
+			if (m_runs.val() > 0 && !pthread_equal(self, m_thread)) {
+				m_moves.increment();
+			}
+			m_thread = self;
+			m_runs.increment();
+			usleep(1000);
+			lock.lock();
+			if (m_finish) {
+				succeeded();
+			}
+			lock.unlock();
+		}
+
+		void finish() {
+			lock.lock();
+			m_finish = true;
+			lock.unlock();
+		}
+
+		void waitForFinished() {
+			lock.lock();
+			while (state() == Process::kPSNotStarted || isAlive()) {
+				signal.wait(lock);
+			}
+			lock.unlock();
+		}
+
+		inline I32 runs() const { return m_runs.val(); }
+		inline I32 moves() const { return m_moves.val(); }
+		inline pthread_t thread() const { return m_thread; }
+		inline Boolean hasSucceeded() const { return m_succeeded; }
+
+	  private:
+		AtomicI32 m_runs;
+		AtomicI32 m_moves;
+		pthread_t m_thread;
+		Boolean m_finish;
+		Boolean m_succeeded;
+	};
+
 	void testCreateAndDestroyProcessManager() {
 		BEGIN_TEST;
 
@@ -1097,6 +1162,168 @@ namespace cc {
 		FINISH_TEST;
 	}
 
+	void testProcessManagerMigrateProcesses() {
+		BEGIN_TEST;
+
+		ProcessManager* runner = new ProcessManager(2);
+		runner->createProcessRunner("PM1", 8);
+		runner->createProcessRunner("PM2", 8);
+		ass_eq(runner->migrationThreshold(), 0);
+		runner->setMigrationThreshold(1);
+		ass_eq(runner->migrationThreshold(), 1);
+		runner->startProcessRunners();
+		ProcessRunner* pm1 = runner->getProcessRunner("PM1");
+		ProcessRunner* pm2 = runner->getProcessRunner("PM2");
+
+		/* A parent and its child are never moved. */
+		MigratingProcess* parent = new MigratingProcess("Parent");
+		MigratingProcess* child = new MigratingProcess("Child");
+		ProcessPtr parentPtr(parent);
+		ProcessPtr childPtr(child);
+		parentPtr->attachChild(childPtr);
+
+		MigratingProcess* procs[6];
+		ProcessPtr ptrs[6];
+		for (I32 i = 0; i < 6; i++) {
+			Char name[32];
+			sprintf(name, "Migrating Process %d", i);
+			procs[i] = new MigratingProcess(name);
+			ptrs[i] = ProcessPtr(procs[i]);
+		}
+		Boolean retVal = runner->queueProcess("PM1", parentPtr);
+		ass_true(retVal);
+		Size queued = runner->queueProcesses("PM1", ptrs, 6);
+		ass_eq(queued, 6);
+
+		/* Three of the seven move to the idle runner, then they stay put. */
+		I32 moves = 0;
+		for (I32 wait = 0; wait < 5000 && moves < 3; wait++) {
+			usleep(1000);
+			moves = 0;
+			for (I32 i = 0; i < 6; i++) {
+				moves += procs[i]->moves();
+			}
+		}
+		ass_eq(moves, 3);
+		usleep(50000);
+		ass_eq(pm1->load(), 4);
+		ass_eq(pm2->load(), 3);
+		ass_eq(parent->moves(), 0);
+		moves = 0;
+		for (I32 i = 0; i < 6; i++) {
+			ass_le(procs[i]->moves(), 1);
+			moves += procs[i]->moves();
+		}
+		ass_eq(moves, 3);
+
+		/* Pausing and resuming finds the processes where they moved to. */
+		for (I32 i = 0; i < 6; i++) {
+			runner->pauseProcess(procs[i]->pID());
+		}
+		for (I32 wait = 0; wait < 5000 && (pm1->load() != 1 || pm2->load() != 0); wait++) {
+			usleep(1000);
+		}
+		ass_eq(pm1->load(), 1);
+		ass_eq(pm2->load(), 0);
+		for (I32 i = 0; i < 6; i++) {
+			ass_true(procs[i]->isPaused());
+			runner->resumeProcess(procs[i]->pID());
+		}
+		for (I32 wait = 0; wait < 5000 && pm1->load() + pm2->load() != 7; wait++) {
+			usleep(1000);
+		}
+		ass_eq(pm1->load() + pm2->load(), 7);
+
+		for (I32 i = 0; i < 6; i++) {
+			procs[i]->finish();
+			procs[i]->waitForFinished();
+			ass_true(procs[i]->hasSucceeded());
+		}
+
+		/* The child is run where its parent was. */
+		parent->finish();
+		parent->waitForFinished();
+		child->finish();
+		child->waitForFinished();
+		ass_true(child->hasSucceeded());
+		ass_eq(parent->moves(), 0);
+		ass_eq(child->moves(), 0);
+		ass_true(pthread_equal(parent->thread(), child->thread()));
+
+		delete runner;
+
+		FINISH_TEST;
+	}
+
+	void testProcessManagerMessageDuringMigration() {
+		BEGIN_TEST;
+
+		ProcessManager* runner = new ProcessManager(2);
+		runner->createProcessRunner("PM1", 8);
+		runner->createProcessRunner("PM2", 2);
+		runner->startProcessRunners();
+		ProcessRunner* pm1 = runner->getProcessRunner("PM1");
+		ProcessRunner* pm2 = runner->getProcessRunner("PM2");
+
+		/* Fill the 6 nodes of PM2 with paused processes, so it is idle but has no room. */
+		MigratingProcess* fillers[6];
+		ProcessPtr fillerPtrs[6];
+		for (I32 i = 0; i < 6; i++) {
+			Char name[32];
+			sprintf(name, "Filler Process %d", i);
+			fillers[i] = new MigratingProcess(name);
+			fillerPtrs[i] = ProcessPtr(fillers[i]);
+			Boolean queued = runner->queueProcess("PM2", fillerPtrs[i]);
+			ass_true(queued);
+			for (I32 wait = 0; wait < 5000 && fillers[i]->runs() == 0; wait++) {
+				usleep(1000);
+			}
+			pm2->pauseProcess(fillers[i]->pID());
+		}
+		for (I32 wait = 0; wait < 5000 && pm2->load() != 0; wait++) {
+			usleep(1000);
+		}
+		ass_eq(pm2->load(), 0);
+
+		/* One process moves to PM2, and waits in its input queue for room. */
+		runner->setMigrationThreshold(1);
+		MigratingProcess* procs[2];
+		ProcessPtr ptrs[2];
+		for (I32 i = 0; i < 2; i++) {
+			Char name[32];
+			sprintf(name, "Moving Process %d", i);
+			procs[i] = new MigratingProcess(name);
+			ptrs[i] = ProcessPtr(procs[i]);
+		}
+		Size queued = runner->queueProcesses("PM1", ptrs, 2);
+		ass_eq(queued, 2);
+		for (I32 wait = 0; wait < 5000 && pm2->load() != 1; wait++) {
+			usleep(1000);
+		}
+		ass_eq(pm2->load(), 1);
+
+		/* The moved process is paused through the runner it left, before PM2 has it. */
+		for (I32 i = 0; i < 2; i++) {
+			pm1->pauseProcess(procs[i]->pID());
+		}
+		usleep(50000);
+
+		/* Once there is room PM2 takes it in, and the pause is not lost. */
+		pm2->terminateProcess(fillers[0]->pID());
+		for (I32 wait = 0; wait < 5000 && pm1->load() + pm2->load() != 0; wait++) {
+			usleep(1000);
+		}
+		ass_eq(pm1->load(), 0);
+		ass_eq(pm2->load(), 0);
+		for (I32 i = 0; i < 2; i++) {
+			ass_true(procs[i]->isPaused());
+		}
+
+		delete runner;
+
+		FINISH_TEST;
+	}
+
 } // namespace cc
 
 int main(int argc, char** argv) {
@@ -1109,6 +1336,8 @@ int main(int argc, char** argv) {
 	cc::testProcessManagerGetAndTerminateProcesses();
 	cc::testProcessManagerPauseAndResumeProcesses();
 	cc::testProcessManagerTerminateAllProcesses();	
+	cc::testProcessManagerMigrateProcesses();
+	cc::testProcessManagerMessageDuringMigration();
 	
 	return 0;
 }
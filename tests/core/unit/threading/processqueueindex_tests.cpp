@@ -0,0 +1,124 @@
+#include "core/testcore.h"
+#include "core/threading/processqueue.h"
+
+namespace Cat {
+
+	ProcessQueueNode nodes[1000];
+
+	void testCreateAndDestroyProcessQueueIndex() {
+		BEGIN_TEST;
+
+		ProcessQueueIndex index1;
+		ass_eq(index1.size(), 0);
+		ass_eq(index1.capacity(), 0);
+		ass_true(index1.find(1) == NIL);
+
+		/* Room for at least the capacity asked for. */
+		ProcessQueueIndex index2(12);
+		ass_eq(index2.size(), 0);
+		ass_ge(index2.capacity(), 12);
+		ass_true(index2.find(1) == NIL);
+
+		index2.set(crc32("Process 1"), &nodes[1]);
+		index2.set(crc32("Process 2"), &nodes[2]);
+		ProcessQueueIndex index3(index2);
+		ass_eq(index3.size(), 2);
+		ass_true(index3.find(crc32("Process 1")) == &nodes[1]);
+		ass_true(index3.find(crc32("Process 2")) == &nodes[2]);
+
+		index1 = index3;
+		ass_eq(index1.size(), 2);
+		ass_true(index1.find(crc32("Process 2")) == &nodes[2]);
+		index1.clear();
+		ass_eq(index1.size(), 0);
+		ass_true(index1.find(crc32("Process 2")) == NIL);
+		ass_true(index3.find(crc32("Process 2")) == &nodes[2]);
+
+		FINISH_TEST;
+	}
+
+	void testProcessQueueIndexSetFindRemove() {
+		BEGIN_TEST;
+
+		ProcessQueueIndex index(16);
+		Size capacity = index.capacity();
+
+		/* Pids that all hash to the same cell, so they have to probe. */
+		OID stride = (OID)(capacity*2);
+		for (U32 i = 0; i < 8; i++) {
+			index.set(5 + i*stride, &nodes[i]);
+		}
+		ass_eq(index.size(), 8);
+		for (U32 i = 0; i < 8; i++) {
+			ass_true(index.find(5 + i*stride) == &nodes[i]);
+		}
+		ass_true(index.find(5 + 8*stride) == NIL);
+
+		/* Removing from the middle of a probe chain keeps the rest findable. */
+		index.remove(5 + 3*stride);
+		index.remove(5);
+		ass_eq(index.size(), 6);
+		ass_true(index.find(5) == NIL);
+		ass_true(index.find(5 + 3*stride) == NIL);
+		for (U32 i = 1; i < 8; i++) {
+			if (i != 3) {
+				ass_true(index.find(5 + i*stride) == &nodes[i]);
+			}
+		}
+		index.remove(12345);
+		ass_eq(index.size(), 6);
+
+		/* A pid set twice is found by the first entry until it is removed. */
+		index.set(crc32("Process 1"), &nodes[100]);
+		index.set(crc32("Process 1"), &nodes[101]);
+		ass_true(index.find(crc32("Process 1")) == &nodes[100]);
+		index.remove(crc32("Process 1"));
+		ass_true(index.find(crc32("Process 1")) == &nodes[101]);
+		index.remove(crc32("Process 1"));
+		ass_true(index.find(crc32("Process 1")) == NIL);
+		ass_eq(index.capacity(), capacity);
+
+		FINISH_TEST;
+	}
+
+	void testProcessQueueIndexGrow() {
+		BEGIN_TEST;
+
+		ProcessQueueIndex index(4);
+		Size capacity = index.capacity();
+		char name[32];
+		for (U32 i = 0; i < 1000; i++) {
+			sprintf(name, "Process %u", i);
+			index.set(crc32(name), &nodes[i]);
+		}
+		ass_eq(index.size(), 1000);
+		ass_ge(index.capacity(), 1000);
+		ass_gt(index.capacity(), capacity);
+
+		/* Remove every other one, and the rest are still found. */
+		for (U32 i = 0; i < 1000; i += 2) {
+			sprintf(name, "Process %u", i);
+			index.remove(crc32(name));
+		}
+		ass_eq(index.size(), 500);
+		for (U32 i = 0; i < 1000; i++) {
+			sprintf(name, "Process %u", i);
+			if (i % 2) {
+				ass_true(index.find(crc32(name)) == &nodes[i]);
+			} else {
+				ass_true(index.find(crc32(name)) == NIL);
+			}
+		}
+
+		FINISH_TEST;
+	}
+
+} // namespace Cat
+
+int main(int argc, char** argv) {
+	Cat::testCreateAndDestroyProcessQueueIndex();
+	Cat::testProcessQueueIndexSetFindRemove();
+	Cat::testProcessQueueIndexGrow();
+
+	return 0;
+}
@@ -7,7 +7,8 @@ namespace cc {
 
 	class TestProcess : public Process {		
 	  public:
-		ConditionVariable lock;
+		Mutex lock;
+		ConditionVariable changed;
 		
 		TestProcess()
 			: Process(), m_ran(0), m_val(0) {}
@@ -26,7 +27,7 @@ namespace cc {
 		void onFailure() {
 			DMSG("Test process (" << m_val << ") failed!" << std::flush);
 			lock.lock();
-			lock.broadcast();
+			changed.broadcast();
 			lock.unlock();	
 		}
 		void onInitialize() {
@@ -41,13 +42,13 @@ namespace cc {
 		void onSuccess() {
 			DMSG("Test process (" << m_val << ") succeeded!" << std::flush);
 			lock.lock();
-			lock.broadcast();
+			changed.broadcast();
 			lock.unlock();	
 		}
 		void onTermination() {
 			DMSG("Test process (" << m_val << ") terminated!" << std::flush);
 			lock.lock();
-			lock.broadcast();
+			changed.broadcast();
 			lock.unlock();	
 		}
 
@@ -65,7 +66,7 @@ namespace cc {
 		void waitForFinished() {
 			lock.lock();
 			while (state() == Process::kPSNotStarted || isAlive()) {
-				lock.wait();
+				changed.wait(lock);
 			}
 			lock.unlock();
 		}		
@@ -86,7 +87,8 @@ namespace cc {
 
 	class LongTestProcess : public Process {		
 	  public:
-		ConditionVariable lock;
+		Mutex lock;
+		ConditionVariable changed;
 		
 		LongTestProcess()
 			: Process(), m_sudoState(0), m_ran(0), m_val(0) {}
@@ -105,13 +107,13 @@ namespace cc {
 		void onFailure() {
 			DMSG("Long Test process (" << m_val << ") failed!" << std::flush);
 			lock.lock();
-			lock.broadcast();
+			changed.broadcast();
 			lock.unlock();	
 		}
 		void onInitialize() {
 			DMSG("Long Test process (" << m_val << ") initialized!" << std::flush);
 			lock.lock();
-			lock.broadcast();
+			changed.broadcast();
 			lock.unlock();			
 		}
 		void onPause() {
@@ -123,13 +125,13 @@ namespace cc {
 		void onSuccess() {
 			DMSG("Long Test process (" << m_val << ") succeeded!" << std::flush);
 			lock.lock();
-			lock.broadcast();
+			changed.broadcast();
 			lock.unlock();	
 		}
 		void onTermination() {
 			DMSG("Long Test process (" << m_val << ") terminated!" << std::flush);
 			lock.lock();
-			lock.broadcast();
+			changed.broadcast();
 			lock.unlock();	
 		}
 
@@ -153,7 +155,7 @@ namespace cc {
 		void waitForFinished() {
 			lock.lock();
 			while (state() == Process::kPSNotStarted || isAlive()) {
-				lock.wait();
+				changed.wait(lock);
 			}
 			lock.unlock();
 		}
@@ -161,7 +163,7 @@ namespace cc {
 		void waitUntilStarted() {
 			lock.lock();
 			while (state() == Process::kPSNotStarted) {
-				lock.wait();
+				changed.wait(lock);
 			}
 			lock.unlock();
 		}
@@ -1,5 +1,6 @@
 #include "core/testcore.h"
 #include "core/threading/processrunner.h"
+#include "core/time/time.h"
 
 namespace cc {
 
@@ -63,6 +64,28 @@ namespace cc {
 		U32 m_timeToRun;		
 	};
 
+	/* Spins for a fixed time on every run, whatever time it is given. */
+	class TimedProcess : public Process {
+	  public:
+		TimedProcess(const Char* name, U64 spinNano)
+			: Process(name), m_spinNano(spinNano), m_runs(0), m_lastTime(0) {}
+
+		void run(U32 time) {
+			m_runs++;
+			m_lastTime = time;
+			U64 end = Time::currentTimeNano() + m_spinNano;
+			while (Time::currentTimeNano() < end) {}
+		}
+
+		inline U32 runs() const { return m_runs; }
+		inline U32 lastTime() const { return m_lastTime; }
+
+	  private:
+		U64 m_spinNano;
+		U32 m_runs;
+		U32 m_lastTime;
+	};
+
 	void testCreateAndDestroyProcessRunner() {
 		BEGIN_TEST;
 
@@ -229,7 +252,7 @@ namespace cc {
 		ass_eq(m->messageQueue()->capacity(), 6);
 		ass_false(m->messageQueue()->isEmpty());
 
-		SimpleQueue<ProcessRunner::PMMessage>::Iterator itr = m->messageQueue()->begin();			
+		MPSCQueue<ProcessRunner::PMMessage>::Iterator itr = m->messageQueue()->begin();			
 		ass_true(itr.isValid());
 		ass_true(itr.hasNext());		
 		ass_eq(itr.val().type, ProcessRunner::kPMMTerminateProcess);
@@ -2037,6 +2060,77 @@ namespace cc {
 		FINISH_TEST;
 	}
 	
+	void testProcessRunnerTimeBudget() {
+		BEGIN_TEST;
+
+		/* One greedy process overruns its 1ms slice by 4ms every time it runs. */
+		ProcessRunner* m = new ProcessRunner("PM", 4);
+		m->setTimeBudget(100*1000000, 1000000);
+		ass_eq(m->tickBudget(), 100*1000000);
+		ass_eq(m->baseSlice(), 1000000);
+
+		TimedProcess* greedy = new TimedProcess("Greedy", 5000000);
+		TimedProcess* polite1 = new TimedProcess("Polite 1", 0);
+		TimedProcess* polite2 = new TimedProcess("Polite 2", 0);
+		ProcessPtr greedyPtr(greedy);
+		ProcessPtr polite1Ptr(polite1);
+		ProcessPtr polite2Ptr(polite2);
+		m->queueProcess(greedyPtr);
+		m->queueProcess(polite1Ptr);
+		m->queueProcess(polite2Ptr);
+
+		m->runProcesses(1);
+		ass_eq(greedy->runs(), 1);
+		ass_eq(polite1->runs(), 1);
+		ass_eq(polite2->runs(), 1);
+		/* Given its slice in microseconds, then went into debt */
+		ass_eq(greedy->lastTime(), 1000);
+		ass_le(m->runningQueue()->next->deficit, -4000000);
+
+		/* Pays off the debt with a slice each tick, while the others run every tick */
+		for (I32 i = 0; i < 4; i++) {
+			m->runProcesses(1);
+		}
+		ass_eq(greedy->runs(), 1);
+		ass_eq(polite1->runs(), 5);
+		ass_eq(polite2->runs(), 5);
+		for (I32 i = 0; i < 7; i++) {
+			m->runProcesses(1);
+		}
+		ass_le(greedy->runs(), 3);
+		ass_eq(polite1->runs(), 12);
+		ass_eq(polite2->runs(), 12);
+
+		delete m;
+
+		/* A 2ms tick only has time for one 5ms process, the next tick starts with the next one. */
+		m = new ProcessRunner("PM", 4);
+		m->setTimeBudget(2000000, 10000000);
+		TimedProcess* slow[3];
+		for (I32 i = 0; i < 3; i++) {
+			Char name[16];
+			sprintf(name, "Slow %d", i);
+			slow[i] = new TimedProcess(name, 5000000);
+			m->queueProcess(ProcessPtr(slow[i]));
+		}
+
+		m->runProcesses(1);
+		ass_eq(slow[0]->runs(), 1);
+		ass_eq(slow[1]->runs(), 0);
+		ass_eq(slow[2]->runs(), 0);
+		/* Only given what is left of the tick */
+		ass_le(slow[0]->lastTime(), 2000);
+		m->runProcesses(1);
+		m->runProcesses(1);
+		ass_eq(slow[0]->runs(), 1);
+		ass_eq(slow[1]->runs(), 1);
+		ass_eq(slow[2]->runs(), 1);
+
+		delete m;
+
+		FINISH_TEST;
+	}
+	
 } // namespace cc
 
 int main(int argc, char** argv) {
@@ -2051,6 +2145,7 @@ int main(int argc, char** argv) {
 	cc::testProcessRunnerAddFinishedProcess();
 	cc::testProcessRunnerTerminateAllProcesses();
 	cc::testProcessRunnerTerminateProcessRunner();
+	cc::testProcessRunnerTimeBudget();
 	
 	return 0;
 }
@@ -0,0 +1,222 @@
+#include "core/testcore.h"
+#include "core/threading/taskgraph.h"
+#include "core/threading/spinlock.h"
+
+namespace Cat {
+
+	Spinlock locky;
+	I32 run_order[16];
+	I32 run_count = 0;
+	I32 terminated_count = 0;
+
+	void reset_counts() {
+		locky.lock();
+		run_count = 0;
+		terminated_count = 0;
+		locky.unlock();
+	}
+
+	I32 order_of(I32 val) {
+		for (I32 i = 0; i < run_count; i++) {
+			if (run_order[i] == val) {
+				return i;
+			}
+		}
+		return -1;
+	}
+
+	class GraphTask : public Task {
+	  public:
+		GraphTask(I32 val, U32 timeToRun = 1, Task::TaskState finishState = Task::kTSSucceeded)
+			: Task((OID)val), m_val(val), m_timeToRun(timeToRun), m_finishState(finishState) {}
+
+		void onTermination() {
+			locky.lock();
+			DMSG("Graph task (" << m_val << ") terminated!");
+			terminated_count++;
+			locky.unlock();
+		}
+
+		void run() {
+			usleep(10000*m_timeToRun);
+			locky.lock();
+			run_order[run_count++] = m_val;
+			locky.unlock();
+
+			switch(m_finishState) {
+			case Task::kTSSucceeded:
+				succeeded();
+				break;
+			case Task::kTSFailed:
+				failed();
+				break;
+			default:
+				terminate();
+				break;
+			}
+		}
+
+		inline static TaskPtr create(I32 val, U32 timeToRun = 1, Task::TaskState finishState = Task::kTSSucceeded) {
+			return TaskPtr(new GraphTask(val, timeToRun, finishState));
+		}
+
+	  private:
+		I32 m_val;
+		U32 m_timeToRun;
+		Task::TaskState m_finishState;
+	};
+
+	TaskManager* createManager() {
+		TaskManager* manager = new TaskManager(4);
+		manager->createTaskRunner("GR1", 8);
+		manager->createTaskRunner("GR2", 8);
+		manager->createTaskRunner("GR3", 8);
+		manager->startTaskRunners();
+		return manager;
+	}
+
+	void testTaskGraphAddTasksAndDependencies() {
+		BEGIN_TEST;
+
+		TaskGraph graph(2);
+		I32 a = graph.addTask(GraphTask::create(0));
+		I32 b = graph.addTask(GraphTask::create(1));
+		I32 c = graph.addTask(GraphTask::create(2));
+		ass_eq(a, 0);
+		ass_eq(c, 2);
+		ass_eq(graph.numTasks(), 3);
+		I32 bad = graph.addTask(TaskPtr::nullPtr());
+		ass_eq(bad, -1);
+
+		Boolean retVal;
+		retVal = graph.addDependency(a, b);
+		ass_true(retVal);
+		retVal = graph.addDependency(a, c);
+		ass_true(retVal);
+		retVal = graph.addDependency(b, c);
+		ass_true(retVal);
+		retVal = graph.addDependency(a, a);
+		ass_false(retVal);
+		retVal = graph.addDependency(a, 3);
+		ass_false(retVal);
+
+		ass_eq(graph.node(a)->numSuccessors(), 2);
+		ass_eq(graph.node(a)->numPredecessors(), 0);
+		ass_eq(graph.node(c)->numPredecessors(), 2);
+		ass_eq(graph.node(b)->index(), b);
+		ass_false(graph.isFinished());
+
+		FINISH_TEST;
+	}
+
+	void testTaskGraphRejectsCycles() {
+		BEGIN_TEST;
+
+		TaskManager* manager = createManager();
+		{
+			TaskGraph graph;
+			I32 a = graph.addTask(GraphTask::create(0));
+			I32 b = graph.addTask(GraphTask::create(1));
+			I32 c = graph.addTask(GraphTask::create(2));
+			graph.addDependency(a, b);
+			graph.addDependency(b, c);
+			graph.addDependency(c, b);
+			Boolean retVal = graph.run(manager);
+			ass_false(retVal);
+			ass_false(graph.isFinished());
+		}
+		delete manager;
+
+		FINISH_TEST;
+	}
+
+	void testTaskGraphFanOutFanIn() {
+		BEGIN_TEST;
+
+		reset_counts();
+		TaskManager* manager = createManager();
+		{
+			/* 0 -> (1, 2, 3) -> 4 -> 5, with 6 on its own. */
+			TaskGraph graph;
+			I32 ids[7];
+			for (I32 i = 0; i < 7; i++) {
+				ids[i] = graph.addTask(GraphTask::create(i, (i == 1) ? 5 : 1));
+			}
+			for (I32 i = 1; i <= 3; i++) {
+				graph.addDependency(ids[0], ids[i]);
+				graph.addDependency(ids[i], ids[4]);
+			}
+			graph.addDependency(ids[4], ids[5]);
+
+			Boolean retVal = graph.run(manager);
+			ass_true(retVal);
+			retVal = graph.run(manager);
+			ass_false(retVal);
+			retVal = graph.wait();
+			ass_true(retVal);
+			ass_true(graph.isFinished());
+			ass_eq(graph.numFailed(), 0);
+
+			ass_eq(run_count, 7);
+			ass_eq(terminated_count, 0);
+			for (I32 i = 1; i <= 3; i++) {
+				ass_lt(order_of(0), order_of(i));
+				ass_lt(order_of(i), order_of(4));
+			}
+			ass_lt(order_of(4), order_of(5));
+			/* The slow task does not hold back the other two branches. */
+			ass_lt(order_of(2), order_of(1));
+			ass_lt(order_of(3), order_of(1));
+		}
+		delete manager;
+
+		FINISH_TEST;
+	}
+
+	void testTaskGraphFailureCancelsSuccessors() {
+		BEGIN_TEST;
+
+		reset_counts();
+		TaskManager* manager = createManager();
+		{
+			/* 0 -> 1 (fails) -> 2 -> 3, and 0 -> 4. */
+			TaskGraph graph;
+			I32 a = graph.addTask(GraphTask::create(0));
+			I32 b = graph.addTask(GraphTask::create(1, 1, Task::kTSFailed));
+			I32 c = graph.addTask(GraphTask::create(2));
+			I32 d = graph.addTask(GraphTask::create(3));
+			I32 e = graph.addTask(GraphTask::create(4));
+			graph.addDependency(a, b);
+			graph.addDependency(b, c);
+			graph.addDependency(c, d);
+			graph.addDependency(a, e);
+
+			Boolean retVal = graph.run(manager);
+			ass_true(retVal);
+			retVal = graph.wait();
+			ass_false(retVal);
+			ass_eq(graph.numFailed(), 3);
+
+			ass_eq(run_count, 3);
+			ass_eq(order_of(2), -1);
+			ass_eq(order_of(3), -1);
+			ass_eq(terminated_count, 2);
+			ass_true(graph.node(c)->wasCancelled());
+			ass_true(graph.node(d)->wasCancelled());
+			ass_false(graph.node(e)->wasCancelled());
+		}
+		delete manager;
+
+		FINISH_TEST;
+	}
+
+} // namespace Cat
+
+int main(int argc, char** argv) {
+	Cat::testTaskGraphAddTasksAndDependencies();
+	Cat::testTaskGraphRejectsCycles();
+	Cat::testTaskGraphFanOutFanIn();
+	Cat::testTaskGraphFailureCancelsSuccessors();
+
+	return 0;
+}
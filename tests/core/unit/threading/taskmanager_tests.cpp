@@ -1,6 +1,8 @@
 #include "core/testcore.h"
 #include "core/threading/taskmanager.h"
 #include "core/threading/taskrunner.h"
+#include "core/threading/spinlock.h"
+#include "core/threading/thread.h"
 
 
 namespace cc {
@@ -33,7 +35,8 @@ namespace cc {
 	
 	class TestTask : public Task {		
 	  public:
-		ConditionVariable lock;
+		Mutex lock;
+		ConditionVariable signal;
 		
 		TestTask()
 			: Task(),m_val(0), m_ran(0), m_timeToRun(0) {}
@@ -57,7 +60,7 @@ namespace cc {
 			failure_count++;
 			locky.unlock();
 			lock.lock();
-			lock.broadcast();
+			signal.broadcast();
 			lock.unlock();	
 		}
 		void onInitialize() {
@@ -71,7 +74,7 @@ namespace cc {
 			success_count++;			
 			locky.unlock();
 			lock.lock();
-			lock.broadcast();
+			signal.broadcast();
 			lock.unlock();	
 		}
 		void onTermination() {
@@ -80,11 +83,12 @@ namespace cc {
 			terminated_count++;			
 			locky.unlock();
 			lock.lock();
-			lock.broadcast();
+			signal.broadcast();
 			lock.unlock();	
 		}
 
 		void run() {
+			m_ranOn = Thread::self();
 			usleep(100000*m_timeToRun);
 			DMSG("Task " << m_val << " ran for " << m_timeToRun << " time.");
 			m_ran += m_timeToRun;			
@@ -111,7 +115,7 @@ namespace cc {
 		void waitForFinished() {
 			lock.lock();
 			while (state() == Task::kTSNotStarted || isAlive()) {
-				lock.wait();
+				signal.wait(lock);
 			}
 			lock.unlock();
 		}		
@@ -119,6 +123,7 @@ namespace cc {
 		inline U32 ran() const { return m_ran; }		
 		inline I32 val() const { return m_val; }
 		inline U32 timeToRun() const { return m_timeToRun; }		
+		inline ThreadHandle ranOn() const { return m_ranOn; }
 
 		inline static TaskPtr create(const Char* name, I32 val, U32 timeToRun = 1, Task::TaskState finishState = Task::kTSSucceeded) {
 			return TaskPtr(new TestTask(name, val, timeToRun, finishState));
@@ -129,12 +134,14 @@ namespace cc {
 		U32 m_ran;		
 		U32 m_timeToRun;
 		Task::TaskState m_finishState;		
+		ThreadHandle m_ranOn;
 	};
 	
 
 	class LongTestTask : public Task {		
 	  public:
-		ConditionVariable lock;
+		Mutex lock;
+		ConditionVariable signal;
 		
 		LongTestTask()
 			: Task(), m_sudoState(0), m_ran(0), m_val(0), m_timeEachRun(1) {}
@@ -158,7 +165,7 @@ namespace cc {
 			failure_count++;			
 			locky.unlock();
 			lock.lock();
-			lock.broadcast();
+			signal.broadcast();
 			lock.unlock();	
 		}
 		void onInitialize() {
@@ -166,7 +173,7 @@ namespace cc {
 			DMSG("Long Test task (" << m_val << ") initialized!" << std::flush);
 			locky.unlock();
 			lock.lock();
-			lock.broadcast();
+			signal.broadcast();
 			lock.unlock();			
 		}	
 		void onSuccess() {
@@ -175,7 +182,7 @@ namespace cc {
 			success_count++;
 			locky.unlock();
 			lock.lock();
-			lock.broadcast();
+			signal.broadcast();
 			lock.unlock();	
 		}
 		void onTermination() {
@@ -184,7 +191,7 @@ namespace cc {
 			terminated_count++;
 			locky.unlock();
 			lock.lock();
-			lock.broadcast();
+			signal.broadcast();
 			lock.unlock();	
 		}
 
@@ -213,7 +220,7 @@ namespace cc {
 		void waitForFinished() {
 			lock.lock();
 			while (state() == Task::kTSNotStarted || isAlive()) {
-				lock.wait();
+				signal.wait(lock);
 			}
 			lock.unlock();
 		}
@@ -221,7 +228,7 @@ namespace cc {
 		void waitUntilStarted() {
 			lock.lock();
 			while (state() == Task::kTSNotStarted) {
-				lock.wait();
+				signal.wait(lock);
 			}
 			lock.unlock();
 		}
@@ -254,6 +261,29 @@ namespace cc {
 		U32 m_timeEachRun;		
 	};
 
+	/* Queues tasks onto another runner from its own runner's thread. */
+	class QueueingTask : public Task {
+	  public:
+		static const I32 kNumQueued = 64;
+
+		QueueingTask(TaskManager* manager, const Char* runnerName)
+			: Task(), m_pManager(manager), m_pRunnerName(runnerName) {}
+
+		void run() {
+			for (I32 i = 0; i < kNumQueued; i++) {
+				queued[i] = m_pManager->queueTask(m_pRunnerName, TaskPtr(new TestTask(i + 100, i, 0)));
+				usleep(100);
+			}
+			succeeded();
+		}
+
+		TaskPtr queued[kNumQueued];
+
+	  private:
+		TaskManager* m_pManager;
+		const Char* m_pRunnerName;
+	};
+
 	void testCreateAndDestroyTaskManager() {
 		BEGIN_TEST;
 
@@ -871,6 +901,157 @@ namespace cc {
 		FINISH_TEST;
 	}
 
+	void testTaskManagerPlacement() {
+		BEGIN_TEST;
+
+		reset_counts();
+
+		TaskManager* runner = new TaskManager(3);
+		runner->createTaskRunner("PM1", 8);
+		runner->createTaskRunner("PM2", 8);
+		runner->createTaskRunner("PM3", 8);
+		TaskRunner* pm1 = runner->getTaskRunner("PM1");
+		TaskRunner* pm2 = runner->getTaskRunner("PM2");
+		TaskRunner* pm3 = runner->getTaskRunner("PM3");
+		TaskPtr queued;
+
+		/* The runners are not started, so the tasks stay queued. */
+		ass_eq(runner->placement(), TaskManager::kTPLeastQueued);
+		for (I32 i = 0; i < 6; i++) {
+			queued = runner->queueTask(TaskPtr(new TestTask(i + 1, i)));
+			ass_true(queued.notNull());
+		}
+		ass_eq(pm1->load(), 2);
+		ass_eq(pm2->load(), 2);
+		ass_eq(pm3->load(), 2);
+
+		runner->setPlacement(TaskManager::kTPRoundRobin);
+		for (I32 i = 0; i < 3; i++) {
+			queued = runner->queueTask(TaskPtr(new TestTask(i + 7, i)));
+			ass_true(queued.notNull());
+		}
+		ass_eq(pm1->load(), 3);
+		ass_eq(pm2->load(), 3);
+		ass_eq(pm3->load(), 3);
+
+		/* The same OID always goes to the same runner, until it is full. */
+		runner->setPlacement(TaskManager::kTPAffinity);
+		for (I32 i = 0; i < 6; i++) {
+			queued = runner->queueTask(TaskPtr(new TestTask(42, i)));
+			ass_true(queued.notNull());
+		}
+		ass_eq(pm1->load(), 8);
+		ass_eq(pm2->load() + pm3->load(), 7);
+
+		runner->setPlacement(TaskManager::kTPPowerOfTwoChoices);
+		queued = runner->queueTask(TaskPtr(new TestTask(43, 0)));
+		ass_true(queued.notNull());
+		queued.setNull();
+		ass_eq(pm1->load(), 8);
+		ass_eq(pm2->load() + pm3->load(), 8);
+
+		/* A batch is split over the runners, and stops when they are all full. */
+		TaskPtr tasks[10];
+		for (I32 i = 0; i < 10; i++) {
+			tasks[i] = TaskPtr(new TestTask(i + 50, i));
+		}
+		Size numQueued = runner->queueTasks(tasks, 10);
+		ass_eq(numQueued, 8);
+		ass_eq(pm1->load() + pm2->load() + pm3->load(), 24);
+		for (I32 i = 0; i < 10; i++) {
+			tasks[i].setNull();
+		}
+		test_counts(0, 0, 0, 2);
+
+		delete runner;
+
+		test_counts(0, 0, 24, 26);
+
+		FINISH_TEST;
+	}
+
+	void testTaskManagerQueueWhileTerminating() {
+		BEGIN_TEST;
+
+		reset_counts();
+
+		TaskManager* runner = new TaskManager(2);
+		runner->createTaskRunner("PM1", 4);
+		runner->createTaskRunner("PM2", 8);
+		runner->startTaskRunners();
+
+		/* PM2 terminates while PM1 is queueing onto it, any task it took must not be
+		 * left waiting in its input queue. */
+		QueueingTask* queueing = new QueueingTask(runner, "PM2");
+		TaskPtr queuer = runner->queueTask("PM1", TaskPtr(queueing));
+		ass_true(queuer.notNull());
+		usleep(2000);
+		runner->terminateTaskRunner("PM2");
+		ass_true(runner->getTaskRunner("PM2")->waitForTermination());
+
+		runner->terminateAllTaskRunners();
+		runner->waitForAllTaskRunnersToTerminate();
+		for (I32 i = 0; i < QueueingTask::kNumQueued; i++) {
+			if (queueing->queued[i].notNull()) {
+				ass_true(queueing->queued[i]->state() != Task::kTSNotStarted);
+				ass_false(queueing->queued[i]->isAlive());
+			}
+		}
+		queuer.setNull();
+
+		delete runner;
+
+		FINISH_TEST;
+	}
+
+	void testTaskManagerIdlePulling() {
+		BEGIN_TEST;
+
+		reset_counts();
+
+		TaskManager* runner = new TaskManager(3);
+		runner->createTaskRunner("PM1", 16);
+		runner->createTaskRunner("PM2", 16);
+		runner->createTaskRunner("PM3", 16);
+		runner->setIdlePulling(true);
+		ass_true(runner->isIdlePulling());
+		runner->startTaskRunners();
+
+		/* Everything is queued on one runner, the others should get some. */
+		TaskPtr tasks[9];
+		for (I32 i = 0; i < 9; i++) {
+			tasks[i] = runner->queueTask("PM1", TaskPtr(new TestTask(i + 1, i)));
+			ass_true(tasks[i].notNull());
+		}
+		for (I32 i = 0; i < 9; i++) {
+			((TestTask*)(tasks[i].ptr()))->waitForFinished();
+		}
+		/* The runners let go of the tasks by the time they have terminated. */
+		runner->terminateAllTaskRunners();
+		runner->waitForAllTaskRunnersToTerminate();
+
+		/* Where the tasks ran, not the loads, which change as they run. */
+		I32 ranElsewhere = 0;
+		ThreadHandle first = ((TestTask*)(tasks[0].ptr()))->ranOn();
+		for (I32 i = 1; i < 9; i++) {
+			if (!pthread_equal(first, ((TestTask*)(tasks[i].ptr()))->ranOn())) {
+				ranElsewhere++;
+			}
+		}
+		ass_true(ranElsewhere > 0);
+
+		for (I32 i = 0; i < 9; i++) {
+			tasks[i].setNull();
+		}
+		test_counts(9, 0, 0, 9);
+
+		delete runner;
+
+		test_counts(9, 0, 0, 9);
+
+		FINISH_TEST;
+	}
+
 } // namespace cc
 
 int main(int argc, char** argv) {
@@ -881,6 +1062,9 @@ int main(int argc, char** argv) {
 	cc::testTaskManagerTerminateTaskRunner();
 	cc::testTaskManagerTerminateAllTaskRunners();
 	cc::testTaskManagerClearAllWaitingTasks();	
+	cc::testTaskManagerPlacement();
+	cc::testTaskManagerQueueWhileTerminating();
+	cc::testTaskManagerIdlePulling();
 	
 	return 0;
 }
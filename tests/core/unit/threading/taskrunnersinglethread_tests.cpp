@@ -278,7 +278,7 @@ namespace cc {
 		ass_false(m->messageQueue()->isEmpty());
 		ass_false(m->messageQueue()->isFull());
 
-		SimpleQueue<TaskRunner::TRMessage>::Iterator itr = m->messageQueue()->begin();				
+		MPSCQueue<TaskRunner::TRMessage>::Iterator itr = m->messageQueue()->begin();				
 		ass_true(itr.isValid());
 		ass_true(itr.hasNext());		
 		ass_eq(itr.val().type, TaskRunner::kTRMClearAllWaitingTasks);
@@ -8,6 +8,7 @@
 #define DEBUG 1
 #endif
 #include "core/threading/thread.h"
+#include "core/threading/processrunner.h"
 
 
 #define BEGIN_TEST (std::cout << ">>> BEGINNING " << __FUNCTION__ << std::endl << std::flush)
@@ -32,6 +33,20 @@ namespace cc {
 	}
 
 
+	Char otherName[16];
+	I32 otherCpu = -1;
+	Size otherStackSize = 0;
+
+	I32 testFuncOptions(VPtr data) {
+		pthread_getname_np(pthread_self(), otherName, sizeof(otherName));
+		otherCpu = sched_getcpu();
+		pthread_attr_t attr;
+		pthread_getattr_np(pthread_self(), &attr);
+		pthread_attr_getstacksize(&attr, &otherStackSize);
+		pthread_attr_destroy(&attr);
+		return 0;
+	}
+
 	void testThreadRunAndJoin() {
 		BEGIN_TEST;
 	
@@ -45,10 +60,62 @@ namespace cc {
 		FINISH_TEST;
 	}
 	
+	void testThreadRunWithOptions() {
+		BEGIN_TEST;
+
+		/* Pin to the last CPU this process may use. */
+		cpu_set_t cpus;
+		sched_getaffinity(0, sizeof(cpus), &cpus);
+		I32 cpu = 0;
+		for (I32 i = 0; i < (I32)ThreadOptions::kMaxCpus; i++) {
+			if (CPU_ISSET(i, &cpus)) {
+				cpu = i;
+			}
+		}
+
+		ThreadOptions options;
+		assert(!options.hasName());
+		assert(options.affinity() == 0);
+		options.setName("a-very-long-thread-name").pinToCpu(cpu).setStackSize(1024*1024);
+		assert(strcmp(options.name(), "a-very-long-thr") == 0);
+		assert(options.affinity() == ((U64)1 << cpu));
+
+		RunnableFunc runnable(testFuncOptions);
+		ThreadHandle* handle = Thread::run(&runnable, options);
+		Thread::join(handle);
+		assert(strcmp(otherName, "a-very-long-thr") == 0);
+		assert(otherCpu == cpu);
+		assert(otherStackSize == 1024*1024);
+
+		/* Real time scheduling falls back to the default without the privileges. */
+		options = ThreadOptions();
+		options.setScheduling(ThreadOptions::kTSPFifo, 1000);
+		handle = Thread::run(&runnable, options);
+		assert(handle != NIL);
+		Thread::join(handle);
+
+		/* Runners name their thread after themselves. */
+		ProcessRunner* runner = new ProcessRunner("Named Runner");
+		assert(strcmp(runner->threadOptions().name(), "Named Runner") == 0);
+		runner->run();
+		runner->waitUntilStarted();
+		Char name[16];
+		pthread_getname_np(*runner->threadPtr(), name, sizeof(name));
+		assert(strcmp(name, "Named Runner") == 0);
+		delete runner;
+
+		runner = new ProcessRunner("Other Runner", 4, ThreadOptions().setName("renamed"));
+		assert(strcmp(runner->threadOptions().name(), "renamed") == 0);
+		delete runner;
+
+		FINISH_TEST;
+	}
+	
 }
 
 int main(int argc, char** argv) {
 	cc::testThreadRunAndJoin();
+	cc::testThreadRunWithOptions();
 	return 0;
 }
 
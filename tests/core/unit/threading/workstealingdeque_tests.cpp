@@ -0,0 +1,123 @@
+#include <assert.h>
+#ifndef DEBUG
+#define DEBUG 1
+#endif
+#include "core/threading/workstealingdeque.h"
+#include "core/threading/runnable.h"
+#include "core/threading/thread.h"
+
+#define BEGIN_TEST (std::cout << ">>> BEGINNING " << __FUNCTION__ << std::endl << std::flush)
+#define FINISH_TEST (std::cout << ">>> FINISHED " << __FUNCTION__ << std::endl << std::endl << std::flush)
+
+#define NUM_ITEMS 100000
+
+namespace Cat {
+
+	I32 items[NUM_ITEMS];
+	AtomicI32 taken[NUM_ITEMS];
+
+	class Thief : public Runnable {
+	  public:
+		Thief(WorkStealingDeque<I32>* deque, AtomicI32* done) 
+			: m_pDeque(deque), m_pDone(done), m_stolen(0) {}
+
+		I32 run() {
+			while (!m_pDone->val() || !m_pDeque->isEmpty()) {
+				I32* item = m_pDeque->steal();
+				if (item) {
+					taken[*item].increment();
+					m_stolen++;
+				}
+			}
+			return 0;
+		}
+
+		inline U32 stolen() const { return m_stolen; }
+
+	  private:
+		WorkStealingDeque<I32>*	m_pDeque;
+		AtomicI32*					m_pDone;
+		U32							m_stolen;
+	};
+
+	void testWorkStealingDequeSingleThread() {
+		BEGIN_TEST;
+		WorkStealingDeque<I32> deque(4);
+		assert(deque.isEmpty());
+		assert(deque.pop() == NIL);
+		assert(deque.steal() == NIL);
+
+		// Grows past the initial capacity.
+		for (I32 i = 0; i < 100; i++) {
+			items[i] = i;
+			deque.push(&items[i]);
+		}
+		assert(!deque.isEmpty());
+
+		// The owner pops the newest, thieves steal the oldest.
+		assert(*deque.pop() == 99);
+		assert(*deque.steal() == 0);
+		assert(*deque.steal() == 1);
+		assert(*deque.pop() == 98);
+		for (I32 i = 97; i >= 2; i--) {
+			assert(*deque.pop() == i);
+		}
+		assert(deque.isEmpty());
+		assert(deque.pop() == NIL);
+		FINISH_TEST;
+	}
+
+	void testWorkStealingDequeWithThieves() {
+		BEGIN_TEST;
+		WorkStealingDeque<I32> deque;
+		AtomicI32 done;
+		Thief* thieves[3];
+		for (U32 i = 0; i < 3; i++) {
+			thieves[i] = new Thief(&deque, &done);
+			Thread::run(thieves[i]);
+		}
+
+		U32 popped = 0;
+		for (I32 i = 0; i < NUM_ITEMS; i++) {
+			items[i] = i;
+			deque.push(&items[i]);
+			// Pop every other time so the owner and the thieves race for the last items.
+			if (i % 2) {
+				I32* item = deque.pop();
+				if (item) {
+					taken[*item].increment();
+					popped++;
+				}
+			}
+		}
+		I32* item;
+		while ((item = deque.pop())) {
+			taken[*item].increment();
+			popped++;
+		}
+		done.increment();
+
+		U32 stolen = 0;
+		for (U32 i = 0; i < 3; i++) {
+			Thread::join(thieves[i]->getThread());
+			stolen += thieves[i]->stolen();
+			delete thieves[i];
+		}
+		D(std::cout << "Popped " << popped << ", stolen " << stolen << std::endl);
+
+		// Every item was taken exactly once.
+		assert(popped + stolen == NUM_ITEMS);
+		for (I32 i = 0; i < NUM_ITEMS; i++) {
+			assert(taken[i].val() == 1);
+		}
+		FINISH_TEST;
+	}
+
+} // namespace Cat
+
+int main(int argc, char** argv) {
+	Cat::testWorkStealingDequeSingleThread();
+	Cat::testWorkStealingDequeWithThieves();
+
+	return 0;
+}
@@ -0,0 +1,72 @@
+#include "core/corelib.h"
+#include "core/testcore.h"
+
+namespace Cat {
+
+	/* The CRC a byte at a time, straight from the polynomial. */
+	U32 bitwiseCrc(U32 polynomial, const Char* data, Size length) {
+		U32 crc = ~0U;
+		for (Size i = 0; i < length; i++) {
+			crc ^= (U8)data[i];
+			for (U32 bit = 0; bit < 8; bit++) {
+				crc = (crc >> 1) ^ (polynomial & (0U - (crc & 1U)));
+			}
+		}
+		return crc ^ ~0U;
+	}
+
+	void testCrc32KnownValues() {
+		BEGIN_TEST;
+
+		ass_eq(crc32("123456789"), 0xcbf43926U);
+		ass_eq(crc32("123456789", 9), 0xcbf43926U);
+		ass_eq(crc32c("123456789", 9), 0xe3069283U);
+		ass_eq(crc32(""), 0U);
+		ass_eq(crc32("", 0), 0U);
+		ass_eq(crc32c("", 0), 0U);
+
+		FINISH_TEST;
+	}
+
+	void testCrc32AllLengthsAndAlignments() {
+		BEGIN_TEST;
+
+		Char data[300];
+		for (Size i = 0; i < sizeof(data); i++) {
+			data[i] = (Char)(i*37 + 11);
+		}
+		for (Size offset = 0; offset < 8; offset++) {
+			for (Size length = 0; length + offset < sizeof(data); length++) {
+				OID expected = bitwiseCrc(0xedb88320U, data + offset, length);
+				OID expectedC = bitwiseCrc(0x82f63b78U, data + offset, length);
+				OID actual = crc32(data + offset, length);
+				OID actualC = crc32c(data + offset, length);
+				ass_eq(actual, expected);
+				ass_eq(actualC, expectedC);
+			}
+		}
+
+		FINISH_TEST;
+	}
+
+	void testCrc32Const() {
+		BEGIN_TEST;
+#if __cplusplus >= 201103L
+		static_assert(crc32Const("123456789") == 0xcbf43926U, "crc32Const is not CRC32");
+		constexpr OID resize = crc32Const("onResize");
+		ass_eq(resize, crc32("onResize"));
+		ass_eq(crc32Const(""), crc32(""));
+#else
+		std::cout << "crc32Const needs C++11, not tested." << std::endl;
+#endif
+		FINISH_TEST;
+	}
+
+}
+
+int main(int argc, char** argv) {
+	Cat::testCrc32KnownValues();
+	Cat::testCrc32AllLengthsAndAlignments();
+	Cat::testCrc32Const();
+	return 0;
+}
@@ -0,0 +1,222 @@
+#include <map>
+#include <cstdlib>
+#include "core/testcore.h"
+#include "core/memory/stackmemoryallocator.h"
+#include "core/util/densemap.h"
+
+namespace Cat {
+
+	Size destroyed_count = 0;
+
+	class TestObject {
+	  public:
+		TestObject(I32 v) : m_v(v) {}
+		~TestObject() { destroyed_count++; }
+
+		I32 m_v;
+	};
+
+	void testDenseMapBasicCreateAndDestroy() {
+		BEGIN_TEST;
+
+		DenseMap<TestObject*> empty;
+		ass_eq(empty.capacity(), 0);
+		ass_eq(empty.numBuckets(), 0);
+		ass_eq(empty.size(), 0);
+		ass_true(empty.isEmpty());
+		ass_true(empty.nullValue() == NIL);
+		ass_true(empty.at("nothing") == NIL);
+		ass_false(empty.contains("nothing"));
+
+		DenseMap<I32> map(32, -1);
+		ass_eq(map.capacity(), 32);
+		ass_eq(map.numBuckets(), 64);
+		ass_eq(map.loadFactor(), 0.8f);
+		ass_eq(map.nullValue(), -1);
+		ass_eq(map.at(5), -1);
+
+		DenseMap<I32> sparse(100, 0.5f, -1);
+		ass_eq(sparse.capacity(), 100);
+		ass_eq(sparse.numBuckets(), 256);
+
+		FINISH_TEST;
+	}
+
+	void testDenseMapInsertAndLookup() {
+		BEGIN_TEST;
+
+		DenseMap<I32> map(4, -1);
+		map.insert("one", 1);
+		map.insert("two", 2);
+		map.insert(crc32("three"), 3);
+		ass_eq(map.size(), 3);
+		ass_eq(map.at("one"), 1);
+		ass_eq(map.get("two"), 2);
+		ass_eq(map.at(crc32("three")), 3);
+		ass_true(map.contains("two"));
+		ass_true(map.contains(3));
+		ass_false(map.contains("four"));
+
+		// Replaces, does not add.
+		map.insert("one", 11);
+		ass_eq(map.size(), 3);
+		ass_eq(map.at("one"), 11);
+
+		// Grows past its capacity.
+		for (I32 i = 0; i < 1000; i++) {
+			map.insert((OID)(i * 1024), i);
+		}
+		ass_eq(map.size(), 1003);
+		ass_true(map.capacity() >= 1003);
+		for (I32 i = 0; i < 1000; i++) {
+			ass_eq(map.at((OID)(i * 1024)), i);
+		}
+		ass_eq(map.at("two"), 2);
+
+		FINISH_TEST;
+	}
+
+	void testDenseMapRemove() {
+		BEGIN_TEST;
+
+		DenseMap<I32> map(8, -1);
+		std::map<OID, I32> reference;
+		srand(42);
+		for (I32 i = 0; i < 20000; i++) {
+			OID key = (OID)(rand() % 512);
+			I32 action = rand() % 3;
+			if (action == 0) {
+				map.insert(key, i);
+				reference[key] = i;
+			} else if (action == 1) {
+				I32 taken = map.take(key);
+				I32 expected = reference.count(key) ? reference[key] : -1;
+				ass_eq(taken, expected);
+				reference.erase(key);
+			} else {
+				map.remove(key);
+				reference.erase(key);
+			}
+		}
+		ass_eq(map.size(), reference.size());
+		for (OID key = 0; key < 512; key++) {
+			I32 expected = reference.count(key) ? reference[key] : -1;
+			ass_eq(map.at(key), expected);
+		}
+
+		ass_true(map.contains(map.at(reference.begin()->first)));
+		I32 value = reference.begin()->second;
+		map.remove(value);
+		ass_false(map.contains(reference.begin()->first));
+
+		map.clear();
+		ass_true(map.isEmpty());
+		ass_eq(map.at(reference.rbegin()->first), -1);
+
+		FINISH_TEST;
+	}
+
+	void testDenseMapIterateAndRemove() {
+		BEGIN_TEST;
+
+		DenseMap<I32> map(16, -1);
+		for (I32 i = 0; i < 100; i++) {
+			map.insert((OID)i, i);
+		}
+
+		I32 sum = 0;
+		Size visited = 0;
+		for (DenseMap<I32>::Iterator it = map.iterator(); it.isValid(); it.next()) {
+			ass_eq((OID)it.val(), it.key());
+			sum += it.val();
+			visited++;
+			if (it.key() % 2 == 0) {
+				map.remove(it.key());
+			}
+		}
+		ass_eq(visited, 100);
+		ass_eq(sum, 4950);
+		ass_eq(map.size(), 50);
+		for (I32 i = 0; i < 100; i++) {
+			ass_eq(map.contains((OID)i), (i % 2) == 1);
+		}
+
+		FINISH_TEST;
+	}
+
+	void testDenseMapErase() {
+		BEGIN_TEST;
+
+		destroyed_count = 0;
+		DenseMap<TestObject*> map(4, NIL);
+		TestObject* kept = new TestObject(3);
+		map.insert("a", new TestObject(1));
+		map.insert("b", new TestObject(2));
+		map.insert("c", kept);
+		map.insert("d", new TestObject(4));
+
+		map.erase("a");
+		ass_eq(destroyed_count, 1);
+		map.erase(kept);
+		ass_eq(destroyed_count, 2);
+		ass_false(map.contains("c"));
+		ass_eq(map.size(), 2);
+
+		map.eraseAll();
+		ass_eq(destroyed_count, 4);
+		ass_true(map.isEmpty());
+
+		FINISH_TEST;
+	}
+
+	void testDenseMapCopyAndAllocator() {
+		BEGIN_TEST;
+
+		StackMemoryAllocator stack(1 << 20);
+		DenseMap<I32> map(4, -1, &stack);
+		ass_true(map.allocator() == &stack);
+		for (I32 i = 0; i < 100; i++) {
+			map.insert((OID)i, -i);
+		}
+
+		DenseMap<I32> copy(map);
+		map.clear();
+		ass_eq(copy.size(), 100);
+		ass_eq(copy.at(42), -42);
+		ass_eq(copy.at(420), -1);
+
+		DenseMap<I32> assigned;
+		assigned = copy;
+		ass_eq(assigned.size(), 100);
+		ass_eq(assigned.at(99), -99);
+		ass_eq(assigned.nullValue(), -1);
+
+		// When the allocator runs out the map keeps the entries it has.
+		StackMemoryAllocator small(1024);
+		DenseMap<I32> full(4, -1, &small);
+		Size added = 0;
+		while (full.insert((OID)added, (I32)added)) {
+			added++;
+		}
+		ass_true(added > 0);
+		ass_eq(full.size(), added);
+		Boolean reserved = full.reserve(1000);
+		ass_false(reserved);
+		for (Size i = 0; i < added; i++) {
+			ass_eq(full.at((OID)i), (I32)i);
+		}
+
+		FINISH_TEST;
+	}
+
+}
+
+int main(int argc, char** argv) {
+	Cat::testDenseMapBasicCreateAndDestroy();
+	Cat::testDenseMapInsertAndLookup();
+	Cat::testDenseMapRemove();
+	Cat::testDenseMapIterateAndRemove();
+	Cat::testDenseMapErase();
+	Cat::testDenseMapCopyAndAllocator();
+	return 0;
+}
@@ -0,0 +1,66 @@
+#include "core/testcore.h"
+#include "core/util/hashedid.h"
+#include "core/util/map.h"
+#include "core/util/staticmap.h"
+
+namespace Cat {
+
+	void testHashedIDMatchesCrc32() {
+		BEGIN_TEST;
+
+		HashedID worker("worker");
+		ass_eq(worker.id(), crc32("worker"));
+		OID id = worker;
+		ass_eq(id, crc32("worker"));
+#if __cplusplus >= 201103L
+		static_assert("onResize"_id == crc32Const("onResize"), "_id is not hashed at compile time");
+		constexpr OID resize = "onResize"_id;
+		ass_eq(resize, crc32("onResize"));
+#endif
+
+		FINISH_TEST;
+	}
+
+	void testHashedIDMapKeys() {
+		BEGIN_TEST;
+
+		StaticMap<I32> staticMap(8, -1);
+		staticMap.insert("alpha", 1);
+		ass_eq(staticMap.at(HashedID("alpha")), 1);
+		ass_true(staticMap.contains(HashedID("alpha")));
+
+		Map<I32> map(8, -1);
+		map.insert(HashedID("beta"), 2);
+		ass_eq(map.at("beta"), 2);
+#if __cplusplus >= 201103L
+		ass_eq(map.at("beta"_id), 2);
+		ass_eq(staticMap.at("alpha"_id), 1);
+#endif
+
+		FINISH_TEST;
+	}
+
+	void testHashedIDNames() {
+		BEGIN_TEST;
+
+		HashedID name("onClose");
+		ass_eq(name.record(), crc32("onClose"));
+#if defined(DEBUG)
+		const Char* recorded = HashedID::nameOf(crc32("onClose"));
+		ass_true(recorded != NIL && strcmp(recorded, "onClose") == 0);
+		ass_true(HashedID::nameOf(crc32("neverRecorded")) == NIL);
+#else
+		ass_true(HashedID::nameOf(crc32("onClose")) == NIL);
+#endif
+
+		FINISH_TEST;
+	}
+
+}
+
+int main(int argc, char** argv) {
+	Cat::testHashedIDMatchesCrc32();
+	Cat::testHashedIDMapKeys();
+	Cat::testHashedIDNames();
+	return 0;
+}
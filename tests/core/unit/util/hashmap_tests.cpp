@@ -0,0 +1,242 @@
+#include "core/testcore.h"
+#include "core/memory/stackmemoryallocator.h"
+#include "core/util/hashmap.h"
+
+namespace Cat {
+
+	struct CellKey {
+		CellKey() : x(0), y(0) {}
+		CellKey(I32 cx, I32 cy) : x(cx), y(cy) {}
+
+		inline Boolean operator==(const CellKey& rval) const {
+			return x == rval.x && y == rval.y;
+		}
+
+		I32 x, y;
+	};
+
+	struct CellKeyHash {
+		inline U64 operator()(const CellKey& key) const {
+			return hashCombine(HashOf<I32>()(key.x), HashOf<I32>()(key.y));
+		}
+	};
+
+	/* Puts every key in the same bucket, to test the probing. */
+	struct CollidingHash {
+		inline U64 operator()(I32 key) const { return 0; }
+	};
+
+	void testHashMapBasicCreateAndDestroy() {
+		BEGIN_TEST;
+
+		HashMap<I32, I32> map;
+		ass_eq(map.capacity(), 0);
+		ass_eq(map.size(), 0);
+		ass_true(map.isEmpty());
+		ass_eq(map.arrayLength(), 0);
+		ass_true(map.find(3) == NIL);
+		ass_false(map.contains(3));
+
+		HashMap<I32, I32> sized(10, 0.5f);
+		ass_eq(sized.capacity(), 16);
+		ass_eq(sized.loadFactor(), 0.5f);
+		ass_eq(sized.arrayLength(), 32);
+		ass_true(sized.isEmpty());
+
+		HashMap<I32, I32> zero(0);
+		ass_eq(zero.capacity(), 0);
+		ass_eq(zero.arrayLength(), 0);
+
+		FINISH_TEST;
+	}
+
+	void testHashMapInsertFindRemove() {
+		BEGIN_TEST;
+
+		HashMap<I32, I32> map;
+		for (I32 i = 0; i < 1000; i++) {
+			Boolean added = map.insert(i, i*3);
+			ass_true(added);
+		}
+		ass_eq(map.size(), 1000);
+		for (I32 i = 0; i < 1000; i++) {
+			I32* val = map.find(i);
+			ass_true(val != NIL);
+			ass_eq(*val, i*3);
+		}
+		ass_true(map.find(1000) == NIL);
+
+		Boolean added = map.insert(7, -7);
+		ass_false(added);
+		ass_eq(*map.find(7), -7);
+		ass_eq(map.size(), 1000);
+
+		for (I32 i = 0; i < 1000; i += 2) {
+			Boolean removed = map.remove(i);
+			ass_true(removed);
+		}
+		Boolean removed = map.remove(0);
+		ass_false(removed);
+		ass_eq(map.size(), 500);
+		for (I32 i = 0; i < 1000; i++) {
+			ass_eq(map.contains(i), (i % 2) == 1);
+		}
+
+		Size count = 0;
+		for (HashMap<I32, I32>::Iterator it = map.iterator(); it.isValid(); it.next()) {
+			ass_eq(it.key() % 2, 1);
+			count++;
+		}
+		ass_eq(count, 500);
+
+		map.clear();
+		ass_true(map.isEmpty());
+		ass_false(map.contains(1));
+
+		FINISH_TEST;
+	}
+
+	void testHashMapCollisions() {
+		BEGIN_TEST;
+
+		HashMap<I32, I32, CollidingHash> map;
+		for (I32 i = 0; i < 50; i++) {
+			map.insert(i, i);
+		}
+		for (I32 i = 0; i < 50; i += 3) {
+			Boolean removed = map.remove(i);
+			ass_true(removed);
+		}
+		for (I32 i = 0; i < 50; i++) {
+			I32* val = map.find(i);
+			if (i % 3 == 0) {
+				ass_true(val == NIL);
+			} else {
+				ass_true(val != NIL);
+				ass_eq(*val, i);
+			}
+		}
+
+		FINISH_TEST;
+	}
+
+	void testHashMapStringKeys() {
+		BEGIN_TEST;
+
+		HashMap<String, I32> map;
+		map.insert(String("alpha"), 1);
+		map.insert(String("beta"), 2);
+		map.insert(String("gamma"), 3);
+
+		/* Searched with a const Char*, no String is made. */
+		I32* val = map.find("beta");
+		ass_true(val != NIL);
+		ass_eq(*val, 2);
+		ass_true(map.contains("gamma"));
+		ass_false(map.contains("delta"));
+		ass_true(map.contains(String("alpha")));
+
+		Boolean removed = map.remove("alpha");
+		ass_true(removed);
+		ass_false(map.contains("alpha"));
+		ass_eq(map.size(), 2);
+
+		HashMap<String, I32> copy(map);
+		map.clear();
+		ass_eq(copy.size(), 2);
+		ass_eq(*copy.find("gamma"), 3);
+
+		FINISH_TEST;
+	}
+
+	void testHashMapCompositeKeys() {
+		BEGIN_TEST;
+
+		HashMap<CellKey, I32, CellKeyHash> map;
+		for (I32 x = 0; x < 20; x++) {
+			for (I32 y = 0; y < 20; y++) {
+				map.insert(CellKey(x, y), x*100 + y);
+			}
+		}
+		ass_eq(map.size(), 400);
+		ass_eq(*map.find(CellKey(3, 17)), 317);
+		ass_eq(*map.find(CellKey(17, 3)), 1703);
+		ass_true(map.find(CellKey(20, 0)) == NIL);
+
+		FINISH_TEST;
+	}
+
+	void testHashMapReserveAndRehash() {
+		BEGIN_TEST;
+
+		HashMap<I32, I32> map;
+		map.reserve(100);
+		ass_true(map.capacity() >= 100);
+		Size length = map.arrayLength();
+		for (I32 i = 0; i < 100; i++) {
+			map.insert(i, i);
+		}
+		ass_eq(map.arrayLength(), length);
+
+		map.rehash(1000);
+		ass_eq(map.arrayLength(), 1024);
+		ass_eq(map.size(), 100);
+		ass_eq(*map.find(42), 42);
+
+		/* Cannot shrink below what the entries need. */
+		map.rehash(0);
+		ass_eq(map.arrayLength(), 128);
+		ass_eq(map.size(), 100);
+		ass_eq(*map.find(99), 99);
+
+		FINISH_TEST;
+	}
+
+	void testHashMapAllocator() {
+		BEGIN_TEST;
+
+		StackMemoryAllocator stack(1 << 20);
+		HashMap<I32, I32> map(0, HashMap<I32, I32>::kDefaultLoadFactor, &stack);
+		ass_true(map.allocator() == &stack);
+		for (I32 i = 0; i < 100; i++) {
+			map.insert(i, -i);
+		}
+		ass_eq(map.size(), 100);
+		ass_eq(*map.find(50), -50);
+
+		HashMap<I32, I32> other;
+		other.setAllocator(&stack);
+		ass_true(other.allocator() == &stack);
+		other = map;
+		ass_eq(*other.find(99), -99);
+
+		// When the allocator runs out the map keeps the entries it has.
+		StackMemoryAllocator small(1024);
+		HashMap<I32, I32> full(0, HashMap<I32, I32>::kDefaultLoadFactor, &small);
+		I32 added = 0;
+		while (full.insert(added, added)) {
+			added++;
+		}
+		ass_true(added > 0);
+		ass_eq(full.size(), added);
+		Boolean reserved = full.reserve(1000);
+		ass_false(reserved);
+		for (I32 i = 0; i < added; i++) {
+			ass_eq(*full.find(i), i);
+		}
+
+		FINISH_TEST;
+	}
+
+}
+
+int main(int argc, char** argv) {
+	Cat::testHashMapBasicCreateAndDestroy();
+	Cat::testHashMapInsertFindRemove();
+	Cat::testHashMapCollisions();
+	Cat::testHashMapStringKeys();
+	Cat::testHashMapCompositeKeys();
+	Cat::testHashMapReserveAndRehash();
+	Cat::testHashMapAllocator();
+	return 0;
+}
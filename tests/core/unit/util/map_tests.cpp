@@ -1,4 +1,5 @@
 #include "core/testcore.h"
+#include "core/memory/stackmemoryallocator.h"
 #include "core/util/map.h"
 
 namespace cc {
@@ -1773,7 +1774,35 @@ namespace cc {
 		FINISH_TEST;
 	}
 
-	
+	void testMapAllocatorExhausted() {
+		BEGIN_TEST;
+
+		// When the allocator runs out the map keeps the entries it has.
+		StackMemoryAllocator small(2048);
+		Map<I32> map(4, 0, &small);
+		ass_eq(map.capacity(), 4);
+		OID added = 0;
+		while (map.insert(added + 1, (I32)added)) {
+			added++;
+		}
+		ass_true(added >= 4);
+		ass_eq(map.size(), added);
+		Boolean reserved = map.reserve(1000);
+		ass_false(reserved);
+		for (OID i = 0; i < added; i++) {
+			ass_eq(map.get(i + 1), (I32)i);
+		}
+
+		// Too small to create the map at all.
+		StackMemoryAllocator tiny(64);
+		Map<I32> empty(100, 0, &tiny);
+		ass_eq(empty.capacity(), 0);
+		Boolean inserted = empty.insert(1, 1);
+		ass_false(inserted);
+		ass_true(empty.isEmpty());
+
+		FINISH_TEST;
+	}
 
 }
 
@@ -1789,6 +1818,7 @@ int main(int argc, char** argv) {
 	cc::testMapBasicEraseAll();
 	cc::testMapBasicErase();
 	cc::testMapIterator();	
+	cc::testMapAllocatorExhausted();
 	return 0;
 }
 
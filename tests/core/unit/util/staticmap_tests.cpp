@@ -49,7 +49,7 @@ namespace cc {
 		ass_eq(map.loadFactor(), 0.2f);
 		ass_eq(map.size(), 0);
 		ass_true(map.isEmpty());
-		ass_eq(map.arrayLength(), 10);
+		ass_eq(map.arrayLength(), 16);
 		ass_eq(map.nullValue(), 0);
 
 		map = StaticMap<I32>(2, -1);
@@ -73,7 +73,7 @@ namespace cc {
 		ass_eq(map3.loadFactor(), 0.2f);
 		ass_eq(map3.size(), 0);
 		ass_true(map3.isEmpty());
-		ass_eq(map3.arrayLength(), 10);
+		ass_eq(map3.arrayLength(), 16);
 		ass_eq(map3.nullValue(), TestObject(0.0f, 0.0f, 0.0f));
 
 		StaticMap<TestObject>* map4 = new StaticMap<TestObject>(4, TestObject(-1.0f, -1.0f, -1.0f));
@@ -191,7 +191,7 @@ namespace cc {
 		ass_eq(map.loadFactor(), 0.5f);
 		ass_eq(map.size(), 0);
 		ass_true(map.isEmpty());
-		ass_eq(map.arrayLength(), 10);
+		ass_eq(map.arrayLength(), 16);
 		ass_eq(map.nullValue(), nullObj);
 
 		ass_false(map.contains("meow"));
@@ -209,23 +209,23 @@ namespace cc {
 		map.insert("meow", TestObject(1.0f, 2.0f, 3.0f));
 		ass_eq(map.size(), 1);
 		ass_eq(map.capacity(), 5);
-		ass_eq(map.arrayLength(), 10);		
+		ass_eq(map.arrayLength(), 16);		
 		map.insert("moo", moo);
 		ass_eq(map.size(), 2);
 		ass_eq(map.capacity(), 5);
-		ass_eq(map.arrayLength(), 10);
+		ass_eq(map.arrayLength(), 16);
 		map.insert("moo2", moo2);
 		ass_eq(map.size(), 3);
 		ass_eq(map.capacity(), 5);
-		ass_eq(map.arrayLength(), 10);
+		ass_eq(map.arrayLength(), 16);
 		map.insert("meow0", meow0);
 		ass_eq(map.size(), 4);
 		ass_eq(map.capacity(), 5);
-		ass_eq(map.arrayLength(), 10);
+		ass_eq(map.arrayLength(), 16);
 		map.insert("mooo", mooo);
 		ass_eq(map.size(), 5);
 		ass_eq(map.capacity(), 5);
-		ass_eq(map.arrayLength(), 10);
+		ass_eq(map.arrayLength(), 16);
 
 		ass_true(map.contains("meow"));
 		ass_true(map.contains("moo"));
@@ -243,7 +243,7 @@ namespace cc {
 		ass_eq(map.loadFactor(), 0.5f);
 		ass_eq(map.size(), 5);
 		ass_false(map.isEmpty());
-		ass_eq(map.arrayLength(), 10);
+		ass_eq(map.arrayLength(), 16);
 		ass_eq(map.nullValue(), nullObj);		
 			
 		FINISH_TEST;
@@ -266,7 +266,7 @@ namespace cc {
 		ass_eq(map.loadFactor(), 0.5f);
 		ass_eq(map.size(), 0);
 		ass_true(map.isEmpty());
-		ass_eq(map.arrayLength(), 10);
+		ass_eq(map.arrayLength(), 16);
 		ass_eq(map.nullValue(), nullObj);
 
 		ass_false(map.contains("meow"));
@@ -284,23 +284,23 @@ namespace cc {
 		map.insert("meow", 1);
 		ass_eq(map.size(), 1);
 		ass_eq(map.capacity(), 5);
-		ass_eq(map.arrayLength(), 10);		
+		ass_eq(map.arrayLength(), 16);		
 		map.insert("moo", moo);
 		ass_eq(map.size(), 2);
 		ass_eq(map.capacity(), 5);
-		ass_eq(map.arrayLength(), 10);
+		ass_eq(map.arrayLength(), 16);
 		map.insert("moo2", moo2);
 		ass_eq(map.size(), 3);
 		ass_eq(map.capacity(), 5);
-		ass_eq(map.arrayLength(), 10);
+		ass_eq(map.arrayLength(), 16);
 		map.insert("meow0", meow0);
 		ass_eq(map.size(), 4);
 		ass_eq(map.capacity(), 5);
-		ass_eq(map.arrayLength(), 10);
+		ass_eq(map.arrayLength(), 16);
 		map.insert("mooo", mooo);
 		ass_eq(map.size(), 5);
 		ass_eq(map.capacity(), 5);
-		ass_eq(map.arrayLength(), 10);
+		ass_eq(map.arrayLength(), 16);
 
 		ass_true(map.contains("meow"));
 		ass_true(map.contains("moo"));
@@ -318,7 +318,7 @@ namespace cc {
 		ass_eq(map.loadFactor(), 0.5f);
 		ass_eq(map.size(), 5);
 		ass_false(map.isEmpty());
-		ass_eq(map.arrayLength(), 10);
+		ass_eq(map.arrayLength(), 16);
 		ass_eq(map.nullValue(), nullObj);		
 			
 		FINISH_TEST;
@@ -341,20 +341,20 @@ namespace cc {
 		ass_eq(map.loadFactor(), 0.5f);
 		ass_eq(map.size(), 0);
 		ass_true(map.isEmpty());
-		ass_eq(map.arrayLength(), 10);
+		ass_eq(map.arrayLength(), 16);
 		ass_eq(map.nullValue(), nullObj);
 
 		map.insert("meow", TestObject(1.0f, 2.0f, 3.0f));
 		ass_eq(map.size(), 1);
 		ass_eq(map.capacity(), 5);
-		ass_eq(map.arrayLength(), 10);		
+		ass_eq(map.arrayLength(), 16);		
 		map.insert("moo", moo);
 		map.insert("moo2", moo2);
 		map.insert("meow0", meow0);
 		map.insert("mooo", mooo);
 		ass_eq(map.size(), 5);
 		ass_eq(map.capacity(), 5);
-		ass_eq(map.arrayLength(), 10);
+		ass_eq(map.arrayLength(), 16);
 
 		ass_true(map.contains("meow"));
 		ass_true(map.contains("moo"));
@@ -372,7 +372,7 @@ namespace cc {
 		ass_eq(map.loadFactor(), 0.5f);
 		ass_eq(map.size(), 5);
 		ass_false(map.isEmpty());
-		ass_eq(map.arrayLength(), 10);
+		ass_eq(map.arrayLength(), 16);
 		ass_eq(map.nullValue(), nullObj);
 
 		map.insert("Uhoh", TestObject(1.0f, 343.0f, -2323.0f));
@@ -380,7 +380,7 @@ namespace cc {
 		ass_eq(map.loadFactor(), 0.5f);
 		ass_eq(map.size(), 6);
 		ass_false(map.isEmpty());
-		ass_eq(map.arrayLength(), 20);
+		ass_eq(map.arrayLength(), 32);
 		ass_eq(map.nullValue(), nullObj);
 
 
@@ -403,20 +403,20 @@ namespace cc {
 		ass_eq(map.loadFactor(), 0.5f);
 		ass_eq(map.size(), 0);
 		ass_true(map.isEmpty());
-		ass_eq(map.arrayLength(), 10);
+		ass_eq(map.arrayLength(), 16);
 		ass_eq(map.nullValue(), nullObj);
 
 		map.insert("meow", TestObject(1.0f, 2.0f, 3.0f));
 		ass_eq(map.size(), 1);
 		ass_eq(map.capacity(), 5);
-		ass_eq(map.arrayLength(), 10);		
+		ass_eq(map.arrayLength(), 16);		
 		map.insert("moo", moo);
 		map.insert("moo2", moo2);
 		map.insert("meow0", meow0);
 		map.insert("mooo", mooo);
 		ass_eq(map.size(), 5);
 		ass_eq(map.capacity(), 5);
-		ass_eq(map.arrayLength(), 10);
+		ass_eq(map.arrayLength(), 16);
 
 		ass_true(map.contains("meow"));
 		ass_true(map.contains("moo"));
@@ -434,12 +434,12 @@ namespace cc {
 		ass_eq(map.loadFactor(), 0.5f);
 		ass_eq(map.size(), 5);
 		ass_false(map.isEmpty());
-		ass_eq(map.arrayLength(), 10);
+		ass_eq(map.arrayLength(), 16);
 		ass_eq(map.nullValue(), nullObj);
 
 		destroyed_count = 0;		
 		map.clear();
-		ass_eq(destroyed_count, 10);
+		ass_eq(destroyed_count, 0);  /* The null value is assigned in place */
 		ass_false(map.contains("meow"));
 		ass_false(map.contains("moo"));
 		ass_false(map.contains("moo2"));
@@ -456,7 +456,7 @@ namespace cc {
 		ass_eq(map.loadFactor(), 0.5f);
 		ass_eq(map.size(), 0);
 		ass_true(map.isEmpty());
-		ass_eq(map.arrayLength(), 10);
+		ass_eq(map.arrayLength(), 16);
 		ass_eq(map.nullValue(), nullObj);
 
 		map.insert("testing", TestObject(-1.0f, 2.0f, -3.0f));
@@ -464,7 +464,7 @@ namespace cc {
 		ass_eq(map.loadFactor(), 0.5f);
 		ass_eq(map.size(), 1);
 		ass_false(map.isEmpty());
-		ass_eq(map.arrayLength(), 10);
+		ass_eq(map.arrayLength(), 16);
 		ass_eq(map.nullValue(), nullObj);
 
 		ass_true(map.contains("testing"));
@@ -491,20 +491,20 @@ namespace cc {
 		ass_eq(map.loadFactor(), 0.5f);
 		ass_eq(map.size(), 0);
 		ass_true(map.isEmpty());
-		ass_eq(map.arrayLength(), 10);
+		ass_eq(map.arrayLength(), 16);
 		ass_eq(map.nullValue(), nullObj);
 
 		map.insert("meow", new TestObject(1.0f, 2.0f, 3.0f));
 		ass_eq(map.size(), 1);
 		ass_eq(map.capacity(), 5);
-		ass_eq(map.arrayLength(), 10);		
+		ass_eq(map.arrayLength(), 16);		
 		map.insert("moo", moo);
 		map.insert("moo2", moo2);
 		map.insert("meow0", meow0);
 		map.insert("mooo", mooo);
 		ass_eq(map.size(), 5);
 		ass_eq(map.capacity(), 5);
-		ass_eq(map.arrayLength(), 10);
+		ass_eq(map.arrayLength(), 16);
 
 		ass_true(map.contains("meow"));
 		ass_true(map.contains("moo"));
@@ -522,7 +522,7 @@ namespace cc {
 		ass_eq(map.loadFactor(), 0.5f);
 		ass_eq(map.size(), 5);
 		ass_false(map.isEmpty());
-		ass_eq(map.arrayLength(), 10);
+		ass_eq(map.arrayLength(), 16);
 		ass_eq(map.nullValue(), nullObj);
 
 		ass_eq(destroyed_count, 0);		
@@ -544,7 +544,7 @@ namespace cc {
 		ass_eq(map.loadFactor(), 0.5f);
 		ass_eq(map.size(), 0);
 		ass_true(map.isEmpty());
-		ass_eq(map.arrayLength(), 10);
+		ass_eq(map.arrayLength(), 16);
 		ass_eq(map.nullValue(), nullObj);
 
 		map.insert("testing", new TestObject(-1.0f, 2.0f, -3.0f));
@@ -552,7 +552,7 @@ namespace cc {
 		ass_eq(map.loadFactor(), 0.5f);
 		ass_eq(map.size(), 1);
 		ass_false(map.isEmpty());
-		ass_eq(map.arrayLength(), 10);
+		ass_eq(map.arrayLength(), 16);
 		ass_eq(map.nullValue(), nullObj);
 
 		ass_true(map.contains("testing"));
@@ -565,7 +565,7 @@ namespace cc {
 		ass_eq(map.loadFactor(), 0.5f);
 		ass_eq(map.size(), 0);
 		ass_true(map.isEmpty());
-		ass_eq(map.arrayLength(), 10);
+		ass_eq(map.arrayLength(), 16);
 		ass_eq(map.nullValue(), nullObj);
 		
 		FINISH_TEST;
@@ -575,6 +575,52 @@ namespace cc {
 
 
 
+	void testStaticMapRemoveAndReplace() {
+		BEGIN_TEST;
+
+		StaticMap<I32> map(8, -1);
+		map.insert("meow", 1);
+		map.insert("meow", 2);
+		ass_eq(map.size(), 1);
+		ass_eq(map.at("meow"), 2);
+
+		/* The assertions evaluate their arguments twice. */
+		Boolean removed = map.remove("meow");
+		ass_true(removed);
+		removed = map.remove("meow");
+		ass_false(removed);
+		ass_false(map.contains("meow"));
+		ass_eq(map.at("meow"), -1);
+		ass_true(map.isEmpty());
+
+		/* Keys sharing their low bits all probe from the same bucket. */
+		const I32 count = 200;
+		for (I32 i = 1; i <= count; i++) {
+			map.insert((OID)(i << 12), i);
+		}
+		ass_eq(map.size(), count);
+		for (I32 i = 1; i <= count; i += 2) {
+			removed = map.remove((OID)(i << 12));
+			ass_true(removed);
+		}
+		ass_eq(map.size(), count / 2);
+		for (I32 i = 1; i <= count; i++) {
+			ass_eq(map.contains((OID)(i << 12)), (i % 2) == 0);
+			ass_eq(map.at((OID)(i << 12)), (i % 2) == 0 ? i : -1);
+		}
+
+		Size entries = 0;
+		for (Size i = 0; i < map.arrayLength(); i++) {
+			if (map.hasEntryAt(i)) {
+				ass_eq(map.valueAt(i) << 12, (I32)map.keyAt(i));
+				entries++;
+			}
+		}
+		ass_eq(entries, map.size());
+		
+		FINISH_TEST;
+	}
+
 }
 
 int main(int argc, char** argv) {
@@ -585,6 +631,7 @@ int main(int argc, char** argv) {
 	cc::testStaticMapBasicAutoIncreaseCapacity();
 	cc::testStaticMapBasicClear();
 	cc::testStaticMapBasicEraseAll();
+	cc::testStaticMapRemoveAndReplace();
 	return 0;
 }
 